@@ -8,178 +8,54 @@
 #include <SDL/SDL.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "scene.h"
 
 
 /************* CONSTANTES **************/
 
 
-/* Dimensions de la fenêtre */
-static unsigned int WINDOW_WIDTH = 400;
-static unsigned int WINDOW_HEIGHT = 400;
+/* Dimensions de la fenêtre (lues par la scène pour passer du pointeur au repère du dessin) */
+unsigned int WINDOW_WIDTH = 400;
+unsigned int WINDOW_HEIGHT = 400;
 
 /* Nombre de bits par pixel de la fenêtre */
 static const unsigned int BIT_PER_PIXEL = 8;
 
-/* Couleurs RVB (à savoir qu'un unsigned char est relatif à un int) */
-static const unsigned char COLORS[] = {
-     255, 255, 255 ,
-     0, 0, 0 ,
-     255, 0, 0 ,
-     0, 255, 0 ,
-     0, 0, 255 ,
-     255, 255, 0 ,
-     0, 255, 255 ,
-     255, 0, 255
-};
-
-/* Pour avoir les couleurs RVB du points, on prend les 3 valeurs correspondantes à ce point */
-static const unsigned int NB_COLORS = sizeof(COLORS) / (3 * sizeof(unsigned char));
-
-
 /* Nombre minimal de millisecondes separant le rendu de deux images */
 static const Uint32 FRAMERATE_MILLISECONDS = 1000 / 60;
 
+/* Fichier écrit par l'export CSV en arrière-plan */
+static const char* EXPORT_PATH = "scene.csv";
 
-/************** STRUCTURES **************/
+/* Fichier de scène binaire (ouvert au lancement s'il existe, ou passé en argument) */
+static const char* SCENE_PATH = "scene.bin";
 
+/* Archive compressée (touche b) */
+static const char* ARCHIVE_PATH = "scene.sca";
 
-typedef struct Point{
-    float x, y; // Position 2D du point
-    unsigned char r, g, b; // Couleur du point
-    struct Point* next; // Point suivant à dessiner
-} Point, *PointList;
+/* Journal de la sauvegarde automatique, rejoué au lancement après un arrêt brutal */
+static const char* AUTOSAVE_PATH = "autosave.log";
 
-typedef struct Primitive{
-    GLenum primitiveType;
-    PointList points;
-    struct Primitive* next;
-} Primitive, *PrimitiveList;
+/* Mémoire que les morceaux chargés du magasin ne dépassent pas, sauf réglage au lancement (4 Go) */
+static const size_t STORE_BUDGET_BYTES = (size_t)4 << 30;
 
 
 /************** FONCTIONS ***************/
 
 
-/* Création du point, placement dans la liste, dessin et libération de mémoire */
-Point* allocPoint(float x, float y, unsigned char r, unsigned char g, unsigned char b) {
-    Point* point = (Point*)malloc(sizeof(Point));
-
-    if(!point) {
-        printf("Error at point malloc\n");
-        exit(1);
-    }
-
-    point->x = x;
-    point->y = y;
-    point->r = r;
-    point->g = g;
-    point->b = b;
-    point->next = NULL;
-
-    return point;
-}
-
-void addPointToList(Point* point, PointList* list) {
-
-    /* Si ma liste est nulle, j'y place mon point simplement */
-    if(*list == NULL) {
-        *list = point;
-    }
-    /* Sinon j'applique une récusivité pour que mon point se place en fin de liste */
-    else {
-        addPointToList(point, &(*list)->next);
-    }
-
-    return;
-
-}
-
-void drawPoints(PointList list) {
-
-    /* Si ma liste n'est pas vide */
-    while(list) {
-        /* Je colorie le pixel aux coordonnées du point avec la couleur spécifique du point */
-        glColor3ub(list->r, list->g, list->b);
-        glVertex2f(list->x, list->y);
-        list = list->next;
-    }
-    return;
-
-}
- 
-void deletePoints(PointList* list) {
-
-    /* Si ma liste n'est pas vide */
-    while(*list != NULL) {
-        /* Je créée un point* pour enregistrer la valeur suivant à celle que je veux free, je free celle-ci, puis ma liste commence maintenant à ce point* */
-        Point* next = (*list)->next;
-        free(*list);
-        *list = next;
-    }
-
-    return;
-}
-
-/* Création de la primitive, placement dans la liste, dessin et libération de mémoire */
-Primitive* allocPrimitive(GLenum primitiveType) {
-    Primitive* primitive = (Primitive*)malloc(sizeof(Primitive));
-
-    if (!primitive) {
-        printf("Error at primitive malloc\n");
-        exit(1);
-    }
-
-    primitive->primitiveType = primitiveType;
-    primitive->points = NULL;
-    primitive->next = NULL;
-
-    return primitive;
-}
-
-void addPrimitive(Primitive* primitive, PrimitiveList* list){
-
-    /* J'ajoute ma primitive au début de la liste */ 
-    primitive->next = *list;
-    *list = primitive;
-
-    return;
-}
-
-void drawPrimitives(PrimitiveList list){
-
-    while(list) {
-        glBegin(list->primitiveType);
-        drawPoints(list->points);
-        list = list->next;
-        glEnd();
-    }
-
-    return;
-}
-
-/* Je vide d'abord les champs de la primitive puis la primitive de la liste */
-void deletePrimitive(PrimitiveList* list) {
-
-    /* Si ma liste n'est pas vide */
-    while(*list) {
-        Primitive* next = (*list)->next;
-        deletePoints(&(*list)->points);
-        free(*list);
-        *list = next;
-    }
-
-    return;
-}
-
 /* Fonctions qui resize la fenêtre */
 void resize(int w, int h) {
 
     WINDOW_WIDTH = w;
     WINDOW_HEIGHT = h;
     SDL_SetVideoMode(WINDOW_WIDTH, WINDOW_HEIGHT, BIT_PER_PIXEL, SDL_OPENGL | SDL_RESIZABLE);
+    checkVertexBuffers();
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    gluOrtho2D(-1., 1., -1., 1.);
+    gluOrtho2D(ORTHO_LEFT, ORTHO_RIGHT, ORTHO_BOTTOM, ORTHO_TOP);
 
 }
 
@@ -234,25 +110,20 @@ void affichePalette() {
              default:
                 break;
         }
-        glColor3ub(r, g, b);
-        glBegin(GL_QUADS);
-            glVertex2f(-1 + (column_width * i), 1);
-            glVertex2f(-1 + ((i+1) * column_width), 1);
-            glVertex2f(-1 + ((i+1) * column_width), -1);
-            glVertex2f(-1 + (i * column_width), -1);
-        glEnd();
+        float corners[8] = {-1 + (column_width * i), 1,
+                            -1 + ((i+1) * column_width), 1,
+                            -1 + ((i+1) * column_width), -1,
+                            -1 + (i * column_width), -1};
+        queueVertices(GL_QUADS, r, g, b, corners, 4);
     }
 }
 
-/* Fonction qui affiche ma liste passée en paramètre */
-void afficheListe(PrimitiveList list) {
-    PrimitiveList tmp = list;
+/* Fonction qui affiche les statistiques de la scène (une ligne JSON) : les compteurs sont tenus à jour, la liste n'est pas parcourue */
+void afficheListe(void) {
 
-    while (tmp->next != NULL) {
-        printf("Élément dans liste de %u : r : %d  v : %d b : %d : x : %f y : %f \n", tmp->primitiveType, tmp->points->r, tmp->points->g, tmp->points->b, tmp->points->x, tmp->points->y);
-        tmp = tmp->next;
-    }
+    writeSceneStatistics(stdout, STATISTICS_JSON);
 
+    return;
 }
 
 
@@ -262,6 +133,85 @@ void afficheListe(PrimitiveList list) {
 int main(int argc, char** argv) {
     unsigned char color = 0; /* color par défaut : blanc */
     int mode = 0; /* mode dessin par défaut */
+    int tool = 0; /* outil par défaut : crayon (1 pour la gomme, 2 pour la sélection, 3 pour la main levée) */
+    int snap = 0; /* aimant désactivé par défaut : les points ne se collent pas aux points existants */
+    Primitive* selection = NULL; /* primitive sélectionnée, sur laquelle agissent les transformations */
+    const char* scenePath = argc > 1 ? argv[1] : SCENE_PATH; /* fichier de scène ouvert et sauvegardé */
+    const char* ingestPath = NULL; /* flux de points lu en arrière-plan */
+    const char* ringName = NULL; /* nom de l'anneau de points partagé avec un autre processus */
+    SharedRing sharedRing = {NULL, NULL, NULL, 0, NULL, 0}; /* anneau dessiné à chaque image (s'il est ouvert) */
+    const char* storePath = NULL; /* magasin de points sur disque, plus gros que la mémoire */
+    size_t storeBudget = STORE_BUDGET_BYTES; /* mémoire des morceaux chargés du magasin */
+    PointStore pointStore = {NULL}; /* magasin dessiné à chaque image (s'il est ouvert) */
+    int generate = 0; /* 1 pour ouvrir une scène générée plutôt que le fichier de scène */
+    int distribution = GENERATOR_UNIFORM; /* paramètres de la scène générée */
+    unsigned int nbGeneratedPrimitives = 0;
+    unsigned long long nbGeneratedVertices = 0, seed = 0;
+
+    /* Conversion sans fenêtre : -a scene.bin archive.sca compresse, -x archive.sca scene.bin décompresse */
+    if (argc == 4 && (strcmp(argv[1], "-a") == 0 || strcmp(argv[1], "-x") == 0)) {
+        int ok = argv[1][1] == 'a' ? convertSceneFileToArchive(argv[2], argv[3]) : convertArchiveToSceneFile(argv[2], argv[3]);
+        if (!ok) {
+            fprintf(stderr, "Impossible de convertir %s en %s\n", argv[2], argv[3]);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    /* Construction sans fenêtre d'un magasin sur disque : -c scene.bin magasin.ooc (la scène peut dépasser la mémoire) */
+    if (argc == 4 && strcmp(argv[1], "-c") == 0) {
+        if (!buildPointStore(argv[2], argv[3])) {
+            fprintf(stderr, "Impossible de construire %s à partir de %s\n", argv[3], argv[2]);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    /* Scène générée : -g primitives sommets distribution (uniform, clusters ou grid) graine, puis éventuellement le fichier de scène où l'écrire sans ouvrir de fenêtre */
+    if ((argc == 6 || argc == 7) && strcmp(argv[1], "-g") == 0) {
+        if (atoi(argv[2]) <= 0 || !parseDistribution(argv[4], &distribution)) {
+            fprintf(stderr, "Usage : %s -g primitives sommets uniform|clusters|grid graine [scene.bin]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        generate = 1;
+        scenePath = SCENE_PATH;
+        nbGeneratedPrimitives = atoi(argv[2]);
+        nbGeneratedVertices = strtoull(argv[3], NULL, 10);
+        seed = strtoull(argv[5], NULL, 10);
+        if (argc == 7) {
+            PrimitiveList generated = NULL;
+            Uint32 start = SDL_GetTicks();
+            unsigned long long nbVertices = generateScene(&generated, nbGeneratedPrimitives, nbGeneratedVertices, distribution, seed);
+            printf("Scène générée : %u primitives, %llu sommets en %u ms\n", nbGeneratedPrimitives, nbVertices, SDL_GetTicks() - start);
+            if (!saveSceneFile(generated, argv[6])) {
+                fprintf(stderr, "Impossible d'écrire %s\n", argv[6]);
+                return EXIT_FAILURE;
+            }
+            resetScene(&generated);
+            freeArena(&sceneArena);
+            return EXIT_SUCCESS;
+        }
+    }
+    /* Producteur de démonstration pour l'anneau partagé d'un autre processus lancé avec -s */
+    if (argc == 3 && strcmp(argv[1], "-p") == 0) {
+        return runSharedRingProducer(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    /* Lecture en flux : -i suivi d'un fichier, d'un tube nommé ou de - pour l'entrée standard (points en texte ou en binaire, tracés SVG ou CSV), puis éventuellement du fichier de scène */
+    if (argc > 2 && strcmp(argv[1], "-i") == 0) {
+        ingestPath = argv[2];
+        scenePath = argc > 3 ? argv[3] : SCENE_PATH;
+    }
+    /* Anneau partagé : -s suivi de son nom (par exemple /imac), puis éventuellement du fichier de scène */
+    else if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+        ringName = argv[2];
+        scenePath = argc > 3 ? argv[3] : SCENE_PATH;
+    }
+    /* Magasin sur disque : -o suivi du fichier, puis éventuellement de la mémoire à lui consacrer (en Mo) et du fichier de scène */
+    else if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+        storePath = argv[2];
+        if (argc > 3 && atoi(argv[3]) > 0) {
+            storeBudget = (size_t)atoi(argv[3]) << 20;
+        }
+        scenePath = argc > 4 ? argv[4] : SCENE_PATH;
+    }
 
     /* Initialisation de la SDL */
     if(-1 == SDL_Init(SDL_INIT_VIDEO)) {
@@ -273,6 +223,36 @@ int main(int argc, char** argv) {
     PrimitiveList primList = NULL;
     addPrimitive(allocPrimitive(GL_POINTS), &primList);
 
+    /* Une scène générée remplace tout. Sinon, après un arrêt brutal le journal de sauvegarde automatique est rejoué, ou le dessin sauvegardé est rouvert */
+    /* (seuls les points dessinés du fichier de scène seront lus sur le disque) */
+    if (generate) {
+        Uint32 start = SDL_GetTicks();
+        unsigned long long nbVertices = generateScene(&primList, nbGeneratedPrimitives, nbGeneratedVertices, distribution, seed);
+        printf("Scène générée : %u primitives, %llu sommets en %u ms\n", nbGeneratedPrimitives, nbVertices, SDL_GetTicks() - start);
+    }
+    else if (replayAutosave(AUTOSAVE_PATH, &primList)) {
+        printf("Dessin récupéré depuis %s\n", AUTOSAVE_PATH);
+    }
+    else if (loadSceneFile(scenePath, &primList) || loadSceneArchive(scenePath, &primList)) {
+        printf("Scène ouverte depuis %s\n", scenePath);
+    }
+    /* Chaque modification part ensuite dans le journal, écrit par un fil de fond */
+    if (!startAutosave(primList, AUTOSAVE_PATH)) {
+        printf("Impossible de lancer la sauvegarde automatique\n");
+    }
+    /* Les points du flux arrivent ensuite dans la primitive courante, au fil des images */
+    if (ingestPath && !startIngest(ingestPath)) {
+        printf("Impossible d'ouvrir %s\n", ingestPath);
+    }
+    /* Les points de l'anneau sont dessinés à chaque image par-dessus la scène, sans passer par elle */
+    if (ringName && !openSharedRing(&sharedRing, ringName, 1)) {
+        printf("Impossible d'ouvrir l'anneau %s\n", ringName);
+    }
+    /* Les points du magasin sont lus par un fil de fond au gré de la caméra, et dessinés par-dessus la scène */
+    if (storePath && !openPointStore(&pointStore, storePath, storeBudget)) {
+        printf("Impossible d'ouvrir le magasin %s\n", storePath);
+    }
+
     /* Ouverture d'une fenêtre et création d'un contexte OpenGL */
     if(NULL == SDL_SetVideoMode(WINDOW_WIDTH, WINDOW_HEIGHT, BIT_PER_PIXEL, SDL_OPENGL | SDL_GL_DOUBLEBUFFER | SDL_RESIZABLE)) {
         fprintf(stderr, "Impossible d'ouvrir la fenetre. Fin du programme.\n");
@@ -291,7 +271,15 @@ int main(int argc, char** argv) {
         /* Récupération du temps au début de la boucle */
         Uint32 startTime = SDL_GetTicks();
 
+        /* Les instantanés rendus par les fils de fond sont libérés, avec la mémoire qu'ils étaient seuls à lire */
+        collectSnapshots();
+        autosaveTick(primList);
+        drainIngest(&primList);
+
         glClear(GL_COLOR_BUFFER_BIT);
+
+        /* La caméra ne s'applique qu'au dessin, la palette garde le cadre fixe du TD */
+        applyCamera(mode == 0);
         
         /* Choix du mode pour le dessin, 1 pour palette et 0 pour dessin */
         if (mode == 1) {
@@ -300,8 +288,16 @@ int main(int argc, char** argv) {
         else {
             /* Mode dessin */
             drawPrimitives(primList);
+            drawSharedRing(&sharedRing);
+            drawPointStore(&pointStore);
+            if (selection) {
+                drawBoundingBox(&selection->points.box);
+            }
         }
-        
+
+        /* Fin de l'image : la file de rendu (palette) est dessinée */
+        flushRenderQueue();
+        endStreamFrame();
         SDL_GL_SwapBuffers();
 
         /* Boucle traitant les evenements */
@@ -319,13 +315,59 @@ int main(int argc, char** argv) {
                 /* Clic souris */
                 case SDL_MOUSEBUTTONUP:
 
+                    /* La molette et le bouton du milieu servent à la caméra */
+                    if (e.button.button == SDL_BUTTON_MIDDLE || e.button.button == SDL_BUTTON_WHEELUP || e.button.button == SDL_BUTTON_WHEELDOWN) {
+                        break;
+                    }
                     if (mode == 1) {
                         /* On modifie la couleur par défaut */
                         color = e.button.x * NB_COLORS / WINDOW_WIDTH;
                     }
                     else {
-                        /* En mode dessin on ajoute un point dans la liste de la primitive courante */
-                        addPointToList(allocPoint(-1 + 2. * e.button.x / WINDOW_WIDTH, - (-1 + 2. * e.button.y / WINDOW_HEIGHT), COLORS[color * 3], COLORS[color * 3 + 1], COLORS[color * 3 + 2]), &primList->points);
+                        float x, y;
+                        float radius = (ORTHO_RIGHT - ORTHO_LEFT) / 40.;
+                        windowToWorld(e.button.x, e.button.y, &x, &y);
+                        if (stroke.list || tool == 3) {
+                            /* Le trait à main levée se termine au relâchement du bouton */
+                            endStroke();
+                        }
+                        else if (tool == 1) {
+                            /* La gomme enlève les points autour du clic */
+                            erasePoints(primList, x, y, radius);
+                        }
+                        else if (tool == 2) {
+                            /* La sélection prend la primitive du point le plus proche (ou rien) */
+                            selection = selectPrimitive(primList, x, y, radius);
+                        }
+                        else {
+                            /* Avec l'aimant, le point se colle au point existant le plus proche */
+                            PointList* nearestList;
+                            unsigned int nearestIndex;
+                            if (snap && findNearestPoint(primList, x, y, radius, &nearestList, &nearestIndex)) {
+                                Point nearest = getPoint(nearestList, nearestIndex);
+                                x = nearest.x;
+                                y = nearest.y;
+                            }
+                            /* En mode dessin on ajoute un point dans la liste de la primitive courante */
+                            addPointToList(allocPoint(x, y, COLORS[color * 3], COLORS[color * 3 + 1], COLORS[color * 3 + 2]), &primList->points);
+                            journalAddPoint(&primList->points, 0);
+                        }
+                    }
+                    break;
+
+                /* La molette zoome autour du pointeur, le bouton gauche commence un trait à main levée */
+                case SDL_MOUSEBUTTONDOWN:
+                    if (e.button.button == SDL_BUTTON_LEFT && mode == 0 && tool == 3) {
+                        float x, y;
+                        windowToWorld(e.button.x, e.button.y, &x, &y);
+                        /* Les points plus proches qu'un pixel à l'écran ne sont pas gardés */
+                        beginStroke(&primList->points, allocPoint(x, y, COLORS[color * 3], COLORS[color * 3 + 1], COLORS[color * 3 + 2]), (ORTHO_RIGHT - ORTHO_LEFT) / (camera.zoom * WINDOW_WIDTH));
+                    }
+                    else if (e.button.button == SDL_BUTTON_WHEELUP) {
+                        zoomCamera(1.25, e.button.x, e.button.y);
+                    }
+                    else if (e.button.button == SDL_BUTTON_WHEELDOWN) {
+                        zoomCamera(1 / 1.25, e.button.x, e.button.y);
                     }
                     break;
 
@@ -333,16 +375,125 @@ int main(int argc, char** argv) {
                 case SDL_KEYDOWN:
                     switch(e.key.keysym.sym) {
                         case SDLK_a:
-                            afficheListe(primList);
+                            afficheListe();
+                            printSharedRing(&sharedRing);
+                            printPointStore(&pointStore);
                             break;
                         case SDLK_l:
                             addPrimitive(allocPrimitive(GL_LINES), &primList);
+                            journalAddPrimitive(primList);
                             break;
                         case SDLK_p:
                             addPrimitive(allocPrimitive(GL_POINTS), &primList);
+                            journalAddPrimitive(primList);
                             break; 
                         case SDLK_t:
                             addPrimitive(allocPrimitive(GL_TRIANGLES), &primList);
+                            journalAddPrimitive(primList);
+                            break;
+                        case SDLK_s:
+                            addPrimitive(allocPrimitive(GL_LINE_STRIP), &primList);
+                            journalAddPrimitive(primList);
+                            break;
+                        /* Passe les primitives terminées au format compact (la primitive courante reste flottante) */
+                        case SDLK_k:
+                            compactPrimitives(primList->next);
+                            break;
+                        /* Flèches : déplace la sélection (ou tout le dessin) d'un vingtième de la largeur du repère */
+                        case SDLK_UP:
+                        case SDLK_DOWN:
+                        case SDLK_LEFT:
+                        case SDLK_RIGHT:
+                            {
+                                float step = (ORTHO_RIGHT - ORTHO_LEFT) / 20.;
+                                float tx = e.key.keysym.sym == SDLK_LEFT ? -step : (e.key.keysym.sym == SDLK_RIGHT ? step : 0);
+                                float ty = e.key.keysym.sym == SDLK_DOWN ? -step : (e.key.keysym.sym == SDLK_UP ? step : 0);
+                                transformSelection(primList, selection, 1, 0, 0, 1, tx, ty);
+                            }
+                            break;
+                        /* Page haut / page bas : agrandit ou rétrécit la sélection (ou tout le dessin) autour du centre de sa boîte englobante, o : le tourne de 15 degrés */
+                        case SDLK_PAGEUP:
+                        case SDLK_PAGEDOWN:
+                        case SDLK_o:
+                            {
+                                BoundingBox box;
+                                if (boundingBoxSelection(primList, selection, &box)) {
+                                    float cx = (box.minX + box.maxX) / 2;
+                                    float cy = (box.minY + box.maxY) / 2;
+                                    float scale = e.key.keysym.sym == SDLK_PAGEUP ? 1.1 : 1 / 1.1;
+                                    if (e.key.keysym.sym == SDLK_o) {
+                                        float cosAngle = cos(15 * M_PI / 180.);
+                                        float sinAngle = sin(15 * M_PI / 180.);
+                                        transformSelection(primList, selection, cosAngle, -sinAngle, sinAngle, cosAngle, cx - cosAngle * cx + sinAngle * cy, cy - sinAngle * cx - cosAngle * cy);
+                                    }
+                                    else {
+                                        transformSelection(primList, selection, scale, 0, 0, scale, cx - scale * cx, cy - scale * cy);
+                                    }
+                                }
+                            }
+                            break;
+                        /* Choix de l'outil : d pour le crayon, e pour la gomme, v pour la sélection, f pour la main levée */
+                        case SDLK_d:
+                            tool = 0;
+                            break;
+                        case SDLK_e:
+                            tool = 1;
+                            break;
+                        case SDLK_v:
+                            tool = 2;
+                            selection = NULL;
+                            break;
+                        case SDLK_f:
+                            tool = 3;
+                            break;
+                        /* Active ou désactive l'aimant */
+                        case SDLK_n:
+                            snap = !snap;
+                            break;
+                        /* Passe du rendu par tampons au mode immédiat (glBegin/glVertex) et inversement, pour les comparer */
+                        case SDLK_g:
+                            renderBackend = renderBackend == RENDER_BUFFERS ? RENDER_IMMEDIATE : RENDER_BUFFERS;
+                            printf("Rendu %s\n", renderBackend == RENDER_BUFFERS ? "par tampons" : "immédiat");
+                            break;
+                        /* Exporte la scène en CSV en arrière-plan, sans arrêter le dessin */
+                        case SDLK_x:
+                            if (startExport(primList, writeSceneCSV, EXPORT_PATH)) {
+                                printf("Export de la scène dans %s\n", EXPORT_PATH);
+                            }
+                            else {
+                                printf("Un export est déjà en cours\n");
+                            }
+                            break;
+                        /* Sauvegarde la scène au format binaire en arrière-plan */
+                        case SDLK_w:
+                            if (startExport(primList, saveSceneFile, scenePath)) {
+                                printf("Sauvegarde de la scène dans %s\n", scenePath);
+                            }
+                            else {
+                                printf("Un export est déjà en cours\n");
+                            }
+                            break;
+                        /* Archive compressée de la scène en arrière-plan (à rouvrir en la passant en argument) */
+                        case SDLK_b:
+                            if (startExport(primList, saveSceneArchive, ARCHIVE_PATH)) {
+                                printf("Archivage de la scène dans %s\n", ARCHIVE_PATH);
+                            }
+                            else {
+                                printf("Un export est déjà en cours\n");
+                            }
+                            break;
+                        /* Recharge la dernière sauvegarde */
+                        case SDLK_c:
+                            if (loadSceneFile(scenePath, &primList) || loadSceneArchive(scenePath, &primList)) {
+                                selection = NULL;
+                            }
+                            else {
+                                printf("Impossible d'ouvrir %s\n", scenePath);
+                            }
+                            break;
+                        /* Début : la caméra revient sur le cadre de départ */
+                        case SDLK_HOME:
+                            resetCamera();
                             break;
                         case SDLK_q:
                             loop = 0;
@@ -352,12 +503,18 @@ int main(int argc, char** argv) {
                             break;
                         /* Reset le dessin (vide les listes puis réalloue) */
                         case SDLK_r:
-                            deletePrimitive(&primList);
+                            resetScene(&primList);
+                            selection = NULL;
                             addPrimitive(allocPrimitive(GL_POINTS), &primList);
                             break; 
-                        /* Comme un ctrl + z mais possible qu'une fois pour le dernier élément */
+                        /* z annule la dernière étape, y refait la dernière étape annulée (sur plusieurs centaines de niveaux) */
                         case SDLK_z:
-                            deletePoints(&primList->points);
+                            undo(&primList);
+                            selection = NULL;
+                            break;
+                        case SDLK_y:
+                            redo(&primList);
+                            selection = NULL;
                             break;  
                         default:
                             mode = 0;
@@ -372,6 +529,18 @@ int main(int argc, char** argv) {
                     }
                     break;
 
+                /* Le bouton du milieu maintenu fait glisser le canevas, le bouton gauche prolonge le trait à main levée */
+                case SDL_MOUSEMOTION:
+                    if (e.motion.state & SDL_BUTTON(SDL_BUTTON_MIDDLE)) {
+                        panCamera(e.motion.xrel, e.motion.yrel);
+                    }
+                    if (stroke.list && (e.motion.state & SDL_BUTTON(SDL_BUTTON_LEFT))) {
+                        float x, y;
+                        windowToWorld(e.motion.x, e.motion.y, &x, &y);
+                        addStrokePoint(allocPoint(x, y, COLORS[color * 3], COLORS[color * 3 + 1], COLORS[color * 3 + 2]));
+                    }
+                    break;
+
                 /*case SDL_MOUSEMOTION:
                     printf("mouvement en (%d, %d)\n", e.motion.x, e.motion.y);
                     float rouge,vert,bleu;
@@ -397,8 +566,14 @@ int main(int argc, char** argv) {
             SDL_Delay(FRAMERATE_MILLISECONDS - elapsedTime);
         }
     }
-    /* Libération de la mémoire */
-    deletePrimitive(&primList);
+    /* Libération de la mémoire : la lecture en flux, l'anneau partagé, le magasin sur disque, la sauvegarde automatique et l'export en cours se terminent, la scène est oubliée puis les blocs du tas sont rendus au système */
+    finishIngest();
+    closeSharedRing(&sharedRing);
+    closePointStore(&pointStore);
+    finishAutosave();
+    finishExport();
+    resetScene(&primList);
+    freeArena(&sceneArena);
 
     /* Liberation des ressources associées à la SDL */ 
     SDL_Quit();
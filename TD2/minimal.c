@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <time.h>
+#include "render.h"
 
 
 /************* CONSTANTES **************/
@@ -185,6 +186,7 @@ void resize(int w, int h) {
     WINDOW_WIDTH = w;
     WINDOW_HEIGHT = h;
     SDL_SetVideoMode(WINDOW_WIDTH, WINDOW_HEIGHT, BIT_PER_PIXEL, SDL_OPENGL | SDL_RESIZABLE);
+    checkStreamRing();
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
@@ -244,13 +246,11 @@ void affichePalette() {
              default:
                 break;
         }
-        glColor3ub(r, g, b);
-        glBegin(GL_QUADS);
-            glVertex2f(-1 + (column_width * i), 1);
-            glVertex2f(-1 + ((i+1) * column_width), 1);
-            glVertex2f(-1 + ((i+1) * column_width), -1);
-            glVertex2f(-1 + (i * column_width), -1);
-        glEnd();
+        float corners[8] = {-1 + (column_width * i), 1,
+                            -1 + ((i+1) * column_width), 1,
+                            -1 + ((i+1) * column_width), -1,
+                            -1 + (i * column_width), -1};
+        queueVertices(GL_QUADS, r, g, b, corners, 4);
     }
 }
 
@@ -269,30 +269,18 @@ void afficheListe(PrimitiveList list) {
 /* Fonction qui me crée un carré de côté 1 et de couleur passée en paramètre (ici rose, parce que c'est joli) */
 void drawSquare(float x, float y, int r, int g, int b, int full) {
 
-    if (full == 0) {
-        glColor3ub(r, g, b);
-        glBegin(GL_LINES);
-            glVertex2f(x-0.5, y-0.5);
-            glVertex2f(x-0.5, y+0.5);
-
-            glVertex2f(x+0.5, y+0.5);
-            glVertex2f(x+0.5, y-0.5);
+    /* Les côtés deux à deux pour le contour, les quatre coins pour le carré plein : déposés dans la file de rendu */
+    float outline[16] = {x-0.5, y-0.5, x-0.5, y+0.5,
+                         x+0.5, y+0.5, x+0.5, y-0.5,
+                         x-0.5, y+0.5, x+0.5, y+0.5,
+                         x-0.5, y-0.5, x+0.5, y-0.5};
+    float corners[8] = {x-0.5, y-0.5, x-0.5, y+0.5, x+0.5, y+0.5, x+0.5, y-0.5};
 
-            glVertex2f(x-0.5, y+0.5);
-            glVertex2f(x+0.5, y+0.5);
-
-            glVertex2f(x-0.5, y-0.5);
-            glVertex2f(x+0.5, y-0.5);
-        glEnd();
+    if (full == 0) {
+        queueVertices(GL_LINES, r, g, b, outline, 8);
     }
     else {
-        glColor3ub(r, g, b);
-        glBegin(GL_QUADS);
-            glVertex2f(x-0.5, y-0.5);
-            glVertex2f(x-0.5, y+0.5);
-            glVertex2f(x+0.5, y+0.5);
-            glVertex2f(x+0.5, y-0.5);
-        glEnd();
+        queueVertices(GL_QUADS, r, g, b, corners, 4);
     }
 
 }
@@ -300,46 +288,40 @@ void drawSquare(float x, float y, int r, int g, int b, int full) {
 /* Fonction qui me crée un repère centré : segment de taille 1 et rouge en abscisse avec pour ordonné un segment vert de taille 1 */
 void drawLandmark() {
 
+    float abscissa[4] = {-0.5, 0., 0.5, 0.};
+    float ordinate[4] = {0, -0.5, 0, 0.5};
+
     /* Abscisses */
-    glColor3ub(255, 0, 0);
-    glBegin(GL_LINES);
-        glVertex2f(-0.5, 0.);
-        glVertex2f(0.5, 0.);
-    glEnd();
+    queueVertices(GL_LINES, 255, 0, 0, abscissa, 2);
     /* Ordonnées */
-    glColor3ub(0, 255, 0);
-    glBegin(GL_LINES);
-        glVertex2f(0, -0.5);
-        glVertex2f(0, 0.5);
-    glEnd();
+    queueVertices(GL_LINES, 0, 255, 0, ordinate, 2);
 
 }
 
 /* Fonction qui me crée un cercle de diamètre 1 : LINE_STRIP si vide et TRIANGLE_FAN si plein */
 void drawCircle(int full) {
-    int i;
+    unsigned int i;
+    float positions[2 * (NB_SEGMENT + 2)]; // Centre (cercle plein) puis les NB_SEGMENT + 1 points du tour
 
-    glColor3ub(255, 200, 100);
     float angle = 3.14*2; // correspond à 2 PI, soit un tour de cercle
 
     if (full == 0) {
-        glBegin(GL_LINE_STRIP);
-
         for (i = 0 ; i <= NB_SEGMENT ; i++) {
             float new_angle = angle*i/NB_SEGMENT;
-            glVertex2f(cos(new_angle)*0.5, sin(new_angle)*0.5); // 0.5 de rayon       
+            positions[i*2] = cos(new_angle)*0.5; // 0.5 de rayon
+            positions[i*2+1] = sin(new_angle)*0.5;
         }
-        glEnd();  
+        queueVertices(GL_LINE_STRIP, 255, 200, 100, positions, NB_SEGMENT + 1);
     }
 
     else {
-        glBegin(GL_TRIANGLE_FAN);
-
-        glVertex2f(0, 0); // centre du cercle
+        positions[0] = 0; // centre du cercle
+        positions[1] = 0;
         for (i = 0 ; i <= NB_SEGMENT ; i++) { 
-            glVertex2f(0.5*(cos(i*angle/NB_SEGMENT)), (0.5*sin(i*angle/NB_SEGMENT)));
+            positions[i*2+2] = 0.5*(cos(i*angle/NB_SEGMENT));
+            positions[i*2+3] = 0.5*sin(i*angle/NB_SEGMENT);
         }
-        glEnd();
+        queueVertices(GL_TRIANGLE_FAN, 255, 200, 100, positions, NB_SEGMENT + 2);
     }
 }
 
@@ -395,6 +377,7 @@ int main(int argc, char** argv) {
             /* Mode dessin */
             drawPrimitives(primList);
             /* Carré jaune qui a subi toutes les questions */
+            renderQueue.layer = 0;
             drawSquare(0, 0, 255, 255, 0, full);
 
             /* Cercle translater */
@@ -414,15 +397,22 @@ int main(int argc, char** argv) {
             glTranslatef(2,0,0);
             drawSquare(0, 0, 255, 0, 200, full);
             glLoadIdentity();*/
-            /* Carré bleu qui bouge aléatoirement dans la fenêtre */
+            /* Carré bleu qui bouge aléatoirement dans la fenêtre (par-dessus le jaune, puis le repère par-dessus les deux) */
+            renderQueue.layer = 1;
             glMatrixMode(GL_MODELVIEW);
             glTranslatef(rand() % (MAX - MIN + 1) - MIN, rand() % (MAX - MIN + 1) - MIN, 0);
             drawSquare(0, 0, 0, 0, 255, full);
             glLoadIdentity();
 
+            renderQueue.layer = 2;
             drawLandmark();
         }
 
+        /* Fin du dessin : la file de rendu est triée et dessinée avant les évènements, qui peuvent changer la projection, puis la part de l'anneau
+           qu'elle a remplie est protégée jusqu'à la fin de son dessin */
+        flushRenderQueue();
+        endStreamFrame();
+
         /* Boucle traitant les evenements */
         SDL_Event e;
         while(SDL_PollEvent(&e)) {
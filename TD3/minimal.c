@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <time.h>
+#include "render.h"
 
 
 /************* CONSTANTES **************/
@@ -185,6 +186,7 @@ void resize(int w, int h) {
     WINDOW_WIDTH = w;
     WINDOW_HEIGHT = h;
     SDL_SetVideoMode(WINDOW_WIDTH, WINDOW_HEIGHT, BIT_PER_PIXEL, SDL_OPENGL | SDL_RESIZABLE);
+    checkStreamRing();
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
@@ -242,13 +244,11 @@ void affichePalette() {
              default:
                 break;
         }
-        glColor3ub(r, g, b);
-        glBegin(GL_QUADS);
-            glVertex2f(-1 + (column_width * i), 1);
-            glVertex2f(-1 + ((i+1) * column_width), 1);
-            glVertex2f(-1 + ((i+1) * column_width), -1);
-            glVertex2f(-1 + (i * column_width), -1);
-        glEnd();
+        float corners[8] = {-1 + (column_width * i), 1,
+                            -1 + ((i+1) * column_width), 1,
+                            -1 + ((i+1) * column_width), -1,
+                            -1 + (i * column_width), -1};
+        queueVertices(GL_QUADS, r, g, b, corners, 4);
     }
 }
 
@@ -267,30 +267,18 @@ void afficheListe(PrimitiveList list) {
 /* Fonction qui me crée un carré de côté 1 et de couleur passée en paramètre (ici rose, parce que c'est joli) */
 void drawSquare(float x, float y, int r, int g, int b, int full) {
 
-    if (full == 0) {
-        glColor3ub(r, g, b);
-        glBegin(GL_LINES);
-            glVertex2f(x-0.5, y-0.5);
-            glVertex2f(x-0.5, y+0.5);
-
-            glVertex2f(x+0.5, y+0.5);
-            glVertex2f(x+0.5, y-0.5);
+    /* Les côtés deux à deux pour le contour, les quatre coins pour le carré plein : déposés dans la file de rendu */
+    float outline[16] = {x-0.5, y-0.5, x-0.5, y+0.5,
+                         x+0.5, y+0.5, x+0.5, y-0.5,
+                         x-0.5, y+0.5, x+0.5, y+0.5,
+                         x-0.5, y-0.5, x+0.5, y-0.5};
+    float corners[8] = {x-0.5, y-0.5, x-0.5, y+0.5, x+0.5, y+0.5, x+0.5, y-0.5};
 
-            glVertex2f(x-0.5, y+0.5);
-            glVertex2f(x+0.5, y+0.5);
-
-            glVertex2f(x-0.5, y-0.5);
-            glVertex2f(x+0.5, y-0.5);
-        glEnd();
+    if (full == 0) {
+        queueVertices(GL_LINES, r, g, b, outline, 8);
     }
     else {
-        glColor3ub(r, g, b);
-        glBegin(GL_QUADS);
-            glVertex2f(x-0.5, y-0.5);
-            glVertex2f(x-0.5, y+0.5);
-            glVertex2f(x+0.5, y+0.5);
-            glVertex2f(x+0.5, y-0.5);
-        glEnd();
+        queueVertices(GL_QUADS, r, g, b, corners, 4);
     }
 
 }
@@ -298,46 +286,40 @@ void drawSquare(float x, float y, int r, int g, int b, int full) {
 /* Fonction qui me crée un repère centré : segment de taille 1 et rouge en abscisse avec pour ordonné un segment vert de taille 1 */
 void drawLandmark() {
 
+    float abscissa[4] = {-5, 0., 5, 0.};
+    float ordinate[4] = {0, -5, 0, 5};
+
     /* Abscisses */
-    glColor3ub(255, 0, 0);
-    glBegin(GL_LINES);
-        glVertex2f(-5, 0.);
-        glVertex2f(5, 0.);
-    glEnd();
+    queueVertices(GL_LINES, 255, 0, 0, abscissa, 2);
     /* Ordonnées */
-    glColor3ub(0, 255, 0);
-    glBegin(GL_LINES);
-        glVertex2f(0, -5);
-        glVertex2f(0, 5);
-    glEnd();
+    queueVertices(GL_LINES, 0, 255, 0, ordinate, 2);
 
 }
 
 /* Fonction qui me crée un cercle de diamètre 1 : LINE_STRIP si vide et TRIANGLE_FAN si plein */
 void drawCircle(int full) {
-    int i;
+    unsigned int i;
+    float positions[2 * (NB_SEGMENT + 2)]; // Centre (cercle plein) puis les NB_SEGMENT + 1 points du tour
 
-    glColor3ub(0, 255, 255);
     float angle = M_PI*2; // correspond à 2 PI, soit un tour de cercle
 
     if (full == 0) {
-        glBegin(GL_LINE_STRIP);
-
         for (i = 0 ; i <= NB_SEGMENT ; i++) {
             float new_angle = angle*i/NB_SEGMENT;
-            glVertex2f(cos(new_angle)*0.5, sin(new_angle)*0.5); // 0.5 de rayon       
+            positions[i*2] = cos(new_angle)*0.5; // 0.5 de rayon
+            positions[i*2+1] = sin(new_angle)*0.5;
         }
-        glEnd();  
+        queueVertices(GL_LINE_STRIP, 0, 255, 255, positions, NB_SEGMENT + 1);
     }
 
     else {
-        glBegin(GL_TRIANGLE_FAN);
-
-        glVertex2f(0, 0); // centre du cercle
+        positions[0] = 0; // centre du cercle
+        positions[1] = 0;
         for (i = 0 ; i <= NB_SEGMENT ; i++) { 
-            glVertex2f(0.5*(cos(i*angle/NB_SEGMENT)), (0.5*sin(i*angle/NB_SEGMENT)));
+            positions[i*2+2] = 0.5*(cos(i*angle/NB_SEGMENT));
+            positions[i*2+3] = 0.5*sin(i*angle/NB_SEGMENT);
         }
-        glEnd();
+        queueVertices(GL_TRIANGLE_FAN, 0, 255, 255, positions, NB_SEGMENT + 2);
     }
 }
 
@@ -383,7 +365,7 @@ void drawRoundedSquare() {
 GLuint createFirstArmIDList() {
 
     GLuint id = glGenLists(1);
-    glNewList(id, GL_COMPILE);
+    beginDisplayList(id);
 
         /* Petit cercle de rayon 10 */
         glPushMatrix();
@@ -404,7 +386,7 @@ GLuint createFirstArmIDList() {
             glVertex2f(60, -10);
         glEnd();
 
-    glEndList();
+    endDisplayList();
 
     return id;
 }
@@ -413,7 +395,7 @@ GLuint createFirstArmIDList() {
 GLuint createSecondArmIDList() {
 
     GLuint id = glGenLists(1);
-    glNewList(id, GL_COMPILE);
+    beginDisplayList(id);
 
         /* Deux carrés séparés de 50 unités soit 50cm pour 10u/10cm */
         /* 1er carré à bouts arrondis de côté 10 */
@@ -435,7 +417,7 @@ GLuint createSecondArmIDList() {
             drawSquare(0,0,0,255,255,1);
         glPopMatrix();
 
-    glEndList();
+    endDisplayList();
 
     return id;
  }
@@ -444,7 +426,7 @@ GLuint createSecondArmIDList() {
 GLuint createThirdArmIDList() {
 
     GLuint id = glGenLists(1);
-    glNewList(id, GL_COMPILE);
+    beginDisplayList(id);
 
         /* Carré de côté 6 */
         glPushMatrix();
@@ -466,7 +448,7 @@ GLuint createThirdArmIDList() {
             drawSquare(0,0,0,255,255,1);
         glPopMatrix();
 
-   glEndList();
+   endDisplayList();
 
    return id;
 }
@@ -553,6 +535,8 @@ int main(int argc, char** argv) {
         /* Choix du mode pour le dessin, 1 pour palette et 0 pour dessin */
             glMatrixMode(GL_MODELVIEW);
         if (mode == 1) {
+            /* Les cases de la palette ne se recouvrent pas : une seule couche de la file de rendu */
+            renderQueue.layer = 0;
             glScalef(100,100,0);
             affichePalette();
             glLoadIdentity();
@@ -561,10 +545,16 @@ int main(int argc, char** argv) {
             /* Mode dessin */
             glLoadIdentity();
             incrementeAngle++;
-            /* Il n'est pas intéressant de faire une liste pour le fullArm car sinon il ne bougera plus */
+            /* Il n'est pas intéressant de faire une liste pour le fullArm car sinon il ne bougera plus.
+               Ses listes d'affichage sont dessinées tout de suite dans l'ordre des appels, elles ne passent pas par la file de rendu */
             drawFullArm(45+incrementeAngle, -10+incrementeAngle, 35+incrementeAngle, firstArm, secondArm, thirdArm);
         }
 
+        /* Fin du dessin : la file de rendu est triée et dessinée avant les évènements, qui peuvent changer la projection, puis la part de l'anneau
+           qu'elle a remplie est protégée jusqu'à la fin de son dessin */
+        flushRenderQueue();
+        endStreamFrame();
+
         /* Boucle traitant les evenements */
         SDL_Event e;
         while(SDL_PollEvent(&e)) {
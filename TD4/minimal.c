@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <time.h>
+#include "render.h"
 
 /********** VARIABLES & CONSTANTES **********/
 
@@ -20,6 +21,10 @@ static const unsigned int BIT_PER_PIXEL = 32;
 static const Uint32 FRAMERATE_MILLISECONDS = 1000 / 60;
 const char* filename = "images.bmp";
 
+/* Coins du quad et coordonnées de texture de chaque coin */
+static const float QUAD_POSITIONS[] = {-0.5, 0.5, 0.5, 0.5, 0.5, -0.5, -0.5, -0.5};
+static const float QUAD_TEXCOORDS[] = {0, 0, 1, 0, 1, 1, 0, 1};
+
 /********** FONCTIONS **********/
 
 void resizeViewport() {
@@ -28,6 +33,7 @@ void resizeViewport() {
     glLoadIdentity();
     gluOrtho2D(-1., 1., -1., 1.);
     SDL_SetVideoMode(WINDOW_WIDTH, WINDOW_HEIGHT, BIT_PER_PIXEL, SDL_OPENGL | SDL_RESIZABLE);
+    checkStreamRing();
 }
 
 /********** MAIN **********/
@@ -86,26 +92,17 @@ int main(int argc, char** argv) {
 
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glEnable(GL_TEXTURE_2D); /* On précise qu’on veut activer la fonctionnalité detexturing */
-        glBindTexture(GL_TEXTURE_2D, textureID); /* On bind la texture pour pouvoir l’utiliser */
-
+        /* Le quad passe par la file de rendu : sa texture fait partie de l'état du paquet, la file active le texturing et binde la texture autour de lui */
         glPushMatrix();
         glScalef(0.5,1,1);
-        glBegin(GL_QUADS);
-            glTexCoord2f(0, 0);
-            glVertex2f(-0.5,0.5);
-            glTexCoord2f(1, 0);
-            glVertex2f(0.5,0.5);
-            glTexCoord2f(1, 1);
-            glVertex2f(0.5,-0.5);
-            glTexCoord2f(0, 1);
-            glVertex2f(-0.5,-0.5);
-        glEnd();
+        queueTexturedVertices(textureID, GL_QUADS, 255, 255, 255, QUAD_POSITIONS, QUAD_TEXCOORDS, 4);
         glPopMatrix();
 
         // Fin du code de dessin
-         glDisable(GL_TEXTURE_2D); /* On désactive le sampling de texture */
-         glBindTexture(GL_TEXTURE_2D, 0); /* On débinde la texture */
+        /* La file de rendu est triée et dessinée avant les évènements, qui peuvent changer la projection, puis la part de l'anneau
+           qu'elle a remplie est protégée jusqu'à la fin de son dessin */
+        flushRenderQueue();
+        endStreamFrame();
 
         SDL_Event e;
         while(SDL_PollEvent(&e)) {
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <time.h>
+#include "render.h"
 
 
 /************* CONSTANTES **************/
@@ -181,6 +182,7 @@ void resize(int w, int h) {
     WINDOW_WIDTH = w;
     WINDOW_HEIGHT = h;
     SDL_SetVideoMode(WINDOW_WIDTH, WINDOW_HEIGHT, BIT_PER_PIXEL, SDL_OPENGL | SDL_RESIZABLE);
+    checkStreamRing();
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
@@ -238,13 +240,11 @@ void affichePalette() {
              default:
                 break;
         }
-        glColor3ub(r, g, b);
-        glBegin(GL_QUADS);
-            glVertex2f(-1 + (column_width * i), 1);
-            glVertex2f(-1 + ((i+1) * column_width), 1);
-            glVertex2f(-1 + ((i+1) * column_width), -1);
-            glVertex2f(-1 + (i * column_width), -1);
-        glEnd();
+        float corners[8] = {-1 + (column_width * i), 1,
+                            -1 + ((i+1) * column_width), 1,
+                            -1 + ((i+1) * column_width), -1,
+                            -1 + (i * column_width), -1};
+        queueVertices(GL_QUADS, r, g, b, corners, 4);
     }
 }
 
@@ -263,30 +263,18 @@ void afficheListe(PrimitiveList list) {
 /* Fonction qui me crée un carré de côté 1 et de couleur passée en paramètre (ici rose, parce que c'est joli) */
 void drawSquare(float x, float y, int r, int g, int b, int full) {
 
-    if (full == 0) {
-        glColor3ub(r, g, b);
-        glBegin(GL_LINES);
-            glVertex2f(x-0.5, y-0.5);
-            glVertex2f(x-0.5, y+0.5);
-
-            glVertex2f(x+0.5, y+0.5);
-            glVertex2f(x+0.5, y-0.5);
+    /* Les côtés deux à deux pour le contour, les quatre coins pour le carré plein : déposés dans la file de rendu */
+    float outline[16] = {x-0.5, y-0.5, x-0.5, y+0.5,
+                         x+0.5, y+0.5, x+0.5, y-0.5,
+                         x-0.5, y+0.5, x+0.5, y+0.5,
+                         x-0.5, y-0.5, x+0.5, y-0.5};
+    float corners[8] = {x-0.5, y-0.5, x-0.5, y+0.5, x+0.5, y+0.5, x+0.5, y-0.5};
 
-            glVertex2f(x-0.5, y+0.5);
-            glVertex2f(x+0.5, y+0.5);
-
-            glVertex2f(x-0.5, y-0.5);
-            glVertex2f(x+0.5, y-0.5);
-        glEnd();
+    if (full == 0) {
+        queueVertices(GL_LINES, r, g, b, outline, 8);
     }
     else {
-        glColor3ub(r, g, b);
-        glBegin(GL_QUADS);
-            glVertex2f(x-0.5, y-0.5);
-            glVertex2f(x-0.5, y+0.5);
-            glVertex2f(x+0.5, y+0.5);
-            glVertex2f(x+0.5, y-0.5);
-        glEnd();
+        queueVertices(GL_QUADS, r, g, b, corners, 4);
     }
 
 }
@@ -294,47 +282,40 @@ void drawSquare(float x, float y, int r, int g, int b, int full) {
 /* Fonction qui me crée un repère centré : segment de taille 1 et rouge en abscisse avec pour ordonné un segment vert de taille 1 */
 void drawLandmark() {
 
+    float abscissa[4] = {-5, 0., 5, 0.};
+    float ordinate[4] = {0, -5, 0, 5};
+
     /* Abscisses */
-    glColor3ub(255, 0, 0);
-    glBegin(GL_LINES);
-        glVertex2f(-5, 0.);
-        glVertex2f(5, 0.);
-    glEnd();
+    queueVertices(GL_LINES, 255, 0, 0, abscissa, 2);
     /* Ordonnées */
-    glColor3ub(0, 255, 0);
-    glBegin(GL_LINES);
-        glVertex2f(0, -5);
-        glVertex2f(0, 5);
-    glEnd();
+    queueVertices(GL_LINES, 0, 255, 0, ordinate, 2);
 
 }
 
 /* Fonction qui me crée un cercle de diamètre 1 : LINE_STRIP si vide et TRIANGLE_FAN si plein */
 void drawCircle(int r, int v, int b, int full) {
-    int i;
+    unsigned int i;
+    float positions[2 * (NB_SEGMENT + 2)]; // Centre (cercle plein) puis les NB_SEGMENT + 1 points du tour
 
     float angle = M_PI*2; // correspond à 2 PI, soit un tour de cercle
 
     if (full == 0) {
-        glColor3ub(r, v, b);
-        glBegin(GL_LINE_STRIP);
-
         for (i = 0 ; i <= NB_SEGMENT ; i++) {
             float new_angle = angle*i/NB_SEGMENT;
-            glVertex2f(cos(new_angle)*0.5, sin(new_angle)*0.5); // 0.5 de rayon       
+            positions[i*2] = cos(new_angle)*0.5; // 0.5 de rayon
+            positions[i*2+1] = sin(new_angle)*0.5;
         }
-        glEnd();  
+        queueVertices(GL_LINE_STRIP, r, v, b, positions, NB_SEGMENT + 1);
     }
 
     else {
-        glColor3ub(r, v, b);
-        glBegin(GL_TRIANGLE_FAN);
-
-        glVertex2f(0, 0); // centre du cercle
+        positions[0] = 0; // centre du cercle
+        positions[1] = 0;
         for (i = 0 ; i <= NB_SEGMENT ; i++) { 
-            glVertex2f(0.5*(cos(i*angle/NB_SEGMENT)), (0.5*sin(i*angle/NB_SEGMENT)));
+            positions[i*2+2] = 0.5*(cos(i*angle/NB_SEGMENT));
+            positions[i*2+3] = 0.5*sin(i*angle/NB_SEGMENT);
         }
-        glEnd();
+        queueVertices(GL_TRIANGLE_FAN, r, v, b, positions, NB_SEGMENT + 2);
     }
 }
 
@@ -380,7 +361,7 @@ void drawRoundedSquare() {
 GLuint createFirstArmIDList() {
 
     GLuint id = glGenLists(1);
-    glNewList(id, GL_COMPILE);
+    beginDisplayList(id);
 
         /* Petit cercle de rayon 10 */
         glPushMatrix();
@@ -401,7 +382,7 @@ GLuint createFirstArmIDList() {
             glVertex2f(60, -10);
         glEnd();
 
-    glEndList();
+    endDisplayList();
 
     return id;
 }
@@ -410,7 +391,7 @@ GLuint createFirstArmIDList() {
 GLuint createSecondArmIDList() {
 
     GLuint id = glGenLists(1);
-    glNewList(id, GL_COMPILE);
+    beginDisplayList(id);
 
         /* Deux carrés séparés de 50 unités soit 50cm pour 10u/10cm */
         /* 1er carré à bouts arrondis de côté 10 */
@@ -432,7 +413,7 @@ GLuint createSecondArmIDList() {
             drawSquare(0,0,0,255,255,1);
         glPopMatrix();
 
-    glEndList();
+    endDisplayList();
 
     return id;
  }
@@ -441,7 +422,7 @@ GLuint createSecondArmIDList() {
 GLuint createThirdArmIDList() {
 
     GLuint id = glGenLists(1);
-    glNewList(id, GL_COMPILE);
+    beginDisplayList(id);
 
         /* Carré de côté 6 */
         glPushMatrix();
@@ -463,7 +444,7 @@ GLuint createThirdArmIDList() {
             drawSquare(0,0,0,255,255,1);
         glPopMatrix();
 
-   glEndList();
+   endDisplayList();
 
    return id;
 }
@@ -505,25 +486,28 @@ void drawFullArm(float alpha, float beta, float gamma, GLuint firstID, GLuint se
 void drawClock(int h, int m, int s){
     int i;
 
-    /* Dessin du fond de l'horloge */
+    /* Dessin du fond de l'horloge : les trois disques se recouvrent, chacun a sa couche de la file de rendu */
     /* BLANC */
+    renderQueue.layer = 0;
     glPushMatrix();
-        glColor3ub(10,10,10);
         glScalef(195, 195, 0);
         drawCircle(255,255,255,1);
     glPopMatrix();
     /* NOIR */
+    renderQueue.layer = 1;
     glPushMatrix();
         glScalef(190, 190, 0);
         drawCircle(0,0,0,1);
     glPopMatrix();
     /* BLANC */
+    renderQueue.layer = 2;
     glPushMatrix();
         glScalef(180, 180, 0);
         drawCircle(255,255,255,1);
     glPopMatrix();
 
-    /* Dessin des aguilles */
+    /* Dessin des aguilles : elles sont noires comme les traits, les deux vont dans la même couche */
+    renderQueue.layer = 3;
     /* Heure */
     glPushMatrix();
         glRotatef(-h*30, 0, 0, 1);
@@ -627,6 +611,11 @@ int main(int argc, char** argv) {
             glPopMatrix();*/
         }
 
+        /* Fin du dessin : la file de rendu est triée et dessinée avant les évènements, qui peuvent changer la projection, puis la part de l'anneau
+           qu'elle a remplie est protégée jusqu'à la fin de son dessin */
+        flushRenderQueue();
+        endStreamFrame();
+
         /* Boucle traitant les evenements */
         SDL_Event e;
         while(SDL_PollEvent(&e)) {
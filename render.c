@@ -0,0 +1,432 @@
+#include "render.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/************** VARIABLES ***************/
+
+
+/* Relu au premier dessin qui suit la création (ou la recréation) du contexte */
+BufferSupport bufferSupport = {-1, 0, 0};
+
+/* L'anneau est créé au premier dessin qui en a besoin */
+StreamRing streamRing = {.buffer = 0, .mode = -1};
+
+RenderQueue renderQueue;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Fonctions des tampons de sommets du pilote */
+
+/* Renvoie 1 si le pilote a des tampons de sommets (OpenGL 1.5 ou plus) */
+int buffersSupported() {
+    const char* version;
+
+    if(bufferSupport.buffers < 0) {
+        int major = 0, minor = 0;
+        version = (const char*)glGetString(GL_VERSION);
+        if(!version) {
+            return 0;
+        }
+        sscanf(version, "%d.%d", &major, &minor);
+        bufferSupport.buffers = major > 1 || (major == 1 && minor >= 5);
+        bufferSupport.copy = major > 3 || (major == 3 && minor >= 1);
+        bufferSupport.persistent = major > 4 || (major == 4 && minor >= 4);
+    }
+
+    return bufferSupport.buffers;
+}
+
+/* Fonctions de l'anneau de sommets : la géométrie refaite à chaque image est écrite à la suite dans la part de l'image, sans attendre le pilote */
+
+/* Crée le tampon de l'anneau : projeté en permanence si le pilote le permet (OpenGL 4.4), sinon vidé par orphelinage. Renvoie 0 s'il n'y a pas de tampon */
+int streamSupported() {
+    GLsizeiptr size = (GLsizeiptr)STREAM_PARTS * STREAM_PART_VERTICES * 2 * sizeof(float);
+
+    if(streamRing.mode >= 0) {
+        return streamRing.mode != STREAM_NONE;
+    }
+    streamRing.mode = STREAM_NONE;
+    if(!buffersSupported()) {
+        return 0;
+    }
+    glGenBuffers(1, &streamRing.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, streamRing.buffer);
+#ifdef GL_MAP_PERSISTENT_BIT
+    if(bufferSupport.persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        streamRing.mapped = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if(streamRing.mapped) {
+            streamRing.mode = STREAM_PERSISTENT;
+        }
+        else {
+            /* Le stockage d'un tampon refusé reste figé : on en reprend un neuf pour l'orphelinage */
+            glDeleteBuffers(1, &streamRing.buffer);
+            glGenBuffers(1, &streamRing.buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, streamRing.buffer);
+        }
+    }
+#endif
+    if(streamRing.mode == STREAM_NONE) {
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        streamRing.mode = STREAM_ORPHAN;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return 1;
+}
+
+/* Attend que la carte ait fini de dessiner la part avant de la réécrire (la barrière a été posée trois images plus tôt, elle est en général déjà passée) */
+void waitStreamPart() {
+#ifdef GL_MAP_PERSISTENT_BIT
+    GLsync fence = streamRing.fences[streamRing.part];
+    GLenum status;
+
+    if(!fence) {
+        return;
+    }
+    status = glClientWaitSync(fence, 0, 0);
+    if(status == GL_TIMEOUT_EXPIRED) {
+        streamRing.waits++;
+        do {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while(status == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    streamRing.fences[streamRing.part] = 0;
+#endif
+
+    return;
+}
+
+/* Copie les sommets à la suite dans la part de l'image et laisse le tampon de l'anneau lié. Renvoie le numéro du premier sommet dans le tampon,
+   ou -1 sans rien lier si l'anneau n'est pas utilisable (pas de tampon, liste d'affichage en cours de compilation, part pleine) */
+int writeStream(const float* positions, unsigned int count) {
+    unsigned int first;
+
+    if(streamRing.recording || !streamSupported() || streamRing.used + count > STREAM_PART_VERTICES) {
+        return -1;
+    }
+    first = streamRing.part * STREAM_PART_VERTICES + streamRing.used;
+    glBindBuffer(GL_ARRAY_BUFFER, streamRing.buffer);
+    if(streamRing.mode == STREAM_PERSISTENT) {
+        if(streamRing.used == 0) {
+            waitStreamPart();
+        }
+        memcpy(streamRing.mapped + first * 2, positions, count * 2 * sizeof(float));
+    }
+    else {
+        /* La première part reprend sur un stockage neuf : les deux autres ne servent qu'aux images suivantes, rien n'y est en cours de dessin */
+        if(first == 0) {
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)STREAM_PARTS * STREAM_PART_VERTICES * 2 * sizeof(float), NULL, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, first * 2 * sizeof(float), count * 2 * sizeof(float), positions);
+    }
+    streamRing.used += count;
+    streamRing.frameBytes += count * 2 * sizeof(float);
+
+    return first;
+}
+
+/* Copie les sommets dans l'anneau et les dessine avec la couleur courante. Renvoie 0 sans rien dessiner si l'anneau n'est pas utilisable :
+   l'appelant dessine alors avec glBegin */
+int streamVertices(GLenum mode, const float* positions, unsigned int count) {
+    int first = writeStream(positions, count);
+
+    if(first < 0) {
+        return 0;
+    }
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, (const GLvoid*)0);
+    glDrawArrays(mode, first, count);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return 1;
+}
+
+/* Dessine des sommets avec la couleur courante : par l'anneau si possible, sinon avec glBegin */
+void drawStreamVertices(GLenum mode, const float* positions, unsigned int count) {
+    unsigned int i;
+
+    if(streamVertices(mode, positions, count)) {
+        return;
+    }
+    glBegin(mode);
+    for(i = 0 ; i < count ; i++) {
+        glVertex2f(positions[i * 2], positions[i * 2 + 1]);
+    }
+    glEnd();
+
+    return;
+}
+
+/* Termine l'image (avant SDL_GL_SwapBuffers) : une barrière protège la part qui vient d'être remplie, l'image suivante écrit dans la part d'après */
+void endStreamFrame() {
+
+    streamRing.streamedBytes = streamRing.frameBytes;
+    streamRing.frameBytes = 0;
+    if(streamRing.used == 0) {
+        return;
+    }
+#ifdef GL_MAP_PERSISTENT_BIT
+    if(streamRing.mode == STREAM_PERSISTENT) {
+        streamRing.fences[streamRing.part] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+#endif
+    streamRing.part = (streamRing.part + 1) % STREAM_PARTS;
+    streamRing.used = 0;
+
+    return;
+}
+
+/* À appeler quand la fenêtre est recréée (resize) : si le contexte est perdu avec elle, la version du pilote est relue, */
+/* et l'anneau, dont les barrières et la projection disparaissent avec le contexte, est recréé au prochain dessin */
+void checkStreamRing() {
+
+    bufferSupport.buffers = -1;
+    if(streamRing.buffer && !glIsBuffer(streamRing.buffer)) {
+        int recording = streamRing.recording;
+        memset(&streamRing, 0, sizeof(streamRing));
+        streamRing.mode = -1;
+        streamRing.recording = recording;
+    }
+
+    return;
+}
+
+/* Compile une liste d'affichage : pendant ce temps, la géométrie n'est pas envoyée dans l'anneau mais recopiée dans la liste */
+void beginDisplayList(GLuint id) {
+
+    glNewList(id, GL_COMPILE);
+    streamRing.recording = 1;
+
+    return;
+}
+
+void endDisplayList() {
+
+    glEndList();
+    streamRing.recording = 0;
+
+    return;
+}
+
+/* Fonctions de la file de rendu : les paquets de l'image sont triés par couche, texture, type de primitive et couleur, puis dessinés en changeant d'état le moins possible */
+
+/* Renvoie la clé de tri d'un paquet : au-delà de RENDER_ORDER_MASK paquets, le rang reste au maximum et c'est la stabilité du tri qui garde l'ordre */
+unsigned long long renderKey(unsigned int layer, GLuint texture, GLenum type, int r, int g, int b, unsigned int order) {
+
+    return ((unsigned long long)(layer & 0xFF) << RENDER_LAYER_SHIFT) | ((unsigned long long)(texture & 0xFF) << RENDER_TEXTURE_SHIFT)
+        | ((unsigned long long)(type & 0xFF) << RENDER_TYPE_SHIFT) | ((unsigned long long)(((r & 0xFF) << 16) | ((g & 0xFF) << 8) | (b & 0xFF)) << RENDER_COLOR_SHIFT)
+        | (order < RENDER_ORDER_MASK ? order : RENDER_ORDER_MASK);
+}
+
+/* Dessine tout de suite des sommets texturés avec glBegin (pendant la compilation d'une liste d'affichage) */
+void drawTexturedVertices(GLuint texture, GLenum type, const float* positions, const float* texCoords, unsigned int count) {
+    unsigned int i;
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBegin(type);
+    for(i = 0 ; i < count ; i++) {
+        glTexCoord2f(texCoords[i * 2], texCoords[i * 2 + 1]);
+        glVertex2f(positions[i * 2], positions[i * 2 + 1]);
+    }
+    glEnd();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+
+    return;
+}
+
+/* Dépose un paquet dans la file : les sommets sont passés dans le repère du monde avec la matrice courante, puisqu'elle aura changé au moment du dessin.
+   Avec une texture (texture non nulle), texCoords donne les coordonnées de texture de chaque sommet, et la couleur module la texture.
+   Pendant la compilation d'une liste d'affichage, le paquet est dessiné tout de suite pour être recopié dans la liste */
+void queueTexturedVertices(GLuint texture, GLenum type, int r, int g, int b, const float* positions, const float* texCoords, unsigned int count) {
+    GLfloat matrix[16];
+    float* vertex;
+    RenderPacket* packet;
+    unsigned int i;
+
+    if(streamRing.recording) {
+        glColor3ub(r, g, b);
+        if(texture) {
+            drawTexturedVertices(texture, type, positions, texCoords, count);
+        }
+        else {
+            drawStreamVertices(type, positions, count);
+        }
+        return;
+    }
+    if(renderQueue.nbPackets == renderQueue.packetsCapacity) {
+        renderQueue.packetsCapacity = renderQueue.packetsCapacity ? renderQueue.packetsCapacity * 2 : 256;
+        renderQueue.packets = (RenderPacket*)realloc(renderQueue.packets, renderQueue.packetsCapacity * sizeof(RenderPacket));
+        renderQueue.sorted = (RenderPacket*)realloc(renderQueue.sorted, renderQueue.packetsCapacity * sizeof(RenderPacket));
+        renderQueue.firsts = (GLint*)realloc(renderQueue.firsts, renderQueue.packetsCapacity * sizeof(GLint));
+        renderQueue.counts = (GLsizei*)realloc(renderQueue.counts, renderQueue.packetsCapacity * sizeof(GLsizei));
+        if(!renderQueue.packets || !renderQueue.sorted || !renderQueue.firsts || !renderQueue.counts) {
+            printf("Error at render queue realloc\n");
+            exit(1);
+        }
+    }
+    if(renderQueue.nbVertices + count > renderQueue.verticesCapacity) {
+        while(renderQueue.nbVertices + count > renderQueue.verticesCapacity) {
+            renderQueue.verticesCapacity = renderQueue.verticesCapacity ? renderQueue.verticesCapacity * 2 : 4096;
+        }
+        renderQueue.positions = (float*)realloc(renderQueue.positions, renderQueue.verticesCapacity * 2 * sizeof(float));
+        renderQueue.texCoords = (float*)realloc(renderQueue.texCoords, renderQueue.verticesCapacity * 2 * sizeof(float));
+        if(!renderQueue.positions || !renderQueue.texCoords) {
+            printf("Error at render queue realloc\n");
+            exit(1);
+        }
+    }
+
+    /* Le dessin est en 2D : seules les lignes x et y de la matrice servent */
+    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
+    vertex = renderQueue.positions + renderQueue.nbVertices * 2;
+    for(i = 0 ; i < count ; i++) {
+        float x = positions[i * 2], y = positions[i * 2 + 1];
+        vertex[i * 2] = matrix[0] * x + matrix[4] * y + matrix[12];
+        vertex[i * 2 + 1] = matrix[1] * x + matrix[5] * y + matrix[13];
+    }
+
+    if(texture) {
+        memcpy(renderQueue.texCoords + renderQueue.nbVertices * 2, texCoords, count * 2 * sizeof(float));
+    }
+
+    packet = renderQueue.packets + renderQueue.nbPackets;
+    packet->key = renderKey(renderQueue.layer, texture, type, r, g, b, renderQueue.nbPackets);
+    renderQueue.nbPackets++;
+    packet->texture = texture;
+    packet->first = renderQueue.nbVertices;
+    packet->count = count;
+    renderQueue.nbVertices += count;
+
+    return;
+}
+
+/* Dépose un paquet sans texture */
+void queueVertices(GLenum type, int r, int g, int b, const float* positions, unsigned int count) {
+    queueTexturedVertices(0, type, r, g, b, positions, NULL, count);
+}
+
+/* Trie les paquets par clé croissante, un octet à la fois en partant du poids faible : chaque passe est stable, donc l'ordre des octets déjà triés est gardé.
+   Les octets communs à toutes les clés (la couche quand il n'y en a qu'une, par exemple) sont sautés */
+void sortRenderQueue() {
+    unsigned int count[256];
+    unsigned int shift, i, offset;
+    RenderPacket* swap;
+
+    for(shift = 0 ; shift < 64 ; shift += 8) {
+        memset(count, 0, sizeof(count));
+        for(i = 0 ; i < renderQueue.nbPackets ; i++) {
+            count[(renderQueue.packets[i].key >> shift) & 0xFF]++;
+        }
+        if(count[(renderQueue.packets[0].key >> shift) & 0xFF] == renderQueue.nbPackets) {
+            continue;
+        }
+        for(i = 0, offset = 0 ; i < 256 ; i++) {
+            unsigned int n = count[i];
+            count[i] = offset;
+            offset += n;
+        }
+        for(i = 0 ; i < renderQueue.nbPackets ; i++) {
+            renderQueue.sorted[count[(renderQueue.packets[i].key >> shift) & 0xFF]++] = renderQueue.packets[i];
+        }
+        swap = renderQueue.packets;
+        renderQueue.packets = renderQueue.sorted;
+        renderQueue.sorted = swap;
+    }
+
+    return;
+}
+
+/* Dessine la file à la fin du dessin de l'image (avant endStreamFrame) : tous les sommets partent d'un seul bloc dans l'anneau, puis chaque suite de paquets de même
+   état est dessinée d'un glMultiDrawArrays. La texture, la couleur et le type ne changent qu'entre deux suites.
+   Les coordonnées de texture, peu nombreuses, sont lues dans le tableau de la file */
+void flushRenderQueue() {
+    unsigned int i, j, changes = 0;
+    unsigned int color = 0;
+    GLuint texture = 0;
+    int base;
+
+    renderQueue.drawnPackets = renderQueue.nbPackets;
+    if(renderQueue.nbPackets == 0) {
+        renderQueue.stateChanges = 0;
+        renderQueue.layer = 0;
+        return;
+    }
+    sortRenderQueue();
+
+    /* Sans anneau (ou s'il n'a plus la place), les sommets sont lus dans le tableau de la file. Le tampon de l'anneau est délié une fois le pointeur
+       des sommets pris : celui des coordonnées de texture désigne le tableau de la file */
+    base = writeStream(renderQueue.positions, renderQueue.nbVertices);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, base < 0 ? (const GLvoid*)renderQueue.positions : (const GLvoid*)0);
+    if(base >= 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glTexCoordPointer(2, GL_FLOAT, 0, renderQueue.texCoords);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    for(i = 0 ; i < renderQueue.nbPackets ; i = j) {
+        unsigned long long key = renderQueue.packets[i].key;
+        GLenum type = (key >> RENDER_TYPE_SHIFT) & 0xFF;
+        unsigned int packetColor = (key >> RENDER_COLOR_SHIFT) & 0xFFFFFF;
+
+        if(renderQueue.packets[i].texture != texture) {
+            if(!texture) {
+                glEnable(GL_TEXTURE_2D);
+                glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+            }
+            texture = renderQueue.packets[i].texture;
+            glBindTexture(GL_TEXTURE_2D, texture);
+            if(!texture) {
+                glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+                glDisable(GL_TEXTURE_2D);
+            }
+            changes++;
+        }
+        if(i == 0 || packetColor != color) {
+            glColor3ub(packetColor >> 16, (packetColor >> 8) & 0xFF, packetColor & 0xFF);
+            color = packetColor;
+            changes++;
+        }
+
+        /* Les paquets de même état qui se suivent, même de couches différentes : le glMultiDrawArrays les dessine dans l'ordre */
+        for(j = i ; j < renderQueue.nbPackets && (renderQueue.packets[j].key & RENDER_STATE_MASK) == (key & RENDER_STATE_MASK) && renderQueue.packets[j].texture == texture ; j++) {
+            renderQueue.firsts[j - i] = (base < 0 ? 0 : base) + renderQueue.packets[j].first;
+            renderQueue.counts[j - i] = renderQueue.packets[j].count;
+        }
+        if(base < 0) {
+            unsigned int k;
+            for(k = 0 ; k < j - i ; k++) {
+                glDrawArrays(type, renderQueue.firsts[k], renderQueue.counts[k]);
+            }
+        }
+        else {
+            glMultiDrawArrays(type, renderQueue.firsts, renderQueue.counts, j - i);
+        }
+    }
+
+    glPopMatrix();
+    if(texture) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisable(GL_TEXTURE_2D);
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+    renderQueue.stateChanges = changes;
+    renderQueue.nbPackets = 0;
+    renderQueue.nbVertices = 0;
+    renderQueue.layer = 0;
+
+    return;
+}
@@ -0,0 +1,110 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+/* Dessin de la géométrie refaite à chaque image (formes des TD, palette, horloge) : anneau de sommets et file de rendu triée */
+/* Chaque programme appelle flushRenderQueue puis endStreamFrame à la fin du dessin de l'image, avant de traiter les évènements, et checkStreamRing quand la fenêtre est recréée */
+
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+
+/************** STRUCTURES **************/
+
+
+/* Ce que le pilote sait faire avec les tampons de sommets, lu dans sa version au premier dessin */
+typedef struct BufferSupport{
+    int buffers; // 1 si le pilote a des tampons (OpenGL 1.5), -1 tant que ce n'est pas vérifié
+    int copy; // 1 si un tampon peut être copié dans un autre sans repasser par la mémoire centrale (OpenGL 3.1)
+    int persistent; // 1 si un tampon peut rester projeté pendant le dessin (OpenGL 4.4)
+} BufferSupport;
+
+extern BufferSupport bufferSupport;
+
+/* Anneau de sommets de la géométrie refaite à chaque image (aiguilles de l'horloge, carré qui bouge) : une part par image en vol */
+#define STREAM_PARTS 3
+#define STREAM_PART_VERTICES 16384 // Sommets (deux float) de chaque part
+#define STREAM_NONE 0 // Pas de tampon de sommets : glBegin/glEnd
+#define STREAM_ORPHAN 1 // glBufferSubData, et glBufferData(NULL) à chaque retour à la première part : le pilote donne un nouveau stockage au lieu d'attendre
+#define STREAM_PERSISTENT 2 // Tampon projeté une fois pour toutes : un memcpy par dessin, une barrière par part
+typedef struct StreamRing{
+    GLuint buffer;
+    int mode; // STREAM_NONE, STREAM_ORPHAN ou STREAM_PERSISTENT, -1 tant que ce n'est pas vérifié
+    float* mapped; // Projection du tampon en mode STREAM_PERSISTENT
+    unsigned int part; // Part remplie par l'image en cours
+    unsigned int used; // Sommets déjà écrits dans cette part
+#ifdef GL_MAP_PERSISTENT_BIT
+    GLsync fences[STREAM_PARTS]; // Barrière posée à la fin de l'image qui a rempli la part (0 si aucune)
+#endif
+    int recording; // 1 pendant la compilation d'une liste d'affichage : les sommets doivent y être recopiés, glBegin le fait
+    unsigned long long frameBytes; // Octets écrits par l'image en cours
+    unsigned long long streamedBytes; // Octets écrits par la dernière image terminée
+    unsigned int waits; // Nombre de fois où le processeur a attendu que la carte libère une part
+} StreamRing;
+
+extern StreamRing streamRing;
+
+/* Clé de tri d'un paquet de la file de rendu, des bits de poids fort aux bits de poids faible */
+#define RENDER_LAYER_SHIFT 56 // 8 bits : couche, dessinées dans l'ordre croissant
+#define RENDER_TEXTURE_SHIFT 48 // 8 bits : octet de poids faible de la texture (0 sans texture), qui regroupe les paquets d'une même texture
+#define RENDER_TYPE_SHIFT 40 // 8 bits : type de primitive
+#define RENDER_COLOR_SHIFT 16 // 24 bits : couleur r, g, b
+#define RENDER_ORDER_MASK 0xFFFF // 16 bits : rang du paquet dans la file, pour que deux paquets de même état restent dans l'ordre où ils ont été déposés
+#define RENDER_STATE_MASK (((1ULL << RENDER_LAYER_SHIFT) - 1) & ~(unsigned long long)RENDER_ORDER_MASK) // Texture, type et couleur : deux paquets qui ne diffèrent que par la couche ou le rang se dessinent sans changement d'état
+
+/* Paquet de dessin : sa clé, sa texture, et ses sommets (déjà dans le repère du monde) dans le tableau de la file */
+typedef struct RenderPacket{
+    unsigned long long key;
+    GLuint texture; // Texture entière : la clé n'en garde qu'un octet, deux textures de même octet ne sont pas dessinées ensemble
+    unsigned int first;
+    unsigned int count;
+} RenderPacket;
+
+/* File de rendu de l'image : les fonctions de dessin y déposent leurs paquets, flushRenderQueue les trie et les dessine à la fin de l'image */
+typedef struct RenderQueue{
+    RenderPacket* packets;
+    RenderPacket* sorted; // Second tableau du tri par base
+    GLint* firsts; // Premier sommet et nombre de sommets des paquets d'un même glMultiDrawArrays
+    GLsizei* counts;
+    unsigned int nbPackets;
+    unsigned int packetsCapacity;
+    float* positions;
+    float* texCoords; // Coordonnées de texture des sommets, écrites seulement pour les paquets texturés
+    unsigned int nbVertices;
+    unsigned int verticesCapacity;
+    unsigned int layer; // Couche des prochains paquets : l'ordre des couches est gardé, pas celui des paquets d'une même couche
+    unsigned int drawnPackets; // Paquets du dernier flushRenderQueue
+    unsigned int stateChanges; // Changements de texture et de couleur du dernier flushRenderQueue : un changement de type ne fait que commencer un autre appel de dessin
+} RenderQueue;
+
+/* La file de l'image : un programme choisit la couche des prochains paquets avec renderQueue.layer */
+extern RenderQueue renderQueue;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Tampons de sommets du pilote */
+int buffersSupported();
+
+/* Anneau de sommets */
+int writeStream(const float* positions, unsigned int count);
+int streamVertices(GLenum mode, const float* positions, unsigned int count);
+void drawStreamVertices(GLenum mode, const float* positions, unsigned int count);
+void endStreamFrame();
+void checkStreamRing();
+void beginDisplayList(GLuint id);
+void endDisplayList();
+
+/* File de rendu */
+void queueTexturedVertices(GLuint texture, GLenum type, int r, int g, int b, const float* positions, const float* texCoords, unsigned int count);
+void queueVertices(GLenum type, int r, int g, int b, const float* positions, unsigned int count);
+void flushRenderQueue();
+
+#endif
@@ -0,0 +1,7076 @@
+#include "scene.h"
+#ifdef __APPLE__
+#include <openGL/glu.h>
+#else
+#include <GL/glu.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <ctype.h>
+#include <math.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <errno.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+
+/************* CONSTANTES **************/
+
+
+/* Taille des blocs que le tas de la scène demande au système (1 Mo) */
+static const size_t ARENA_BLOCK_SIZE = 1 << 20;
+
+/* Version du format des fichiers de scène binaires */
+static const unsigned int SCENE_FILE_VERSION = 1;
+
+/* Archive compressée : version du format, taille du tampon de lecture et d'écriture, et points décodés par morceau lors des conversions */
+static const unsigned int ARCHIVE_FILE_VERSION = 1;
+static const size_t ARCHIVE_BUFFER_SIZE = 1 << 16;
+static const unsigned int ARCHIVE_CHUNK_POINTS = 1 << 14;
+
+/* Sauvegarde automatique : version du format du journal, attente entre deux écritures groupées (en ms), taille qui déclenche son compactage */
+/* (ou le double de sa taille après le compactage précédent si c'est plus : un gros flux de points ne réécrit pas la scène à chaque fois) */
+/* et taille des enregistrements en attente au-delà de laquelle la boucle principale attend le fil d'écriture */
+static const unsigned int AUTOSAVE_FILE_VERSION = 1;
+static const Uint32 AUTOSAVE_INTERVAL = 200;
+static const size_t AUTOSAVE_COMPACT_BYTES = 16 << 20;
+static const size_t AUTOSAVE_PENDING_BYTES = 64 << 20;
+
+/* Lecture de points en flux : octets lus d'un coup, points et primitives commencées par lot, et temps passé au plus à verser les lots dans la scène à chaque image (en ms) */
+static const size_t INGEST_READ_SIZE = 1 << 20;
+static const unsigned int INGEST_BATCH_POINTS = 1 << 16;
+static const unsigned int INGEST_BATCH_PRIMITIVES = 1 << 12;
+static const Uint32 INGEST_FRAME_BUDGET = 8;
+
+/* Anneau de points partagé : version de son format et nombre de cases quand le programme le crée */
+static const unsigned int SHARED_RING_VERSION = 1;
+static const unsigned int SHARED_RING_POINTS = 1 << 20;
+
+/* Magasin de points sur disque (plus gros que la mémoire) : version du format, alignement des morceaux (multiple des pages de 4 et 16 Ko), points visés par morceau, côté maximal du découpage et points dessinés au plus par image */
+static const unsigned int STORE_FILE_VERSION = 1;
+static const unsigned long long STORE_PAGE_SIZE = 1 << 14;
+static const unsigned int STORE_CHUNK_POINTS = 1 << 16;
+static const unsigned int STORE_MAX_GRID = 1 << 10;
+static const unsigned int STORE_FRAME_POINTS = 1 << 22;
+
+/* Lecture des tracés SVG : écart maximal entre une courbe et les segments qui la remplacent (en unités du fichier) et segments au plus par courbe */
+static const float SVG_TOLERANCE = 0.05;
+static const unsigned int SVG_MAX_SEGMENTS = 1 << 12;
+
+/* Générateur de scènes : sommets générés puis ajoutés d'un coup */
+static const unsigned int GENERATOR_CHUNK_POINTS = 1 << 16;
+
+
+/************** VARIABLES ***************/
+
+
+/* Le tas unique de la scène (initialisé à zéro, le premier bloc est créé à la première demande) */
+SceneArena sceneArena;
+
+/* La grille de la scène, dont les cases sont prises dans le tas de la scène */
+static SpatialGrid spatialGrid;
+
+Camera camera = {0, 0, 1};
+
+StrokeFilter stroke = {NULL, 0, 0, 0, 0, 0};
+
+static Journal journal;
+
+/* Mémoire maximale du journal d'annulation (8 Mo par défaut, voir setJournalLimit) : au-delà, les étapes les plus anciennes sont fondues puis oubliées */
+static size_t journalMaxBytes = 8 << 20;
+
+static SnapshotRegistry snapshots = {NULL, NULL, NULL, 0, 1, NULL};
+
+static SceneMapping* sceneMappings = NULL;
+
+/* Export en arrière-plan : un seul à la fois */
+static SDL_Thread* exportThread = NULL;
+static int exportRunning = 0; // 1 tant que le fil d'export travaille (protégé par snapshots.mutex)
+static SceneWriter exportWriter = NULL; // Format de l'export en cours
+static const char* exportPath = NULL; // Fichier de l'export en cours
+
+static AutosaveState autosave;
+
+static IngestState ingest;
+
+static LodPyramid lodPyramid;
+
+/* Nombre de primitives dessinées et écartées (hors du repère), et d'appels de dessin, lors du dernier drawPrimitives */
+static unsigned int drawnPrimitives = 0;
+static unsigned int culledPrimitives = 0;
+static unsigned int drawCalls = 0;
+
+/* Octets de sommets envoyés dans les tampons lors du dernier drawPrimitives */
+static unsigned long long uploadedBytes = 0;
+
+/* Niveau de la pyramide utilisé lors du dernier drawPrimitives (-1 si tout a été dessiné) et nombre de représentants envoyés */
+static int lodLevel = -1;
+static unsigned int drawnLodPoints = 0;
+
+/* Nombre de sommets de lignes non envoyés lors du dernier drawPrimitives (plus petits qu'un pixel) */
+static unsigned int decimatedVertices = 0;
+
+static VertexBuffers vertexBuffers;
+
+int renderBackend = RENDER_BUFFERS;
+
+static SceneStatistics sceneStatistics;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Fonctions du tas de la scène : découpe, free lists par taille et reset en temps constant */
+
+/* Renvoie la classe de la plus petite puissance de 2 (au moins 16 octets) qui contient size, sans dépasser la dernière classe */
+unsigned int arenaSizeClass(size_t size) {
+    unsigned int sizeClass = 4;
+
+    while(sizeClass + 1 < ARENA_NB_CLASSES && ((size_t)1 << sizeClass) < size) {
+        sizeClass++;
+    }
+
+    return sizeClass;
+}
+
+/* Les données d'un bloc commencent après son en-tête, alignées sur 16 octets */
+unsigned char* arenaBlockData(ArenaBlock* block) {
+    return (unsigned char*)block + ((sizeof(ArenaBlock) + 15) & ~(size_t)15);
+}
+
+/* Même chose pour un gros morceau */
+unsigned char* arenaLargeData(ArenaLarge* large) {
+    return (unsigned char*)large + ((sizeof(ArenaLarge) + 15) & ~(size_t)15);
+}
+
+/* Demande un gros morceau au système et l'ajoute à ceux du tas */
+void* arenaAllocLarge(SceneArena* arena, size_t size) {
+    ArenaLarge* large = (ArenaLarge*)malloc(((sizeof(ArenaLarge) + 15) & ~(size_t)15) + size);
+
+    if(!large) {
+        printf("Error at arena large malloc\n");
+        exit(1);
+    }
+
+    large->prev = NULL;
+    large->next = arena->large;
+    large->size = size;
+    if(arena->large) {
+        arena->large->prev = large;
+    }
+    arena->large = large;
+    arena->bytesReserved += size;
+    arena->bytesUsed += size;
+
+    return arenaLargeData(large);
+}
+
+/* Rend un gros morceau au système */
+void arenaFreeLarge(SceneArena* arena, void* chunk) {
+    ArenaLarge* large = (ArenaLarge*)((unsigned char*)chunk - ((sizeof(ArenaLarge) + 15) & ~(size_t)15));
+
+    if(large->prev) {
+        large->prev->next = large->next;
+    }
+    else {
+        arena->large = large->next;
+    }
+    if(large->next) {
+        large->next->prev = large->prev;
+    }
+    arena->bytesReserved -= large->size;
+    arena->bytesUsed -= large->size;
+    free(large);
+
+    return;
+}
+
+ArenaBlock* allocArenaBlock(SceneArena* arena, size_t size) {
+    ArenaBlock* block = (ArenaBlock*)malloc(((sizeof(ArenaBlock) + 15) & ~(size_t)15) + size);
+
+    if(!block) {
+        printf("Error at arena block malloc\n");
+        exit(1);
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    arena->bytesReserved += size;
+
+    return block;
+}
+
+/* Les morceaux plus grands qu'un bloc sont demandés au système à leur taille : arenaFree doit recevoir la même taille */
+void* arenaAlloc(SceneArena* arena, size_t size) {
+    unsigned int sizeClass;
+    size_t chunkSize;
+    void* chunk;
+
+    if(size > ARENA_BLOCK_SIZE) {
+        return arenaAllocLarge(arena, size);
+    }
+    sizeClass = arenaSizeClass(size);
+    chunkSize = (size_t)1 << sizeClass;
+    chunk = arena->freeLists[sizeClass];
+
+    /* Si un morceau de cette taille a été rendu, je le réutilise */
+    if(chunk) {
+        arena->freeLists[sizeClass] = *(void**)chunk;
+        arena->bytesUsed += chunkSize;
+        return chunk;
+    }
+
+    if(!arena->current) {
+        arena->first = allocArenaBlock(arena, ARENA_BLOCK_SIZE);
+        arena->current = arena->first;
+    }
+
+    /* Sinon je passe aux blocs suivants (gardés par un reset) jusqu'à en trouver un assez grand */
+    while(arena->current->size - arena->current->used < chunkSize) {
+        if(!arena->current->next) {
+            arena->current->next = allocArenaBlock(arena, ARENA_BLOCK_SIZE);
+        }
+        arena->current = arena->current->next;
+        arena->current->used = 0;
+    }
+
+    chunk = arenaBlockData(arena->current) + arena->current->used;
+    arena->current->used += chunkSize;
+    arena->bytesUsed += chunkSize;
+
+    return chunk;
+}
+
+/* Rend un morceau : il part dans la free list de sa classe, sans appel au système (un gros morceau est rendu au système) */
+void arenaFree(SceneArena* arena, void* chunk, size_t size) {
+    unsigned int sizeClass;
+
+    if(!chunk) {
+        return;
+    }
+    if(size > ARENA_BLOCK_SIZE) {
+        arenaFreeLarge(arena, chunk);
+        return;
+    }
+
+    sizeClass = arenaSizeClass(size);
+    *(void**)chunk = arena->freeLists[sizeClass];
+    arena->freeLists[sizeClass] = chunk;
+    arena->bytesUsed -= (size_t)1 << sizeClass;
+
+    return;
+}
+
+/* Oublie tout ce qui a été découpé en temps constant : les blocs restent réservés pour la suite, seuls les gros morceaux sont rendus un par un */
+void arenaReset(SceneArena* arena) {
+    unsigned int i;
+
+    for(i = 0 ; i < ARENA_NB_CLASSES ; i++) {
+        arena->freeLists[i] = NULL;
+    }
+    while(arena->large) {
+        arenaFreeLarge(arena, arenaLargeData(arena->large));
+    }
+    arena->current = arena->first;
+    if(arena->current) {
+        arena->current->used = 0;
+    }
+    arena->bytesUsed = 0;
+
+    return;
+}
+
+/* Rend tous les blocs et les gros morceaux au système (un free par bloc, pas par élément) */
+void freeArena(SceneArena* arena) {
+
+    arenaReset(arena);
+    while(arena->first) {
+        ArenaBlock* next = arena->first->next;
+        free(arena->first);
+        arena->first = next;
+    }
+    arena->current = NULL;
+    arena->bytesReserved = 0;
+
+    return;
+}
+
+/* Fonctions des instantanés : copie sur écriture des tableaux de points et mémoire rendue quand plus aucun instantané ne la lit */
+
+/* 1 si un instantané vivant lit les tableaux courants de list */
+int isPointsShared(const PointList* list) {
+    return list->sharedVersion != 0 && list->sharedVersion >= snapshots.oldestVersion;
+}
+
+/* Met de côté un morceau du tas (ou un tas entier) jusqu'à la libération des instantanés qui peuvent le lire */
+void retireMemory(void* chunk, size_t size, SceneArena* arena) {
+    RetiredMemory* retired = (RetiredMemory*)malloc(sizeof(RetiredMemory));
+
+    if(!retired) {
+        printf("Error at retired memory malloc\n");
+        exit(1);
+    }
+    retired->chunk = chunk;
+    retired->size = size;
+    retired->arena = arena;
+    retired->version = snapshots.lastVersion;
+    retired->next = snapshots.retired;
+    snapshots.retired = retired;
+
+    return;
+}
+
+/* Rend un morceau au tas, ou le met de côté si un instantané le lit */
+void freeSharedChunk(void* chunk, size_t size, int shared) {
+
+    if(!chunk) {
+        return;
+    }
+    if(shared) {
+        retireMemory(chunk, size, NULL);
+    }
+    else {
+        arenaFree(&sceneArena, chunk, size);
+    }
+
+    return;
+}
+
+/* Rend les tableaux courants de list (au format flottant ou compact) : l'appelant les remplace ensuite */
+void freePointArrays(PointList* list) {
+    int shared = isPointsShared(list);
+
+    /* Les tableaux d'un fichier projeté restent dans la projection jusqu'au reset */
+    if(list->mapped) {
+        list->mapped = 0;
+    }
+    else if(list->quantized) {
+        freeSharedChunk(list->quantized, 2 * list->capacity * sizeof(unsigned short), shared);
+        freeSharedChunk(list->colorIndices, list->capacity * sizeof(unsigned char), shared);
+    }
+    else {
+        freeSharedChunk(list->positions, 2 * list->capacity * sizeof(float), shared);
+        freeSharedChunk(list->colors, 3 * list->capacity * sizeof(unsigned char), shared);
+    }
+    list->sharedVersion = 0;
+    list->nbShared = 0;
+
+    return;
+}
+
+/* Avant d'écrire dans des points qu'un instantané lit : le tableau est recopié, l'ancien reste à l'instantané */
+void unsharePoints(PointList* list) {
+
+    if(!isPointsShared(list)) {
+        list->nbShared = 0;
+        return;
+    }
+
+    if(list->quantized) {
+        unsigned short* quantized = (unsigned short*)arenaAlloc(&sceneArena, 2 * list->capacity * sizeof(unsigned short));
+        unsigned char* colorIndices = (unsigned char*)arenaAlloc(&sceneArena, list->capacity * sizeof(unsigned char));
+        memcpy(quantized, list->quantized, 2 * list->nbPoints * sizeof(unsigned short));
+        memcpy(colorIndices, list->colorIndices, list->nbPoints * sizeof(unsigned char));
+        freePointArrays(list);
+        list->quantized = quantized;
+        list->colorIndices = colorIndices;
+    }
+    else {
+        float* positions = (float*)arenaAlloc(&sceneArena, 2 * list->capacity * sizeof(float));
+        unsigned char* colors = (unsigned char*)arenaAlloc(&sceneArena, 3 * list->capacity * sizeof(unsigned char));
+        memcpy(positions, list->positions, 2 * list->nbPoints * sizeof(float));
+        memcpy(colors, list->colors, 3 * list->nbPoints * sizeof(unsigned char));
+        freePointArrays(list);
+        list->positions = positions;
+        list->colors = colors;
+    }
+
+    return;
+}
+
+/* Prend un instantané de la scène en copiant seulement les en-têtes des primitives (boucle principale) */
+SceneSnapshot* takeSnapshot(PrimitiveList scene) {
+    unsigned int i, nbPrimitives = 0;
+    Primitive* primitive;
+    SceneSnapshot* snapshot = (SceneSnapshot*)malloc(sizeof(SceneSnapshot));
+
+    for(primitive = scene ; primitive ; primitive = primitive->next) {
+        nbPrimitives++;
+    }
+    if(!snapshot) {
+        printf("Error at snapshot malloc\n");
+        exit(1);
+    }
+    snapshot->scene = NULL;
+    if(nbPrimitives > 0) {
+        snapshot->scene = (Primitive*)malloc(nbPrimitives * sizeof(Primitive));
+        if(!snapshot->scene) {
+            printf("Error at snapshot primitives malloc\n");
+            exit(1);
+        }
+    }
+    if(!snapshots.mutex) {
+        snapshots.mutex = SDL_CreateMutex();
+    }
+
+    snapshots.lastVersion++;
+    snapshot->version = snapshots.lastVersion;
+    snapshot->released = 0;
+    for(i = 0, primitive = scene ; primitive ; i++, primitive = primitive->next) {
+        snapshot->scene[i] = *primitive;
+        snapshot->scene[i].points.significance = NULL;
+        snapshot->scene[i].points.significanceCapacity = 0;
+        snapshot->scene[i].points.nbSignificant = 0;
+        snapshot->scene[i].points.nbSignificantBase = 0;
+        snapshot->scene[i].next = i + 1 < nbPrimitives ? snapshot->scene + i + 1 : NULL;
+        /* Les tableaux de la primitive sont désormais lus par l'instantané */
+        primitive->points.sharedVersion = snapshot->version;
+        if(primitive->points.nbShared < primitive->points.nbPoints) {
+            primitive->points.nbShared = primitive->points.nbPoints;
+        }
+    }
+
+    SDL_LockMutex(snapshots.mutex);
+    if(!snapshots.live) {
+        snapshots.oldestVersion = snapshot->version;
+    }
+    snapshot->next = snapshots.live;
+    snapshots.live = snapshot;
+    SDL_UnlockMutex(snapshots.mutex);
+
+    return snapshot;
+}
+
+/* Le lecteur a fini avec son instantané (n'importe quel fil) : la boucle principale le libérera */
+void releaseSnapshot(SceneSnapshot* snapshot) {
+
+    SDL_LockMutex(snapshots.mutex);
+    snapshot->released = 1;
+    SDL_UnlockMutex(snapshots.mutex);
+
+    return;
+}
+
+/* Libère les instantanés rendus et la mémoire que plus aucun instantané ne lit (boucle principale, à chaque image) */
+void collectSnapshots() {
+    SceneSnapshot** link;
+    RetiredMemory** retiredLink;
+    SceneMapping** mappingLink;
+    unsigned int oldestVersion = snapshots.lastVersion + 1;
+
+    if(!snapshots.mutex) {
+        return;
+    }
+
+    SDL_LockMutex(snapshots.mutex);
+    for(link = &snapshots.live ; *link ; ) {
+        SceneSnapshot* snapshot = *link;
+        if(snapshot->released) {
+            *link = snapshot->next;
+            free(snapshot->scene);
+            free(snapshot);
+        }
+        else {
+            /* Les plus récents sont en premier : le dernier vu est le plus ancien */
+            oldestVersion = snapshot->version;
+            link = &snapshot->next;
+        }
+    }
+    SDL_UnlockMutex(snapshots.mutex);
+    snapshots.oldestVersion = oldestVersion;
+
+    for(retiredLink = &snapshots.retired ; *retiredLink ; ) {
+        RetiredMemory* retired = *retiredLink;
+        if(retired->version >= oldestVersion) {
+            retiredLink = &retired->next;
+            continue;
+        }
+        if(retired->arena) {
+            freeArena(retired->arena);
+            free(retired->arena);
+        }
+        else {
+            arenaFree(&sceneArena, retired->chunk, retired->size);
+        }
+        *retiredLink = retired->next;
+        free(retired);
+    }
+
+    /* Les fichiers projetés que la scène a quittés se ferment comme le reste de la mémoire mise de côté */
+    for(mappingLink = &snapshots.retiredMappings ; *mappingLink ; ) {
+        SceneMapping* mapping = *mappingLink;
+        if(mapping->version >= oldestVersion) {
+            mappingLink = &mapping->next;
+            continue;
+        }
+        munmap(mapping->data, mapping->size);
+        *mappingLink = mapping->next;
+        free(mapping);
+    }
+
+    return;
+}
+
+
+/* Fonctions d'enregistrement de la sauvegarde automatique (boucle principale) : chaque modification coûte la taille de la modification */
+
+/* Agrandit le tampon pour qu'il puisse recevoir size octets de plus */
+void reserveAutosaveBuffer(AutosaveBuffer* buffer, size_t size) {
+
+    if(buffer->size + size <= buffer->capacity) {
+        return;
+    }
+    buffer->capacity = buffer->capacity ? 2 * buffer->capacity : 4096;
+    while(buffer->capacity < buffer->size + size) {
+        buffer->capacity *= 2;
+    }
+    buffer->data = (unsigned char*)realloc(buffer->data, buffer->capacity);
+    if(!buffer->data) {
+        printf("Error at autosave buffer realloc\n");
+        exit(1);
+    }
+
+    return;
+}
+
+/* Si pending dépasse AUTOSAVE_PENDING_BYTES, réveille le fil d'écriture et attend qu'il l'ait pris : autosave.mutex doit être pris. */
+/* Sans journal où écrire, le fil ne prend pending qu'au prochain compactage : on n'attend pas */
+void waitAutosaveRoom() {
+
+    while(autosave.pending.size >= AUTOSAVE_PENDING_BYTES && autosave.running && autosave.writable) {
+        SDL_CondSignal(autosave.wake);
+        SDL_CondWait(autosave.drained, autosave.mutex);
+    }
+
+    return;
+}
+
+/* Ajoute un enregistrement suivi de deux blocs de données (size peut valoir 0) à pending : autosave.mutex doit être pris */
+void appendAutosaveRecord(const AutosaveRecord* record, const void* data, size_t size, const void* data2, size_t size2) {
+    AutosaveBuffer* pending = &autosave.pending;
+
+    reserveAutosaveBuffer(pending, sizeof(AutosaveRecord) + size + size2);
+    memcpy(pending->data + pending->size, record, sizeof(AutosaveRecord));
+    pending->size += sizeof(AutosaveRecord);
+    if(size > 0) {
+        memcpy(pending->data + pending->size, data, size);
+        pending->size += size;
+    }
+    if(size2 > 0) {
+        memcpy(pending->data + pending->size, data2, size2);
+        pending->size += size2;
+    }
+
+    return;
+}
+
+/* Note une modification de la primitive de rang id : ne fait rien si la sauvegarde automatique est arrêtée */
+void autosaveAppend(unsigned int type, unsigned int id, unsigned int count, unsigned int value, const void* data, size_t size, const void* data2, size_t size2) {
+    AutosaveRecord record = {type, id, count, value};
+
+    if(!autosave.thread) {
+        return;
+    }
+    SDL_LockMutex(autosave.mutex);
+    waitAutosaveRoom();
+    appendAutosaveRecord(&record, data, size, data2, size2);
+    autosave.canMerge = 0;
+    SDL_UnlockMutex(autosave.mutex);
+
+    return;
+}
+
+/* Note count points ajoutés en fin de list : ils rejoignent l'enregistrement précédent s'il ajoutait au même tableau */
+void autosaveAddPoints(const PointList* list, const Point* points, unsigned int count) {
+    AutosaveRecord record = {AUTOSAVE_ADD_POINTS, list->autosaveId, count, 0};
+
+    if(!autosave.thread || count == 0) {
+        return;
+    }
+
+    SDL_LockMutex(autosave.mutex);
+    waitAutosaveRoom();
+    if(autosave.canMerge) {
+        AutosaveRecord last;
+        memcpy(&last, autosave.pending.data + autosave.lastRecord, sizeof(AutosaveRecord));
+        if(last.id == list->autosaveId) {
+            last.count += count;
+            memcpy(autosave.pending.data + autosave.lastRecord, &last, sizeof(AutosaveRecord));
+            reserveAutosaveBuffer(&autosave.pending, count * sizeof(Point));
+            memcpy(autosave.pending.data + autosave.pending.size, points, count * sizeof(Point));
+            autosave.pending.size += count * sizeof(Point);
+            SDL_UnlockMutex(autosave.mutex);
+            return;
+        }
+    }
+    autosave.lastRecord = autosave.pending.size;
+    appendAutosaveRecord(&record, points, count * sizeof(Point), NULL, 0);
+    autosave.canMerge = 1;
+    SDL_UnlockMutex(autosave.mutex);
+
+    return;
+}
+
+/* Note le remplacement du dernier point de list : s'il vient d'être ajouté, il est remplacé dans l'enregistrement en attente */
+void autosaveReplaceLast(const PointList* list, Point point) {
+
+    if(!autosave.thread) {
+        return;
+    }
+
+    SDL_LockMutex(autosave.mutex);
+    if(autosave.canMerge) {
+        AutosaveRecord last;
+        memcpy(&last, autosave.pending.data + autosave.lastRecord, sizeof(AutosaveRecord));
+        if(last.id == list->autosaveId) {
+            memcpy(autosave.pending.data + autosave.pending.size - sizeof(Point), &point, sizeof(Point));
+            SDL_UnlockMutex(autosave.mutex);
+            return;
+        }
+    }
+    SDL_UnlockMutex(autosave.mutex);
+    autosaveAppend(AUTOSAVE_REPLACE_LAST, list->autosaveId, 0, 0, &point, sizeof(Point), NULL, 0);
+
+    return;
+}
+
+/* La scène a changé sans passer par le journal : la prochaine image écrira un instantané complet */
+void autosaveInvalidate() {
+    autosave.checkpointNeeded = 1;
+    return;
+}
+
+
+/* Fonctions de la grille spatiale : ajout et retrait d'un point, (dés)indexation d'un tableau entier */
+
+int gridCellCoord(float v) {
+    return (int)floor(v / spatialGrid.cellSize);
+}
+
+/* Mélange les coordonnées d'une case pour répartir les cases voisines dans des seaux différents */
+unsigned int gridHash(int cellX, int cellY) {
+    unsigned int hash = (unsigned int)cellX * 0x9E3779B1u + (unsigned int)cellY;
+
+    hash ^= hash >> 15;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+
+    return hash;
+}
+
+/* Renvoie la case (cellX, cellY), en la créant si create vaut 1 (sinon NULL si elle n'existe pas) */
+GridCell* findGridCell(int cellX, int cellY, int create) {
+    unsigned int i;
+
+    if(!spatialGrid.buckets) {
+        if(!create) {
+            return NULL;
+        }
+        spatialGrid.nbBuckets = 1024;
+        spatialGrid.buckets = (GridCell**)arenaAlloc(&sceneArena, spatialGrid.nbBuckets * sizeof(GridCell*));
+        memset(spatialGrid.buckets, 0, spatialGrid.nbBuckets * sizeof(GridCell*));
+    }
+
+    unsigned int bucket = gridHash(cellX, cellY) & (spatialGrid.nbBuckets - 1);
+    GridCell* cell = spatialGrid.buckets[bucket];
+
+    while(cell) {
+        if(cell->cellX == cellX && cell->cellY == cellY) {
+            return cell;
+        }
+        cell = cell->next;
+    }
+    if(!create) {
+        return NULL;
+    }
+
+    /* Quand il y a deux fois plus de cases que de seaux, je double la table et je range à nouveau les cases */
+    if(spatialGrid.nbCells >= 2 * spatialGrid.nbBuckets) {
+        unsigned int nbBuckets = 2 * spatialGrid.nbBuckets;
+        GridCell** buckets = (GridCell**)arenaAlloc(&sceneArena, nbBuckets * sizeof(GridCell*));
+
+        memset(buckets, 0, nbBuckets * sizeof(GridCell*));
+        for(i = 0 ; i < spatialGrid.nbBuckets ; i++) {
+            while(spatialGrid.buckets[i]) {
+                GridCell* moved = spatialGrid.buckets[i];
+                unsigned int newBucket = gridHash(moved->cellX, moved->cellY) & (nbBuckets - 1);
+                spatialGrid.buckets[i] = moved->next;
+                moved->next = buckets[newBucket];
+                buckets[newBucket] = moved;
+            }
+        }
+        arenaFree(&sceneArena, spatialGrid.buckets, spatialGrid.nbBuckets * sizeof(GridCell*));
+        spatialGrid.buckets = buckets;
+        spatialGrid.nbBuckets = nbBuckets;
+        bucket = gridHash(cellX, cellY) & (nbBuckets - 1);
+    }
+
+    cell = (GridCell*)arenaAlloc(&sceneArena, sizeof(GridCell));
+    cell->cellX = cellX;
+    cell->cellY = cellY;
+    cell->entries = NULL;
+    cell->nbEntries = 0;
+    cell->capacity = 0;
+    cell->next = spatialGrid.buckets[bucket];
+    spatialGrid.buckets[bucket] = cell;
+    spatialGrid.nbCells++;
+
+    return cell;
+}
+
+void gridInsert(PointList* list, unsigned int index, float x, float y) {
+    GridCell* cell = findGridCell(gridCellCoord(x), gridCellCoord(y), 1);
+
+    if(cell->nbEntries == cell->capacity) {
+        unsigned int capacity = cell->capacity ? 2 * cell->capacity : 4;
+        GridEntry* entries = (GridEntry*)arenaAlloc(&sceneArena, capacity * sizeof(GridEntry));
+        if(cell->nbEntries > 0) {
+            memcpy(entries, cell->entries, cell->nbEntries * sizeof(GridEntry));
+        }
+        arenaFree(&sceneArena, cell->entries, cell->capacity * sizeof(GridEntry));
+        cell->entries = entries;
+        cell->capacity = capacity;
+    }
+    cell->entries[cell->nbEntries].list = list;
+    cell->entries[cell->nbEntries].index = index;
+    cell->nbEntries++;
+
+    return;
+}
+
+void gridRemove(PointList* list, unsigned int index, float x, float y) {
+    unsigned int i;
+    GridCell* cell = findGridCell(gridCellCoord(x), gridCellCoord(y), 0);
+
+    if(!cell) {
+        return;
+    }
+    /* L'ordre dans une case n'a pas d'importance : la dernière entrée prend la place de celle qu'on enlève */
+    for(i = 0 ; i < cell->nbEntries ; i++) {
+        if(cell->entries[i].list == list && cell->entries[i].index == index) {
+            cell->entries[i] = cell->entries[cell->nbEntries - 1];
+            cell->nbEntries--;
+            return;
+        }
+    }
+
+    return;
+}
+
+/* Le point index de list passe à l'indice newIndex sans changer de position : seule son entrée est renumérotée */
+void gridMove(PointList* list, unsigned int index, unsigned int newIndex, float x, float y) {
+    unsigned int i;
+    GridCell* cell = findGridCell(gridCellCoord(x), gridCellCoord(y), 0);
+
+    if(!cell) {
+        return;
+    }
+    for(i = 0 ; i < cell->nbEntries ; i++) {
+        if(cell->entries[i].list == list && cell->entries[i].index == index) {
+            cell->entries[i].index = newIndex;
+            return;
+        }
+    }
+
+    return;
+}
+
+/* Les fonctions qui déplacent des points en masse marquent la grille, elle sera reconstruite à la prochaine requête */
+void invalidateSpatialGrid() {
+    spatialGrid.dirty = 1;
+}
+
+/* Quand des points sont enlevés ou déplacés, la pyramide de niveaux de détail sera reconstruite */
+void invalidateLodPyramid() {
+    lodPyramid.dirty = 1;
+}
+
+/* Rend toutes les cases au tas et vide la grille */
+void clearSpatialGrid() {
+    unsigned int i;
+
+    for(i = 0 ; i < spatialGrid.nbBuckets ; i++) {
+        while(spatialGrid.buckets[i]) {
+            GridCell* next = spatialGrid.buckets[i]->next;
+            arenaFree(&sceneArena, spatialGrid.buckets[i]->entries, spatialGrid.buckets[i]->capacity * sizeof(GridEntry));
+            arenaFree(&sceneArena, spatialGrid.buckets[i], sizeof(GridCell));
+            spatialGrid.buckets[i] = next;
+        }
+    }
+    arenaFree(&sceneArena, spatialGrid.buckets, spatialGrid.nbBuckets * sizeof(GridCell*));
+    spatialGrid.buckets = NULL;
+    spatialGrid.nbBuckets = 0;
+    spatialGrid.nbCells = 0;
+    spatialGrid.dirty = 0;
+
+    return;
+}
+
+
+/* Création du point, placement dans la liste, dessin et libération de mémoire */
+Point allocPoint(float x, float y, unsigned char r, unsigned char g, unsigned char b) {
+    Point point;
+
+    point.x = x;
+    point.y = y;
+    point.r = r;
+    point.g = g;
+    point.b = b;
+
+    return point;
+}
+
+/* Format compact : 4 octets de position et 1 octet de couleur par point au lieu de 8 + 3, soit 5 octets contre 11 (environ 2,2 fois moins) */
+
+/* Ramène v de [min, max] vers un entier 16 bits (les valeurs hors de l'intervalle sont bloquées aux bords) */
+unsigned short quantizeCoord(float v, float min, float max) {
+    float t = max > min ? (v - min) / (max - min) : 0;
+
+    if(t < 0) {
+        t = 0;
+    }
+    if(t > 1) {
+        t = 1;
+    }
+
+    return (unsigned short)(t * 65535. + 0.5);
+}
+
+float dequantizeCoord(unsigned short q, float min, float max) {
+    return min + q * ((max - min) / 65535.);
+}
+
+/* Renvoie l'indice de la couleur dans COLORS, ou -1 si elle n'est pas dans la palette */
+int paletteIndex(unsigned char r, unsigned char g, unsigned char b) {
+    unsigned int i;
+
+    for(i = 0 ; i < NB_COLORS ; i++) {
+        if(COLORS[i * 3] == r && COLORS[i * 3 + 1] == g && COLORS[i * 3 + 2] == b) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* Fonctions des statistiques de la scène : chaque changement de taille ou de format d'un tableau retire sa contribution puis la remet */
+
+/* Octets occupés par count points au format du tableau */
+unsigned long long pointBytes(const PointList* list, unsigned long long count) {
+    if(list->quantized) {
+        return count * (2 * sizeof(unsigned short) + sizeof(unsigned char));
+    }
+    return count * (2 * sizeof(float) + 3 * sizeof(unsigned char));
+}
+
+/* Ajoute (sign = 1) ou retire (sign = -1) la contribution du tableau, s'il est dans la scène */
+void countPoints(const PointList* list, int sign) {
+
+    if(!list->counted) {
+        return;
+    }
+    if(sign > 0) {
+        sceneStatistics.nbVertices += list->nbPoints;
+        sceneStatistics.usedBytes += pointBytes(list, list->nbPoints);
+        sceneStatistics.reservedBytes += pointBytes(list, list->capacity);
+    }
+    else {
+        sceneStatistics.nbVertices -= list->nbPoints;
+        sceneStatistics.usedBytes -= pointBytes(list, list->nbPoints);
+        sceneStatistics.reservedBytes -= pointBytes(list, list->capacity);
+    }
+
+    return;
+}
+
+/* Compte une primitive qui entre dans la scène (sign = 1) ou qui en sort (sign = -1), avec ses points */
+void countPrimitive(Primitive* primitive, int sign) {
+    unsigned int type = primitive->primitiveType <= GL_POLYGON ? primitive->primitiveType : GL_POLYGON + 1;
+
+    if((sign > 0) == (primitive->points.counted != 0)) {
+        return;
+    }
+    if(sign > 0) {
+        primitive->points.counted = 1;
+        countPoints(&primitive->points, 1);
+        sceneStatistics.nbPrimitives[type]++;
+        sceneStatistics.totalPrimitives++;
+    }
+    else {
+        countPoints(&primitive->points, -1);
+        primitive->points.counted = 0;
+        sceneStatistics.nbPrimitives[type]--;
+        sceneStatistics.totalPrimitives--;
+    }
+
+    return;
+}
+
+/* Les points [first, end[ ont changé : seuls ceux-là seront renvoyés dans le tampon au prochain dessin */
+/* (end vaut nbPoints quand tout change jusqu'à la fin du tableau, y compris quand il vient d'être raccourci) */
+void touchPoints(PointList* list, unsigned int first, unsigned int end) {
+
+    /* Jusqu'à la fin du tableau, les points repartent avec ceux qui seront ajoutés */
+    if(end >= list->nbPoints) {
+        if(list->nbUploaded > first) {
+            list->nbUploaded = first;
+        }
+        return;
+    }
+    if(first >= list->nbUploaded) {
+        return;
+    }
+    /* Une seule plage par tableau : elle englobe les modifications depuis le dernier envoi */
+    if(list->dirtyFirst == list->dirtyEnd) {
+        list->dirtyFirst = first;
+        list->dirtyEnd = end;
+    }
+    else {
+        list->dirtyFirst = first < list->dirtyFirst ? first : list->dirtyFirst;
+        list->dirtyEnd = end > list->dirtyEnd ? end : list->dirtyEnd;
+    }
+
+    return;
+}
+
+/* Passe le tableau au format compact : renvoie 0 (et ne touche à rien) si une couleur est hors palette */
+int compactPoints(PointList* list) {
+    unsigned int i;
+
+    if(list->quantized || list->nbPoints == 0) {
+        return list->quantized != NULL;
+    }
+
+    unsigned short* quantized = (unsigned short*)arenaAlloc(&sceneArena, 2 * list->nbPoints * sizeof(unsigned short));
+    unsigned char* colorIndices = (unsigned char*)arenaAlloc(&sceneArena, list->nbPoints * sizeof(unsigned char));
+
+    for(i = 0 ; i < list->nbPoints ; i++) {
+        int index = paletteIndex(list->colors[i * 3], list->colors[i * 3 + 1], list->colors[i * 3 + 2]);
+
+        if(index < 0) {
+            arenaFree(&sceneArena, quantized, 2 * list->nbPoints * sizeof(unsigned short));
+            arenaFree(&sceneArena, colorIndices, list->nbPoints * sizeof(unsigned char));
+            return 0;
+        }
+        quantized[i * 2] = quantizeCoord(list->positions[i * 2], list->box.minX, list->box.maxX);
+        quantized[i * 2 + 1] = quantizeCoord(list->positions[i * 2 + 1], list->box.minY, list->box.maxY);
+        colorIndices[i] = index;
+    }
+
+    countPoints(list, -1);
+    freePointArrays(list);
+    invalidateSpatialGrid();
+    list->positions = NULL;
+    list->colors = NULL;
+    list->quantized = quantized;
+    list->colorIndices = colorIndices;
+    list->capacity = list->nbPoints;
+    countPoints(list, 1);
+    touchPoints(list, 0, list->nbPoints);
+    autosaveAppend(AUTOSAVE_COMPACT, list->autosaveId, 0, 0, NULL, 0, NULL, 0);
+
+    return 1;
+}
+
+/* Repasse le tableau au format flottant (ne fait rien s'il y est déjà) */
+void expandPoints(PointList* list) {
+    unsigned int i, capacity = 16;
+
+    if(!list->quantized) {
+        return;
+    }
+    /* Le tableau reprend plus du double de mémoire : les statistiques le comptent */
+    sceneStatistics.expandedLists++;
+    while(capacity < list->nbPoints) {
+        capacity *= 2;
+    }
+
+    float* positions = (float*)arenaAlloc(&sceneArena, 2 * capacity * sizeof(float));
+    unsigned char* colors = (unsigned char*)arenaAlloc(&sceneArena, 3 * capacity * sizeof(unsigned char));
+
+    for(i = 0 ; i < list->nbPoints ; i++) {
+        const unsigned char* color = COLORS + 3 * list->colorIndices[i];
+        positions[i * 2] = dequantizeCoord(list->quantized[i * 2], list->box.minX, list->box.maxX);
+        positions[i * 2 + 1] = dequantizeCoord(list->quantized[i * 2 + 1], list->box.minY, list->box.maxY);
+        colors[i * 3] = color[0];
+        colors[i * 3 + 1] = color[1];
+        colors[i * 3 + 2] = color[2];
+    }
+
+    countPoints(list, -1);
+    freePointArrays(list);
+    invalidateSpatialGrid();
+    list->quantized = NULL;
+    list->colorIndices = NULL;
+    list->positions = positions;
+    list->colors = colors;
+    list->capacity = capacity;
+    countPoints(list, 1);
+
+    return;
+}
+
+/* Agrandit le tableau pour qu'il puisse contenir au moins minCapacity points (on double la capacité) */
+void reservePoints(PointList* list, unsigned int minCapacity) {
+    unsigned int capacity;
+
+    /* On n'ajoute des points qu'au format flottant */
+    expandPoints(list);
+    capacity = list->capacity ? list->capacity : 16;
+
+    if(minCapacity <= list->capacity) {
+        return;
+    }
+    while(capacity < minCapacity) {
+        capacity *= 2;
+    }
+
+    /* Les nouveaux tableaux sont pris dans le tas de la scène, les anciens y retournent */
+    float* positions = (float*)arenaAlloc(&sceneArena, 2 * capacity * sizeof(float));
+    unsigned char* colors = (unsigned char*)arenaAlloc(&sceneArena, 3 * capacity * sizeof(unsigned char));
+
+    if(list->nbPoints > 0) {
+        memcpy(positions, list->positions, 2 * list->nbPoints * sizeof(float));
+        memcpy(colors, list->colors, 3 * list->nbPoints * sizeof(unsigned char));
+    }
+    countPoints(list, -1);
+    freePointArrays(list);
+
+    list->positions = positions;
+    list->colors = colors;
+    list->capacity = capacity;
+    countPoints(list, 1);
+
+    return;
+}
+
+void addPointToList(Point point, PointList* list) {
+
+    /* Si mon tableau est plein (ou compact), je double sa capacité */
+    if(list->nbPoints == list->capacity || list->quantized) {
+        reservePoints(list, list->nbPoints + 1);
+    }
+    /* Après une annulation, la fin du tableau peut encore être lue par un instantané */
+    if(list->nbPoints < list->nbShared) {
+        unsharePoints(list);
+    }
+
+    /* Le point se place directement en fin de tableau, sans parcourir la liste */
+    float* position = list->positions + 2 * list->nbPoints;
+    unsigned char* color = list->colors + 3 * list->nbPoints;
+    position[0] = point.x;
+    position[1] = point.y;
+    color[0] = point.r;
+    color[1] = point.g;
+    color[2] = point.b;
+
+    /* La boîte englobante grandit avec le point ajouté */
+    if(list->nbPoints == 0) {
+        list->box.minX = list->box.maxX = point.x;
+        list->box.minY = list->box.maxY = point.y;
+    }
+    else {
+        if(point.x < list->box.minX) {
+            list->box.minX = point.x;
+        }
+        if(point.x > list->box.maxX) {
+            list->box.maxX = point.x;
+        }
+        if(point.y < list->box.minY) {
+            list->box.minY = point.y;
+        }
+        if(point.y > list->box.maxY) {
+            list->box.maxY = point.y;
+        }
+    }
+
+    /* Le point est rangé dans la grille spatiale (sauf si elle doit de toute façon être reconstruite) */
+    if(!spatialGrid.dirty) {
+        if(spatialGrid.cellSize == 0) {
+            spatialGrid.cellSize = (ORTHO_RIGHT - ORTHO_LEFT) / 256.;
+        }
+        gridInsert(list, list->nbPoints, point.x, point.y);
+    }
+    list->nbPoints++;
+    if(list->counted) {
+        sceneStatistics.nbVertices++;
+        sceneStatistics.usedBytes += pointBytes(list, 1);
+    }
+
+    return;
+
+}
+
+/* Renvoie le point d'indice index (0 pour le premier, nbPoints - 1 pour le dernier) */
+Point getPoint(const PointList* list, unsigned int index) {
+
+    if(list->quantized) {
+        const unsigned char* paletteColor = COLORS + 3 * list->colorIndices[index];
+        return allocPoint(dequantizeCoord(list->quantized[index * 2], list->box.minX, list->box.maxX), dequantizeCoord(list->quantized[index * 2 + 1], list->box.minY, list->box.maxY), paletteColor[0], paletteColor[1], paletteColor[2]);
+    }
+
+    const float* position = list->positions + 2 * index;
+    const unsigned char* color = list->colors + 3 * index;
+
+    return allocPoint(position[0], position[1], color[0], color[1], color[2]);
+}
+
+void drawPoints(const PointList* list) {
+    unsigned int i;
+    const float* position = list->positions;
+    const unsigned char* color = list->colors;
+
+    /* Au format compact, les positions et les couleurs sont décodées à la volée */
+    if(list->quantized) {
+        float scaleX = (list->box.maxX - list->box.minX) / 65535.;
+        float scaleY = (list->box.maxY - list->box.minY) / 65535.;
+        const unsigned short* quantized = list->quantized;
+
+        for(i = 0 ; i < list->nbPoints ; i++) {
+            color = COLORS + 3 * list->colorIndices[i];
+            glColor3ub(color[0], color[1], color[2]);
+            glVertex2f(list->box.minX + quantized[0] * scaleX, list->box.minY + quantized[1] * scaleY);
+            quantized += 2;
+        }
+        return;
+    }
+
+    /* Je parcours le tableau dans l'ordre de la mémoire */
+    for(i = 0 ; i < list->nbPoints ; i++) {
+        /* Je colorie le pixel aux coordonnées du point avec la couleur spécifique du point */
+        glColor3ub(color[0], color[1], color[2]);
+        glVertex2f(position[0], position[1]);
+        position += 2;
+        color += 3;
+    }
+
+    return;
+
+}
+
+/* Fonctions du rendu par tampons : les primitives d'un même type partagent un tampon, chacune y a sa plage, et ne renvoient que ce qui a changé */
+
+/* Lie le tampon de la réserve (il est recréé à sa taille s'il n'existe pas, par exemple après la perte du contexte) */
+void bindVertexPool(VertexPool* pool) {
+
+    if(!pool->buffer) {
+        glGenBuffers(1, &pool->buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, pool->buffer);
+        glBufferData(GL_ARRAY_BUFFER, pool->capacity * sizeof(BufferVertex), NULL, GL_DYNAMIC_DRAW);
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, pool->buffer);
+
+    return;
+}
+
+/* Rend la plage du tableau à sa réserve (le dernier propriétaire prend sa place dans owners) */
+void releaseVertexRange(PointList* list) {
+    VertexPool* pool;
+    unsigned int last;
+
+    if(list->poolCapacity == 0) {
+        return;
+    }
+    pool = vertexBuffers.pools + list->vertexPool;
+    /* Une plage en fin de tampon est reprise tout de suite, les autres attendent le prochain tassement */
+    if(list->poolFirst + list->poolCapacity == pool->used) {
+        pool->used = list->poolFirst;
+    }
+    else {
+        pool->wasted += list->poolCapacity;
+    }
+    last = --pool->nbOwners;
+    if(list->poolSlot != last) {
+        pool->owners[list->poolSlot] = pool->owners[last];
+        pool->owners[list->poolSlot]->poolSlot = list->poolSlot;
+    }
+    list->poolCapacity = 0;
+    list->nbUploaded = 0;
+
+    return;
+}
+
+/* Range les plages les unes derrière les autres : tous les propriétaires seront renvoyés */
+void packVertexPool(VertexPool* pool) {
+    unsigned int i;
+
+    pool->used = 0;
+    pool->wasted = 0;
+    for(i = 0 ; i < pool->nbOwners ; i++) {
+        pool->owners[i]->poolFirst = pool->used;
+        pool->owners[i]->nbUploaded = 0;
+        pool->used += pool->owners[i]->poolCapacity;
+    }
+
+    return;
+}
+
+/* Agrandit le tampon de la réserve : les plages sont copiées d'un tampon à l'autre par le pilote, ou renvoyées depuis les tableaux de points */
+void growVertexPool(VertexPool* pool, unsigned int capacity) {
+    unsigned int i;
+
+#ifdef GL_COPY_READ_BUFFER
+    if(pool->buffer && bufferSupport.copy) {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(BufferVertex), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, pool->buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, pool->used * sizeof(BufferVertex));
+        glDeleteBuffers(1, &pool->buffer);
+        pool->buffer = buffer;
+        pool->capacity = capacity;
+        return;
+    }
+#endif
+    if(pool->buffer) {
+        glDeleteBuffers(1, &pool->buffer);
+        pool->buffer = 0;
+    }
+    pool->capacity = capacity;
+    /* Le nouveau tampon est vide : tout sera renvoyé depuis les tableaux de points */
+    for(i = 0 ; i < pool->nbOwners ; i++) {
+        pool->owners[i]->nbUploaded = 0;
+    }
+
+    return;
+}
+
+/* Donne au tableau une plage d'au moins nbPoints sommets dans la réserve de son type */
+/* La plage est prise avec de la marge (la moitié en plus) : un tableau qui grandit au fil des images déménage rarement */
+void reserveVertexRange(PointList* list, GLenum primitiveType) {
+    VertexPool* pool = vertexBuffers.pools + primitiveType;
+    unsigned int need = list->nbPoints;
+
+    if(list->poolCapacity >= need) {
+        return;
+    }
+    need = need < 64 ? 64 : need + need / 2;
+    /* La dernière plage du tampon grandit sur place : ses sommets déjà envoyés restent valables */
+    if(list->poolCapacity > 0 && list->poolFirst + list->poolCapacity == pool->used && list->poolFirst + list->nbPoints <= pool->capacity) {
+        if(list->poolFirst + need > pool->capacity) {
+            need = pool->capacity - list->poolFirst;
+        }
+        pool->used = list->poolFirst + need;
+        list->poolCapacity = need;
+        return;
+    }
+    releaseVertexRange(list);
+
+    if(pool->used + need > pool->capacity) {
+        /* Plus de la moitié du tampon est perdue : on tasse avant d'agrandir */
+        if(pool->wasted > pool->capacity / 2) {
+            packVertexPool(pool);
+        }
+        if(pool->used + need > pool->capacity) {
+            unsigned int capacity = pool->capacity ? 2 * pool->capacity : 4096;
+            while(capacity < pool->used + need) {
+                capacity *= 2;
+            }
+            growVertexPool(pool, capacity);
+        }
+    }
+
+    if(pool->nbOwners == pool->ownersCapacity) {
+        pool->ownersCapacity = pool->ownersCapacity ? 2 * pool->ownersCapacity : 64;
+        pool->owners = (PointList**)realloc(pool->owners, pool->ownersCapacity * sizeof(PointList*));
+        if(!pool->owners) {
+            printf("Error at vertex pool realloc\n");
+            exit(1);
+        }
+    }
+    list->vertexPool = primitiveType;
+    list->poolSlot = pool->nbOwners;
+    list->poolFirst = pool->used;
+    list->poolCapacity = need;
+    list->nbUploaded = 0;
+    pool->owners[pool->nbOwners++] = list;
+    pool->used += need;
+
+    return;
+}
+
+/* Rend tous les tampons (la scène est oubliée) */
+void releaseVertexBuffers() {
+    unsigned int i;
+
+    for(i = 0 ; i <= GL_POLYGON ; i++) {
+        if(vertexBuffers.pools[i].buffer) {
+            glDeleteBuffers(1, &vertexBuffers.pools[i].buffer);
+        }
+        free(vertexBuffers.pools[i].owners);
+    }
+    memset(vertexBuffers.pools, 0, sizeof(vertexBuffers.pools));
+
+    return;
+}
+
+/* Après un changement de mode vidéo, le contexte OpenGL a pu être recréé : ses tampons n'existent plus et tout sera renvoyé */
+void checkVertexBuffers() {
+    unsigned int i, j;
+
+    for(i = 0 ; i <= GL_POLYGON ; i++) {
+        VertexPool* pool = vertexBuffers.pools + i;
+        if(!pool->buffer || glIsBuffer(pool->buffer)) {
+            continue;
+        }
+        pool->buffer = 0;
+        for(j = 0 ; j < pool->nbOwners ; j++) {
+            pool->owners[j]->nbUploaded = 0;
+        }
+    }
+    checkStreamRing();
+
+    return;
+}
+
+/* Entrelace les points [first, end[ et les copie à leur place dans la plage du tableau (le tampon de sa réserve doit être lié) */
+void uploadPointRange(const PointList* list, unsigned int first, unsigned int end) {
+    unsigned int i, count = end - first;
+    BufferVertex* vertex;
+
+    if(count > vertexBuffers.stagingCapacity) {
+        free(vertexBuffers.staging);
+        vertexBuffers.stagingCapacity = count;
+        vertexBuffers.staging = (BufferVertex*)malloc(vertexBuffers.stagingCapacity * sizeof(BufferVertex));
+        if(!vertexBuffers.staging) {
+            printf("Error at vertex staging malloc\n");
+            exit(1);
+        }
+    }
+
+    vertex = vertexBuffers.staging;
+    /* Au format compact, les positions et les couleurs sont décodées comme dans drawPoints */
+    if(list->quantized) {
+        float scaleX = (list->box.maxX - list->box.minX) / 65535.;
+        float scaleY = (list->box.maxY - list->box.minY) / 65535.;
+        for(i = first ; i < end ; i++, vertex++) {
+            const unsigned char* color = COLORS + 3 * list->colorIndices[i];
+            vertex->x = list->box.minX + list->quantized[i * 2] * scaleX;
+            vertex->y = list->box.minY + list->quantized[i * 2 + 1] * scaleY;
+            vertex->r = color[0];
+            vertex->g = color[1];
+            vertex->b = color[2];
+            vertex->a = 255;
+        }
+    }
+    else {
+        for(i = first ; i < end ; i++, vertex++) {
+            vertex->x = list->positions[i * 2];
+            vertex->y = list->positions[i * 2 + 1];
+            vertex->r = list->colors[i * 3];
+            vertex->g = list->colors[i * 3 + 1];
+            vertex->b = list->colors[i * 3 + 2];
+            vertex->a = 255;
+        }
+    }
+
+    glBufferSubData(GL_ARRAY_BUFFER, (list->poolFirst + first) * sizeof(BufferVertex), count * sizeof(BufferVertex), vertexBuffers.staging);
+    uploadedBytes += count * sizeof(BufferVertex);
+
+    return;
+}
+
+/* Renvoie ce qui a changé depuis le dernier envoi : la plage modifiée sur place, puis les points ajoutés */
+void uploadPoints(PointList* list) {
+
+    if(list->dirtyFirst < list->dirtyEnd && list->dirtyFirst < list->nbUploaded) {
+        uploadPointRange(list, list->dirtyFirst, list->dirtyEnd < list->nbUploaded ? list->dirtyEnd : list->nbUploaded);
+    }
+    if(list->nbUploaded < list->nbPoints) {
+        uploadPointRange(list, list->nbUploaded, list->nbPoints);
+    }
+    list->nbUploaded = list->nbPoints;
+    list->dirtyFirst = 0;
+    list->dirtyEnd = 0;
+
+    return;
+}
+
+/* Agrandit les tableaux du regroupement pour nbPrimitives primitives visibles */
+void reserveDrawList(unsigned int nbPrimitives) {
+
+    if(nbPrimitives <= vertexBuffers.drawCapacity) {
+        return;
+    }
+    while(vertexBuffers.drawCapacity < nbPrimitives) {
+        vertexBuffers.drawCapacity = vertexBuffers.drawCapacity ? 2 * vertexBuffers.drawCapacity : 256;
+    }
+    vertexBuffers.drawList = (Primitive**)realloc(vertexBuffers.drawList, vertexBuffers.drawCapacity * sizeof(Primitive*));
+    vertexBuffers.drawBatch = (unsigned int*)realloc(vertexBuffers.drawBatch, vertexBuffers.drawCapacity * sizeof(unsigned int));
+    vertexBuffers.firsts = (GLint*)realloc(vertexBuffers.firsts, vertexBuffers.drawCapacity * sizeof(GLint));
+    vertexBuffers.counts = (GLsizei*)realloc(vertexBuffers.counts, vertexBuffers.drawCapacity * sizeof(GLsizei));
+    /* Il n'y a jamais plus de lots que de primitives visibles */
+    vertexBuffers.batches = (DrawBatch*)realloc(vertexBuffers.batches, vertexBuffers.drawCapacity * sizeof(DrawBatch));
+    if(!vertexBuffers.drawList || !vertexBuffers.drawBatch || !vertexBuffers.firsts || !vertexBuffers.counts || !vertexBuffers.batches) {
+        printf("Error at draw list realloc\n");
+        exit(1);
+    }
+
+    return;
+}
+
+/* Range les nbPrimitives primitives de drawList en lots (drawBatch, batches, firsts et counts) : renvoie le nombre de lots, en général un par type */
+/* Une primitive rejoint le dernier lot de son type si elle ne touche (à margin près) aucune primitive des lots dessinés après lui : */
+/* l'image est la même que dans l'ordre de la liste, où une primitive recouvre celles dessinées avant elle */
+unsigned int assignDrawBatches(VertexBuffers* buffers, unsigned int nbPrimitives, const BoundingBox* view, float margin) {
+    int lastBatch[GL_POLYGON + 1];
+    /* Cases de la vue (une ligne de BATCH_GRID cases par entier) touchées par les lots dessinés après le dernier lot de chaque type */
+    unsigned long long blocker[GL_POLYGON + 1][BATCH_GRID];
+    float cellWidth = (view->maxX - view->minX) / BATCH_GRID;
+    float cellHeight = (view->maxY - view->minY) / BATCH_GRID;
+    unsigned int i, nbBatches = 0, first = 0;
+    GLenum type;
+
+    for(type = 0 ; type <= GL_POLYGON ; type++) {
+        lastBatch[type] = -1;
+    }
+
+    for(i = 0 ; i < nbPrimitives ; i++) {
+        const Primitive* primitive = buffers->drawList[i];
+        const BoundingBox* box = &primitive->points.box;
+        int batch = lastBatch[primitive->primitiveType];
+        int minX = (int)floor((box->minX - margin - view->minX) / cellWidth);
+        int maxX = (int)floor((box->maxX + margin - view->minX) / cellWidth);
+        int minY = (int)floor((box->minY - margin - view->minY) / cellHeight);
+        int maxY = (int)floor((box->maxY + margin - view->minY) / cellHeight);
+        unsigned long long row;
+        int y;
+
+        /* Ce qui dépasse de la vue n'est pas dessiné : les cases du bord suffisent */
+        minX = minX < 0 ? 0 : (minX >= BATCH_GRID ? BATCH_GRID - 1 : minX);
+        maxX = maxX < 0 ? 0 : (maxX >= BATCH_GRID ? BATCH_GRID - 1 : maxX);
+        minY = minY < 0 ? 0 : (minY >= BATCH_GRID ? BATCH_GRID - 1 : minY);
+        maxY = maxY < 0 ? 0 : (maxY >= BATCH_GRID ? BATCH_GRID - 1 : maxY);
+        row = (maxX - minX == BATCH_GRID - 1 ? ~0ULL : ((1ULL << (maxX - minX + 1)) - 1)) << minX;
+
+        for(y = minY ; y <= maxY && batch >= 0 ; y++) {
+            if(blocker[primitive->primitiveType][y] & row) {
+                batch = -1;
+            }
+        }
+        if(batch < 0) {
+            batch = nbBatches++;
+            buffers->batches[batch].type = primitive->primitiveType;
+            buffers->batches[batch].count = 0;
+            lastBatch[primitive->primitiveType] = batch;
+            memset(blocker[primitive->primitiveType], 0, sizeof(blocker[primitive->primitiveType]));
+        }
+        buffers->batches[batch].count++;
+        buffers->drawBatch[i] = batch;
+
+        /* La primitive sera dessinée après les derniers lots des autres types qui précèdent le sien */
+        for(type = 0 ; type <= GL_POLYGON ; type++) {
+            if(type == primitive->primitiveType || lastBatch[type] < 0 || lastBatch[type] >= batch) {
+                continue;
+            }
+            for(y = minY ; y <= maxY ; y++) {
+                blocker[type][y] |= row;
+            }
+        }
+    }
+
+    /* Les plages de chaque lot se suivent dans firsts et counts, dans l'ordre de la liste */
+    for(i = 0 ; i < nbBatches ; i++) {
+        buffers->batches[i].first = first;
+        first += buffers->batches[i].count;
+        buffers->batches[i].count = 0;
+    }
+    for(i = 0 ; i < nbPrimitives ; i++) {
+        DrawBatch* batch = buffers->batches + buffers->drawBatch[i];
+        unsigned int slot = batch->first + batch->count++;
+        buffers->firsts[slot] = buffers->drawList[i]->points.poolFirst;
+        buffers->counts[slot] = buffers->drawList[i]->points.nbPoints;
+    }
+
+    return nbBatches;
+}
+
+/* Dessine les nbPrimitives primitives de drawList par lots : un glMultiDrawArrays par lot */
+void drawPrimitiveBatches(unsigned int nbPrimitives, const BoundingBox* view, float margin) {
+    unsigned int i, nbBatches = assignDrawBatches(&vertexBuffers, nbPrimitives, view, margin);
+
+    for(i = 0 ; i < nbBatches ; i++) {
+        DrawBatch* batch = vertexBuffers.batches + i;
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers.pools[batch->type].buffer);
+        glVertexPointer(2, GL_FLOAT, sizeof(BufferVertex), (const GLvoid*)0);
+        glColorPointer(3, GL_UNSIGNED_BYTE, sizeof(BufferVertex), (const GLvoid*)(2 * sizeof(float)));
+        glMultiDrawArrays(batch->type, vertexBuffers.firsts + batch->first, vertexBuffers.counts + batch->first, batch->count);
+        drawCalls++;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return;
+}
+
+/* Dessine les primitives visibles rangées dans drawList : plages réservées d'abord (un tampon peut grandir), puis envoi de ce qui a changé et dessin par lots */
+void drawVertexBuffers(unsigned int nbPrimitives, const BoundingBox* view, float margin) {
+    unsigned int i;
+
+    for(i = 0 ; i < nbPrimitives ; i++) {
+        reserveVertexRange(&vertexBuffers.drawList[i]->points, vertexBuffers.drawList[i]->primitiveType);
+    }
+    for(i = 0 ; i < nbPrimitives ; i++) {
+        Primitive* primitive = vertexBuffers.drawList[i];
+        if(primitive->points.nbUploaded < primitive->points.nbPoints || primitive->points.dirtyFirst < primitive->points.dirtyEnd) {
+            bindVertexPool(vertexBuffers.pools + primitive->primitiveType);
+            uploadPoints(&primitive->points);
+        }
+    }
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    drawPrimitiveBatches(nbPrimitives, view, margin);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    return;
+}
+
+/* Retire tous les points du tableau de la grille spatiale */
+void unindexPoints(PointList* list) {
+    unsigned int i;
+
+    if(spatialGrid.dirty) {
+        return;
+    }
+    /* Seules les cases des points du tableau sont touchées, quelle que soit la taille de la scène */
+    for(i = 0 ; i < list->nbPoints ; i++) {
+        Point point = getPoint(list, i);
+        gridRemove(list, i, point.x, point.y);
+    }
+
+    return;
+}
+
+/* Range tous les points du tableau dans la grille spatiale */
+void indexPoints(PointList* list) {
+    unsigned int i;
+
+    if(spatialGrid.dirty) {
+        return;
+    }
+    for(i = 0 ; i < list->nbPoints ; i++) {
+        Point point = getPoint(list, i);
+        gridInsert(list, i, point.x, point.y);
+    }
+
+    return;
+}
+
+void deletePoints(PointList* list) {
+
+    unindexPoints(list);
+    if(list->nbLodPoints > 0) {
+        invalidateLodPyramid();
+    }
+
+    /* Les points sont dans deux morceaux contigus : je les rends aux free lists du tas (ou aux instantanés qui les lisent) */
+    countPoints(list, -1);
+    releaseVertexRange(list);
+    freePointArrays(list);
+    list->positions = NULL;
+    list->colors = NULL;
+    list->quantized = NULL;
+    list->colorIndices = NULL;
+    list->nbPoints = 0;
+    list->capacity = 0;
+    list->nbLodPoints = 0;
+    arenaFree(&sceneArena, list->significance, list->significanceCapacity * sizeof(float));
+    list->significance = NULL;
+    list->significanceCapacity = 0;
+    list->nbSignificant = 0;
+    list->nbSignificantBase = 0;
+
+    return;
+}
+
+/* Création de la primitive, placement dans la liste, dessin et libération de mémoire */
+Primitive* allocPrimitive(GLenum primitiveType) {
+    Primitive* primitive = (Primitive*)arenaAlloc(&sceneArena, sizeof(Primitive));
+
+    primitive->primitiveType = primitiveType;
+    primitive->points.positions = NULL;
+    primitive->points.colors = NULL;
+    primitive->points.quantized = NULL;
+    primitive->points.colorIndices = NULL;
+    primitive->points.nbLodPoints = 0;
+    primitive->points.significance = NULL;
+    primitive->points.significanceCapacity = 0;
+    primitive->points.nbSignificant = 0;
+    primitive->points.nbSignificantBase = 0;
+    primitive->points.sharedVersion = 0;
+    primitive->points.nbShared = 0;
+    primitive->points.mapped = 0;
+    primitive->points.autosaveId = 0;
+    primitive->points.counted = 0;
+    primitive->points.vertexPool = 0;
+    primitive->points.poolSlot = 0;
+    primitive->points.poolFirst = 0;
+    primitive->points.poolCapacity = 0;
+    primitive->points.nbUploaded = 0;
+    primitive->points.dirtyFirst = 0;
+    primitive->points.dirtyEnd = 0;
+    primitive->points.nbPoints = 0;
+    primitive->points.capacity = 0;
+    primitive->next = NULL;
+
+    return primitive;
+}
+
+void addPrimitive(Primitive* primitive, PrimitiveList* list){
+
+    /* J'ajoute ma primitive au début de la liste */
+    primitive->next = *list;
+    *list = primitive;
+    countPrimitive(primitive, 1);
+
+    return;
+}
+
+/* Renvoie 1 si une partie de la boîte peut être vue à travers matrix (projection * modelview, rangée par colonnes) */
+int isBoxVisible(const BoundingBox* box, const GLfloat* matrix) {
+    int i;
+    int left = 0, right = 0, below = 0, above = 0;
+
+    /* La boîte est écartée si ses 4 coins sont tous du même côté d'un bord du repère */
+    for(i = 0 ; i < 4 ; i++) {
+        float x = (i & 1) ? box->maxX : box->minX;
+        float y = (i & 2) ? box->maxY : box->minY;
+        float clipX = matrix[0] * x + matrix[4] * y + matrix[12];
+        float clipY = matrix[1] * x + matrix[5] * y + matrix[13];
+        float clipW = matrix[3] * x + matrix[7] * y + matrix[15];
+
+        left += clipX < -clipW;
+        right += clipX > clipW;
+        below += clipY < -clipW;
+        above += clipY > clipW;
+    }
+
+    return left < 4 && right < 4 && below < 4 && above < 4;
+}
+
+/* Produit de deux matrices 4x4 OpenGL (rangées par colonnes) : result = a * b */
+void multiplyMatrices(const GLfloat* a, const GLfloat* b, GLfloat* result) {
+    int row, column, k;
+
+    for(column = 0 ; column < 4 ; column++) {
+        for(row = 0 ; row < 4 ; row++) {
+            result[column * 4 + row] = 0;
+            for(k = 0 ; k < 4 ; k++) {
+                result[column * 4 + row] += a[k * 4 + row] * b[column * 4 + k];
+            }
+        }
+    }
+
+    return;
+}
+
+/* Région du canevas visible à travers matrix (projection * modelview d'une projection orthographique) */
+void visibleWorldBox(const GLfloat* matrix, BoundingBox* view) {
+    int i;
+    float determinant = matrix[0] * matrix[5] - matrix[4] * matrix[1];
+
+    /* On inverse la partie affine 2D pour ramener les 4 coins du repère de découpage dans le canevas */
+    for(i = 0 ; i < 4 ; i++) {
+        float clipX = ((i & 1) ? 1 : -1) - matrix[12];
+        float clipY = ((i & 2) ? 1 : -1) - matrix[13];
+        float x = (matrix[5] * clipX - matrix[4] * clipY) / determinant;
+        float y = (matrix[0] * clipY - matrix[1] * clipX) / determinant;
+
+        if(i == 0 || x < view->minX) {
+            view->minX = x;
+        }
+        if(i == 0 || x > view->maxX) {
+            view->maxX = x;
+        }
+        if(i == 0 || y < view->minY) {
+            view->minY = y;
+        }
+        if(i == 0 || y > view->maxY) {
+            view->maxY = y;
+        }
+    }
+
+    return;
+}
+
+/* Pyramide de niveaux de détail : tuiles rangées par (niveau, tileX, tileY) dans une table de hachage */
+
+/* Espacement des cases au niveau 0, fixé à la première utilisation (et après un reset de la scène) */
+float lodBaseSpacing() {
+
+    if(lodPyramid.baseSpacing == 0) {
+        lodPyramid.baseSpacing = (ORTHO_RIGHT - ORTHO_LEFT) / 512.;
+    }
+
+    return lodPyramid.baseSpacing;
+}
+
+/* Seau de la tuile (level, tileX, tileY) du tableau list */
+unsigned int lodHash(const PointList* list, int level, int tileX, int tileY) {
+    return gridHash(tileX, tileY) ^ (unsigned int)level * 0x27D4EB2Fu ^ gridHash((int)((size_t)list >> 4), 0);
+}
+
+/* Renvoie la tuile demandée du tableau list, en la créant si create vaut 1 (sinon NULL si elle n'existe pas) */
+LodTile* findLodTile(const PointList* list, int level, int tileX, int tileY, int create) {
+    unsigned int i;
+
+    if(!lodPyramid.buckets) {
+        if(!create) {
+            return NULL;
+        }
+        lodPyramid.nbBuckets = 256;
+        lodPyramid.buckets = (LodTile**)arenaAlloc(&sceneArena, lodPyramid.nbBuckets * sizeof(LodTile*));
+        memset(lodPyramid.buckets, 0, lodPyramid.nbBuckets * sizeof(LodTile*));
+    }
+
+    unsigned int bucket = lodHash(list, level, tileX, tileY) & (lodPyramid.nbBuckets - 1);
+    LodTile* tile = lodPyramid.buckets[bucket];
+
+    while(tile) {
+        if(tile->list == list && tile->level == level && tile->tileX == tileX && tile->tileY == tileY) {
+            return tile;
+        }
+        tile = tile->next;
+    }
+    if(!create) {
+        return NULL;
+    }
+
+    /* Même agrandissement que pour la grille spatiale */
+    if(lodPyramid.nbTiles >= 2 * lodPyramid.nbBuckets) {
+        unsigned int nbBuckets = 2 * lodPyramid.nbBuckets;
+        LodTile** buckets = (LodTile**)arenaAlloc(&sceneArena, nbBuckets * sizeof(LodTile*));
+
+        memset(buckets, 0, nbBuckets * sizeof(LodTile*));
+        for(i = 0 ; i < lodPyramid.nbBuckets ; i++) {
+            while(lodPyramid.buckets[i]) {
+                LodTile* moved = lodPyramid.buckets[i];
+                unsigned int newBucket = lodHash(moved->list, moved->level, moved->tileX, moved->tileY) & (nbBuckets - 1);
+                lodPyramid.buckets[i] = moved->next;
+                moved->next = buckets[newBucket];
+                buckets[newBucket] = moved;
+            }
+        }
+        arenaFree(&sceneArena, lodPyramid.buckets, lodPyramid.nbBuckets * sizeof(LodTile*));
+        lodPyramid.buckets = buckets;
+        lodPyramid.nbBuckets = nbBuckets;
+        bucket = lodHash(list, level, tileX, tileY) & (nbBuckets - 1);
+    }
+
+    tile = (LodTile*)arenaAlloc(&sceneArena, sizeof(LodTile));
+    memset(tile, 0, sizeof(LodTile));
+    tile->list = list;
+    tile->level = level;
+    tile->tileX = tileX;
+    tile->tileY = tileY;
+    tile->next = lodPyramid.buckets[bucket];
+    lodPyramid.buckets[bucket] = tile;
+    lodPyramid.nbTiles++;
+
+    return tile;
+}
+
+/* Verse un point de list dans sa pyramide : du niveau le plus fin au plus grossier, il devient le représentant de sa case
+   si elle est encore vide. Une case occupée l'est aussi à tous les niveaux au-dessus, on s'arrête donc là */
+void lodInsert(const PointList* list, Point point) {
+    int level;
+    float spacing = lodBaseSpacing();
+
+    for(level = 0 ; level < LOD_NB_LEVELS ; level++, spacing *= 2) {
+        int cellX = (int)floor(point.x / spacing);
+        int cellY = (int)floor(point.y / spacing);
+        int tileX = (int)floor((float)cellX / LOD_TILE_CELLS);
+        int tileY = (int)floor((float)cellY / LOD_TILE_CELLS);
+        int bit = (cellY - tileY * LOD_TILE_CELLS) * LOD_TILE_CELLS + (cellX - tileX * LOD_TILE_CELLS);
+        LodTile* tile = findLodTile(list, level, tileX, tileY, 1);
+
+        if(tile->occupied[bit / 8] & (1 << (bit % 8))) {
+            return;
+        }
+        tile->occupied[bit / 8] |= 1 << (bit % 8);
+
+        if(tile->points.nbPoints == tile->points.capacity) {
+            reservePoints(&tile->points, tile->points.nbPoints + 1);
+        }
+        tile->points.positions[tile->points.nbPoints * 2] = point.x;
+        tile->points.positions[tile->points.nbPoints * 2 + 1] = point.y;
+        tile->points.colors[tile->points.nbPoints * 3] = point.r;
+        tile->points.colors[tile->points.nbPoints * 3 + 1] = point.g;
+        tile->points.colors[tile->points.nbPoints * 3 + 2] = point.b;
+        tile->points.nbPoints++;
+    }
+
+    return;
+}
+
+/* Met la pyramide à jour : reconstruction si elle a été invalidée, puis ajout des points arrivés depuis le dernier passage */
+void updateLodPyramid(PrimitiveList list) {
+    unsigned int i;
+    PrimitiveList primitive;
+
+    if(lodPyramid.dirty) {
+        for(i = 0 ; i < lodPyramid.nbBuckets ; i++) {
+            while(lodPyramid.buckets[i]) {
+                LodTile* next = lodPyramid.buckets[i]->next;
+                arenaFree(&sceneArena, lodPyramid.buckets[i]->points.positions, 2 * lodPyramid.buckets[i]->points.capacity * sizeof(float));
+                arenaFree(&sceneArena, lodPyramid.buckets[i]->points.colors, 3 * lodPyramid.buckets[i]->points.capacity * sizeof(unsigned char));
+                arenaFree(&sceneArena, lodPyramid.buckets[i], sizeof(LodTile));
+                lodPyramid.buckets[i] = next;
+            }
+        }
+        lodPyramid.nbTiles = 0;
+        lodPyramid.dirty = 0;
+        for(primitive = list ; primitive ; primitive = primitive->next) {
+            primitive->points.nbLodPoints = 0;
+        }
+    }
+
+    for(primitive = list ; primitive ; primitive = primitive->next) {
+        if(primitive->primitiveType != GL_POINTS) {
+            continue;
+        }
+        for(i = primitive->points.nbLodPoints ; i < primitive->points.nbPoints ; i++) {
+            lodInsert(&primitive->points, getPoint(&primitive->points, i));
+        }
+        primitive->points.nbLodPoints = primitive->points.nbPoints;
+    }
+
+    return;
+}
+
+/* Choisit le niveau dont les cases mesurent au moins un pixel, ou -1 si la vue est assez proche pour tout dessiner */
+int chooseLodLevel(float pixelSize) {
+    int level = 0;
+    float spacing = lodBaseSpacing();
+
+    if(pixelSize < spacing / 2) {
+        return -1;
+    }
+    while(spacing < pixelSize && level < LOD_NB_LEVELS - 1) {
+        spacing *= 2;
+        level++;
+    }
+
+    return level;
+}
+
+/* Dessine les représentants de list dans les tuiles visibles du niveau choisi : au plus un point par pixel */
+void drawLodTiles(const PointList* list, int level, const BoundingBox* view) {
+    int tileX, tileY;
+    unsigned int i;
+    float tileSize = lodBaseSpacing() * LOD_TILE_CELLS * (float)(1 << level);
+    float minX = view->minX > list->box.minX ? view->minX : list->box.minX;
+    float maxX = view->maxX < list->box.maxX ? view->maxX : list->box.maxX;
+    float minY = view->minY > list->box.minY ? view->minY : list->box.minY;
+    float maxY = view->maxY < list->box.maxY ? view->maxY : list->box.maxY;
+    int minTileX = (int)floor(minX / tileSize), maxTileX = (int)floor(maxX / tileSize);
+    int minTileY = (int)floor(minY / tileSize), maxTileY = (int)floor(maxY / tileSize);
+
+    glBegin(GL_POINTS);
+    /* Si la partie visible couvre plus de tuiles qu'il n'en existe, on parcourt plutôt la table */
+    if((double)(maxTileX - minTileX + 1) * (maxTileY - minTileY + 1) > lodPyramid.nbTiles) {
+        for(i = 0 ; i < lodPyramid.nbBuckets ; i++) {
+            LodTile* tile;
+            for(tile = lodPyramid.buckets[i] ; tile ; tile = tile->next) {
+                if(tile->list == list && tile->level == level && tile->tileX >= minTileX && tile->tileX <= maxTileX && tile->tileY >= minTileY && tile->tileY <= maxTileY) {
+                    drawPoints(&tile->points);
+                    drawnLodPoints += tile->points.nbPoints;
+                }
+            }
+        }
+    }
+    else {
+        for(tileX = minTileX ; tileX <= maxTileX ; tileX++) {
+            for(tileY = minTileY ; tileY <= maxTileY ; tileY++) {
+                LodTile* tile = findLodTile(list, level, tileX, tileY, 0);
+                if(tile) {
+                    drawPoints(&tile->points);
+                    drawnLodPoints += tile->points.nbPoints;
+                }
+            }
+        }
+    }
+    glEnd();
+
+    return;
+}
+
+/* Fonctions de simplification des lignes : seuls les sommets qui s'écartent d'au moins un pixel sont envoyés */
+
+/* Morceau de ligne [first, last] qui reste à simplifier, et écart de son sommet parent */
+typedef struct SignificanceSpan{
+    unsigned int first, last;
+    float cap;
+} SignificanceSpan;
+
+/* Distance du point p au segment [a, b] */
+float segmentDistance(Point p, Point a, Point b) {
+    float dx = b.x - a.x, dy = b.y - a.y;
+    float length2 = dx * dx + dy * dy;
+    float t = 0;
+
+    if(length2 > 0) {
+        t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2;
+        t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    }
+    dx = a.x + t * dx - p.x;
+    dy = a.y + t * dy - p.y;
+
+    return sqrt(dx * dx + dy * dy);
+}
+
+/* Douglas-Peucker sans récursion sur [first, last] : chaque sommet reçoit son écart au segment qui le remplacerait, borné par celui de son parent */
+/* Garder les sommets d'écart >= tolérance donne alors exactement la simplification de Douglas-Peucker à cette tolérance */
+void significanceSpans(PointList* list, unsigned int first, unsigned int last) {
+    unsigned int i, nbSpans = 0;
+    unsigned int maxSpans = last - first + 1;
+    SignificanceSpan* spans;
+
+    /* Chaque morceau dépilé en empile au plus deux : la pile ne dépasse jamais last - first + 1 morceaux */
+    spans = (SignificanceSpan*)arenaAlloc(&sceneArena, maxSpans * sizeof(SignificanceSpan));
+    spans[nbSpans].first = first;
+    spans[nbSpans].last = last;
+    spans[nbSpans].cap = FLT_MAX;
+    nbSpans++;
+    while(nbSpans > 0) {
+        SignificanceSpan span = spans[--nbSpans];
+        Point a = getPoint(list, span.first);
+        Point b = getPoint(list, span.last);
+        unsigned int farthest = span.first + 1;
+        float maxDistance = -1;
+
+        for(i = span.first + 1 ; i < span.last ; i++) {
+            float distance = segmentDistance(getPoint(list, i), a, b);
+            if(distance > maxDistance) {
+                maxDistance = distance;
+                farthest = i;
+            }
+        }
+        if(maxDistance > span.cap) {
+            maxDistance = span.cap;
+        }
+        list->significance[farthest] = maxDistance;
+
+        if(farthest - span.first > 1) {
+            spans[nbSpans].first = span.first;
+            spans[nbSpans].last = farthest;
+            spans[nbSpans].cap = maxDistance;
+            nbSpans++;
+        }
+        if(span.last - farthest > 1) {
+            spans[nbSpans].first = farthest;
+            spans[nbSpans].last = span.last;
+            spans[nbSpans].cap = maxDistance;
+            nbSpans++;
+        }
+    }
+    arenaFree(&sceneArena, spans, maxSpans * sizeof(SignificanceSpan));
+
+    return;
+}
+
+/* Met significance à jour pour tout le tableau. Les points ajoutés depuis le dernier calcul forment une ligne simplifiée à part, */
+/* qui commence au dernier sommet déjà calculé (gardé comme extrémité) : chaque morceau reste sous la tolérance. */
+/* On ne refait le calcul complet que lorsque le tableau a doublé depuis le précédent, pour un coût amorti linéaire */
+void computeSignificance(PointList* list) {
+    unsigned int first = 0;
+
+    if(list->nbSignificant == list->nbPoints) {
+        return;
+    }
+    if(list->significanceCapacity < list->capacity) {
+        float* significance = (float*)arenaAlloc(&sceneArena, list->capacity * sizeof(float));
+        if(list->nbSignificant > 0) {
+            memcpy(significance, list->significance, list->nbSignificant * sizeof(float));
+        }
+        arenaFree(&sceneArena, list->significance, list->significanceCapacity * sizeof(float));
+        list->significance = significance;
+        list->significanceCapacity = list->capacity;
+    }
+    if(list->nbSignificant > 0 && list->nbSignificant < list->nbPoints && list->nbPoints < 2 * list->nbSignificantBase) {
+        first = list->nbSignificant - 1;
+    }
+    else {
+        list->nbSignificantBase = list->nbPoints;
+    }
+    list->nbSignificant = list->nbPoints;
+    if(list->nbPoints == 0) {
+        return;
+    }
+
+    /* Les extrémités sont toujours gardées */
+    list->significance[first] = FLT_MAX;
+    list->significance[list->nbPoints - 1] = FLT_MAX;
+    if(list->nbPoints - first < 3) {
+        return;
+    }
+    significanceSpans(list, first, list->nbPoints - 1);
+
+    return;
+}
+
+/* Dessine une ligne brisée (ou fermée) en sautant les sommets dont l'écart est inférieur à tolerance */
+void drawDecimatedStrip(PointList* list, float tolerance) {
+    unsigned int i;
+
+    computeSignificance(list);
+    for(i = 0 ; i < list->nbPoints ; i++) {
+        if(list->significance[i] >= tolerance) {
+            Point point = getPoint(list, i);
+            glColor3ub(point.r, point.g, point.b);
+            glVertex2f(point.x, point.y);
+        }
+        else {
+            decimatedVertices++;
+        }
+    }
+
+    return;
+}
+
+/* Dessine des segments indépendants en sautant ceux qui tiennent dans un demi-pixel autour de la fin du segment précédent */
+void drawDecimatedSegments(const PointList* list, float tolerance) {
+    unsigned int i;
+    float lastX = 0, lastY = 0;
+    int hasLast = 0;
+    float half2 = tolerance * tolerance / 4;
+
+    for(i = 0 ; i + 1 < list->nbPoints ; i += 2) {
+        Point start = getPoint(list, i);
+        Point end = getPoint(list, i + 1);
+        float startGap2 = (start.x - lastX) * (start.x - lastX) + (start.y - lastY) * (start.y - lastY);
+        float length2 = (end.x - start.x) * (end.x - start.x) + (end.y - start.y) * (end.y - start.y);
+
+        if(hasLast && startGap2 < half2 && length2 < half2) {
+            decimatedVertices += 2;
+            continue;
+        }
+        glColor3ub(start.r, start.g, start.b);
+        glVertex2f(start.x, start.y);
+        glColor3ub(end.r, end.g, end.b);
+        glVertex2f(end.x, end.y);
+        lastX = end.x;
+        lastY = end.y;
+        hasLast = 1;
+    }
+
+    return;
+}
+
+/* Dessine des triangles (ou quadrilatères) indépendants vus de loin : ceux qui dépassent un pixel sont envoyés en entier, */
+/* les autres sont remplacés par leur premier sommet, au plus un par pixel de la boîte de la primitive */
+void drawDecimatedShapes(const Primitive* primitive, float tolerance) {
+    const PointList* list = &primitive->points;
+    const BoundingBox* box = &list->box;
+    unsigned int i, k, pass;
+    unsigned int shape = primitive->primitiveType == GL_TRIANGLES ? 3 : 4;
+    unsigned int width = (box->maxX - box->minX) / tolerance + 1;
+    unsigned int height = (box->maxY - box->minY) / tolerance + 1;
+    unsigned char* covered = (unsigned char*)arenaAlloc(&sceneArena, (width * height + 7) / 8);
+
+    memset(covered, 0, (width * height + 7) / 8);
+    for(pass = 0 ; pass < 2 ; pass++) {
+        glBegin(pass == 0 ? primitive->primitiveType : GL_POINTS);
+        for(i = 0 ; i + shape <= list->nbPoints ; i += shape) {
+            Point first = getPoint(list, i);
+            float minX = first.x, maxX = first.x, minY = first.y, maxY = first.y;
+            for(k = 1 ; k < shape ; k++) {
+                Point point = getPoint(list, i + k);
+                minX = point.x < minX ? point.x : minX;
+                maxX = point.x > maxX ? point.x : maxX;
+                minY = point.y < minY ? point.y : minY;
+                maxY = point.y > maxY ? point.y : maxY;
+            }
+            if(maxX - minX >= tolerance || maxY - minY >= tolerance) {
+                for(k = 0 ; pass == 0 && k < shape ; k++) {
+                    Point point = getPoint(list, i + k);
+                    glColor3ub(point.r, point.g, point.b);
+                    glVertex2f(point.x, point.y);
+                }
+            }
+            else if(pass == 1) {
+                unsigned int cellX = (first.x - box->minX) / tolerance, cellY = (first.y - box->minY) / tolerance;
+                unsigned int cell = (cellY < height ? cellY : height - 1) * width + (cellX < width ? cellX : width - 1);
+                if(covered[cell / 8] & (1 << (cell % 8))) {
+                    decimatedVertices += shape;
+                    continue;
+                }
+                covered[cell / 8] |= 1 << (cell % 8);
+                glColor3ub(first.r, first.g, first.b);
+                glVertex2f(first.x, first.y);
+                decimatedVertices += shape - 1;
+            }
+        }
+        glEnd();
+    }
+    drawCalls++;
+    arenaFree(&sceneArena, covered, (width * height + 7) / 8);
+
+    return;
+}
+
+/* 1 si la primitive, vue de loin, envoie bien moins de sommets par glBegin que par le tampon qui les dessinerait tous : */
+/* une primitive qui tient dans un pixel (un seul point), une ligne qui a plus de sommets que de pixels sur le pourtour de sa boîte */
+/* (la simplification en retire la plupart), ou des triangles ou quadrilatères plus nombreux que les pixels de leur boîte */
+int isPrimitiveDecimated(const Primitive* primitive, float tolerance) {
+    const BoundingBox* box = &primitive->points.box;
+    float width = (box->maxX - box->minX) / tolerance;
+    float height = (box->maxY - box->minY) / tolerance;
+
+    if(primitive->points.nbPoints <= 32 || primitive->primitiveType == GL_POINTS) {
+        return 0;
+    }
+    if(width < 1 && height < 1) {
+        return 1;
+    }
+    switch(primitive->primitiveType) {
+        case GL_LINES:
+        case GL_LINE_STRIP:
+        case GL_LINE_LOOP:
+            return primitive->points.nbPoints > 2 * (width + height);
+        case GL_TRIANGLES:
+            return primitive->points.nbPoints / 3 > (width + 1) * (height + 1);
+        case GL_QUADS:
+            return primitive->points.nbPoints / 4 > (width + 1) * (height + 1);
+    }
+
+    return 0;
+}
+
+void drawPrimitives(PrimitiveList list){
+    GLfloat projection[16], modelview[16], matrix[16];
+    float pixelSize, lineTolerance, pixelMargin;
+    unsigned int nbVisible = 0;
+    int useBuffers = renderBackend == RENDER_BUFFERS && buffersSupported();
+    BoundingBox view;
+
+    /* Le repère visible est celui de la projection courante (la caméra) et de la modelview */
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    multiplyMatrices(projection, modelview, matrix);
+    drawnPrimitives = 0;
+    culledPrimitives = 0;
+    drawCalls = 0;
+    uploadedBytes = 0;
+    drawnLodPoints = 0;
+    decimatedVertices = 0;
+
+    /* Taille d'un pixel dans le repère de la scène : en x pour la pyramide, la plus petite des deux pour les lignes */
+    pixelSize = 2 / (sqrt(matrix[0] * matrix[0] + matrix[1] * matrix[1]) * WINDOW_WIDTH);
+    lineTolerance = 2 / (sqrt(matrix[4] * matrix[4] + matrix[5] * matrix[5]) * WINDOW_HEIGHT);
+    /* Deux primitives à moins de deux pixels l'une de l'autre peuvent toucher les mêmes pixels */
+    pixelMargin = 2 * (pixelSize > lineTolerance ? pixelSize : lineTolerance);
+    if(pixelSize < lineTolerance) {
+        lineTolerance = pixelSize;
+    }
+
+    /* Vu de loin, les primitives GL_POINTS sont remplacées par les représentants de leur pyramide */
+    lodLevel = chooseLodLevel(pixelSize);
+    if(lodLevel >= 0) {
+        updateLodPyramid(list);
+    }
+    visibleWorldBox(matrix, &view);
+
+    while(list) {
+        /* Une primitive vide ou entièrement hors du repère n'est pas envoyée */
+        if(list->points.nbPoints > 0) {
+            if(isBoxVisible(&list->points.box, matrix)) {
+                int decimated = isPrimitiveDecimated(list, lineTolerance);
+                /* Dans un tampon, un sommet ne coûte plus d'appel au pilote : seules les primitives que la réduction vue de loin allège beaucoup passent par glBegin */
+                /* Les primitives visibles sont mises de côté pour être dessinées par lots ; celles d'un type inconnu n'ont pas de lot et restent à glBegin */
+                if(useBuffers && !decimated && !(lodLevel >= 0 && list->primitiveType == GL_POINTS) && list->primitiveType <= GL_POLYGON) {
+                    reserveDrawList(nbVisible + 1);
+                    vertexBuffers.drawList[nbVisible++] = list;
+                }
+                else {
+                    /* Les lots mis de côté sont dessinés avant, pour garder l'ordre de la liste */
+                    if(nbVisible > 0) {
+                        drawVertexBuffers(nbVisible, &view, pixelMargin);
+                        nbVisible = 0;
+                    }
+                    if(lodLevel >= 0 && list->primitiveType == GL_POINTS) {
+                        drawLodTiles(&list->points, lodLevel, &view);
+                        drawCalls++;
+                    }
+                    else if(decimated && (list->primitiveType == GL_TRIANGLES || list->primitiveType == GL_QUADS)) {
+                        drawDecimatedShapes(list, lineTolerance);
+                    }
+                    else if(decimated && list->points.box.maxX - list->points.box.minX < lineTolerance && list->points.box.maxY - list->points.box.minY < lineTolerance) {
+                        /* Toute la primitive tient dans un pixel : un point suffit */
+                        Point point = getPoint(&list->points, 0);
+                        glBegin(GL_POINTS);
+                        glColor3ub(point.r, point.g, point.b);
+                        glVertex2f(point.x, point.y);
+                        glEnd();
+                        decimatedVertices += list->points.nbPoints - 1;
+                        drawCalls++;
+                    }
+                    else {
+                        glBegin(list->primitiveType);
+                        /* Les longues lignes sont simplifiées à un pixel près selon le zoom */
+                        if(list->points.nbPoints > 32 && (list->primitiveType == GL_LINE_STRIP || list->primitiveType == GL_LINE_LOOP)) {
+                            drawDecimatedStrip(&list->points, lineTolerance);
+                        }
+                        else if(list->points.nbPoints > 32 && list->primitiveType == GL_LINES) {
+                            drawDecimatedSegments(&list->points, lineTolerance);
+                        }
+                        else {
+                            drawPoints(&list->points);
+                        }
+                        glEnd();
+                        drawCalls++;
+                    }
+                }
+                /* glBegin refuse un type inconnu : rien n'a été dessiné */
+                if(list->primitiveType <= GL_POLYGON) {
+                    drawnPrimitives++;
+                }
+            }
+            else {
+                culledPrimitives++;
+            }
+        }
+        list = list->next;
+    }
+    if(nbVisible > 0) {
+        drawVertexBuffers(nbVisible, &view, pixelMargin);
+    }
+
+    return;
+}
+
+/* Renvoie les statistiques de la scène et de la dernière image : tout est tenu à jour, rien n'est recompté */
+SceneStatistics getSceneStatistics(void) {
+    SceneStatistics statistics = sceneStatistics;
+
+    statistics.heapUsed = sceneArena.bytesUsed;
+    statistics.heapReserved = sceneArena.bytesReserved;
+    statistics.drawnPrimitives = drawnPrimitives;
+    statistics.culledPrimitives = culledPrimitives;
+    statistics.drawCalls = drawCalls;
+    statistics.uploadedBytes = uploadedBytes;
+    statistics.streamedBytes = streamRing.streamedBytes;
+    statistics.streamWaits = streamRing.waits;
+    statistics.renderPackets = renderQueue.drawnPackets;
+    statistics.stateChanges = renderQueue.stateChanges;
+    statistics.lodLevel = lodLevel;
+    statistics.drawnLodPoints = drawnLodPoints;
+    statistics.decimatedVertices = decimatedVertices;
+
+    return statistics;
+}
+
+/* Écrit les statistiques au format STATISTICS_CSV ou STATISTICS_JSON, d'un seul fwrite : renvoie 0 si l'écriture a échoué */
+int writeSceneStatistics(FILE* file, int format) {
+    static const char* TYPE_NAMES[GL_POLYGON + 2] = {"points", "lines", "line_loop", "line_strip", "triangles", "triangle_strip", "triangle_fan", "quads", "quad_strip", "polygon", "other"};
+    SceneStatistics statistics = getSceneStatistics();
+    char buffer[2048];
+    int length = 0;
+    unsigned int i;
+
+    if(format == STATISTICS_JSON) {
+        length += snprintf(buffer + length, sizeof(buffer) - length, "{\"primitives\":{");
+        for(i = 0 ; i < GL_POLYGON + 2 ; i++) {
+            length += snprintf(buffer + length, sizeof(buffer) - length, "%s\"%s\":%u", i > 0 ? "," : "", TYPE_NAMES[i], statistics.nbPrimitives[i]);
+        }
+        length += snprintf(buffer + length, sizeof(buffer) - length, "},\"total_primitives\":%u,\"vertices\":%llu,\"used_bytes\":%llu,\"reserved_bytes\":%llu,\"heap_used_bytes\":%llu,\"heap_reserved_bytes\":%llu,"
+            "\"drawn_primitives\":%u,\"culled_primitives\":%u,\"draw_calls\":%u,\"uploaded_bytes\":%llu,\"streamed_bytes\":%llu,\"stream_waits\":%u,\"render_packets\":%u,\"state_changes\":%u,\"lod_level\":%d,\"lod_points\":%u,\"decimated_vertices\":%u,\"expanded_lists\":%u,\"journal_merged\":%u,\"journal_forgotten\":%u}\n",
+            statistics.totalPrimitives, statistics.nbVertices, statistics.usedBytes, statistics.reservedBytes, (unsigned long long)statistics.heapUsed, (unsigned long long)statistics.heapReserved,
+            statistics.drawnPrimitives, statistics.culledPrimitives, statistics.drawCalls, statistics.uploadedBytes, statistics.streamedBytes, statistics.streamWaits, statistics.renderPackets, statistics.stateChanges, statistics.lodLevel, statistics.drawnLodPoints, statistics.decimatedVertices, statistics.expandedLists, statistics.mergedSteps, statistics.forgottenSteps);
+    }
+    else {
+        for(i = 0 ; i < GL_POLYGON + 2 ; i++) {
+            length += snprintf(buffer + length, sizeof(buffer) - length, "%s,", TYPE_NAMES[i]);
+        }
+        length += snprintf(buffer + length, sizeof(buffer) - length, "total_primitives,vertices,used_bytes,reserved_bytes,heap_used_bytes,heap_reserved_bytes,drawn_primitives,culled_primitives,draw_calls,uploaded_bytes,streamed_bytes,stream_waits,render_packets,state_changes,lod_level,lod_points,decimated_vertices,expanded_lists,journal_merged,journal_forgotten\n");
+        for(i = 0 ; i < GL_POLYGON + 2 ; i++) {
+            length += snprintf(buffer + length, sizeof(buffer) - length, "%u,", statistics.nbPrimitives[i]);
+        }
+        length += snprintf(buffer + length, sizeof(buffer) - length, "%u,%llu,%llu,%llu,%llu,%llu,%u,%u,%u,%llu,%llu,%u,%u,%u,%d,%u,%u,%u,%u,%u\n",
+            statistics.totalPrimitives, statistics.nbVertices, statistics.usedBytes, statistics.reservedBytes, (unsigned long long)statistics.heapUsed, (unsigned long long)statistics.heapReserved,
+            statistics.drawnPrimitives, statistics.culledPrimitives, statistics.drawCalls, statistics.uploadedBytes, statistics.streamedBytes, statistics.streamWaits, statistics.renderPackets, statistics.stateChanges, statistics.lodLevel, statistics.drawnLodPoints, statistics.decimatedVertices, statistics.expandedLists, statistics.mergedSteps, statistics.forgottenSteps);
+    }
+
+    /* Le tampon est assez grand pour tous les compteurs : la ligne n'est jamais coupée au milieu d'une autre écriture */
+    if(fwrite(buffer, 1, length, file) != (size_t)length) {
+        return 0;
+    }
+
+    return fflush(file) == 0;
+}
+
+/* Opérations de masse sur les points : un seul noyau (AVX, SSE ou scalaire) pour toutes les transformations */
+
+/* Applique x' = a * x + b * y + tx et y' = c * x + d * y + ty à nbPoints positions x, y consécutives */
+void transformPositions(float* positions, unsigned int nbPoints, float a, float b, float c, float d, float tx, float ty) {
+    unsigned int i = 0;
+    unsigned int nbFloats = 2 * nbPoints;
+
+#if defined(__AVX__)
+    /* 4 points par tour : on échange x et y dans chaque paire pour avoir les termes croisés */
+    __m256 diagonal = _mm256_setr_ps(a, d, a, d, a, d, a, d);
+    __m256 cross = _mm256_setr_ps(b, c, b, c, b, c, b, c);
+    __m256 translation = _mm256_setr_ps(tx, ty, tx, ty, tx, ty, tx, ty);
+    for( ; i + 8 <= nbFloats ; i += 8) {
+        __m256 xy = _mm256_loadu_ps(positions + i);
+        __m256 yx = _mm256_permute_ps(xy, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm256_storeu_ps(positions + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xy, diagonal), _mm256_mul_ps(yx, cross)), translation));
+    }
+#elif defined(__SSE__)
+    /* 2 points par tour */
+    __m128 diagonal = _mm_setr_ps(a, d, a, d);
+    __m128 cross = _mm_setr_ps(b, c, b, c);
+    __m128 translation = _mm_setr_ps(tx, ty, tx, ty);
+    for( ; i + 4 <= nbFloats ; i += 4) {
+        __m128 xy = _mm_loadu_ps(positions + i);
+        __m128 yx = _mm_shuffle_ps(xy, xy, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_ps(positions + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xy, diagonal), _mm_mul_ps(yx, cross)), translation));
+    }
+#endif
+
+    /* Les points restants (ou tous, sans SIMD) sont traités un par un */
+    for( ; i < nbFloats ; i += 2) {
+        float x = positions[i];
+        float y = positions[i + 1];
+        positions[i] = a * x + b * y + tx;
+        positions[i + 1] = c * x + d * y + ty;
+    }
+
+    return;
+}
+
+/* Calcule la boîte englobante de nbPoints positions (nbPoints doit être non nul) */
+void boundingBoxPositions(const float* positions, unsigned int nbPoints, BoundingBox* box) {
+    unsigned int i = 0;
+    unsigned int nbFloats = 2 * nbPoints;
+    float minX = positions[0], minY = positions[1], maxX = positions[0], maxY = positions[1];
+
+#if defined(__SSE__)
+    /* Les minimums et maximums sont gardés sous la forme x, y, x, y puis repliés à la fin */
+    if(nbFloats >= 4) {
+        __m128 minimum = _mm_loadu_ps(positions);
+        __m128 maximum = minimum;
+        float tmp[4];
+        for(i = 4 ; i + 4 <= nbFloats ; i += 4) {
+            __m128 xy = _mm_loadu_ps(positions + i);
+            minimum = _mm_min_ps(minimum, xy);
+            maximum = _mm_max_ps(maximum, xy);
+        }
+        _mm_storeu_ps(tmp, _mm_min_ps(minimum, _mm_movehl_ps(minimum, minimum)));
+        minX = tmp[0];
+        minY = tmp[1];
+        _mm_storeu_ps(tmp, _mm_max_ps(maximum, _mm_movehl_ps(maximum, maximum)));
+        maxX = tmp[0];
+        maxY = tmp[1];
+    }
+#endif
+
+    for( ; i < nbFloats ; i += 2) {
+        if(positions[i] < minX) {
+            minX = positions[i];
+        }
+        if(positions[i] > maxX) {
+            maxX = positions[i];
+        }
+        if(positions[i + 1] < minY) {
+            minY = positions[i + 1];
+        }
+        if(positions[i + 1] > maxY) {
+            maxY = positions[i + 1];
+        }
+    }
+
+    box->minX = minX;
+    box->minY = minY;
+    box->maxX = maxX;
+    box->maxY = maxY;
+
+    return;
+}
+
+/* Ajoute count points d'un coup en fin de tableau (positions x0, y0, x1... et colors r0, g0, b0...) : une seule copie par tableau */
+void appendPoints(PointList* list, const float* positions, const unsigned char* colors, unsigned int count) {
+    BoundingBox box;
+
+    if(count == 0) {
+        return;
+    }
+    reservePoints(list, list->nbPoints + count);
+    if(list->nbPoints < list->nbShared) {
+        unsharePoints(list);
+    }
+    memcpy(list->positions + 2 * list->nbPoints, positions, 2 * count * sizeof(float));
+    memcpy(list->colors + 3 * list->nbPoints, colors, 3 * count * sizeof(unsigned char));
+
+    boundingBoxPositions(positions, count, &box);
+    if(list->nbPoints == 0) {
+        list->box = box;
+    }
+    else {
+        list->box.minX = box.minX < list->box.minX ? box.minX : list->box.minX;
+        list->box.minY = box.minY < list->box.minY ? box.minY : list->box.minY;
+        list->box.maxX = box.maxX > list->box.maxX ? box.maxX : list->box.maxX;
+        list->box.maxY = box.maxY > list->box.maxY ? box.maxY : list->box.maxY;
+    }
+    /* Plutôt que d'insérer chaque point, la grille sera reconstruite quand on en aura besoin */
+    invalidateSpatialGrid();
+    countPoints(list, -1);
+    list->nbPoints += count;
+    countPoints(list, 1);
+
+    return;
+}
+
+/* Une sélection est la plage [first, first + count[ d'un tableau : count est ramené à la fin du tableau */
+unsigned int clampSelection(const PointList* list, unsigned int first, unsigned int count) {
+
+    if(first >= list->nbPoints) {
+        return 0;
+    }
+    if(count > list->nbPoints - first) {
+        count = list->nbPoints - first;
+    }
+
+    return count;
+}
+
+/* Transforme un tableau compact sans le repasser au format flottant : les points sont décodés dans un tableau temporaire, */
+/* transformés, puis requantifiés dans la nouvelle boîte englobante (à un demi-pas de quantification près pour tous les points) */
+void transformCompactPoints(PointList* list, unsigned int first, unsigned int count, float a, float b, float c, float d, float tx, float ty) {
+    unsigned int i;
+    float* positions = (float*)arenaAlloc(&sceneArena, 2 * list->nbPoints * sizeof(float));
+    unsigned short* quantized = (unsigned short*)arenaAlloc(&sceneArena, 2 * list->nbPoints * sizeof(unsigned short));
+    unsigned char* colorIndices = (unsigned char*)arenaAlloc(&sceneArena, list->nbPoints * sizeof(unsigned char));
+
+    for(i = 0 ; i < list->nbPoints ; i++) {
+        positions[i * 2] = dequantizeCoord(list->quantized[i * 2], list->box.minX, list->box.maxX);
+        positions[i * 2 + 1] = dequantizeCoord(list->quantized[i * 2 + 1], list->box.minY, list->box.maxY);
+    }
+    transformPositions(positions + 2 * first, count, a, b, c, d, tx, ty);
+    boundingBoxPositions(positions, list->nbPoints, &list->box);
+    for(i = 0 ; i < list->nbPoints ; i++) {
+        quantized[i * 2] = quantizeCoord(positions[i * 2], list->box.minX, list->box.maxX);
+        quantized[i * 2 + 1] = quantizeCoord(positions[i * 2 + 1], list->box.minY, list->box.maxY);
+    }
+    memcpy(colorIndices, list->colorIndices, list->nbPoints * sizeof(unsigned char));
+    arenaFree(&sceneArena, positions, 2 * list->nbPoints * sizeof(float));
+
+    /* Les anciens tableaux restent aux instantanés (ou à la projection) qui les lisent */
+    countPoints(list, -1);
+    freePointArrays(list);
+    list->quantized = quantized;
+    list->colorIndices = colorIndices;
+    list->capacity = list->nbPoints;
+    countPoints(list, 1);
+    touchPoints(list, 0, list->nbPoints);
+
+    return;
+}
+
+void transformPoints(PointList* list, unsigned int first, unsigned int count, float a, float b, float c, float d, float tx, float ty) {
+
+    count = clampSelection(list, first, count);
+    if(count == 0) {
+        return;
+    }
+
+    /* Un tableau compact le reste ; sinon on travaille sur des points qu'aucun instantané ne lit */
+    if(list->quantized) {
+        transformCompactPoints(list, first, count, a, b, c, d, tx, ty);
+    }
+    else {
+        unsharePoints(list);
+        transformPositions(list->positions + 2 * first, count, a, b, c, d, tx, ty);
+        touchPoints(list, first, first + count);
+        boundingBoxPositions(list->positions, list->nbPoints, &list->box);
+    }
+    list->nbSignificant = 0;
+    invalidateSpatialGrid();
+    invalidateLodPyramid();
+    {
+        float matrix[6] = {a, b, c, d, tx, ty};
+        autosaveAppend(AUTOSAVE_TRANSFORM, list->autosaveId, count, first, matrix, sizeof(matrix), NULL, 0);
+    }
+
+    return;
+}
+
+void translatePoints(PointList* list, unsigned int first, unsigned int count, float tx, float ty) {
+    transformPoints(list, first, count, 1, 0, 0, 1, tx, ty);
+}
+
+/* Mise à l'échelle autour du centre (cx, cy) */
+void scalePoints(PointList* list, unsigned int first, unsigned int count, float sx, float sy, float cx, float cy) {
+    transformPoints(list, first, count, sx, 0, 0, sy, cx - sx * cx, cy - sy * cy);
+}
+
+/* Rotation d'angle en degrés (comme glRotatef) autour du centre (cx, cy) */
+void rotatePoints(PointList* list, unsigned int first, unsigned int count, float angle, float cx, float cy) {
+    float cosAngle = cos(angle * M_PI / 180.);
+    float sinAngle = sin(angle * M_PI / 180.);
+
+    transformPoints(list, first, count, cosAngle, -sinAngle, sinAngle, cosAngle, cx - cosAngle * cx + sinAngle * cy, cy - sinAngle * cx - cosAngle * cy);
+}
+
+void recolorPoints(PointList* list, unsigned int first, unsigned int count, unsigned char r, unsigned char g, unsigned char b) {
+    unsigned int i;
+
+    count = clampSelection(list, first, count);
+    if(count == 0) {
+        return;
+    }
+
+    /* Un tableau compact le reste si la couleur est dans la palette : seul son indice est écrit */
+    if(list->quantized && paletteIndex(r, g, b) >= 0) {
+        unsharePoints(list);
+        memset(list->colorIndices + first, paletteIndex(r, g, b), count);
+    }
+    else {
+        expandPoints(list);
+        unsharePoints(list);
+        unsigned char* color = list->colors + 3 * first;
+        for(i = 0 ; i < count ; i++) {
+            color[0] = r;
+            color[1] = g;
+            color[2] = b;
+            color += 3;
+        }
+    }
+    touchPoints(list, first, first + count);
+    {
+        unsigned char rgb[4] = {r, g, b, 0};
+        autosaveAppend(AUTOSAVE_RECOLOR, list->autosaveId, count, first, rgb, sizeof(rgb), NULL, 0);
+    }
+
+    return;
+}
+
+/* Boîte englobante d'une sélection : renvoie 0 si elle est vide */
+int boundingBoxPoints(const PointList* list, unsigned int first, unsigned int count, BoundingBox* box) {
+    unsigned int i;
+
+    count = clampSelection(list, first, count);
+    if(count == 0) {
+        return 0;
+    }
+
+    /* Pour tout le tableau, la boîte tenue à jour par addPointToList suffit */
+    if(count == list->nbPoints) {
+        *box = list->box;
+        return 1;
+    }
+
+    /* Au format compact on cherche les extrêmes sur les entiers puis on décode seulement ceux-là */
+    if(list->quantized) {
+        const unsigned short* quantized = list->quantized + 2 * first;
+        unsigned short minX = quantized[0], minY = quantized[1], maxX = quantized[0], maxY = quantized[1];
+        for(i = 1 ; i < count ; i++) {
+            if(quantized[i * 2] < minX) {
+                minX = quantized[i * 2];
+            }
+            if(quantized[i * 2] > maxX) {
+                maxX = quantized[i * 2];
+            }
+            if(quantized[i * 2 + 1] < minY) {
+                minY = quantized[i * 2 + 1];
+            }
+            if(quantized[i * 2 + 1] > maxY) {
+                maxY = quantized[i * 2 + 1];
+            }
+        }
+        box->minX = dequantizeCoord(minX, list->box.minX, list->box.maxX);
+        box->minY = dequantizeCoord(minY, list->box.minY, list->box.maxY);
+        box->maxX = dequantizeCoord(maxX, list->box.minX, list->box.maxX);
+        box->maxY = dequantizeCoord(maxY, list->box.minY, list->box.maxY);
+        return 1;
+    }
+
+    boundingBoxPositions(list->positions + 2 * first, count, box);
+
+    return 1;
+}
+
+/* Applique la même transformation à toutes les primitives de la liste */
+void transformPrimitives(PrimitiveList list, float a, float b, float c, float d, float tx, float ty) {
+
+    while(list) {
+        transformPoints(&list->points, 0, list->points.nbPoints, a, b, c, d, tx, ty);
+        list = list->next;
+    }
+
+    return;
+}
+
+/* Boîte englobante de toute la liste : renvoie 0 si elle ne contient aucun point */
+int boundingBoxPrimitives(PrimitiveList list, BoundingBox* box) {
+    BoundingBox primitiveBox;
+    int found = 0;
+
+    while(list) {
+        if(boundingBoxPoints(&list->points, 0, list->points.nbPoints, &primitiveBox)) {
+            if(!found) {
+                *box = primitiveBox;
+                found = 1;
+            }
+            else {
+                box->minX = primitiveBox.minX < box->minX ? primitiveBox.minX : box->minX;
+                box->minY = primitiveBox.minY < box->minY ? primitiveBox.minY : box->minY;
+                box->maxX = primitiveBox.maxX > box->maxX ? primitiveBox.maxX : box->maxX;
+                box->maxY = primitiveBox.maxY > box->maxY ? primitiveBox.maxY : box->maxY;
+            }
+        }
+        list = list->next;
+    }
+
+    return found;
+}
+
+int boundingBoxSelection(PrimitiveList list, Primitive* selection, BoundingBox* box) {
+
+    if(selection) {
+        return boundingBoxPoints(&selection->points, 0, selection->points.nbPoints, box);
+    }
+
+    return boundingBoxPrimitives(list, box);
+}
+
+/* Caméra : région du canevas visible, application à la projection, zoom et déplacement */
+
+void cameraView(BoundingBox* view) {
+    float halfWidth = (ORTHO_RIGHT - ORTHO_LEFT) / (2 * camera.zoom);
+    float halfHeight = (ORTHO_TOP - ORTHO_BOTTOM) / (2 * camera.zoom);
+    float centerX = (ORTHO_LEFT + ORTHO_RIGHT) / 2 + camera.panX;
+    float centerY = (ORTHO_BOTTOM + ORTHO_TOP) / 2 + camera.panY;
+
+    view->minX = centerX - halfWidth;
+    view->maxX = centerX + halfWidth;
+    view->minY = centerY - halfHeight;
+    view->maxY = centerY + halfHeight;
+
+    return;
+}
+
+/* Charge la projection de la caméra (ou le cadre fixe du TD si enabled vaut 0, pour la palette) */
+void applyCamera(int enabled) {
+    BoundingBox view;
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    if(enabled) {
+        cameraView(&view);
+        gluOrtho2D(view.minX, view.maxX, view.minY, view.maxY);
+    }
+    else {
+        gluOrtho2D(ORTHO_LEFT, ORTHO_RIGHT, ORTHO_BOTTOM, ORTHO_TOP);
+    }
+    glMatrixMode(GL_MODELVIEW);
+
+    return;
+}
+
+/* Conversion des coordonnées de la fenêtre (en pixels, y vers le bas) vers celles du canevas, à travers la caméra */
+void windowToWorld(int px, int py, float* x, float* y) {
+    BoundingBox view;
+
+    cameraView(&view);
+    *x = view.minX + (view.maxX - view.minX) * px / WINDOW_WIDTH;
+    *y = view.maxY - (view.maxY - view.minY) * py / WINDOW_HEIGHT;
+}
+
+/* Même conversion pour nbPoints positions en pixels, faite en place avec le noyau de transformation */
+void windowToWorldPositions(float* positions, unsigned int nbPoints) {
+    BoundingBox view;
+
+    cameraView(&view);
+    transformPositions(positions, nbPoints, (view.maxX - view.minX) / WINDOW_WIDTH, 0, 0, -(view.maxY - view.minY) / WINDOW_HEIGHT, view.minX, view.maxY);
+}
+
+/* Zoome de factor en gardant immobile le point du canevas qui est sous le pixel (px, py) */
+void zoomCamera(float factor, int px, int py) {
+    float beforeX, beforeY, afterX, afterY;
+
+    windowToWorld(px, py, &beforeX, &beforeY);
+    camera.zoom *= factor;
+    windowToWorld(px, py, &afterX, &afterY);
+    camera.panX += beforeX - afterX;
+    camera.panY += beforeY - afterY;
+
+    return;
+}
+
+/* Fait glisser le canevas de (dx, dy) pixels, comme si on le tirait avec la souris */
+void panCamera(int dx, int dy) {
+    BoundingBox view;
+
+    cameraView(&view);
+    camera.panX -= dx * (view.maxX - view.minX) / WINDOW_WIDTH;
+    camera.panY += dy * (view.maxY - view.minY) / WINDOW_HEIGHT;
+
+    return;
+}
+
+void resetCamera() {
+    camera.panX = 0;
+    camera.panY = 0;
+    camera.zoom = 1;
+}
+
+/* Passe au format compact toutes les primitives de la liste (celles dont une couleur est hors palette restent flottantes) */
+void compactPrimitives(PrimitiveList list) {
+
+    while(list) {
+        compactPoints(&list->points);
+        list = list->next;
+    }
+
+    return;
+}
+
+/* Dessine le contour de la boîte (pour montrer la primitive sélectionnée) */
+void drawBoundingBox(const BoundingBox* box) {
+
+    glColor3ub(255, 255, 0);
+    glBegin(GL_LINE_LOOP);
+        glVertex2f(box->minX, box->minY);
+        glVertex2f(box->maxX, box->minY);
+        glVertex2f(box->maxX, box->maxY);
+        glVertex2f(box->minX, box->maxY);
+    glEnd();
+
+    return;
+}
+
+/* Requêtes sur la grille spatiale : point le plus proche, sélection d'une primitive et gomme */
+
+/* Reconstruit la grille si des points ont bougé en masse depuis la dernière requête */
+void refreshSpatialGrid(PrimitiveList list) {
+
+    if(!spatialGrid.dirty) {
+        return;
+    }
+    clearSpatialGrid();
+    spatialGrid.cellSize = (ORTHO_RIGHT - ORTHO_LEFT) / 256.;
+    while(list) {
+        indexPoints(&list->points);
+        list = list->next;
+    }
+
+    return;
+}
+
+/* Cherche le point le plus proche de (x, y) à moins de maxDistance : renvoie 0 s'il n'y en a pas */
+int findNearestPoint(PrimitiveList scene, float x, float y, float maxDistance, PointList** foundList, unsigned int* foundIndex) {
+    int cellX, cellY;
+    unsigned int i;
+    float bestDistance = maxDistance * maxDistance;
+    int found = 0;
+
+    refreshSpatialGrid(scene);
+    if(spatialGrid.cellSize == 0) {
+        return 0;
+    }
+
+    /* Seules les cases qui touchent le disque de rayon maxDistance sont parcourues */
+    for(cellX = gridCellCoord(x - maxDistance) ; cellX <= gridCellCoord(x + maxDistance) ; cellX++) {
+        for(cellY = gridCellCoord(y - maxDistance) ; cellY <= gridCellCoord(y + maxDistance) ; cellY++) {
+            GridCell* cell = findGridCell(cellX, cellY, 0);
+            if(!cell) {
+                continue;
+            }
+            for(i = 0 ; i < cell->nbEntries ; i++) {
+                Point point = getPoint(cell->entries[i].list, cell->entries[i].index);
+                float distance = (point.x - x) * (point.x - x) + (point.y - y) * (point.y - y);
+                if(distance <= bestDistance) {
+                    bestDistance = distance;
+                    *foundList = cell->entries[i].list;
+                    *foundIndex = cell->entries[i].index;
+                    found = 1;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+/* Renvoie la primitive qui possède le point le plus proche de (x, y), ou NULL */
+Primitive* selectPrimitive(PrimitiveList scene, float x, float y, float maxDistance) {
+    PointList* foundList;
+    unsigned int foundIndex;
+
+    if(!findNearestPoint(scene, x, y, maxDistance, &foundList, &foundIndex)) {
+        return NULL;
+    }
+    while(scene && &scene->points != foundList) {
+        scene = scene->next;
+    }
+
+    return scene;
+}
+
+/* Fonctions de modification des tableaux partagées par la gomme et le journal */
+
+/* Enlève de list les count points d'indices croissants indices, en gardant l'ordre des autres : seuls les points qui suivent le premier enlevé */
+/* sont déplacés, et seules leurs entrées de la grille sont corrigées. Comme pour truncatePoints, la boîte englobante n'est pas réduite : */
+/* elle reste valable pour le fenêtrage, et les points gardés d'un tableau compact sont tassés sans être requantifiés */
+void removeIndexedPoints(PointList* list, const unsigned int* indices, unsigned int count) {
+    unsigned int i, k = 0, nbPoints = list->nbPoints;
+
+    if(count == 0) {
+        return;
+    }
+    unsharePoints(list);
+    for(i = indices[0] ; i < nbPoints ; i++) {
+        int removed = k < count && indices[k] == i;
+        if(!spatialGrid.dirty) {
+            Point point = getPoint(list, i);
+            if(removed) {
+                gridRemove(list, i, point.x, point.y);
+            }
+            else {
+                gridMove(list, i, i - k, point.x, point.y);
+            }
+        }
+        if(removed) {
+            k++;
+        }
+        else if(list->quantized) {
+            list->quantized[(i - k) * 2] = list->quantized[i * 2];
+            list->quantized[(i - k) * 2 + 1] = list->quantized[i * 2 + 1];
+            list->colorIndices[i - k] = list->colorIndices[i];
+        }
+        else {
+            list->positions[(i - k) * 2] = list->positions[i * 2];
+            list->positions[(i - k) * 2 + 1] = list->positions[i * 2 + 1];
+            memmove(list->colors + (i - k) * 3, list->colors + i * 3, 3);
+        }
+    }
+    countPoints(list, -1);
+    list->nbPoints = nbPoints - count;
+    countPoints(list, 1);
+    /* Les points avant le premier enlevé n'ont pas bougé */
+    touchPoints(list, indices[0], list->nbPoints);
+    list->nbSignificant = 0;
+    if(list->nbLodPoints > 0) {
+        invalidateLodPyramid();
+    }
+
+    return;
+}
+
+/* 1 si le point peut entrer dans le tableau compact sans le repasser au format flottant : couleur de la palette et position dans la boîte englobante */
+int fitsCompactPoints(const PointList* list, Point point) {
+    return paletteIndex(point.r, point.g, point.b) >= 0 && point.x >= list->box.minX && point.x <= list->box.maxX && point.y >= list->box.minY && point.y <= list->box.maxY;
+}
+
+/* Remet count points enlevés à leurs indices d'origine (croissants) : une fusion par la fin à partir du premier, sans tableau intermédiaire, */
+/* et seules les entrées de la grille des points décalés sont corrigées. Un tableau compact le reste si tous les points remis y tiennent */
+/* (ceux de la gomme, puisque la boîte n'a pas été réduite) : la fusion se fait alors dans de nouveaux tableaux compacts */
+void restorePoints(PointList* list, const unsigned int* indices, const Point* points, unsigned int count) {
+    unsigned int nbPoints = list->nbPoints;
+    unsigned int i, j = nbPoints, k;
+    unsigned short* quantized = NULL;
+    unsigned char* colorIndices = NULL;
+    int compact = list->quantized != NULL;
+
+    if(count == 0) {
+        return;
+    }
+    for(k = 0 ; compact && k < count ; k++) {
+        compact = fitsCompactPoints(list, points[k]);
+    }
+    if(compact) {
+        quantized = (unsigned short*)arenaAlloc(&sceneArena, 2 * (nbPoints + count) * sizeof(unsigned short));
+        colorIndices = (unsigned char*)arenaAlloc(&sceneArena, (nbPoints + count) * sizeof(unsigned char));
+        memcpy(quantized, list->quantized, 2 * indices[0] * sizeof(unsigned short));
+        memcpy(colorIndices, list->colorIndices, indices[0] * sizeof(unsigned char));
+    }
+    else {
+        reservePoints(list, nbPoints + count);
+        unsharePoints(list);
+    }
+    /* Par la fin, une entrée renumérotée prend un indice plus grand que tous ceux qui restent à chercher */
+    for(i = nbPoints + count, k = count ; i-- > indices[0] ; ) {
+        if(k > 0 && indices[k - 1] == i) {
+            k--;
+            if(compact) {
+                quantized[i * 2] = quantizeCoord(points[k].x, list->box.minX, list->box.maxX);
+                quantized[i * 2 + 1] = quantizeCoord(points[k].y, list->box.minY, list->box.maxY);
+                colorIndices[i] = paletteIndex(points[k].r, points[k].g, points[k].b);
+            }
+            else {
+                list->positions[i * 2] = points[k].x;
+                list->positions[i * 2 + 1] = points[k].y;
+                list->colors[i * 3] = points[k].r;
+                list->colors[i * 3 + 1] = points[k].g;
+                list->colors[i * 3 + 2] = points[k].b;
+            }
+            if(!spatialGrid.dirty) {
+                gridInsert(list, i, points[k].x, points[k].y);
+            }
+            continue;
+        }
+        j--;
+        if(!spatialGrid.dirty) {
+            Point point = getPoint(list, j);
+            gridMove(list, j, i, point.x, point.y);
+        }
+        if(compact) {
+            quantized[i * 2] = list->quantized[j * 2];
+            quantized[i * 2 + 1] = list->quantized[j * 2 + 1];
+            colorIndices[i] = list->colorIndices[j];
+        }
+        else {
+            list->positions[i * 2] = list->positions[j * 2];
+            list->positions[i * 2 + 1] = list->positions[j * 2 + 1];
+            memmove(list->colors + i * 3, list->colors + j * 3, 3);
+        }
+    }
+    countPoints(list, -1);
+    if(compact) {
+        /* Les anciens tableaux restent aux instantanés (ou à la projection) qui les lisent */
+        freePointArrays(list);
+        list->quantized = quantized;
+        list->colorIndices = colorIndices;
+        list->capacity = nbPoints + count;
+    }
+    else {
+        /* La boîte englobante grandit seulement des points remis */
+        for(k = 0 ; k < count ; k++) {
+            if(nbPoints == 0 && k == 0) {
+                list->box.minX = list->box.maxX = points[k].x;
+                list->box.minY = list->box.maxY = points[k].y;
+            }
+            list->box.minX = points[k].x < list->box.minX ? points[k].x : list->box.minX;
+            list->box.minY = points[k].y < list->box.minY ? points[k].y : list->box.minY;
+            list->box.maxX = points[k].x > list->box.maxX ? points[k].x : list->box.maxX;
+            list->box.maxY = points[k].y > list->box.maxY ? points[k].y : list->box.maxY;
+        }
+    }
+    list->nbPoints = nbPoints + count;
+    countPoints(list, 1);
+    touchPoints(list, indices[0], list->nbPoints);
+    list->nbSignificant = 0;
+    if(list->nbLodPoints > 0) {
+        invalidateLodPyramid();
+    }
+
+    return;
+}
+
+/* Enlève les derniers points du tableau pour n'en garder que nbPoints */
+void truncatePoints(PointList* list, unsigned int nbPoints) {
+    unsigned int i;
+
+    if(!spatialGrid.dirty) {
+        for(i = nbPoints ; i < list->nbPoints ; i++) {
+            Point point = getPoint(list, i);
+            gridRemove(list, i, point.x, point.y);
+        }
+    }
+    if(list->nbLodPoints > nbPoints) {
+        invalidateLodPyramid();
+    }
+    /* Comme pour le trait à main levée, la boîte englobante n'est pas réduite : elle reste valable pour le fenêtrage */
+    countPoints(list, -1);
+    list->nbPoints = nbPoints;
+    countPoints(list, 1);
+    touchPoints(list, nbPoints, nbPoints);
+    list->nbSignificant = 0;
+
+    return;
+}
+
+
+/* Fonctions du journal d'annulation : annuler ou refaire une étape ne coûte que la taille de l'étape */
+
+JournalEntry* journalEntry(unsigned int index) {
+    return journal.entries + ((journal.start + index) & (journal.capacity - 1));
+}
+
+/* Rend les copies de points d'une étape */
+void freeJournalCopies(JournalEntry* entry) {
+
+    if(entry->points) {
+        arenaFree(&sceneArena, entry->points, entry->count * sizeof(Point));
+        journal.bytes -= entry->count * sizeof(Point);
+        entry->points = NULL;
+    }
+    if(entry->indices) {
+        arenaFree(&sceneArena, entry->indices, entry->count * sizeof(unsigned int));
+        journal.bytes -= entry->count * sizeof(unsigned int);
+        entry->indices = NULL;
+    }
+
+    return;
+}
+
+/* Rend la mémoire d'une étape ; une primitive ajoutée puis annulée n'est plus dans la scène et part avec elle */
+void forgetJournalEntry(JournalEntry* entry, int done) {
+
+    freeJournalCopies(entry);
+    if(!done && entry->type == JOURNAL_ADD_PRIMITIVE) {
+        /* Les primitives retirées restent chaînées de la plus récente à la plus ancienne */
+        Primitive* primitive = entry->primitive;
+        unsigned int i;
+        for(i = 0 ; i < entry->count ; i++) {
+            Primitive* next = primitive->next;
+            deletePoints(&primitive->points);
+            arenaFree(&sceneArena, primitive, sizeof(Primitive));
+            primitive = next;
+        }
+    }
+    journal.bytes -= sizeof(JournalEntry);
+
+    return;
+}
+
+/* Ouvre une nouvelle étape : les étapes annulées ne peuvent plus être refaites */
+JournalEntry* newJournalEntry(int type, int chained) {
+    JournalEntry* entry;
+
+    while(journal.nbUndone > 0) {
+        journal.nbUndone--;
+        forgetJournalEntry(journalEntry(journal.nbDone + journal.nbUndone), 0);
+    }
+
+    /* Journal plein : la capacité double et les étapes sont remises dans l'ordre */
+    if(journal.nbDone == journal.capacity) {
+        unsigned int i, capacity = journal.capacity ? 2 * journal.capacity : 64;
+        JournalEntry* entries = (JournalEntry*)arenaAlloc(&sceneArena, capacity * sizeof(JournalEntry));
+        for(i = 0 ; i < journal.nbDone ; i++) {
+            entries[i] = *journalEntry(i);
+        }
+        arenaFree(&sceneArena, journal.entries, journal.capacity * sizeof(JournalEntry));
+        journal.entries = entries;
+        journal.capacity = capacity;
+        journal.start = 0;
+    }
+
+    entry = journalEntry(journal.nbDone);
+    memset(entry, 0, sizeof(JournalEntry));
+    entry->type = type;
+    entry->chained = chained;
+    journal.nbDone++;
+    journal.bytes += sizeof(JournalEntry);
+
+    return entry;
+}
+
+/* Fond la plus ancienne étape dans la suivante quand une seule étape peut défaire les deux sans copie : renvoie 0 si elles ne se combinent pas. */
+/* La scène d'avant les deux étapes reste accessible, seule la finesse des annulations les plus anciennes est perdue */
+int mergeOldestJournalEntries() {
+    JournalEntry* first = journalEntry(0);
+    JournalEntry* second = journalEntry(1);
+
+    if(first->type == JOURNAL_ADD_PRIMITIVE && second->type == JOURNAL_ADD_PRIMITIVE) {
+        /* Les primitives des deux étapes se suivent en tête de liste : elles sont retirées et remises ensemble */
+        second->count += first->count;
+    }
+    else if(first->type == JOURNAL_ADD_PRIMITIVE
+        && (second->type == JOURNAL_TRANSFORM ? second->primitive == first->primitive : second->list == &first->primitive->points)) {
+        /* Défaire l'ajout retire la primitive telle qu'elle est, le refaire la remet : les changements de ses points suivent */
+        freeJournalCopies(second);
+        *second = *first;
+    }
+    else if(first->type == JOURNAL_ADD_POINTS && second->type == JOURNAL_ADD_POINTS
+        && second->list == first->list && first->first + first->count == second->first) {
+        second->first = first->first;
+        second->count += first->count;
+    }
+    else if(first->type == JOURNAL_TRANSFORM && second->type == JOURNAL_TRANSFORM && second->primitive == first->primitive) {
+        /* La seconde matrice après la première : x' = a x + b y + tx, y' = c x + d y + ty */
+        const float* m1 = first->matrix;
+        float* m2 = second->matrix;
+        float matrix[6];
+        matrix[0] = m2[0] * m1[0] + m2[1] * m1[2];
+        matrix[1] = m2[0] * m1[1] + m2[1] * m1[3];
+        matrix[2] = m2[2] * m1[0] + m2[3] * m1[2];
+        matrix[3] = m2[2] * m1[1] + m2[3] * m1[3];
+        matrix[4] = m2[0] * m1[4] + m2[1] * m1[5] + m2[4];
+        matrix[5] = m2[2] * m1[4] + m2[3] * m1[5] + m2[5];
+        if(matrix[0] * matrix[3] - matrix[1] * matrix[2] == 0 || !isfinite(matrix[0] * matrix[3] - matrix[1] * matrix[2])) {
+            return 0;
+        }
+        memcpy(m2, matrix, sizeof(matrix));
+    }
+    else {
+        /* Deux passages de gomme se combineraient aussi, mais en recopiant leurs points à chaque fois : ils sont oubliés */
+        return 0;
+    }
+    second->chained = 0;
+    journal.bytes -= sizeof(JournalEntry);
+    journal.start = (journal.start + 1) & (journal.capacity - 1);
+    journal.nbDone--;
+    sceneStatistics.mergedSteps++;
+
+    return 1;
+}
+
+/* Tant que le journal dépasse journalMaxBytes, fond les deux plus anciennes étapes ou, si elles ne se combinent pas, oublie la plus ancienne */
+/* (la dernière est toujours gardée) */
+void trimJournal() {
+
+    while(journal.bytes > journalMaxBytes && journal.nbDone > 1) {
+        if(mergeOldestJournalEntries()) {
+            continue;
+        }
+        forgetJournalEntry(journalEntry(0), 1);
+        journal.start = (journal.start + 1) & (journal.capacity - 1);
+        journal.nbDone--;
+        sceneStatistics.forgottenSteps++;
+        /* Une étape ne peut pas rester liée à une étape oubliée */
+        journalEntry(0)->chained = 0;
+    }
+
+    return;
+}
+
+/* Change la mémoire maximale du journal d'annulation (en octets) : les étapes en trop sont fondues ou oubliées tout de suite */
+void setJournalLimit(size_t maxBytes) {
+
+    journalMaxBytes = maxBytes;
+    trimJournal();
+
+    return;
+}
+
+/* Oublie toutes les étapes, faites ou annulées */
+void clearJournal() {
+
+    while(journal.nbUndone > 0) {
+        journal.nbUndone--;
+        forgetJournalEntry(journalEntry(journal.nbDone + journal.nbUndone), 0);
+    }
+    while(journal.nbDone > 0) {
+        forgetJournalEntry(journalEntry(0), 1);
+        journal.start = (journal.start + 1) & (journal.capacity - 1);
+        journal.nbDone--;
+    }
+
+    return;
+}
+
+/* Note l'ajout de la primitive en tête de liste */
+void journalAddPrimitive(Primitive* primitive) {
+    JournalEntry* entry = newJournalEntry(JOURNAL_ADD_PRIMITIVE, 0);
+
+    entry->primitive = primitive;
+    entry->count = 1;
+    trimJournal();
+    primitive->points.autosaveId = autosave.nbPrimitives++;
+    autosaveAppend(AUTOSAVE_ADD_PRIMITIVE, primitive->points.autosaveId, 0, primitive->primitiveType, NULL, 0, NULL, 0);
+
+    return;
+}
+
+/* Note l'ajout des count derniers points de list ; avec merge, ils rejoignent l'étape précédente si elle ajoutait juste avant eux */
+void journalAddPoints(PointList* list, unsigned int count, int merge) {
+    Point chunk[256];
+    JournalEntry* entry;
+    unsigned int i, first = list->nbPoints - count;
+
+    for(i = 0 ; autosave.thread && i < count ; i++) {
+        chunk[i % 256] = getPoint(list, first + i);
+        if(i % 256 == 255 || i == count - 1) {
+            autosaveAddPoints(list, chunk, i % 256 + 1);
+        }
+    }
+    if(merge && journal.nbDone > 0 && journal.nbUndone == 0) {
+        entry = journalEntry(journal.nbDone - 1);
+        if(entry->type == JOURNAL_ADD_POINTS && entry->list == list && entry->first + entry->count == first) {
+            entry->count += count;
+            return;
+        }
+    }
+    entry = newJournalEntry(JOURNAL_ADD_POINTS, 0);
+    entry->list = list;
+    entry->first = first;
+    entry->count = count;
+    trimJournal();
+
+    return;
+}
+
+/* Note l'ajout du dernier point de list ; avec merge, il rejoint l'étape précédente si elle ajoutait juste avant lui */
+void journalAddPoint(PointList* list, int merge) {
+    journalAddPoints(list, 1, merge);
+}
+
+/* Note les count points de list que la gomme va enlever (indices croissants), avant qu'ils ne soient écrasés */
+void journalErasePoints(PointList* list, const unsigned int* indices, unsigned int count, int chained) {
+    unsigned int k;
+    JournalEntry* entry = newJournalEntry(JOURNAL_ERASE_POINTS, chained);
+
+    entry->list = list;
+    entry->count = count;
+    entry->points = (Point*)arenaAlloc(&sceneArena, count * sizeof(Point));
+    entry->indices = (unsigned int*)arenaAlloc(&sceneArena, count * sizeof(unsigned int));
+    memcpy(entry->indices, indices, count * sizeof(unsigned int));
+    for(k = 0 ; k < count ; k++) {
+        entry->points[k] = getPoint(list, indices[k]);
+    }
+    journal.bytes += count * (sizeof(Point) + sizeof(unsigned int));
+    autosaveAppend(AUTOSAVE_ERASE, list->autosaveId, count, 0, indices, count * sizeof(unsigned int), NULL, 0);
+    trimJournal();
+
+    return;
+}
+
+/* Note la transformation de la sélection (de toute la scène si selection vaut NULL) : seule la matrice est gardée, */
+/* l'annulation applique son inverse. Une transformation qui écrase le dessin (déterminant nul) ne s'inverse pas : le journal est vidé */
+void journalTransform(Primitive* selection, float a, float b, float c, float d, float tx, float ty) {
+    JournalEntry* entry;
+    float determinant = a * d - b * c;
+
+    if(determinant == 0 || !isfinite(determinant)) {
+        clearJournal();
+        return;
+    }
+    entry = newJournalEntry(JOURNAL_TRANSFORM, 0);
+    entry->primitive = selection;
+    entry->matrix[0] = a;
+    entry->matrix[1] = b;
+    entry->matrix[2] = c;
+    entry->matrix[3] = d;
+    entry->matrix[4] = tx;
+    entry->matrix[5] = ty;
+    trimJournal();
+
+    return;
+}
+
+/* Applique la transformation de l'étape (ou son inverse) à sa primitive, ou à toute la scène */
+void applyJournalTransform(PrimitiveList scene, const JournalEntry* entry, int inverse) {
+    const float* m = entry->matrix;
+    float a = m[0], b = m[1], c = m[2], d = m[3], tx = m[4], ty = m[5];
+
+    if(inverse) {
+        float determinant = m[0] * m[3] - m[1] * m[2];
+        a = m[3] / determinant;
+        b = -m[1] / determinant;
+        c = -m[2] / determinant;
+        d = m[0] / determinant;
+        tx = -(a * m[4] + b * m[5]);
+        ty = -(c * m[4] + d * m[5]);
+    }
+    if(entry->primitive) {
+        transformPoints(&entry->primitive->points, 0, entry->primitive->points.nbPoints, a, b, c, d, tx, ty);
+    }
+    else {
+        transformPrimitives(scene, a, b, c, d, tx, ty);
+    }
+
+    return;
+}
+
+/* Défait une étape : les points ajoutés sont copiés dans l'étape pour pouvoir la refaire */
+void undoJournalEntry(PrimitiveList* scene, JournalEntry* entry) {
+    unsigned int i;
+
+    if(entry->type == JOURNAL_ADD_POINTS) {
+        entry->points = (Point*)arenaAlloc(&sceneArena, entry->count * sizeof(Point));
+        for(i = 0 ; i < entry->count ; i++) {
+            entry->points[i] = getPoint(entry->list, entry->first + i);
+        }
+        journal.bytes += entry->count * sizeof(Point);
+        truncatePoints(entry->list, entry->first);
+        autosaveAppend(AUTOSAVE_TRUNCATE, entry->list->autosaveId, 0, entry->first, NULL, 0, NULL, 0);
+    }
+    else if(entry->type == JOURNAL_ADD_PRIMITIVE) {
+        /* Les étapes suivantes ont été défaites et tout ce qui change la liste sans passer par le journal le vide (resetScene) : */
+        /* la primitive est en tête de liste */
+        if(*scene != entry->primitive) {
+            return;
+        }
+        for(i = 0 ; i < entry->count ; i++) {
+            Primitive* primitive = *scene;
+            *scene = primitive->next;
+            countPrimitive(primitive, -1);
+            autosave.nbPrimitives--;
+            autosaveAppend(AUTOSAVE_REMOVE_PRIMITIVE, primitive->points.autosaveId, 0, 0, NULL, 0, NULL, 0);
+            unindexPoints(&primitive->points);
+            if(primitive->points.nbLodPoints > 0) {
+                invalidateLodPyramid();
+                primitive->points.nbLodPoints = 0;
+            }
+        }
+    }
+    else if(entry->type == JOURNAL_TRANSFORM) {
+        applyJournalTransform(*scene, entry, 1);
+    }
+    else {
+        restorePoints(entry->list, entry->indices, entry->points, entry->count);
+        autosaveAppend(AUTOSAVE_RESTORE, entry->list->autosaveId, entry->count, 0, entry->indices, entry->count * sizeof(unsigned int), entry->points, entry->count * sizeof(Point));
+    }
+
+    return;
+}
+
+/* Refait une étape défaite */
+void redoJournalEntry(PrimitiveList* scene, JournalEntry* entry) {
+    unsigned int i;
+
+    if(entry->type == JOURNAL_ADD_POINTS) {
+        for(i = 0 ; i < entry->count ; i++) {
+            addPointToList(entry->points[i], entry->list);
+        }
+        autosaveAddPoints(entry->list, entry->points, entry->count);
+        arenaFree(&sceneArena, entry->points, entry->count * sizeof(Point));
+        journal.bytes -= entry->count * sizeof(Point);
+        entry->points = NULL;
+    }
+    else if(entry->type == JOURNAL_ADD_PRIMITIVE) {
+        /* Les primitives sont remises de la plus ancienne à la plus récente, dans l'ordre où la sauvegarde automatique les numérote */
+        Primitive** added = (Primitive**)arenaAlloc(&sceneArena, entry->count * sizeof(Primitive*));
+        Primitive* primitive = entry->primitive;
+        unsigned int k;
+        for(k = entry->count ; k-- > 0 ; ) {
+            added[k] = primitive;
+            primitive = primitive->next;
+        }
+        for(k = 0 ; k < entry->count ; k++) {
+            PointList* list = &added[k]->points;
+            added[k]->next = *scene;
+            *scene = added[k];
+            countPrimitive(added[k], 1);
+            indexPoints(list);
+            list->autosaveId = autosave.nbPrimitives++;
+            autosaveAppend(AUTOSAVE_ADD_PRIMITIVE, list->autosaveId, 0, added[k]->primitiveType, NULL, 0, NULL, 0);
+            for(i = 0 ; i < list->nbPoints ; i++) {
+                Point point = getPoint(list, i);
+                autosaveAddPoints(list, &point, 1);
+            }
+        }
+        arenaFree(&sceneArena, added, entry->count * sizeof(Primitive*));
+    }
+    else if(entry->type == JOURNAL_TRANSFORM) {
+        applyJournalTransform(*scene, entry, 0);
+    }
+    else {
+        removeIndexedPoints(entry->list, entry->indices, entry->count);
+        autosaveAppend(AUTOSAVE_ERASE, entry->list->autosaveId, entry->count, 0, entry->indices, entry->count * sizeof(unsigned int), NULL, 0);
+    }
+
+    return;
+}
+
+/* Annule la dernière étape (et celles qui lui sont liées) : renvoie 0 s'il n'y a rien à annuler */
+int undo(PrimitiveList* scene) {
+    int chained;
+
+    if(journal.nbDone == 0) {
+        return 0;
+    }
+    /* Un trait à main levée en cours se termine */
+    stroke.list = NULL;
+    do {
+        JournalEntry* entry = journalEntry(journal.nbDone - 1);
+        chained = entry->chained;
+        undoJournalEntry(scene, entry);
+        journal.nbDone--;
+        journal.nbUndone++;
+    } while(chained && journal.nbDone > 0);
+
+    return 1;
+}
+
+/* Refait la dernière étape annulée (et celles qui lui sont liées) : renvoie 0 s'il n'y a rien à refaire */
+int redo(PrimitiveList* scene) {
+
+    if(journal.nbUndone == 0) {
+        return 0;
+    }
+    /* Un trait à main levée en cours se termine */
+    stroke.list = NULL;
+    do {
+        redoJournalEntry(scene, journalEntry(journal.nbDone));
+        journal.nbDone++;
+        journal.nbUndone--;
+    } while(journal.nbUndone > 0 && journalEntry(journal.nbDone)->chained);
+
+    return 1;
+}
+
+/* Applique la transformation à la primitive sélectionnée, ou à toute la liste s'il n'y a pas de sélection */
+void transformSelection(PrimitiveList list, Primitive* selection, float a, float b, float c, float d, float tx, float ty) {
+
+    journalTransform(selection, a, b, c, d, tx, ty);
+    if(selection) {
+        transformPoints(&selection->points, 0, selection->points.nbPoints, a, b, c, d, tx, ty);
+    }
+    else {
+        transformPrimitives(list, a, b, c, d, tx, ty);
+    }
+
+    return;
+}
+
+/* Fonctions du trait à main levée : le nombre de sommets gardés suit la courbure du trait, pas la fréquence de la souris */
+
+/* Remplace le dernier point du tableau (grille, pyramide et simplification sont tenues à jour) */
+void replaceLastPoint(PointList* list, Point point) {
+    unsigned int last = list->nbPoints - 1;
+
+    if(!spatialGrid.dirty) {
+        Point old = getPoint(list, last);
+        gridRemove(list, last, old.x, old.y);
+    }
+    if(list->nbLodPoints > last) {
+        invalidateLodPyramid();
+    }
+    /* La boîte englobante n'est pas réduite : elle déborde au plus de la tolérance du trait */
+    countPoints(list, -1);
+    list->nbPoints--;
+    countPoints(list, 1);
+    touchPoints(list, last, last);
+    list->nbSignificant = 0;
+    addPointToList(point, list);
+    autosaveReplaceLast(list, point);
+
+    return;
+}
+
+/* Commence un trait dans list au point (x, y) ; tolerance est la taille d'un pixel dans le repère de la scène */
+void beginStroke(PointList* list, Point point, float tolerance) {
+
+    addPointToList(point, list);
+    journalAddPoint(list, 0);
+    stroke.list = list;
+    stroke.anchor = list->nbPoints - 1;
+    stroke.floating = 0;
+    stroke.tolerance = tolerance;
+
+    return;
+}
+
+/* Ajoute au trait en cours un point venu de la souris, ou l'ignore s'il n'apporte rien */
+void addStrokePoint(Point point) {
+    PointList* list = stroke.list;
+    Point last, anchor;
+    float dx, dy, keyLength, distance, progress;
+
+    /* Le trait a pu être vidé (z, r) entre deux mouvements */
+    if(!list || list->nbPoints <= stroke.anchor) {
+        stroke.list = NULL;
+        return;
+    }
+
+    /* Distance radiale : un point trop proche du précédent est ignoré */
+    last = getPoint(list, list->nbPoints - 1);
+    if((point.x - last.x) * (point.x - last.x) + (point.y - last.y) * (point.y - last.y) < stroke.tolerance * stroke.tolerance) {
+        return;
+    }
+
+    /* Le premier point qui s'éloigne du sommet fixé donne la direction du couloir */
+    anchor = getPoint(list, stroke.anchor);
+    if(!stroke.floating) {
+        stroke.keyX = point.x - anchor.x;
+        stroke.keyY = point.y - anchor.y;
+        stroke.floating = 1;
+        addPointToList(point, list);
+        journalAddPoint(list, 1);
+        return;
+    }
+
+    /* Reumann-Witkam : tant que le point reste dans le couloir et avance, il remplace le point provisoire */
+    dx = point.x - anchor.x;
+    dy = point.y - anchor.y;
+    keyLength = sqrt(stroke.keyX * stroke.keyX + stroke.keyY * stroke.keyY);
+    distance = fabs(dx * stroke.keyY - dy * stroke.keyX) / keyLength;
+    progress = ((point.x - last.x) * stroke.keyX + (point.y - last.y) * stroke.keyY) / keyLength;
+    if(distance <= stroke.tolerance && progress > -stroke.tolerance) {
+        replaceLastPoint(list, point);
+        return;
+    }
+
+    /* Sinon le point provisoire devient un sommet fixé et un nouveau couloir part de lui */
+    stroke.anchor = list->nbPoints - 1;
+    stroke.keyX = point.x - last.x;
+    stroke.keyY = point.y - last.y;
+    addPointToList(point, list);
+    journalAddPoint(list, 1);
+
+    return;
+}
+
+/* Termine le trait : le dernier point provisoire reste comme extrémité */
+void endStroke() {
+    stroke.list = NULL;
+    return;
+}
+
+/* Ordre des points sous la gomme : par tableau, puis par indice croissant */
+int compareGridEntries(const void* a, const void* b) {
+    const GridEntry* first = (const GridEntry*)a;
+    const GridEntry* second = (const GridEntry*)b;
+
+    if(first->list != second->list) {
+        return (size_t)first->list < (size_t)second->list ? -1 : 1;
+    }
+
+    return first->index < second->index ? -1 : first->index > second->index;
+}
+
+/* Gomme : enlève tous les points à moins de radius de (x, y) en gardant l'ordre des autres, renvoie le nombre de points enlevés */
+/* Seules les cases qui touchent le disque sont parcourues, et seuls les points qui suivent un point enlevé dans son tableau sont déplacés */
+unsigned int erasePoints(PrimitiveList scene, float x, float y, float radius) {
+    int cellX, cellY;
+    unsigned int i, first;
+    GridEntry* hits = NULL; // Points sous la gomme
+    unsigned int nbHits = 0, hitsCapacity = 0;
+    unsigned int* indices;
+
+    refreshSpatialGrid(scene);
+    if(spatialGrid.cellSize == 0) {
+        return 0;
+    }
+
+    /* Je cherche d'abord dans la grille les points sous la gomme */
+    for(cellX = gridCellCoord(x - radius) ; cellX <= gridCellCoord(x + radius) ; cellX++) {
+        for(cellY = gridCellCoord(y - radius) ; cellY <= gridCellCoord(y + radius) ; cellY++) {
+            GridCell* cell = findGridCell(cellX, cellY, 0);
+            if(!cell) {
+                continue;
+            }
+            for(i = 0 ; i < cell->nbEntries ; i++) {
+                Point point = getPoint(cell->entries[i].list, cell->entries[i].index);
+                if((point.x - x) * (point.x - x) + (point.y - y) * (point.y - y) > radius * radius) {
+                    continue;
+                }
+                if(nbHits == hitsCapacity) {
+                    unsigned int capacity = hitsCapacity ? 2 * hitsCapacity : 16;
+                    GridEntry* grown = (GridEntry*)arenaAlloc(&sceneArena, capacity * sizeof(GridEntry));
+                    if(nbHits > 0) {
+                        memcpy(grown, hits, nbHits * sizeof(GridEntry));
+                    }
+                    arenaFree(&sceneArena, hits, hitsCapacity * sizeof(GridEntry));
+                    hits = grown;
+                    hitsCapacity = capacity;
+                }
+                hits[nbHits++] = cell->entries[i];
+            }
+        }
+    }
+    if(nbHits == 0) {
+        return 0;
+    }
+
+    /* Puis les points de chaque tableau touché, rangés par indice croissant, sont enlevés en une passe */
+    qsort(hits, nbHits, sizeof(GridEntry), compareGridEntries);
+    indices = (unsigned int*)arenaAlloc(&sceneArena, nbHits * sizeof(unsigned int));
+    for(first = 0 ; first < nbHits ; first = i) {
+        PointList* list = hits[first].list;
+        for(i = first ; i < nbHits && hits[i].list == list ; i++) {
+            indices[i - first] = hits[i].index;
+        }
+        /* Les points enlevés partent dans le journal : un seul z les remet, sur toutes les primitives touchées */
+        journalErasePoints(list, indices, i - first, first > 0);
+        removeIndexedPoints(list, indices, i - first);
+    }
+    arenaFree(&sceneArena, indices, nbHits * sizeof(unsigned int));
+    arenaFree(&sceneArena, hits, hitsCapacity * sizeof(GridEntry));
+
+    return nbHits;
+}
+
+/* Je vide d'abord les champs de la primitive puis la primitive de la liste */
+void deletePrimitive(PrimitiveList* list) {
+
+    autosaveInvalidate();
+    /* Si ma liste n'est pas vide */
+    while(*list) {
+        Primitive* next = (*list)->next;
+        countPrimitive(*list, -1);
+        deletePoints(&(*list)->points);
+        arenaFree(&sceneArena, *list, sizeof(Primitive));
+        *list = next;
+    }
+
+    return;
+}
+
+/* Écrit les points de la scène au format CSV (une ligne par point) : renvoie 0 si le fichier n'a pas pu être écrit */
+int writeSceneCSV(PrimitiveList scene, const char* path) {
+    unsigned int i, index = 0;
+    const Primitive* primitive;
+    FILE* file = fopen(path, "w");
+
+    if(!file) {
+        return 0;
+    }
+    fprintf(file, "primitive;type;x;y;r;g;b\n");
+    for(primitive = scene ; primitive ; primitive = primitive->next, index++) {
+        for(i = 0 ; i < primitive->points.nbPoints ; i++) {
+            Point point = getPoint(&primitive->points, i);
+            fprintf(file, "%u;%u;%.9g;%.9g;%d;%d;%d\n", index, primitive->primitiveType, point.x, point.y, point.r, point.g, point.b);
+        }
+    }
+
+    return fclose(file) == 0;
+}
+
+/* Taille sur le disque des deux tableaux d'une primitive, chacun arrondi à 64 octets */
+unsigned long long sceneFileArraySize(const PointList* list, int colors) {
+    unsigned long long size;
+
+    if(list->quantized) {
+        size = colors ? list->nbPoints * sizeof(unsigned char) : 2 * list->nbPoints * sizeof(unsigned short);
+    }
+    else {
+        size = colors ? 3 * list->nbPoints * sizeof(unsigned char) : 2 * list->nbPoints * sizeof(float);
+    }
+
+    return (size + 63) & ~63ULL;
+}
+
+/* Écrit size octets puis des zéros jusqu'à paddedSize */
+int writePadded(FILE* file, const void* data, size_t size, size_t paddedSize) {
+    static const char zeros[64] = {0};
+
+    if(size > 0 && fwrite(data, 1, size, file) != size) {
+        return 0;
+    }
+
+    return paddedSize == size || fwrite(zeros, 1, paddedSize - size, file) == paddedSize - size;
+}
+
+/* Sauvegarde la scène au format binaire en une écriture séquentielle : renvoie 0 en cas d'erreur */
+/* Le fichier est écrit à côté puis renommé, un fichier projeté par la scène reste donc valable */
+int saveSceneFile(PrimitiveList scene, const char* path) {
+    SceneFileHeader header;
+    SceneFilePrimitive entry;
+    const Primitive* primitive;
+    unsigned long long offset;
+    size_t tableSize;
+    char tmpPath[1024];
+    FILE* file;
+    int ok = 1;
+
+    memset(&header, 0, sizeof(SceneFileHeader));
+    memcpy(header.magic, "IMACSCN", 8);
+    header.version = SCENE_FILE_VERSION;
+    header.byteOrder = 0x01020304;
+    for(primitive = scene ; primitive ; primitive = primitive->next) {
+        header.nbPrimitives++;
+    }
+    tableSize = (sizeof(SceneFileHeader) + header.nbPrimitives * sizeof(SceneFilePrimitive) + 63) & ~(size_t)63;
+    header.fileSize = tableSize;
+    for(primitive = scene ; primitive ; primitive = primitive->next) {
+        header.fileSize += sceneFileArraySize(&primitive->points, 0) + sceneFileArraySize(&primitive->points, 1);
+    }
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    file = fopen(tmpPath, "wb");
+    if(!file) {
+        return 0;
+    }
+
+    /* L'en-tête et la table, avec les positions des tableaux qui suivent */
+    ok = fwrite(&header, sizeof(SceneFileHeader), 1, file) == 1;
+    offset = tableSize;
+    for(primitive = scene ; ok && primitive ; primitive = primitive->next) {
+        memset(&entry, 0, sizeof(SceneFilePrimitive));
+        entry.primitiveType = primitive->primitiveType;
+        entry.compact = primitive->points.quantized != NULL;
+        entry.nbPoints = primitive->points.nbPoints;
+        entry.box = primitive->points.box;
+        entry.positionsOffset = offset;
+        offset += sceneFileArraySize(&primitive->points, 0);
+        entry.colorsOffset = offset;
+        offset += sceneFileArraySize(&primitive->points, 1);
+        ok = fwrite(&entry, sizeof(SceneFilePrimitive), 1, file) == 1;
+    }
+    ok = ok && writePadded(file, NULL, 0, tableSize - sizeof(SceneFileHeader) - header.nbPrimitives * sizeof(SceneFilePrimitive));
+
+    /* Puis les tableaux, octet pour octet comme en mémoire */
+    for(primitive = scene ; ok && primitive ; primitive = primitive->next) {
+        const PointList* list = &primitive->points;
+        if(list->quantized) {
+            ok = writePadded(file, list->quantized, 2 * list->nbPoints * sizeof(unsigned short), sceneFileArraySize(list, 0))
+                && writePadded(file, list->colorIndices, list->nbPoints * sizeof(unsigned char), sceneFileArraySize(list, 1));
+        }
+        else {
+            ok = writePadded(file, list->positions, 2 * list->nbPoints * sizeof(float), sceneFileArraySize(list, 0))
+                && writePadded(file, list->colors, 3 * list->nbPoints * sizeof(unsigned char), sceneFileArraySize(list, 1));
+        }
+    }
+
+    ok = fclose(file) == 0 && ok;
+    if(!ok || rename(tmpPath, path) != 0) {
+        remove(tmpPath);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Fil d'export : il lit son instantané pendant que la boucle principale continue d'éditer et de dessiner la scène */
+int exportThreadMain(void* data) {
+    SceneSnapshot* snapshot = (SceneSnapshot*)data;
+
+    if(!exportWriter(snapshot->scene, exportPath)) {
+        printf("Impossible d'écrire %s\n", exportPath);
+    }
+    SDL_LockMutex(snapshots.mutex);
+    snapshot->released = 1;
+    exportRunning = 0;
+    SDL_UnlockMutex(snapshots.mutex);
+
+    return 0;
+}
+
+/* Lance l'écriture de la scène dans path avec writer, en arrière-plan : renvoie 0 si un export est déjà en cours */
+int startExport(PrimitiveList scene, SceneWriter writer, const char* path) {
+    SceneSnapshot* snapshot;
+
+    if(exportThread) {
+        int running;
+        SDL_LockMutex(snapshots.mutex);
+        running = exportRunning;
+        SDL_UnlockMutex(snapshots.mutex);
+        if(running) {
+            return 0;
+        }
+        SDL_WaitThread(exportThread, NULL);
+        exportThread = NULL;
+    }
+
+    snapshot = takeSnapshot(scene);
+    exportWriter = writer;
+    exportPath = path;
+    exportRunning = 1;
+    exportThread = SDL_CreateThread(exportThreadMain, snapshot);
+    if(!exportThread) {
+        exportRunning = 0;
+        releaseSnapshot(snapshot);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Attend la fin de l'export en cours (avant de quitter) */
+void finishExport() {
+
+    if(exportThread) {
+        SDL_WaitThread(exportThread, NULL);
+        exportThread = NULL;
+    }
+    collectSnapshots();
+
+    return;
+}
+
+/* La scène quitte ses fichiers projetés : ils sont fermés tout de suite si aucun instantané ne vit, */
+/* sinon mis de côté avec le numéro du dernier instantané et fermés par collectSnapshots quand plus aucun ne peut y lire */
+void closeSceneMappings() {
+
+    while(sceneMappings) {
+        SceneMapping* next = sceneMappings->next;
+        if(snapshots.live) {
+            sceneMappings->version = snapshots.lastVersion;
+            sceneMappings->next = snapshots.retiredMappings;
+            snapshots.retiredMappings = sceneMappings;
+        }
+        else {
+            munmap(sceneMappings->data, sceneMappings->size);
+            free(sceneMappings);
+        }
+        sceneMappings = next;
+    }
+
+    return;
+}
+
+/* Vide toute la scène en temps constant : la liste est oubliée et le tas remis à zéro d'un coup */
+void resetScene(PrimitiveList* list) {
+
+    *list = NULL;
+    memset(&sceneStatistics, 0, sizeof(SceneStatistics));
+    releaseVertexBuffers();
+    if(snapshots.live) {
+        /* Des instantanés lisent encore le tas : il est mis de côté en entier (avec les morceaux déjà mis de côté) et la scène repart d'un tas neuf */
+        SceneArena* arena = (SceneArena*)malloc(sizeof(SceneArena));
+        if(!arena) {
+            printf("Error at retired arena malloc\n");
+            exit(1);
+        }
+        while(snapshots.retired && !snapshots.retired->arena) {
+            RetiredMemory* retired = snapshots.retired;
+            snapshots.retired = retired->next;
+            free(retired);
+        }
+        *arena = sceneArena;
+        memset(&sceneArena, 0, sizeof(SceneArena));
+        retireMemory(NULL, 0, arena);
+    }
+    else {
+        arenaReset(&sceneArena);
+    }
+    closeSceneMappings();
+    /* Les cases de la grille et les tuiles de la pyramide étaient dans le tas : il suffit de les oublier */
+    memset(&spatialGrid, 0, sizeof(SpatialGrid));
+    memset(&lodPyramid, 0, sizeof(LodPyramid));
+    memset(&journal, 0, sizeof(Journal));
+    endStroke();
+    autosaveInvalidate();
+
+    return;
+}
+
+/* Projette un fichier de scène en mémoire et vérifie l'en-tête, le type et les bornes de chaque tableau : renvoie NULL si le fichier est absent ou invalide */
+unsigned char* mapSceneFile(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    unsigned char* data;
+    const SceneFileHeader* header;
+    const SceneFilePrimitive* table;
+    unsigned int i;
+
+    if(fd < 0) {
+        return NULL;
+    }
+    if(fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(SceneFileHeader)) {
+        close(fd);
+        return NULL;
+    }
+    /* Projection privée : modifier un point recopie sa page, le fichier n'est jamais réécrit en place */
+    data = (unsigned char*)mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        return NULL;
+    }
+
+    header = (const SceneFileHeader*)data;
+    table = (const SceneFilePrimitive*)(data + sizeof(SceneFileHeader));
+    if(memcmp(header->magic, "IMACSCN", 8) != 0 || header->version != SCENE_FILE_VERSION || header->byteOrder != 0x01020304
+        || header->fileSize != (unsigned long long)info.st_size
+        || header->nbPrimitives > (info.st_size - sizeof(SceneFileHeader)) / sizeof(SceneFilePrimitive)) {
+        munmap(data, info.st_size);
+        return NULL;
+    }
+    for(i = 0 ; i < header->nbPrimitives ; i++) {
+        unsigned long long positionsSize = table[i].compact ? 2ULL * table[i].nbPoints * sizeof(unsigned short) : 2ULL * table[i].nbPoints * sizeof(float);
+        unsigned long long colorsSize = table[i].compact ? table[i].nbPoints : 3ULL * table[i].nbPoints;
+        if(table[i].primitiveType > GL_POLYGON || table[i].positionsOffset % 64 != 0 || table[i].colorsOffset % 64 != 0
+            || table[i].positionsOffset > header->fileSize || positionsSize > header->fileSize - table[i].positionsOffset
+            || table[i].colorsOffset > header->fileSize || colorsSize > header->fileSize - table[i].colorsOffset) {
+            munmap(data, info.st_size);
+            return NULL;
+        }
+    }
+    *size = info.st_size;
+
+    return data;
+}
+
+/* Fait pointer list sur les tableaux d'une entrée de la table, dans la projection data (correction des pointeurs) */
+void mapSceneFileList(PointList* list, unsigned char* data, const SceneFilePrimitive* entry) {
+
+    if(entry->nbPoints == 0) {
+        return;
+    }
+    if(entry->compact) {
+        list->quantized = (unsigned short*)(data + entry->positionsOffset);
+        list->colorIndices = data + entry->colorsOffset;
+    }
+    else {
+        list->positions = (float*)(data + entry->positionsOffset);
+        list->colors = data + entry->colorsOffset;
+    }
+    list->nbPoints = entry->nbPoints;
+    list->capacity = entry->nbPoints;
+    list->box = entry->box;
+    list->mapped = 1;
+
+    return;
+}
+
+/* Ouvre un fichier de scène : une projection en mémoire et la correction des pointeurs, sans lire les points */
+/* Les pages ne sont lues qu'au premier accès (dessin des primitives visibles). Renvoie 0 si le fichier est absent ou invalide, la scène n'est alors pas touchée */
+int loadSceneFile(const char* path, PrimitiveList* scene) {
+    size_t size;
+    unsigned char* data = mapSceneFile(path, &size);
+    const SceneFileHeader* header;
+    const SceneFilePrimitive* table;
+    SceneMapping* mapping;
+    unsigned int i;
+
+    if(!data) {
+        return 0;
+    }
+    header = (const SceneFileHeader*)data;
+    table = (const SceneFilePrimitive*)(data + sizeof(SceneFileHeader));
+
+    resetScene(scene);
+    mapping = (SceneMapping*)malloc(sizeof(SceneMapping));
+    if(!mapping) {
+        printf("Error at scene mapping malloc\n");
+        exit(1);
+    }
+    mapping->data = data;
+    mapping->size = size;
+    mapping->version = 0;
+    mapping->next = sceneMappings;
+    sceneMappings = mapping;
+
+    /* La table est dans l'ordre de la liste : je l'ajoute à l'envers pour retrouver le même ordre */
+    for(i = header->nbPrimitives ; i-- > 0 ; ) {
+        Primitive* primitive = allocPrimitive(table[i].primitiveType);
+        mapSceneFileList(&primitive->points, data, table + i);
+        addPrimitive(primitive, scene);
+    }
+    if(!*scene) {
+        addPrimitive(allocPrimitive(GL_POINTS), scene);
+    }
+    /* La grille spatiale ne sera construite qu'à la première recherche (gomme, aimant, sélection) */
+    invalidateSpatialGrid();
+
+    return 1;
+}
+
+/* Fonctions du format d'archive : coordonnées quantifiées codées en écarts zigzag varint, couleurs en plages d'indices de COLORS */
+/* En-tête "IMACARC", version, nombre de primitives, puis la table (type, nombre de points, boîte), puis les points primitive par primitive */
+
+/* Ouvre un flux d'archive en lecture (mode "rb") ou en écriture (mode "wb") : renvoie 0 si le fichier ne peut pas être ouvert */
+int openArchiveStream(ArchiveStream* stream, const char* path, const char* mode) {
+
+    stream->file = fopen(path, mode);
+    if(!stream->file) {
+        return 0;
+    }
+    stream->buffer = (unsigned char*)malloc(ARCHIVE_BUFFER_SIZE);
+    if(!stream->buffer) {
+        printf("Error at archive buffer malloc\n");
+        exit(1);
+    }
+    stream->position = 0;
+    stream->size = 0;
+    stream->writing = mode[0] == 'w';
+    stream->error = 0;
+
+    return 1;
+}
+
+/* Écrit le morceau en cours dans le fichier */
+void flushArchiveStream(ArchiveStream* stream) {
+
+    if(stream->position > 0 && fwrite(stream->buffer, 1, stream->position, stream->file) != stream->position) {
+        stream->error = 1;
+    }
+    stream->position = 0;
+
+    return;
+}
+
+/* Ferme le flux : renvoie 0 s'il y a eu une erreur */
+int closeArchiveStream(ArchiveStream* stream) {
+
+    if(stream->writing) {
+        flushArchiveStream(stream);
+    }
+    if(fclose(stream->file) != 0) {
+        stream->error = 1;
+    }
+    free(stream->buffer);
+
+    return !stream->error;
+}
+
+void archivePutByte(ArchiveStream* stream, unsigned char byte) {
+
+    if(stream->position == ARCHIVE_BUFFER_SIZE) {
+        flushArchiveStream(stream);
+    }
+    stream->buffer[stream->position++] = byte;
+
+    return;
+}
+
+/* Lit un octet : à la fin du fichier, le flux passe en erreur et renvoie 0 */
+unsigned char archiveGetByte(ArchiveStream* stream) {
+
+    if(stream->position == stream->size) {
+        stream->size = fread(stream->buffer, 1, ARCHIVE_BUFFER_SIZE, stream->file);
+        stream->position = 0;
+        if(stream->size == 0) {
+            stream->error = 1;
+            return 0;
+        }
+    }
+
+    return stream->buffer[stream->position++];
+}
+
+/* Entier en varint : 7 bits par octet, le bit de poids fort indique qu'un octet suit */
+void archivePutVarint(ArchiveStream* stream, unsigned int value) {
+
+    while(value >= 0x80) {
+        archivePutByte(stream, (value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    archivePutByte(stream, value);
+
+    return;
+}
+
+unsigned int archiveGetVarint(ArchiveStream* stream) {
+    unsigned int value = 0, shift = 0;
+    unsigned char byte;
+
+    do {
+        byte = archiveGetByte(stream);
+        if(shift > 28) {
+            stream->error = 1;
+            return 0;
+        }
+        value |= (unsigned int)(byte & 0x7F) << shift;
+        shift += 7;
+    } while(byte & 0x80 && !stream->error);
+
+    return value;
+}
+
+/* Un flottant est écrit octet par octet, poids faible en premier, quel que soit l'ordre de la machine */
+void archivePutFloat(ArchiveStream* stream, float value) {
+    unsigned int bits, i;
+
+    memcpy(&bits, &value, sizeof(float));
+    for(i = 0 ; i < 4 ; i++) {
+        archivePutByte(stream, (bits >> (8 * i)) & 0xFF);
+    }
+
+    return;
+}
+
+float archiveGetFloat(ArchiveStream* stream) {
+    unsigned int bits = 0, i;
+    float value;
+
+    for(i = 0 ; i < 4 ; i++) {
+        bits |= (unsigned int)archiveGetByte(stream) << (8 * i);
+    }
+    memcpy(&value, &bits, sizeof(float));
+
+    return value;
+}
+
+/* Zigzag : les petits écarts négatifs deviennent de petits entiers positifs (0, -1, 1, -2... donnent 0, 1, 2, 3...) */
+unsigned int zigzag(int value) {
+    return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+}
+
+int unzigzag(unsigned int value) {
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+/* Écrit l'en-tête d'une archive de nbPrimitives primitives */
+void archiveHeader(ArchiveStream* stream, unsigned int nbPrimitives) {
+    unsigned int i;
+
+    for(i = 0 ; i < 8 ; i++) {
+        archivePutByte(stream, "IMACARC"[i]);
+    }
+    archivePutVarint(stream, ARCHIVE_FILE_VERSION);
+    archivePutVarint(stream, nbPrimitives);
+
+    return;
+}
+
+/* Lit l'en-tête d'une archive : renvoie le nombre de primitives, ou 0 avec le flux en erreur si ce n'est pas une archive */
+unsigned int readArchiveHeader(ArchiveStream* stream) {
+    unsigned int i;
+
+    for(i = 0 ; i < 8 ; i++) {
+        if(archiveGetByte(stream) != (unsigned char)"IMACARC"[i]) {
+            stream->error = 1;
+        }
+    }
+    if(archiveGetVarint(stream) != ARCHIVE_FILE_VERSION) {
+        stream->error = 1;
+    }
+
+    return stream->error ? 0 : archiveGetVarint(stream);
+}
+
+/* Écrit les points d'un tableau : écarts des coordonnées quantifiées dans sa boîte, puis plages de couleurs */
+void archivePoints(ArchiveStream* stream, const PointList* list) {
+    unsigned int i, run;
+    int x, y, previousX = 0, previousY = 0;
+
+    for(i = 0 ; i < list->nbPoints ; i++) {
+        if(list->quantized) {
+            x = list->quantized[i * 2];
+            y = list->quantized[i * 2 + 1];
+        }
+        else {
+            x = quantizeCoord(list->positions[i * 2], list->box.minX, list->box.maxX);
+            y = quantizeCoord(list->positions[i * 2 + 1], list->box.minY, list->box.maxY);
+        }
+        archivePutVarint(stream, zigzag(x - previousX));
+        archivePutVarint(stream, zigzag(y - previousY));
+        previousX = x;
+        previousY = y;
+    }
+
+    /* Une plage : sa longueur, puis l'indice de la couleur dans COLORS (ou 255 suivi de la couleur hors palette) */
+    for(i = 0 ; i < list->nbPoints ; i += run) {
+        const unsigned char* color = list->quantized ? COLORS + 3 * list->colorIndices[i] : list->colors + 3 * i;
+        int index = paletteIndex(color[0], color[1], color[2]);
+        for(run = 1 ; i + run < list->nbPoints ; run++) {
+            const unsigned char* next = list->quantized ? COLORS + 3 * list->colorIndices[i + run] : list->colors + 3 * (i + run);
+            if(memcmp(next, color, 3) != 0) {
+                break;
+            }
+        }
+        archivePutVarint(stream, run);
+        if(index >= 0) {
+            archivePutByte(stream, index);
+        }
+        else {
+            archivePutByte(stream, 255);
+            archivePutByte(stream, color[0]);
+            archivePutByte(stream, color[1]);
+            archivePutByte(stream, color[2]);
+        }
+    }
+
+    return;
+}
+
+/* Lit jusqu'à count coordonnées (x, y) dans positions : previous garde le dernier point décodé entre deux morceaux */
+void readArchivePositions(ArchiveStream* stream, const BoundingBox* box, float* positions, unsigned int count, int* previous) {
+    unsigned int i;
+
+    for(i = 0 ; i < count && !stream->error ; i++) {
+        previous[0] += unzigzag(archiveGetVarint(stream));
+        previous[1] += unzigzag(archiveGetVarint(stream));
+        if(previous[0] < 0 || previous[0] > 65535 || previous[1] < 0 || previous[1] > 65535) {
+            stream->error = 1;
+            return;
+        }
+        positions[i * 2] = dequantizeCoord(previous[0], box->minX, box->maxX);
+        positions[i * 2 + 1] = dequantizeCoord(previous[1], box->minY, box->maxY);
+    }
+
+    return;
+}
+
+/* Lit count couleurs dans colors : run et color gardent la plage en cours entre deux morceaux */
+void readArchiveColors(ArchiveStream* stream, unsigned char* colors, unsigned int count, unsigned int* run, unsigned char* color) {
+    unsigned int i;
+
+    for(i = 0 ; i < count && !stream->error ; i++) {
+        if(*run == 0) {
+            unsigned char index;
+            *run = archiveGetVarint(stream);
+            index = archiveGetByte(stream);
+            if(index == 255) {
+                color[0] = archiveGetByte(stream);
+                color[1] = archiveGetByte(stream);
+                color[2] = archiveGetByte(stream);
+            }
+            else if(index < NB_COLORS) {
+                memcpy(color, COLORS + 3 * index, 3);
+            }
+            else {
+                stream->error = 1;
+            }
+            if(*run == 0) {
+                stream->error = 1;
+                return;
+            }
+        }
+        memcpy(colors + 3 * i, color, 3);
+        (*run)--;
+    }
+
+    return;
+}
+
+/* Sauvegarde la scène en archive compressée, en un passage et avec un tampon de taille fixe : renvoie 0 en cas d'erreur */
+int saveSceneArchive(PrimitiveList scene, const char* path) {
+    ArchiveStream stream;
+    const Primitive* primitive;
+    unsigned int nbPrimitives = 0;
+
+    for(primitive = scene ; primitive ; primitive = primitive->next) {
+        nbPrimitives++;
+    }
+    if(!openArchiveStream(&stream, path, "wb")) {
+        return 0;
+    }
+    archiveHeader(&stream, nbPrimitives);
+    for(primitive = scene ; primitive ; primitive = primitive->next) {
+        archivePutVarint(&stream, primitive->primitiveType);
+        archivePutVarint(&stream, primitive->points.nbPoints);
+        archivePutFloat(&stream, primitive->points.box.minX);
+        archivePutFloat(&stream, primitive->points.box.minY);
+        archivePutFloat(&stream, primitive->points.box.maxX);
+        archivePutFloat(&stream, primitive->points.box.maxY);
+    }
+    for(primitive = scene ; primitive ; primitive = primitive->next) {
+        archivePoints(&stream, &primitive->points);
+    }
+
+    return closeArchiveStream(&stream);
+}
+
+/* Lit la table d'une archive (malloc, à libérer) : renvoie NULL si elle est invalide */
+SceneFilePrimitive* readArchiveTable(ArchiveStream* stream, unsigned int nbPrimitives, unsigned long long fileSize) {
+    unsigned int i;
+    SceneFilePrimitive* table;
+
+    /* Chaque entrée prend au moins 18 octets et chaque point au moins 2 : un fichier tronqué ou corrompu est refusé avant d'allouer */
+    if(stream->error || nbPrimitives > fileSize / 18) {
+        return NULL;
+    }
+    table = (SceneFilePrimitive*)calloc(nbPrimitives ? nbPrimitives : 1, sizeof(SceneFilePrimitive));
+    if(!table) {
+        printf("Error at archive table malloc\n");
+        exit(1);
+    }
+    for(i = 0 ; i < nbPrimitives && !stream->error ; i++) {
+        table[i].primitiveType = archiveGetVarint(stream);
+        table[i].nbPoints = archiveGetVarint(stream);
+        table[i].box.minX = archiveGetFloat(stream);
+        table[i].box.minY = archiveGetFloat(stream);
+        table[i].box.maxX = archiveGetFloat(stream);
+        table[i].box.maxY = archiveGetFloat(stream);
+        if(table[i].primitiveType > GL_POLYGON || table[i].nbPoints > fileSize / 2) {
+            stream->error = 1;
+        }
+    }
+    if(stream->error) {
+        free(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+/* Taille d'un fichier ouvert */
+unsigned long long streamFileSize(FILE* file) {
+    struct stat info;
+
+    return fstat(fileno(file), &info) == 0 ? (unsigned long long)info.st_size : 0;
+}
+
+/* Décode tous les points de l'archive par morceaux de ARCHIVE_CHUNK_POINTS sans les garder : renvoie 0 si le flux est corrompu ou tronqué */
+int checkArchivePoints(ArchiveStream* stream, const SceneFilePrimitive* table, unsigned int nbPrimitives) {
+    float* positions = (float*)malloc(2 * ARCHIVE_CHUNK_POINTS * sizeof(float));
+    unsigned char* colors = (unsigned char*)malloc(3 * ARCHIVE_CHUNK_POINTS * sizeof(unsigned char));
+    unsigned int i, done, count;
+
+    if(!positions || !colors) {
+        printf("Error at archive chunk malloc\n");
+        exit(1);
+    }
+    for(i = 0 ; i < nbPrimitives && !stream->error ; i++) {
+        int previous[2] = {0, 0};
+        unsigned int run = 0;
+        unsigned char color[3];
+
+        for(done = 0 ; !stream->error && done < table[i].nbPoints ; done += count) {
+            count = table[i].nbPoints - done < ARCHIVE_CHUNK_POINTS ? table[i].nbPoints - done : ARCHIVE_CHUNK_POINTS;
+            readArchivePositions(stream, &table[i].box, positions, count, previous);
+        }
+        for(done = 0 ; !stream->error && done < table[i].nbPoints ; done += count) {
+            count = table[i].nbPoints - done < ARCHIVE_CHUNK_POINTS ? table[i].nbPoints - done : ARCHIVE_CHUNK_POINTS;
+            readArchiveColors(stream, colors, count, &run, color);
+        }
+    }
+    free(positions);
+    free(colors);
+
+    return !stream->error;
+}
+
+/* Reprend la lecture du flux au début du fichier */
+void rewindArchiveStream(ArchiveStream* stream) {
+
+    if(fseek(stream->file, 0, SEEK_SET) != 0) {
+        stream->error = 1;
+        return;
+    }
+    stream->position = 0;
+    stream->size = 0;
+
+    return;
+}
+
+/* Ouvre une archive dans la scène (au format flottant, k la repasse au format compact) : renvoie 0 si le fichier est absent ou invalide */
+/* Toute l'archive est d'abord décodée à vide : une archive corrompue ou tronquée laisse la scène telle quelle. */
+/* Une archive vide donne, comme loadSceneFile, une scène avec une primitive GL_POINTS */
+int loadSceneArchive(const char* path, PrimitiveList* scene) {
+    ArchiveStream stream;
+    SceneFilePrimitive* table;
+    PrimitiveList* link = scene;
+    unsigned int i, nbPrimitives;
+
+    if(!openArchiveStream(&stream, path, "rb")) {
+        return 0;
+    }
+    nbPrimitives = readArchiveHeader(&stream);
+    table = readArchiveTable(&stream, nbPrimitives, streamFileSize(stream.file));
+    if(!table || !checkArchivePoints(&stream, table, nbPrimitives)) {
+        free(table);
+        closeArchiveStream(&stream);
+        return 0;
+    }
+    /* Deuxième lecture, pour de bon : on repasse l'en-tête et la table déjà vérifiés */
+    rewindArchiveStream(&stream);
+    readArchiveHeader(&stream);
+    free(table);
+    table = readArchiveTable(&stream, nbPrimitives, streamFileSize(stream.file));
+    if(!table) {
+        closeArchiveStream(&stream);
+        return 0;
+    }
+
+    resetScene(scene);
+    /* Les primitives sont lues dans l'ordre de la liste : chacune est accrochée derrière la précédente */
+    for(i = 0 ; i < nbPrimitives && !stream.error ; i++) {
+        int previous[2] = {0, 0};
+        unsigned int run = 0;
+        unsigned char color[3];
+        Primitive* primitive = allocPrimitive(table[i].primitiveType);
+        PointList* list = &primitive->points;
+
+        *link = primitive;
+        link = &primitive->next;
+        countPrimitive(primitive, 1);
+        if(table[i].nbPoints == 0) {
+            continue;
+        }
+        reservePoints(list, table[i].nbPoints);
+        list->box = table[i].box;
+        readArchivePositions(&stream, &list->box, list->positions, table[i].nbPoints, previous);
+        readArchiveColors(&stream, list->colors, table[i].nbPoints, &run, color);
+        countPoints(list, -1);
+        list->nbPoints = stream.error ? 0 : table[i].nbPoints;
+        countPoints(list, 1);
+    }
+    free(table);
+    if(!*scene) {
+        addPrimitive(allocPrimitive(GL_POINTS), scene);
+    }
+    invalidateSpatialGrid();
+
+    return closeArchiveStream(&stream);
+}
+
+/* Convertit une archive en fichier de scène binaire sans la charger : les points passent par un tampon de ARCHIVE_CHUNK_POINTS points */
+int convertArchiveToSceneFile(const char* archivePath, const char* scenePath) {
+    ArchiveStream stream;
+    SceneFileHeader header;
+    SceneFilePrimitive* table;
+    PointList sizes;
+    float* positions;
+    unsigned char* colors;
+    unsigned long long offset;
+    unsigned int i, done, count;
+    size_t tableSize;
+    char tmpPath[1024];
+    FILE* file;
+    int ok;
+
+    if(!openArchiveStream(&stream, archivePath, "rb")) {
+        return 0;
+    }
+    memset(&header, 0, sizeof(SceneFileHeader));
+    header.nbPrimitives = readArchiveHeader(&stream);
+    table = readArchiveTable(&stream, header.nbPrimitives, streamFileSize(stream.file));
+    if(!table) {
+        closeArchiveStream(&stream);
+        return 0;
+    }
+
+    /* Même disposition que saveSceneFile, au format flottant */
+    memcpy(header.magic, "IMACSCN", 8);
+    header.version = SCENE_FILE_VERSION;
+    header.byteOrder = 0x01020304;
+    tableSize = (sizeof(SceneFileHeader) + header.nbPrimitives * sizeof(SceneFilePrimitive) + 63) & ~(size_t)63;
+    memset(&sizes, 0, sizeof(PointList));
+    offset = tableSize;
+    for(i = 0 ; i < header.nbPrimitives ; i++) {
+        sizes.nbPoints = table[i].nbPoints;
+        table[i].positionsOffset = offset;
+        offset += sceneFileArraySize(&sizes, 0);
+        table[i].colorsOffset = offset;
+        offset += sceneFileArraySize(&sizes, 1);
+    }
+    header.fileSize = offset;
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", scenePath);
+    file = fopen(tmpPath, "wb");
+    if(!file) {
+        free(table);
+        closeArchiveStream(&stream);
+        return 0;
+    }
+    positions = (float*)malloc(2 * ARCHIVE_CHUNK_POINTS * sizeof(float));
+    colors = (unsigned char*)malloc(3 * ARCHIVE_CHUNK_POINTS * sizeof(unsigned char));
+    if(!positions || !colors) {
+        printf("Error at archive chunk malloc\n");
+        exit(1);
+    }
+
+    ok = fwrite(&header, sizeof(SceneFileHeader), 1, file) == 1
+        && fwrite(table, sizeof(SceneFilePrimitive), header.nbPrimitives, file) == header.nbPrimitives
+        && writePadded(file, NULL, 0, tableSize - sizeof(SceneFileHeader) - header.nbPrimitives * sizeof(SceneFilePrimitive));
+    for(i = 0 ; ok && i < header.nbPrimitives ; i++) {
+        int previous[2] = {0, 0};
+        unsigned int run = 0;
+        unsigned char color[3];
+        sizes.nbPoints = table[i].nbPoints;
+
+        for(done = 0 ; ok && done < table[i].nbPoints ; done += count) {
+            count = table[i].nbPoints - done < ARCHIVE_CHUNK_POINTS ? table[i].nbPoints - done : ARCHIVE_CHUNK_POINTS;
+            readArchivePositions(&stream, &table[i].box, positions, count, previous);
+            ok = !stream.error && fwrite(positions, 2 * sizeof(float), count, file) == count;
+        }
+        ok = ok && writePadded(file, NULL, 0, sceneFileArraySize(&sizes, 0) - 2ULL * table[i].nbPoints * sizeof(float));
+        for(done = 0 ; ok && done < table[i].nbPoints ; done += count) {
+            count = table[i].nbPoints - done < ARCHIVE_CHUNK_POINTS ? table[i].nbPoints - done : ARCHIVE_CHUNK_POINTS;
+            readArchiveColors(&stream, colors, count, &run, color);
+            ok = !stream.error && fwrite(colors, 3, count, file) == count;
+        }
+        ok = ok && writePadded(file, NULL, 0, sceneFileArraySize(&sizes, 1) - 3ULL * table[i].nbPoints);
+    }
+
+    free(positions);
+    free(colors);
+    free(table);
+    ok = closeArchiveStream(&stream) && ok;
+    ok = fclose(file) == 0 && ok;
+    if(!ok || rename(tmpPath, scenePath) != 0) {
+        remove(tmpPath);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Convertit un fichier de scène binaire en archive : le fichier est projeté et lu une fois dans l'ordre, sans copie dans le tas */
+int convertSceneFileToArchive(const char* scenePath, const char* archivePath) {
+    size_t size;
+    unsigned char* data = mapSceneFile(scenePath, &size);
+    const SceneFileHeader* header;
+    const SceneFilePrimitive* table;
+    Primitive* primitives;
+    unsigned int i;
+    int ok;
+
+    if(!data) {
+        return 0;
+    }
+    header = (const SceneFileHeader*)data;
+    table = (const SceneFilePrimitive*)(data + sizeof(SceneFileHeader));
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    /* Des en-têtes de primitives qui pointent dans la projection, chaînées comme une scène */
+    primitives = (Primitive*)calloc(header->nbPrimitives ? header->nbPrimitives : 1, sizeof(Primitive));
+    if(!primitives) {
+        printf("Error at conversion primitives malloc\n");
+        exit(1);
+    }
+    for(i = 0 ; i < header->nbPrimitives ; i++) {
+        primitives[i].primitiveType = table[i].primitiveType;
+        mapSceneFileList(&primitives[i].points, data, table + i);
+        primitives[i].next = i + 1 < header->nbPrimitives ? primitives + i + 1 : NULL;
+    }
+    ok = saveSceneArchive(header->nbPrimitives ? primitives : NULL, archivePath);
+
+    free(primitives);
+    munmap(data, size);
+
+    return ok;
+}
+
+/* Fonctions du fil de sauvegarde automatique : les enregistrements sont écrits par groupes, un seul fsync par groupe */
+
+/* Écrit des enregistrements puis attend qu'ils soient sur le disque : renvoie 0 en cas d'erreur */
+int writeAutosaveRecords(FILE* file, const unsigned char* data, size_t size) {
+
+    if(size > 0 && fwrite(data, 1, size, file) != size) {
+        return 0;
+    }
+
+    return fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+/* Écrit l'en-tête du journal puis la scène de l'instantané, de la queue à la tête, sous forme d'ajouts */
+int writeAutosaveCheckpoint(FILE* file, const SceneSnapshot* checkpoint) {
+    AutosaveFileHeader header;
+    const Primitive* primitive;
+    Point chunk[256];
+    unsigned int i, k, nbPrimitives = 0;
+    int ok;
+
+    memset(&header, 0, sizeof(AutosaveFileHeader));
+    memcpy(header.magic, "IMACLOG", 8);
+    header.version = AUTOSAVE_FILE_VERSION;
+    header.byteOrder = 0x01020304;
+    ok = fwrite(&header, sizeof(AutosaveFileHeader), 1, file) == 1;
+
+    for(primitive = checkpoint->scene ; primitive ; primitive = primitive->next) {
+        nbPrimitives++;
+    }
+    /* Les primitives d'un instantané se suivent dans un tableau : checkpoint->scene + i est la i-ème en partant de la tête */
+    for(i = nbPrimitives ; ok && i-- > 0 ; ) {
+        const PointList* list = &checkpoint->scene[i].points;
+        AutosaveRecord record = {AUTOSAVE_ADD_PRIMITIVE, nbPrimitives - 1 - i, 0, checkpoint->scene[i].primitiveType};
+        ok = fwrite(&record, sizeof(AutosaveRecord), 1, file) == 1;
+        if(list->nbPoints == 0) {
+            continue;
+        }
+        record.type = AUTOSAVE_ADD_POINTS;
+        record.count = list->nbPoints;
+        record.value = 0;
+        ok = ok && fwrite(&record, sizeof(AutosaveRecord), 1, file) == 1;
+        for(k = 0 ; ok && k < list->nbPoints ; k++) {
+            chunk[k % 256] = getPoint(list, k);
+            if(k % 256 == 255 || k == list->nbPoints - 1) {
+                ok = fwrite(chunk, sizeof(Point), k % 256 + 1, file) == k % 256 + 1;
+            }
+        }
+    }
+
+    return ok;
+}
+
+/* Écrit sur le disque le répertoire de path, pour qu'un rename qui y a eu lieu survive à une coupure : renvoie 0 en cas d'erreur */
+int syncParentDirectory(const char* path) {
+    char directory[1024];
+    char* slash;
+    int fd, ok;
+
+    snprintf(directory, sizeof(directory), "%s", path);
+    slash = strrchr(directory, '/');
+    if(!slash) {
+        snprintf(directory, sizeof(directory), ".");
+    }
+    else if(slash == directory) {
+        directory[1] = '\0';
+    }
+    else {
+        *slash = '\0';
+    }
+    fd = open(directory, O_RDONLY);
+    if(fd < 0) {
+        return 0;
+    }
+    ok = fsync(fd) == 0;
+    close(fd);
+
+    return ok;
+}
+
+/* Compactage : l'instantané et les enregistrements qui le suivent forment un nouveau journal, qui remplace l'ancien d'un rename */
+/* Renvoie le journal dans lequel continuer d'écrire (l'ancien si le nouveau n'a pas pu être écrit) */
+FILE* compactAutosave(FILE* file, const SceneSnapshot* checkpoint, const unsigned char* data, size_t boundary, size_t size) {
+    char tmpPath[1024];
+    FILE* compacted;
+
+    /* Les enregistrements d'avant l'instantané vont encore dans l'ancien journal, au cas où le nouveau ne serait pas écrit */
+    if(file && !writeAutosaveRecords(file, data, boundary)) {
+        printf("Impossible d'écrire %s\n", autosave.path);
+    }
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", autosave.path);
+    compacted = fopen(tmpPath, "wb");
+    if(!compacted) {
+        printf("Impossible d'écrire %s\n", tmpPath);
+        return file;
+    }
+    if(!writeAutosaveCheckpoint(compacted, checkpoint)
+        || !writeAutosaveRecords(compacted, data + boundary, size - boundary)
+        || rename(tmpPath, autosave.path) != 0) {
+        printf("Impossible d'écrire %s\n", tmpPath);
+        fclose(compacted);
+        remove(tmpPath);
+        return file;
+    }
+    /* Le nouveau journal n'est sûr qu'une fois le répertoire écrit : jusque-là une coupure peut ramener l'ancien, qui est encore complet */
+    if(!syncParentDirectory(autosave.path)) {
+        printf("Impossible d'écrire le répertoire de %s\n", autosave.path);
+    }
+    if(file) {
+        fclose(file);
+    }
+
+    return compacted;
+}
+
+/* Fil d'écriture : il se réveille toutes les AUTOSAVE_INTERVAL ms (ou à la demande d'un compactage) et écrit tout ce qui s'est accumulé. */
+/* Tant qu'aucun compactage n'a réussi (au lancement, ou après un échec qui laisse l'ancien journal incomplet), les enregistrements */
+/* restent dans pending : le prochain instantané contient déjà ceux d'avant lui, les suivants vont dans le nouveau journal */
+int autosaveThreadMain(void* data) {
+    AutosaveBuffer writing = {NULL, 0, 0};
+    FILE* file = NULL; // Journal en cours d'écriture (NULL avant le premier compactage réussi et après un compactage raté)
+    int running = 1;
+
+    (void)data;
+    SDL_LockMutex(autosave.mutex);
+    while(running) {
+        SceneSnapshot* checkpoint;
+        size_t boundary;
+        AutosaveBuffer swap;
+
+        if(autosave.running && !autosave.checkpoint) {
+            SDL_CondWaitTimeout(autosave.wake, autosave.mutex, AUTOSAVE_INTERVAL);
+        }
+        running = autosave.running;
+        checkpoint = autosave.checkpoint;
+        boundary = autosave.boundary;
+        if(!checkpoint && !file) {
+            continue;
+        }
+        autosave.checkpoint = NULL;
+        /* Les tampons sont échangés : la boucle principale continue d'ajouter pendant l'écriture */
+        swap = autosave.pending;
+        autosave.pending = writing;
+        autosave.pending.size = 0;
+        autosave.canMerge = 0;
+        writing = swap;
+        SDL_CondBroadcast(autosave.drained);
+        SDL_UnlockMutex(autosave.mutex);
+
+        if(checkpoint) {
+            FILE* compacted = compactAutosave(file, checkpoint, writing.data, boundary, writing.size);
+            /* Un échec laisse l'ancien journal sur le disque, mais il lui manque désormais des enregistrements : */
+            /* il n'en reçoit plus jusqu'au compactage réussi que la boucle principale redemande */
+            if(compacted == file && file) {
+                fclose(file);
+                compacted = NULL;
+            }
+            file = compacted;
+            releaseSnapshot(checkpoint);
+        }
+        else if(writing.size > 0 && !writeAutosaveRecords(file, writing.data, writing.size)) {
+            printf("Impossible d'écrire %s\n", autosave.path);
+        }
+
+        SDL_LockMutex(autosave.mutex);
+        if(checkpoint) {
+            autosave.compacting = 0;
+            autosave.writable = file != NULL;
+            autosave.failed = file == NULL;
+            autosave.failedTime = SDL_GetTicks();
+            autosave.checkpointBytes = file ? ftell(file) : 0;
+        }
+        if(file) {
+            autosave.logBytes = ftell(file);
+        }
+    }
+    SDL_UnlockMutex(autosave.mutex);
+
+    if(file) {
+        fclose(file);
+    }
+    free(writing.data);
+
+    return 0;
+}
+
+/* À chaque image : demande un compactage si la scène a changé hors du journal, si le journal dépasse AUTOSAVE_COMPACT_BYTES et a doublé, */
+/* ou toutes les AUTOSAVE_INTERVAL ms après un compactage raté */
+void autosaveTick(PrimitiveList scene) {
+    Primitive* primitive;
+    SceneSnapshot* checkpoint;
+    unsigned int nbPrimitives = 0, id;
+    int compacting, failed;
+    Uint32 failedTime;
+    size_t logBytes, checkpointBytes;
+
+    if(!autosave.thread) {
+        return;
+    }
+    SDL_LockMutex(autosave.mutex);
+    compacting = autosave.compacting;
+    logBytes = autosave.logBytes;
+    checkpointBytes = autosave.checkpointBytes;
+    failed = autosave.failed;
+    failedTime = autosave.failedTime;
+    SDL_UnlockMutex(autosave.mutex);
+    if(compacting || (failed && SDL_GetTicks() - failedTime < AUTOSAVE_INTERVAL)
+        || (!failed && !autosave.checkpointNeeded && (logBytes < AUTOSAVE_COMPACT_BYTES || logBytes < 2 * checkpointBytes))) {
+        return;
+    }
+
+    /* Les rangs des primitives sont recalculés : le nouveau journal les numérote depuis la queue */
+    for(primitive = scene ; primitive ; primitive = primitive->next) {
+        nbPrimitives++;
+    }
+    for(id = nbPrimitives, primitive = scene ; primitive ; primitive = primitive->next) {
+        primitive->points.autosaveId = --id;
+    }
+    autosave.nbPrimitives = nbPrimitives;
+    autosave.checkpointNeeded = 0;
+    checkpoint = takeSnapshot(scene);
+
+    SDL_LockMutex(autosave.mutex);
+    autosave.checkpoint = checkpoint;
+    autosave.boundary = autosave.pending.size;
+    autosave.canMerge = 0;
+    autosave.compacting = 1;
+    SDL_CondSignal(autosave.wake);
+    SDL_UnlockMutex(autosave.mutex);
+
+    return;
+}
+
+/* Lance la sauvegarde automatique de la scène dans path : le premier compactage écrit la scène entière */
+int startAutosave(PrimitiveList scene, const char* path) {
+
+    autosave.mutex = SDL_CreateMutex();
+    autosave.wake = SDL_CreateCond();
+    autosave.drained = SDL_CreateCond();
+    autosave.path = path;
+    autosave.running = 1;
+    autosave.thread = SDL_CreateThread(autosaveThreadMain, NULL);
+    if(!autosave.thread) {
+        SDL_DestroyCond(autosave.drained);
+        SDL_DestroyCond(autosave.wake);
+        SDL_DestroyMutex(autosave.mutex);
+        return 0;
+    }
+    autosaveInvalidate();
+    autosaveTick(scene);
+
+    return 1;
+}
+
+/* Arrête la sauvegarde automatique après une dernière écriture ; un arrêt normal efface le journal, qui ne sert qu'après un arrêt brutal */
+void finishAutosave() {
+
+    if(!autosave.thread) {
+        return;
+    }
+    SDL_LockMutex(autosave.mutex);
+    autosave.running = 0;
+    SDL_CondSignal(autosave.wake);
+    SDL_UnlockMutex(autosave.mutex);
+    SDL_WaitThread(autosave.thread, NULL);
+
+    remove(autosave.path);
+    free(autosave.pending.data);
+    SDL_DestroyCond(autosave.drained);
+    SDL_DestroyCond(autosave.wake);
+    SDL_DestroyMutex(autosave.mutex);
+    memset(&autosave, 0, sizeof(AutosaveState));
+
+    return;
+}
+
+/* 1 si les count indices sont croissants et inférieurs à limit */
+int isIndexRangeValid(const unsigned int* indices, unsigned int count, unsigned int limit) {
+    unsigned int i;
+
+    for(i = 0 ; i < count ; i++) {
+        if(indices[i] >= limit || (i > 0 && indices[i] <= indices[i - 1])) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Rejoue un enregistrement sur la scène : renvoie 0 s'il est incohérent (la scène n'est alors pas modifiée) */
+/* primitives[id] est la primitive de rang id, nbPrimitives leur nombre */
+int replayAutosaveRecord(PrimitiveList* scene, Primitive*** primitives, unsigned int* nbPrimitives, const AutosaveRecord* record, const unsigned char* data, size_t size) {
+    PointList* list = NULL;
+    unsigned int i;
+
+    if(record->type != AUTOSAVE_ADD_PRIMITIVE) {
+        if(record->id >= *nbPrimitives) {
+            return 0;
+        }
+        list = &(*primitives)[record->id]->points;
+    }
+
+    switch(record->type) {
+        case AUTOSAVE_ADD_PRIMITIVE:
+            if(record->id != *nbPrimitives || record->value > GL_POLYGON) {
+                return 0;
+            }
+            /* Le tableau des primitives grandit par puissances de 2 */
+            if((*nbPrimitives & (*nbPrimitives - 1)) == 0) {
+                *primitives = (Primitive**)realloc(*primitives, (*nbPrimitives ? 2 * *nbPrimitives : 1) * sizeof(Primitive*));
+                if(!*primitives) {
+                    printf("Error at autosave primitives realloc\n");
+                    exit(1);
+                }
+            }
+            (*primitives)[*nbPrimitives] = allocPrimitive(record->value);
+            addPrimitive((*primitives)[*nbPrimitives], scene);
+            (*nbPrimitives)++;
+            return 1;
+        case AUTOSAVE_REMOVE_PRIMITIVE:
+            if(record->id != *nbPrimitives - 1) {
+                return 0;
+            }
+            *scene = (*scene)->next;
+            countPrimitive((*primitives)[record->id], -1);
+            deletePoints(list);
+            arenaFree(&sceneArena, (*primitives)[record->id], sizeof(Primitive));
+            (*nbPrimitives)--;
+            return 1;
+        case AUTOSAVE_ADD_POINTS:
+            if(size != (size_t)record->count * sizeof(Point)) {
+                return 0;
+            }
+            reservePoints(list, list->nbPoints + record->count);
+            for(i = 0 ; i < record->count ; i++) {
+                addPointToList(((const Point*)data)[i], list);
+            }
+            return 1;
+        case AUTOSAVE_REPLACE_LAST:
+            if(size != sizeof(Point) || list->nbPoints == 0) {
+                return 0;
+            }
+            replaceLastPoint(list, *(const Point*)data);
+            return 1;
+        case AUTOSAVE_TRUNCATE:
+            if(record->value > list->nbPoints) {
+                return 0;
+            }
+            truncatePoints(list, record->value);
+            return 1;
+        case AUTOSAVE_ERASE:
+            if(size != (size_t)record->count * sizeof(unsigned int) || !isIndexRangeValid((const unsigned int*)data, record->count, list->nbPoints)) {
+                return 0;
+            }
+            removeIndexedPoints(list, (const unsigned int*)data, record->count);
+            return 1;
+        case AUTOSAVE_RESTORE:
+            if(size != (size_t)record->count * (sizeof(unsigned int) + sizeof(Point)) || !isIndexRangeValid((const unsigned int*)data, record->count, list->nbPoints + record->count)) {
+                return 0;
+            }
+            restorePoints(list, (const unsigned int*)data, (const Point*)(data + record->count * sizeof(unsigned int)), record->count);
+            return 1;
+        case AUTOSAVE_TRANSFORM:
+            if(size != 6 * sizeof(float)) {
+                return 0;
+            }
+            else {
+                const float* m = (const float*)data;
+                transformPoints(list, record->value, record->count, m[0], m[1], m[2], m[3], m[4], m[5]);
+            }
+            return 1;
+        case AUTOSAVE_RECOLOR:
+            if(size != 4) {
+                return 0;
+            }
+            recolorPoints(list, record->value, record->count, data[0], data[1], data[2]);
+            return 1;
+        case AUTOSAVE_COMPACT:
+            compactPoints(list);
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Taille des données qui suivent un enregistrement (0 si le type est inconnu) */
+size_t autosaveRecordSize(const AutosaveRecord* record) {
+
+    switch(record->type) {
+        case AUTOSAVE_ADD_POINTS:
+            return (size_t)record->count * sizeof(Point);
+        case AUTOSAVE_REPLACE_LAST:
+            return sizeof(Point);
+        case AUTOSAVE_ERASE:
+            return (size_t)record->count * sizeof(unsigned int);
+        case AUTOSAVE_RESTORE:
+            return (size_t)record->count * (sizeof(unsigned int) + sizeof(Point));
+        case AUTOSAVE_TRANSFORM:
+            return 6 * sizeof(float);
+        case AUTOSAVE_RECOLOR:
+            return 4;
+    }
+
+    return 0;
+}
+
+/* Rejoue le journal de sauvegarde automatique laissé par un arrêt brutal : renvoie le nombre d'enregistrements rejoués (0 si le fichier est absent ou invalide) */
+/* Un enregistrement coupé ou incohérent (écriture interrompue) arrête la relecture : la scène garde tout ce qui le précède */
+unsigned int replayAutosave(const char* path, PrimitiveList* scene) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    unsigned char* data;
+    size_t position = sizeof(AutosaveFileHeader);
+    Primitive** primitives = NULL;
+    unsigned int nbPrimitives = 0, nbRecords = 0;
+    AutosaveFileHeader header;
+
+    if(fd < 0) {
+        return 0;
+    }
+    if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(AutosaveFileHeader)) {
+        close(fd);
+        return 0;
+    }
+    data = (unsigned char*)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        return 0;
+    }
+    memcpy(&header, data, sizeof(AutosaveFileHeader));
+    if(memcmp(header.magic, "IMACLOG", 8) != 0 || header.version != AUTOSAVE_FILE_VERSION || header.byteOrder != 0x01020304) {
+        munmap(data, info.st_size);
+        return 0;
+    }
+
+    resetScene(scene);
+    while(position + sizeof(AutosaveRecord) <= (size_t)info.st_size) {
+        const AutosaveRecord* record = (const AutosaveRecord*)(data + position);
+        size_t size = autosaveRecordSize(record);
+        if(size > (size_t)info.st_size - position - sizeof(AutosaveRecord)
+            || !replayAutosaveRecord(scene, &primitives, &nbPrimitives, record, data + position + sizeof(AutosaveRecord), size)) {
+            break;
+        }
+        position += sizeof(AutosaveRecord) + size;
+        nbRecords++;
+    }
+    free(primitives);
+    munmap(data, info.st_size);
+    invalidateSpatialGrid();
+    invalidateLodPyramid();
+    if(!*scene) {
+        addPrimitive(allocPrimitive(GL_POINTS), scene);
+    }
+
+    return nbRecords;
+}
+
+/* Fonctions de lecture de points en flux */
+/* Texte : une ligne "x y" ou "x y r g b" par point, "p type" commence une primitive (points, lines, line_strip, line_loop, triangles), "#" commente */
+/* Binaire : "IMACPTS" puis des enregistrements de 12 octets dans l'ordre d'octets de la machine : float x, float y, r, g, b, genre */
+/* (genre 0 pour un point, 1 pour une nouvelle primitive dont le type est dans r) */
+/* SVG (premier caractère <) : les éléments de tracé, courbes aplaties. CSV (séparateurs ; ou , dans la première ligne) : une ligne par point, */
+/* colonnes x, y, r, g, b, primitive et type nommées par l'en-tête (celui de l'export CSV convient) */
+
+/* Nouveau lot vide (malloc, à libérer avec freeIngestBatch) */
+IngestBatch* allocIngestBatch() {
+    IngestBatch* batch = (IngestBatch*)malloc(sizeof(IngestBatch));
+
+    if(!batch) {
+        printf("Error at ingest batch malloc\n");
+        exit(1);
+    }
+    batch->nbPoints = 0;
+    batch->nbIgnored = 0;
+    batch->positions = (float*)malloc(2 * INGEST_BATCH_POINTS * sizeof(float));
+    batch->colors = (unsigned char*)malloc(3 * INGEST_BATCH_POINTS * sizeof(unsigned char));
+    batch->nbPrimitives = 0;
+    batch->starts = (unsigned int*)malloc(INGEST_BATCH_PRIMITIVES * sizeof(unsigned int));
+    batch->primitiveTypes = (GLenum*)malloc(INGEST_BATCH_PRIMITIVES * sizeof(GLenum));
+    if(!batch->positions || !batch->colors || !batch->starts || !batch->primitiveTypes) {
+        printf("Error at ingest batch malloc\n");
+        exit(1);
+    }
+
+    return batch;
+}
+
+void freeIngestBatch(IngestBatch* batch) {
+    free(batch->positions);
+    free(batch->colors);
+    free(batch->starts);
+    free(batch->primitiveTypes);
+    free(batch);
+    return;
+}
+
+/* Met le lot dans la file en attendant une place : renvoie 0 (et libère le lot) si la lecture doit s'arrêter */
+int pushIngestBatch(IngestBatch* batch) {
+    int stop;
+
+    SDL_LockMutex(ingest.mutex);
+    while(ingest.nbBatches == INGEST_QUEUE_LENGTH && !ingest.stop) {
+        SDL_CondWait(ingest.notFull, ingest.mutex);
+    }
+    stop = ingest.stop;
+    if(!stop) {
+        ingest.batches[(ingest.first + ingest.nbBatches) % INGEST_QUEUE_LENGTH] = batch;
+        ingest.nbBatches++;
+    }
+    SDL_UnlockMutex(ingest.mutex);
+    if(stop) {
+        freeIngestBatch(batch);
+    }
+
+    return !stop;
+}
+
+/* Ajoute un point au lot courant, qui part dans la file quand il est plein : renvoie 0 si la lecture doit s'arrêter */
+int ingestPoint(IngestBatch** batch, float x, float y, const unsigned char* color) {
+    IngestBatch* current = *batch;
+
+    current->positions[2 * current->nbPoints] = x;
+    current->positions[2 * current->nbPoints + 1] = y;
+    memcpy(current->colors + 3 * current->nbPoints, color, 3);
+    current->nbPoints++;
+    if(current->nbPoints < INGEST_BATCH_POINTS) {
+        return 1;
+    }
+    *batch = allocIngestBatch();
+
+    return pushIngestBatch(current);
+}
+
+/* Commence une primitive dans le lot courant, qui part dans la file s'il n'a plus de place : renvoie 0 si la lecture doit s'arrêter */
+/* Une primitive encore vide prend simplement le nouveau type */
+int ingestPrimitive(IngestBatch** batch, GLenum primitiveType) {
+    IngestBatch* current = *batch;
+
+    if(current->nbPrimitives > 0 && current->starts[current->nbPrimitives - 1] == current->nbPoints) {
+        current->primitiveTypes[current->nbPrimitives - 1] = primitiveType;
+        return 1;
+    }
+    if(current->nbPrimitives == INGEST_BATCH_PRIMITIVES) {
+        *batch = allocIngestBatch();
+        if(!pushIngestBatch(current)) {
+            return 0;
+        }
+        current = *batch;
+    }
+    current->starts[current->nbPrimitives] = current->nbPoints;
+    current->primitiveTypes[current->nbPrimitives] = primitiveType;
+    current->nbPrimitives++;
+
+    return 1;
+}
+
+/* Type de primitive d'après son nom : renvoie 0 si le nom est inconnu */
+int parsePrimitiveType(const char* name, GLenum* primitiveType) {
+    static const char* NAMES[] = {"points", "lines", "line_strip", "line_loop", "triangles"};
+    static const GLenum TYPES[] = {GL_POINTS, GL_LINES, GL_LINE_STRIP, GL_LINE_LOOP, GL_TRIANGLES};
+    unsigned int i, length = strcspn(name, " \t\r");
+
+    for(i = 0 ; i < 5 ; i++) {
+        if(strlen(NAMES[i]) == length && strncmp(name, NAMES[i], length) == 0) {
+            *primitiveType = TYPES[i];
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* strtof rapide pour les nombres décimaux courants : les autres passent par strtof */
+/* Quand la mantisse tient dans les 24 bits d'un float et la puissance de 10 est exacte en float (jusqu'à 1e10), */
+/* une seule division en float donne le même arrondi que strtof */
+float parseIngestFloat(char* cursor, char** next) {
+    static const float POWERS[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    char* start = cursor;
+    unsigned long long mantissa = 0;
+    int nbDigits = 0, nbDecimals = 0, negative = 0;
+    float value;
+
+    for( ; *cursor == ' ' || *cursor == '\t' ; cursor++);
+    if(*cursor == '-' || *cursor == '+') {
+        negative = *cursor == '-';
+        cursor++;
+    }
+    for( ; *cursor >= '0' && *cursor <= '9' ; cursor++, nbDigits++) {
+        mantissa = mantissa * 10 + (*cursor - '0');
+    }
+    if(*cursor == '.') {
+        for(cursor++ ; *cursor >= '0' && *cursor <= '9' ; cursor++, nbDigits++, nbDecimals++) {
+            mantissa = mantissa * 10 + (*cursor - '0');
+        }
+    }
+    if(nbDigits == 0 || nbDigits > 15 || nbDecimals > 10 || mantissa > (1 << 24) || *cursor == 'e' || *cursor == 'E') {
+        return strtof(start, next);
+    }
+    value = (float)mantissa / POWERS[nbDecimals];
+    *next = cursor;
+
+    return negative ? -value : value;
+}
+
+/* Découpe les lignes complètes de data (la dernière aussi si last) : renvoie le nombre d'octets consommés, ou 0 avec *stop à 1 si la lecture doit s'arrêter */
+size_t parseIngestText(char* data, size_t size, int last, IngestBatch** batch, int* stop) {
+    static const unsigned char WHITE[3] = {255, 255, 255};
+    size_t position = 0;
+
+    while(position < size) {
+        char* line = data + position;
+        char* end = (char*)memchr(line, '\n', size - position);
+        char* cursor;
+        char* next;
+        float x, y;
+
+        if(!end) {
+            if(!last) {
+                break;
+            }
+            end = data + size;
+        }
+        /* La ligne est terminée par un zéro pour les conversions (data a une case de plus que les octets lus) */
+        position = end < data + size ? (size_t)(end - data) + 1 : size;
+        *end = '\0';
+
+        for(cursor = line ; *cursor == ' ' || *cursor == '\t' ; cursor++);
+        if(*cursor == '\0' || *cursor == '\r' || *cursor == '#') {
+            continue;
+        }
+        if(*cursor == 'p') {
+            GLenum primitiveType;
+            for(cursor++ ; *cursor == ' ' || *cursor == '\t' ; cursor++);
+            if(!parsePrimitiveType(cursor, &primitiveType)) {
+                (*batch)->nbIgnored++;
+            }
+            else if(!ingestPrimitive(batch, primitiveType)) {
+                *stop = 1;
+                return 0;
+            }
+            continue;
+        }
+
+        x = parseIngestFloat(cursor, &next);
+        if(next == cursor) {
+            (*batch)->nbIgnored++;
+            continue;
+        }
+        cursor = next;
+        y = parseIngestFloat(cursor, &next);
+        if(next == cursor) {
+            (*batch)->nbIgnored++;
+            continue;
+        }
+        cursor = next;
+        {
+            unsigned char color[3];
+            long r = strtol(cursor, &next, 10);
+            const unsigned char* pointColor = WHITE;
+            if(next != cursor) {
+                long g = strtol(next, &cursor, 10);
+                long b = strtol(cursor, &next, 10);
+                color[0] = r < 0 ? 0 : r > 255 ? 255 : r;
+                color[1] = g < 0 ? 0 : g > 255 ? 255 : g;
+                color[2] = b < 0 ? 0 : b > 255 ? 255 : b;
+                pointColor = color;
+            }
+            if(!ingestPoint(batch, x, y, pointColor)) {
+                *stop = 1;
+                return 0;
+            }
+        }
+    }
+
+    return position;
+}
+
+/* Découpe les enregistrements binaires complets de data : renvoie le nombre d'octets consommés, ou 0 avec *stop à 1 si la lecture doit s'arrêter */
+size_t parseIngestBinary(const unsigned char* data, size_t size, IngestBatch** batch, int* stop) {
+    size_t position;
+
+    for(position = 0 ; position + 12 <= size ; position += 12) {
+        const unsigned char* record = data + position;
+        float x, y;
+
+        memcpy(&x, record, sizeof(float));
+        memcpy(&y, record + 4, sizeof(float));
+        if(record[11] == 1) {
+            if(record[8] > GL_POLYGON) {
+                (*batch)->nbIgnored++;
+                continue;
+            }
+            if(!ingestPrimitive(batch, record[8])) {
+                *stop = 1;
+                return 0;
+            }
+        }
+        else if(!ingestPoint(batch, x, y, record + 8)) {
+            *stop = 1;
+            return 0;
+        }
+    }
+
+    return position;
+}
+
+/* Lit la première ligne d'un flux CSV : le séparateur et le rôle de chaque colonne d'après son nom */
+/* Renvoie 0 si la ligne commence par un nombre : il n'y a pas d'en-tête, les colonnes sont alors x, y, r, g, b */
+int parseCsvHeader(char* line) {
+    static const char* CSV_COLUMNS[] = {"x", "y", "r", "g", "b", "primitive", "type"};
+    char* cursor;
+    unsigned int i;
+
+    ingest.csvSeparator = strchr(line, ';') ? ';' : ',';
+    ingest.csvPrimitive = -1;
+    ingest.nbCsvColumns = 0;
+    /* Marque d'ordre des octets UTF-8 en tête de fichier */
+    if(strncmp(line, "\xEF\xBB\xBF", 3) == 0) {
+        line += 3;
+    }
+    for(cursor = line ; *cursor == ' ' || *cursor == '\t' ; cursor++);
+    if((*cursor >= '0' && *cursor <= '9') || *cursor == '-' || *cursor == '+' || *cursor == '.') {
+        for(i = 0 ; i < 5 ; i++) {
+            ingest.csvColumns[i] = i;
+        }
+        ingest.nbCsvColumns = 5;
+        return 0;
+    }
+    while(ingest.nbCsvColumns < 16) {
+        char separators[3] = {ingest.csvSeparator, '\r', '\0'};
+        size_t length = strcspn(cursor, separators);
+        char* name = cursor;
+        int role = -1;
+
+        cursor += length;
+        /* Les noms peuvent être entourés d'espaces ou de guillemets */
+        for( ; length > 0 && (*name == ' ' || *name == '"') ; name++, length--);
+        for( ; length > 0 && (name[length - 1] == ' ' || name[length - 1] == '"') ; length--);
+        for(i = 0 ; i < 7 ; i++) {
+            if(strlen(CSV_COLUMNS[i]) == length && strncasecmp(name, CSV_COLUMNS[i], length) == 0) {
+                role = i;
+            }
+        }
+        ingest.csvColumns[ingest.nbCsvColumns++] = role;
+        if(*cursor != ingest.csvSeparator) {
+            break;
+        }
+        cursor++;
+    }
+
+    return 1;
+}
+
+/* Découpe les lignes CSV complètes de data (la dernière aussi si last), comme parseIngestText */
+/* Un changement de la colonne primitive commence une primitive du type de la colonne type (GL_LINE_STRIP sans elle), */
+/* une ligne vide aussi : sans colonne primitive, chaque bloc de lignes est une polyligne */
+size_t parseIngestCsv(char* data, size_t size, int last, IngestBatch** batch, int* stop) {
+    static const unsigned char WHITE[3] = {255, 255, 255};
+    size_t position = 0;
+
+    while(position < size) {
+        char* line = data + position;
+        char* end = (char*)memchr(line, '\n', size - position);
+        char* cursor;
+        float x = 0, y = 0;
+        long values[7];
+        int present[7] = {0, 0, 0, 0, 0, 0, 0};
+        unsigned int i;
+
+        if(!end) {
+            if(!last) {
+                break;
+            }
+            end = data + size;
+        }
+        position = end < data + size ? (size_t)(end - data) + 1 : size;
+        *end = '\0';
+
+        for(cursor = line ; *cursor == ' ' || *cursor == '\t' ; cursor++);
+        if(*cursor == '\0' || *cursor == '\r') {
+            ingest.csvPrimitive = -1;
+            continue;
+        }
+        if(ingest.nbCsvColumns == 0 && parseCsvHeader(line)) {
+            continue;
+        }
+
+        for(i = 0 ; i < ingest.nbCsvColumns && cursor ; i++) {
+            int role = ingest.csvColumns[i];
+            char* next = cursor;
+
+            if(role == 0 || role == 1) {
+                float value = parseIngestFloat(cursor, &next);
+                if(role == 0) {
+                    x = value;
+                }
+                else {
+                    y = value;
+                }
+            }
+            else if(role >= 0) {
+                values[role] = strtol(cursor, &next, 10);
+            }
+            if(role >= 0) {
+                present[role] = next != cursor;
+            }
+            cursor = strchr(cursor, ingest.csvSeparator);
+            if(cursor) {
+                cursor++;
+            }
+        }
+        if(!present[0] || !present[1]) {
+            (*batch)->nbIgnored++;
+            continue;
+        }
+
+        /* Nouvelle primitive : autre numéro de primitive, ou première ligne d'un bloc */
+        if((present[5] && values[5] != ingest.csvPrimitive) || (!present[5] && ingest.csvPrimitive < 0)) {
+            GLenum primitiveType = present[6] && values[6] >= 0 && values[6] <= GL_POLYGON ? (GLenum)values[6] : GL_LINE_STRIP;
+            ingest.csvPrimitive = present[5] ? values[5] : 0;
+            if(!ingestPrimitive(batch, primitiveType)) {
+                *stop = 1;
+                return 0;
+            }
+        }
+        if(present[2] && present[3] && present[4]) {
+            unsigned char color[3];
+            for(i = 0 ; i < 3 ; i++) {
+                color[i] = values[2 + i] < 0 ? 0 : values[2 + i] > 255 ? 255 : values[2 + i];
+            }
+            if(!ingestPoint(batch, x, y, color)) {
+                *stop = 1;
+                return 0;
+            }
+        }
+        else if(!ingestPoint(batch, x, y, WHITE)) {
+            *stop = 1;
+            return 0;
+        }
+    }
+
+    return position;
+}
+
+/* Fonctions du lecteur SVG : les éléments de tracé (path, polyline, polygon, line, rect, circle, ellipse) deviennent des primitives, */
+/* les courbes des lignes brisées qui s'en écartent d'au plus SVG_TOLERANCE. L'axe y du SVG descend, il est retourné */
+
+/* Valeur de l'attribut name de la balise tag (terminée par un zéro) : renvoie NULL s'il est absent, sinon son début et sa fin (le guillemet) dans *end */
+char* svgAttribute(char* tag, const char* name, char** end) {
+    size_t length = strlen(name);
+    char* cursor;
+
+    for(cursor = strstr(tag, name) ; cursor ; cursor = strstr(cursor + 1, name)) {
+        char* value = cursor + length;
+        if(cursor == tag || !(cursor[-1] == ' ' || cursor[-1] == '\t' || cursor[-1] == '\n' || cursor[-1] == '\r')) {
+            continue;
+        }
+        for( ; *value == ' ' || *value == '\t' || *value == '\n' || *value == '\r' ; value++);
+        if(*value != '=') {
+            continue;
+        }
+        for(value++ ; *value == ' ' || *value == '\t' || *value == '\n' || *value == '\r' ; value++);
+        if(*value != '"' && *value != '\'') {
+            continue;
+        }
+        *end = strchr(value + 1, *value);
+        if(!*end) {
+            *end = value + strlen(value);
+        }
+        return value + 1;
+    }
+
+    return NULL;
+}
+
+/* Lit un nombre d'une liste SVG (espaces ou virgules entre les nombres) avant end : renvoie 0 s'il n'y en a plus */
+int svgNumber(char** cursor, const char* end, float* value) {
+    char* next;
+
+    for( ; *cursor < end && (**cursor == ' ' || **cursor == ',' || **cursor == '\t' || **cursor == '\n' || **cursor == '\r') ; (*cursor)++);
+    if(*cursor >= end) {
+        return 0;
+    }
+    *value = parseIngestFloat(*cursor, &next);
+    if(next == *cursor || next > end) {
+        return 0;
+    }
+    *cursor = next;
+
+    return 1;
+}
+
+/* Lit un drapeau d'arc (0 ou 1, éventuellement collé au suivant) : renvoie 0 s'il n'y en a pas */
+int svgFlag(char** cursor, const char* end, int* flag) {
+
+    for( ; *cursor < end && (**cursor == ' ' || **cursor == ',' || **cursor == '\t' || **cursor == '\n' || **cursor == '\r') ; (*cursor)++);
+    if(*cursor >= end || (**cursor != '0' && **cursor != '1')) {
+        return 0;
+    }
+    *flag = **cursor == '1';
+    (*cursor)++;
+
+    return 1;
+}
+
+/* Nombre de l'attribut name : renvoie 0 s'il est absent ou illisible */
+int svgAttributeNumber(char* tag, const char* name, float* value) {
+    char* end;
+    char* cursor = svgAttribute(tag, name, &end);
+
+    return cursor && svgNumber(&cursor, end, value);
+}
+
+/* Couleur SVG : #rgb, #rrggbb, rgb(r, g, b) ou l'un des noms courants. Renvoie 0 pour none ou une couleur inconnue */
+int parseSvgColor(const char* value, unsigned char* color) {
+    static const char* NAMES[] = {"black", "white", "red", "green", "blue", "yellow", "cyan", "magenta", "gray", "grey", "orange"};
+    static const unsigned char NAMED_COLORS[] = {0, 0, 0, 255, 255, 255, 255, 0, 0, 0, 128, 0, 0, 0, 255, 255, 255, 0, 0, 255, 255, 255, 0, 255, 128, 128, 128, 128, 128, 128, 255, 165, 0};
+    unsigned int i, length;
+
+    for( ; *value == ' ' ; value++);
+    if(value[0] == '#') {
+        unsigned long hex = 0;
+        for(length = 1 ; length <= 6 && isxdigit((unsigned char)value[length]) ; length++) {
+            hex = hex * 16 + (isdigit((unsigned char)value[length]) ? value[length] - '0' : tolower((unsigned char)value[length]) - 'a' + 10);
+        }
+        if(length == 4) {
+            color[0] = ((hex >> 8) & 15) * 17;
+            color[1] = ((hex >> 4) & 15) * 17;
+            color[2] = (hex & 15) * 17;
+            return 1;
+        }
+        if(length == 7) {
+            color[0] = hex >> 16;
+            color[1] = (hex >> 8) & 255;
+            color[2] = hex & 255;
+            return 1;
+        }
+        return 0;
+    }
+    if(strncmp(value, "rgb(", 4) == 0) {
+        char* cursor = (char*)value + 4;
+        for(i = 0 ; i < 3 ; i++) {
+            long component = strtol(cursor, &cursor, 10);
+            color[i] = component < 0 ? 0 : component > 255 ? 255 : component;
+            for( ; *cursor == ' ' || *cursor == ',' ; cursor++);
+        }
+        return 1;
+    }
+    for(i = 0 ; i < 11 ; i++) {
+        length = strlen(NAMES[i]);
+        if(strncmp(value, NAMES[i], length) == 0 && !isalpha((unsigned char)value[length])) {
+            memcpy(color, NAMED_COLORS + 3 * i, 3);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Couleur d'un élément : son trait (attribut ou style), à défaut son remplissage, à défaut du blanc */
+void svgColor(char* tag, unsigned char* color) {
+    static const char* PROPERTIES[] = {"stroke", "fill"};
+    static const char* STYLES[] = {"stroke:", "fill:"};
+    char* end;
+    char* style = svgAttribute(tag, "style", &end);
+    unsigned int i;
+
+    for(i = 0 ; i < 2 ; i++) {
+        char* value = svgAttribute(tag, PROPERTIES[i], &end);
+        if(value && parseSvgColor(value, color)) {
+            return;
+        }
+        value = style ? strstr(style, STYLES[i]) : NULL;
+        if(value && parseSvgColor(value + strlen(STYLES[i]), color)) {
+            return;
+        }
+    }
+    memset(color, 255, 3);
+
+    return;
+}
+
+/* Ajoute un point du tracé (y retourné) */
+void svgPoint(SvgPen* pen, float x, float y) {
+
+    if(!pen->stop && !ingestPoint(pen->batch, x, -y, pen->color)) {
+        pen->stop = 1;
+    }
+
+    return;
+}
+
+/* Commence une primitive */
+void svgPrimitive(SvgPen* pen, GLenum primitiveType) {
+
+    if(!pen->stop && !ingestPrimitive(pen->batch, primitiveType)) {
+        pen->stop = 1;
+    }
+    ingest.svgLines = 0;
+
+    return;
+}
+
+/* Segment jusqu'à (x, y) : le premier segment d'un sous-chemin commence sa primitive */
+void svgLineTo(SvgPen* pen, float x, float y) {
+
+    if(!pen->open) {
+        svgPrimitive(pen, GL_LINE_STRIP);
+        svgPoint(pen, pen->x, pen->y);
+        pen->open = 1;
+    }
+    svgPoint(pen, x, y);
+    pen->x = x;
+    pen->y = y;
+
+    return;
+}
+
+/* Nombre de segments égaux qui suivent une courbe à tolerance près, d'après la borne curvature de sa dérivée seconde : erreur <= curvature / (8 n²) */
+unsigned int svgSegments(double curvature, float tolerance) {
+    double count = ceil(sqrt(curvature / (8 * tolerance)));
+
+    return count < 1 ? 1 : count > SVG_MAX_SEGMENTS ? SVG_MAX_SEGMENTS : (unsigned int)count;
+}
+
+/* Courbe de Bézier cubique depuis le point courant */
+void svgCubicTo(SvgPen* pen, float x1, float y1, float x2, float y2, float x, float y) {
+    double x0 = pen->x, y0 = pen->y;
+    double ax = x0 - 2 * x1 + x2, ay = y0 - 2 * y1 + y2, bx = x1 - 2 * x2 + x, by = y1 - 2 * y2 + y;
+    double a = sqrt(ax * ax + ay * ay), b = sqrt(bx * bx + by * by);
+    /* La dérivée seconde vaut 6 ((1 - t) a + t b) : au plus 6 max(|a|, |b|) */
+    unsigned int n = svgSegments(6 * (a > b ? a : b), SVG_TOLERANCE), i;
+
+    for(i = 1 ; i < n ; i++) {
+        double t = (double)i / n, u = 1 - t;
+        svgLineTo(pen, u * u * u * x0 + 3 * u * u * t * x1 + 3 * u * t * t * x2 + t * t * t * x, u * u * u * y0 + 3 * u * u * t * y1 + 3 * u * t * t * y2 + t * t * t * y);
+    }
+    svgLineTo(pen, x, y);
+
+    return;
+}
+
+/* Courbe de Bézier quadratique depuis le point courant */
+void svgQuadTo(SvgPen* pen, float x1, float y1, float x, float y) {
+    double x0 = pen->x, y0 = pen->y;
+    double ax = x0 - 2 * x1 + x, ay = y0 - 2 * y1 + y;
+    /* La dérivée seconde est constante : 2 a */
+    unsigned int n = svgSegments(2 * sqrt(ax * ax + ay * ay), SVG_TOLERANCE), i;
+
+    for(i = 1 ; i < n ; i++) {
+        double t = (double)i / n, u = 1 - t;
+        svgLineTo(pen, u * u * x0 + 2 * u * t * x1 + t * t * x, u * u * y0 + 2 * u * t * y1 + t * t * y);
+    }
+    svgLineTo(pen, x, y);
+
+    return;
+}
+
+/* Pas angulaire d'un arc de rayon radius qui s'écarte d'au plus SVG_TOLERANCE de sa corde */
+double svgArcStep(double radius) {
+    double step = radius > SVG_TOLERANCE ? 2 * acos(1 - SVG_TOLERANCE / radius) : M_PI / 2;
+
+    return step < 2 * M_PI / SVG_MAX_SEGMENTS ? 2 * M_PI / SVG_MAX_SEGMENTS : step;
+}
+
+/* Arc d'ellipse depuis le point courant (commande A) : passage des extrémités au centre comme dans la norme SVG (annexe F.6) */
+void svgArcTo(SvgPen* pen, float rx, float ry, float angle, int large, int sweep, float x, float y) {
+    double phi = angle * M_PI / 180, cosPhi = cos(phi), sinPhi = sin(phi);
+    double dx = (pen->x - x) / 2, dy = (pen->y - y) / 2;
+    double x1 = cosPhi * dx + sinPhi * dy, y1 = -sinPhi * dx + cosPhi * dy;
+    double lambda, numerator, denominator, coefficient, centerX, centerY, cx, cy, theta, delta;
+    unsigned int n, i;
+
+    rx = fabs(rx);
+    ry = fabs(ry);
+    if(pen->x == x && pen->y == y) {
+        return;
+    }
+    if(rx == 0 || ry == 0) {
+        svgLineTo(pen, x, y);
+        return;
+    }
+    /* Rayons trop petits pour joindre les deux extrémités : ils sont agrandis */
+    lambda = x1 * x1 / (rx * rx) + y1 * y1 / (ry * ry);
+    if(lambda > 1) {
+        rx *= sqrt(lambda);
+        ry *= sqrt(lambda);
+    }
+    numerator = (double)rx * rx * ry * ry - (double)rx * rx * y1 * y1 - (double)ry * ry * x1 * x1;
+    denominator = (double)rx * rx * y1 * y1 + (double)ry * ry * x1 * x1;
+    coefficient = numerator > 0 ? sqrt(numerator / denominator) : 0;
+    if(large == sweep) {
+        coefficient = -coefficient;
+    }
+    centerX = coefficient * rx * y1 / ry;
+    centerY = -coefficient * ry * x1 / rx;
+    cx = cosPhi * centerX - sinPhi * centerY + (pen->x + x) / 2;
+    cy = sinPhi * centerX + cosPhi * centerY + (pen->y + y) / 2;
+    theta = atan2((y1 - centerY) / ry, (x1 - centerX) / rx);
+    delta = atan2((-y1 - centerY) / ry, (-x1 - centerX) / rx) - theta;
+    if(!sweep && delta > 0) {
+        delta -= 2 * M_PI;
+    }
+    else if(sweep && delta < 0) {
+        delta += 2 * M_PI;
+    }
+
+    n = ceil(fabs(delta) / svgArcStep(rx > ry ? rx : ry));
+    for(i = 1 ; i < n ; i++) {
+        double t = theta + delta * i / n;
+        svgLineTo(pen, cx + rx * cos(t) * cosPhi - ry * sin(t) * sinPhi, cy + rx * cos(t) * sinPhi + ry * sin(t) * cosPhi);
+    }
+    svgLineTo(pen, x, y);
+
+    return;
+}
+
+/* Ellipse entière (éléments circle et ellipse) en une primitive GL_LINE_LOOP */
+void svgEllipse(SvgPen* pen, float cx, float cy, float rx, float ry) {
+    unsigned int n, i;
+
+    if(rx <= 0 || ry <= 0) {
+        return;
+    }
+    n = ceil(2 * M_PI / svgArcStep(rx > ry ? rx : ry));
+    n = n < 3 ? 3 : n;
+    svgPrimitive(pen, GL_LINE_LOOP);
+    for(i = 0 ; i < n ; i++) {
+        svgPoint(pen, cx + rx * cos(2 * M_PI * i / n), cy + ry * sin(2 * M_PI * i / n));
+    }
+
+    return;
+}
+
+/* Données d'un chemin (attribut d) entre cursor et end : chaque sous-chemin devient une primitive GL_LINE_STRIP, fermée par Z en revenant à son début */
+/* La lecture s'arrête à la première commande invalide, comme le prévoit la norme */
+void parseSvgPath(SvgPen* pen, char* cursor, const char* end) {
+    char command = 0, previous = 0;
+    float v[7], controlX = 0, controlY = 0;
+    int large, sweep;
+
+    while(!pen->stop) {
+        float originX, originY;
+        int relative;
+
+        for( ; cursor < end && (*cursor == ' ' || *cursor == ',' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r') ; cursor++);
+        if(cursor >= end) {
+            break;
+        }
+        if(isalpha((unsigned char)*cursor)) {
+            command = *cursor++;
+        }
+        else if(!command) {
+            break;
+        }
+        relative = islower((unsigned char)command);
+        originX = relative ? pen->x : 0;
+        originY = relative ? pen->y : 0;
+
+        switch(toupper((unsigned char)command)) {
+            case 'M':
+                if(!svgNumber(&cursor, end, v) || !svgNumber(&cursor, end, v + 1)) {
+                    return;
+                }
+                pen->x = pen->startX = originX + v[0];
+                pen->y = pen->startY = originY + v[1];
+                pen->open = 0;
+                /* Les paires qui suivent un déplacement sont des segments */
+                command = relative ? 'l' : 'L';
+                break;
+            case 'Z':
+                if(pen->open && (pen->x != pen->startX || pen->y != pen->startY)) {
+                    svgLineTo(pen, pen->startX, pen->startY);
+                }
+                pen->x = pen->startX;
+                pen->y = pen->startY;
+                pen->open = 0;
+                command = 0;
+                break;
+            case 'L':
+                if(!svgNumber(&cursor, end, v) || !svgNumber(&cursor, end, v + 1)) {
+                    return;
+                }
+                svgLineTo(pen, originX + v[0], originY + v[1]);
+                break;
+            case 'H':
+                if(!svgNumber(&cursor, end, v)) {
+                    return;
+                }
+                svgLineTo(pen, originX + v[0], pen->y);
+                break;
+            case 'V':
+                if(!svgNumber(&cursor, end, v)) {
+                    return;
+                }
+                svgLineTo(pen, pen->x, originY + v[0]);
+                break;
+            case 'C':
+            case 'S':
+                if(toupper((unsigned char)command) == 'C') {
+                    if(!svgNumber(&cursor, end, v) || !svgNumber(&cursor, end, v + 1)) {
+                        return;
+                    }
+                    v[0] += originX;
+                    v[1] += originY;
+                }
+                else {
+                    /* Premier point de contrôle : le symétrique du précédent s'il y en a un */
+                    v[0] = previous == 'C' || previous == 'S' ? 2 * pen->x - controlX : pen->x;
+                    v[1] = previous == 'C' || previous == 'S' ? 2 * pen->y - controlY : pen->y;
+                }
+                if(!svgNumber(&cursor, end, v + 2) || !svgNumber(&cursor, end, v + 3) || !svgNumber(&cursor, end, v + 4) || !svgNumber(&cursor, end, v + 5)) {
+                    return;
+                }
+                controlX = originX + v[2];
+                controlY = originY + v[3];
+                svgCubicTo(pen, v[0], v[1], controlX, controlY, originX + v[4], originY + v[5]);
+                break;
+            case 'Q':
+            case 'T':
+                if(toupper((unsigned char)command) == 'Q') {
+                    if(!svgNumber(&cursor, end, v) || !svgNumber(&cursor, end, v + 1)) {
+                        return;
+                    }
+                    controlX = originX + v[0];
+                    controlY = originY + v[1];
+                }
+                else {
+                    controlX = previous == 'Q' || previous == 'T' ? 2 * pen->x - controlX : pen->x;
+                    controlY = previous == 'Q' || previous == 'T' ? 2 * pen->y - controlY : pen->y;
+                }
+                if(!svgNumber(&cursor, end, v + 2) || !svgNumber(&cursor, end, v + 3)) {
+                    return;
+                }
+                svgQuadTo(pen, controlX, controlY, originX + v[2], originY + v[3]);
+                break;
+            case 'A':
+                if(!svgNumber(&cursor, end, v) || !svgNumber(&cursor, end, v + 1) || !svgNumber(&cursor, end, v + 2)
+                    || !svgFlag(&cursor, end, &large) || !svgFlag(&cursor, end, &sweep)
+                    || !svgNumber(&cursor, end, v + 3) || !svgNumber(&cursor, end, v + 4)) {
+                    return;
+                }
+                svgArcTo(pen, v[0], v[1], v[2], large, sweep, originX + v[3], originY + v[4]);
+                break;
+            default:
+                return;
+        }
+        previous = toupper((unsigned char)command);
+    }
+
+    return;
+}
+
+/* Liste de points (attribut points de polyline et polygon) en une primitive du type donné */
+void parseSvgPoints(SvgPen* pen, char* cursor, const char* end, GLenum primitiveType) {
+    float x, y;
+
+    svgPrimitive(pen, primitiveType);
+    while(!pen->stop && svgNumber(&cursor, end, &x) && svgNumber(&cursor, end, &y)) {
+        svgPoint(pen, x, y);
+    }
+
+    return;
+}
+
+/* Balise ouvrante tag (sans le <, terminée par un zéro) : les éléments de tracé sont ajoutés, les autres ignorés */
+/* Les éléments line consécutifs vont dans une même primitive GL_LINES. Renvoie 0 si la lecture doit s'arrêter */
+int parseSvgElement(char* tag, IngestBatch** batch) {
+    size_t length = strcspn(tag, " \t\r\n/");
+    SvgPen pen;
+    char* value;
+    char* end;
+    float x = 0, y = 0, width = 0, height = 0, radiusX = 0, radiusY = 0;
+
+    memset(&pen, 0, sizeof(SvgPen));
+    pen.batch = batch;
+    if(length == 4 && strncmp(tag, "path", 4) == 0) {
+        value = svgAttribute(tag, "d", &end);
+        if(value) {
+            svgColor(tag, pen.color);
+            parseSvgPath(&pen, value, end);
+        }
+    }
+    else if((length == 8 && strncmp(tag, "polyline", 8) == 0) || (length == 7 && strncmp(tag, "polygon", 7) == 0)) {
+        value = svgAttribute(tag, "points", &end);
+        if(value) {
+            svgColor(tag, pen.color);
+            parseSvgPoints(&pen, value, end, length == 7 ? GL_LINE_LOOP : GL_LINE_STRIP);
+        }
+    }
+    else if(length == 4 && strncmp(tag, "line", 4) == 0) {
+        svgColor(tag, pen.color);
+        if(!ingest.svgLines) {
+            svgPrimitive(&pen, GL_LINES);
+            ingest.svgLines = 1;
+        }
+        svgAttributeNumber(tag, "x1", &x);
+        svgAttributeNumber(tag, "y1", &y);
+        svgPoint(&pen, x, y);
+        x = y = 0;
+        svgAttributeNumber(tag, "x2", &x);
+        svgAttributeNumber(tag, "y2", &y);
+        svgPoint(&pen, x, y);
+    }
+    else if(length == 4 && strncmp(tag, "rect", 4) == 0) {
+        svgAttributeNumber(tag, "x", &x);
+        svgAttributeNumber(tag, "y", &y);
+        if(svgAttributeNumber(tag, "width", &width) && svgAttributeNumber(tag, "height", &height) && width > 0 && height > 0) {
+            svgColor(tag, pen.color);
+            svgPrimitive(&pen, GL_LINE_LOOP);
+            svgPoint(&pen, x, y);
+            svgPoint(&pen, x + width, y);
+            svgPoint(&pen, x + width, y + height);
+            svgPoint(&pen, x, y + height);
+        }
+    }
+    else if((length == 6 && strncmp(tag, "circle", 6) == 0) || (length == 7 && strncmp(tag, "ellipse", 7) == 0)) {
+        svgAttributeNumber(tag, "cx", &x);
+        svgAttributeNumber(tag, "cy", &y);
+        if(length == 6) {
+            svgAttributeNumber(tag, "r", &radiusX);
+            radiusY = radiusX;
+        }
+        else {
+            svgAttributeNumber(tag, "rx", &radiusX);
+            svgAttributeNumber(tag, "ry", &radiusY);
+        }
+        svgColor(tag, pen.color);
+        svgEllipse(&pen, x, y, radiusX, radiusY);
+    }
+
+    return !pen.stop;
+}
+
+/* Découpe les balises complètes de data (lecture au fil de l'eau : seule la balise en cours est gardée), comme parseIngestText */
+/* Le texte entre les balises, les commentaires, les balises fermantes et les déclarations sont sautés */
+size_t parseIngestSvg(char* data, size_t size, int last, IngestBatch** batch, int* stop) {
+    size_t position = 0;
+
+    while(position < size) {
+        char* tag = (char*)memchr(data + position, '<', size - position);
+        char* end;
+        char quote = 0;
+
+        if(!tag) {
+            return size;
+        }
+        position = tag - data;
+        if(size - position < 4) {
+            return last ? size : position;
+        }
+        if(memcmp(tag, "<!--", 4) == 0) {
+            for(end = tag + 4 ; end + 3 <= data + size && memcmp(end, "-->", 3) != 0 ; end++);
+            if(end + 3 > data + size) {
+                return last ? size : position;
+            }
+            position = end + 3 - data;
+            continue;
+        }
+        /* Un > entre guillemets ne ferme pas la balise */
+        for(end = tag + 1 ; end < data + size && (quote || *end != '>') ; end++) {
+            if(*end == '"' || *end == '\'') {
+                quote = quote == *end ? 0 : (quote ? quote : *end);
+            }
+        }
+        if(end == data + size) {
+            return last ? size : position;
+        }
+        *end = '\0';
+        position = end - data + 1;
+        if(tag[1] != '/' && tag[1] != '!' && tag[1] != '?' && !parseSvgElement(tag + 1, batch)) {
+            *stop = 1;
+            return 0;
+        }
+    }
+
+    return position;
+}
+
+/* Fil de lecture : lit le flux par morceaux de INGEST_READ_SIZE octets, et vérifie toutes les 100 ms s'il doit s'arrêter */
+int ingestThreadMain(void* data) {
+    size_t capacity = INGEST_READ_SIZE;
+    char* buffer = (char*)malloc(capacity + 1);
+    IngestBatch* batch = allocIngestBatch();
+    size_t size = 0;
+    int format = -1; // -1 tant qu'on ne sait pas, 0 pour le texte, 1 pour le binaire, 2 pour le SVG, 3 pour le CSV
+    int stop = 0, end = 0;
+    unsigned int nbIgnored = 0;
+
+    (void)data;
+    if(!buffer) {
+        printf("Error at ingest buffer malloc\n");
+        exit(1);
+    }
+    while(!stop) {
+        struct pollfd waiting = {ingest.fd, POLLIN, 0};
+        ssize_t nbRead;
+        size_t consumed;
+
+        if(!end) {
+            SDL_LockMutex(ingest.mutex);
+            stop = ingest.stop;
+            SDL_UnlockMutex(ingest.mutex);
+            if(stop) {
+                break;
+            }
+            if(poll(&waiting, 1, 100) == 0) {
+                continue;
+            }
+            nbRead = read(ingest.fd, buffer + size, capacity - size);
+            if(nbRead < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            if(nbRead <= 0) {
+                end = 1;
+            }
+            else {
+                size += nbRead;
+            }
+        }
+
+        /* Le format est reconnu à l'en-tête binaire, au < d'un SVG, ou aux séparateurs de la première ligne d'un CSV */
+        if(format < 0) {
+            char* first;
+            char* newline;
+            if(size < 8 && !end && memcmp(buffer, "IMACPTS", size) == 0) {
+                continue;
+            }
+            if(size >= 8 && memcmp(buffer, "IMACPTS", 8) == 0) {
+                format = 1;
+                memmove(buffer, buffer + 8, size - 8);
+                size -= 8;
+            }
+            else {
+                /* Les blancs (et la marque d'ordre des octets UTF-8) du début sont sautés, la première ligne doit être complète */
+                for(first = buffer ; first < buffer + size && (isspace((unsigned char)*first) || (unsigned char)*first >= 0x80) ; first++);
+                newline = (char*)memchr(first, '\n', buffer + size - first);
+                if((first == buffer + size || !newline) && !end && size < capacity) {
+                    continue;
+                }
+                if(!newline) {
+                    newline = buffer + size;
+                }
+                if(first < newline && *first == '<') {
+                    format = 2;
+                }
+                else if(first < newline && *first != '#' && (memchr(first, ';', newline - first) || memchr(first, ',', newline - first))) {
+                    format = 3;
+                }
+                else {
+                    format = 0;
+                }
+            }
+        }
+        if(format == 1) {
+            consumed = parseIngestBinary((const unsigned char*)buffer, size, &batch, &stop);
+        }
+        else if(format == 2) {
+            consumed = parseIngestSvg(buffer, size, end, &batch, &stop);
+        }
+        else if(format == 3) {
+            consumed = parseIngestCsv(buffer, size, end, &batch, &stop);
+        }
+        else {
+            consumed = parseIngestText(buffer, size, end, &batch, &stop);
+        }
+        if(stop) {
+            break;
+        }
+        /* Une ligne plus longue que le tampon entier est abandonnée, une balise SVG l'agrandit : la mémoire suit le plus long élément, pas le fichier */
+        if(consumed == 0 && size == capacity) {
+            if(format == 2) {
+                capacity *= 2;
+                buffer = (char*)realloc(buffer, capacity + 1);
+                if(!buffer) {
+                    printf("Error at ingest buffer realloc\n");
+                    exit(1);
+                }
+            }
+            else {
+                batch->nbIgnored++;
+                consumed = size;
+            }
+        }
+        memmove(buffer, buffer + consumed, size - consumed);
+        size -= consumed;
+        if(end) {
+            break;
+        }
+    }
+
+    /* Un dernier lot sans point n'est pas mis dans la file : ses lignes ignorées sont comptées directement */
+    if(stop || batch->nbPoints == 0) {
+        nbIgnored = batch->nbIgnored;
+        freeIngestBatch(batch);
+    }
+    else {
+        pushIngestBatch(batch);
+    }
+    free(buffer);
+    SDL_LockMutex(ingest.mutex);
+    ingest.nbIgnored += nbIgnored;
+    ingest.done = 1;
+    SDL_UnlockMutex(ingest.mutex);
+
+    return 0;
+}
+
+/* Lance la lecture de points depuis path ("-" pour l'entrée standard) : renvoie 0 si le flux ne peut pas être ouvert */
+/* L'ouverture d'un tube nommé attend qu'un programme l'ouvre en écriture */
+int startIngest(const char* path) {
+
+    ingest.fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if(ingest.fd < 0) {
+        return 0;
+    }
+    ingest.path = path;
+    ingest.mutex = SDL_CreateMutex();
+    ingest.notFull = SDL_CreateCond();
+    ingest.thread = SDL_CreateThread(ingestThreadMain, NULL);
+    if(!ingest.thread) {
+        SDL_DestroyCond(ingest.notFull);
+        SDL_DestroyMutex(ingest.mutex);
+        if(ingest.fd != STDIN_FILENO) {
+            close(ingest.fd);
+        }
+        memset(&ingest, 0, sizeof(IngestState));
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Arrête la lecture (ou attend la fin du fil s'il a déjà tout lu) et oublie les lots pas encore versés */
+void finishIngest() {
+
+    if(!ingest.thread) {
+        return;
+    }
+    SDL_LockMutex(ingest.mutex);
+    ingest.stop = 1;
+    SDL_CondSignal(ingest.notFull);
+    SDL_UnlockMutex(ingest.mutex);
+    SDL_WaitThread(ingest.thread, NULL);
+
+    while(ingest.nbBatches > 0) {
+        freeIngestBatch(ingest.batches[ingest.first]);
+        ingest.first = (ingest.first + 1) % INGEST_QUEUE_LENGTH;
+        ingest.nbBatches--;
+    }
+    if(ingest.fd != STDIN_FILENO) {
+        close(ingest.fd);
+    }
+    SDL_DestroyCond(ingest.notFull);
+    SDL_DestroyMutex(ingest.mutex);
+    memset(&ingest, 0, sizeof(IngestState));
+
+    return;
+}
+
+/* Verse dans la primitive courante les lots lus, pendant au plus INGEST_FRAME_BUDGET ms par image */
+/* Renvoie 0 quand tout le flux est dans la scène (la lecture est alors terminée) */
+int drainIngest(PrimitiveList* scene) {
+    Uint32 start = SDL_GetTicks();
+    IngestBatch* batch = NULL;
+    unsigned int i, nbIgnored = 0;
+    int done = 0;
+
+    if(!ingest.thread) {
+        return 0;
+    }
+    do {
+        SDL_LockMutex(ingest.mutex);
+        batch = NULL;
+        if(ingest.nbBatches > 0) {
+            batch = ingest.batches[ingest.first];
+            ingest.first = (ingest.first + 1) % INGEST_QUEUE_LENGTH;
+            ingest.nbBatches--;
+            ingest.nbIgnored += batch->nbIgnored;
+            SDL_CondSignal(ingest.notFull);
+        }
+        done = ingest.done;
+        nbIgnored = ingest.nbIgnored;
+        SDL_UnlockMutex(ingest.mutex);
+        if(!batch) {
+            break;
+        }
+
+        /* Les points d'avant la première primitive commencée vont dans la primitive courante, puis chaque primitive reçoit les siens */
+        for(i = 0 ; i <= batch->nbPrimitives ; i++) {
+            unsigned int first = i == 0 ? 0 : batch->starts[i - 1];
+            unsigned int last = i < batch->nbPrimitives ? batch->starts[i] : batch->nbPoints;
+
+            if(i > 0 || !*scene) {
+                addPrimitive(allocPrimitive(i > 0 ? batch->primitiveTypes[i - 1] : GL_POINTS), scene);
+                journalAddPrimitive(*scene);
+            }
+            if(last > first) {
+                /* Un trait à main levée dans la même primitive s'arrête : son dernier point n'est plus le dernier du tableau */
+                if(stroke.list == &(*scene)->points) {
+                    endStroke();
+                }
+                appendPoints(&(*scene)->points, batch->positions + 2 * first, batch->colors + 3 * first, last - first);
+                journalAddPoints(&(*scene)->points, last - first, 1);
+            }
+        }
+        ingest.nbPoints += batch->nbPoints;
+        freeIngestBatch(batch);
+    } while(SDL_GetTicks() - start < INGEST_FRAME_BUDGET);
+
+    if(!batch && done) {
+        printf("Lecture de %s terminée : %llu points", ingest.path, ingest.nbPoints);
+        if(nbIgnored > 0) {
+            printf(", %u lignes ignorées", nbIgnored);
+        }
+        printf("\n");
+        finishIngest();
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Fonctions de l'anneau de points partagé : le producteur écrit des lots, la boucle principale les dessine là où ils sont, sans copie */
+
+size_t sharedRingSize(unsigned int capacity) {
+    return sizeof(SharedRingHeader) + capacity * (2 * sizeof(float) + 3 * sizeof(unsigned char));
+}
+
+/* Ouvre l'anneau name (create : le crée s'il n'existe pas, avec SHARED_RING_POINTS cases) : renvoie 0 s'il est absent ou invalide */
+int openSharedRing(SharedRing* ring, const char* name, int create) {
+    int fd = shm_open(name, O_RDWR | (create ? O_CREAT : 0), 0600);
+    struct stat info;
+    SharedRingHeader header;
+    void* data;
+
+    if(fd < 0) {
+        return 0;
+    }
+    if(fstat(fd, &info) != 0) {
+        close(fd);
+        return 0;
+    }
+    /* Une mémoire partagée vide vient d'être créée : par nous, ou par un consommateur qui ne l'a pas encore dimensionnée */
+    ring->owner = info.st_size == 0;
+    if(ring->owner && !create) {
+        close(fd);
+        return 0;
+    }
+    if(ring->owner && ftruncate(fd, sharedRingSize(SHARED_RING_POINTS)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+    if(!ring->owner) {
+        /* Un anneau existant doit être complet et de la même version */
+        if((size_t)info.st_size < sizeof(SharedRingHeader) || pread(fd, &header, sizeof(SharedRingHeader), 0) != sizeof(SharedRingHeader)
+            || memcmp(header.magic, "IMACRNG", 8) != 0 || header.version != SHARED_RING_VERSION
+            || header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0 || (size_t)info.st_size < sharedRingSize(header.capacity)) {
+            close(fd);
+            return 0;
+        }
+    }
+    ring->size = ring->owner ? sharedRingSize(SHARED_RING_POINTS) : sharedRingSize(header.capacity);
+    data = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        if(ring->owner) {
+            shm_unlink(name);
+        }
+        return 0;
+    }
+
+    ring->header = (SharedRingHeader*)data;
+    if(ring->owner) {
+        unsigned long long magic;
+        memset(ring->header, 0, sizeof(SharedRingHeader));
+        ring->header->version = SHARED_RING_VERSION;
+        ring->header->capacity = SHARED_RING_POINTS;
+        ring->header->primitiveType = GL_POINTS;
+        /* L'en-tête n'est reconnu qu'une fois rempli */
+        memcpy(&magic, "IMACRNG", 8);
+        __atomic_store_n((unsigned long long*)ring->header->magic, magic, __ATOMIC_RELEASE);
+    }
+    ring->positions = (float*)(ring->header + 1);
+    ring->colors = (unsigned char*)(ring->positions + 2 * ring->header->capacity);
+    ring->name = name;
+
+    return 1;
+}
+
+/* Ferme l'anneau (et efface la mémoire partagée si ce processus l'a créée) */
+void closeSharedRing(SharedRing* ring) {
+
+    if(!ring->header) {
+        return;
+    }
+    munmap(ring->header, ring->size);
+    if(ring->owner) {
+        shm_unlink(ring->name);
+    }
+    memset(ring, 0, sizeof(SharedRing));
+
+    return;
+}
+
+/* Producteur : écrit un lot de count points s'il tient en entier dans la place libre, sinon le compte comme perdu et renvoie 0 */
+int writeSharedRing(SharedRing* ring, const float* positions, const unsigned char* colors, unsigned int count) {
+    SharedRingHeader* header = ring->header;
+    unsigned int capacity = header->capacity;
+    unsigned long long head = header->head;
+    unsigned long long tail = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+    unsigned int slot = head & (capacity - 1);
+    unsigned int first = count < capacity - slot ? count : capacity - slot;
+
+    if(count > capacity - (head - tail)) {
+        header->stalls++;
+        header->droppedPoints += count;
+        return 0;
+    }
+    /* Le lot peut faire le tour de l'anneau : deux copies */
+    memcpy(ring->positions + 2 * slot, positions, 2 * first * sizeof(float));
+    memcpy(ring->colors + 3 * slot, colors, 3 * first);
+    memcpy(ring->positions, positions + 2 * first, 2 * (count - first) * sizeof(float));
+    memcpy(ring->colors, colors + 3 * first, 3 * (count - first));
+    /* Les points sont écrits avant que le consommateur ne voie la nouvelle tête */
+    __atomic_store_n(&header->head, head + count, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+/* Consommateur : nombre de points présents dans l'anneau, de *tail à *head (une tête incohérente, d'un producteur fautif, */
+/* ramène la fenêtre aux capacity derniers points pour ne jamais lire hors de l'anneau) */
+unsigned int sharedRingWindow(const SharedRing* ring, unsigned long long* head, unsigned long long* tail) {
+    const SharedRingHeader* header = ring->header;
+
+    *head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+    *tail = header->tail;
+    if(*head < *tail || *head - *tail > header->capacity) {
+        *tail = *head - header->capacity;
+    }
+
+    return *head - *tail;
+}
+
+/* Consommateur : une fois les points de la fenêtre lus, libère les plus anciens pour qu'au moins la moitié de l'anneau reste libre */
+void releaseSharedRing(SharedRing* ring, unsigned long long head, unsigned long long tail) {
+    SharedRingHeader* header = ring->header;
+
+    if(head - tail > header->capacity / 2) {
+        __atomic_store_n(&header->tail, head - header->capacity / 2, __ATOMIC_RELEASE);
+    }
+    else if(tail != header->tail) {
+        __atomic_store_n(&header->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    return;
+}
+
+/* Consommateur : dessine les points présents dans l'anneau directement depuis la mémoire partagée, puis en libère une partie */
+void drawSharedRing(SharedRing* ring) {
+    SharedRingHeader* header = ring->header;
+    unsigned int capacity, slot, first, count;
+    unsigned long long head, tail;
+
+    if(!header) {
+        return;
+    }
+    capacity = header->capacity;
+    count = sharedRingWindow(ring, &head, &tail);
+    slot = tail & (capacity - 1);
+    first = count < capacity - slot ? count : capacity - slot;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, ring->positions);
+    glColorPointer(3, GL_UNSIGNED_BYTE, 0, ring->colors);
+    glDrawArrays(header->primitiveType, slot, first);
+    if(count > first) {
+        glDrawArrays(header->primitiveType, 0, count - first);
+        /* Une ligne continue est raccordée entre la dernière case et la première */
+        if(header->primitiveType == GL_LINE_STRIP) {
+            GLuint seam[2] = {capacity - 1, 0};
+            glDrawElements(GL_LINES, 2, GL_UNSIGNED_INT, seam);
+        }
+    }
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    /* glDrawArrays a lu les points : les cases libérées peuvent être réécrites */
+    releaseSharedRing(ring, head, tail);
+
+    return;
+}
+
+/* Compteurs de l'anneau : points reçus, en attente et perdus faute de place */
+void printSharedRing(const SharedRing* ring) {
+    SharedRingHeader* header = ring->header;
+    unsigned long long head;
+
+    if(!header) {
+        return;
+    }
+    head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+    printf("Anneau %s : %llu points reçus, %llu affichés, %llu lots refusés faute de place (%llu points perdus)\n", ring->name,
+        head, head - header->tail, header->stalls, header->droppedPoints);
+
+    return;
+}
+
+/* Producteur de démonstration (-p nom) : une courbe de Lissajous qui tourne, par lots de 4096 points, jusqu'à la disparition de l'anneau */
+int runSharedRingProducer(const char* name) {
+    SharedRing ring;
+    float positions[2 * 4096];
+    unsigned char colors[3 * 4096];
+    unsigned long long nbPoints = 0;
+    unsigned int i, nbBatches;
+
+    memset(&ring, 0, sizeof(SharedRing));
+    if(!openSharedRing(&ring, name, 0)) {
+        fprintf(stderr, "Impossible d'ouvrir l'anneau %s\n", name);
+        return 0;
+    }
+    ring.header->primitiveType = GL_LINE_STRIP;
+    for(nbBatches = 1 ; ; nbBatches++) {
+        for(i = 0 ; i < 4096 ; i++, nbPoints++) {
+            float t = nbPoints * 1e-4;
+            positions[2 * i] = cos(3 * t) * (ORTHO_RIGHT - ORTHO_LEFT) * 0.4;
+            positions[2 * i + 1] = sin(2 * t + nbPoints * 1e-7) * (ORTHO_TOP - ORTHO_BOTTOM) * 0.4;
+            colors[3 * i] = 128 + 127 * cos(t);
+            colors[3 * i + 1] = 128 + 127 * sin(t);
+            colors[3 * i + 2] = 255;
+        }
+        /* Anneau plein : le lot est perdu (compté dans l'en-tête) et le producteur laisse une milliseconde au consommateur */
+        if(!writeSharedRing(&ring, positions, colors, 4096)) {
+            nbPoints -= 4096;
+            SDL_Delay(1);
+        }
+        /* De temps en temps, on vérifie que le consommateur n'a pas effacé l'anneau en quittant */
+        if(nbBatches % 256 == 0) {
+            int fd = shm_open(name, O_RDONLY, 0);
+            if(fd < 0) {
+                break;
+            }
+            close(fd);
+        }
+    }
+    closeSharedRing(&ring);
+
+    return 1;
+}
+
+/* Fonctions du magasin de points sur disque : un fichier découpé en morceaux par cases, projeté en entier, */
+/* dont seuls les morceaux visibles (et leurs voisins, en avance sur le déplacement de la caméra) sont lus, dans la limite d'un budget mémoire */
+
+/* Entrelace les bits de x et de y : deux cases voisines ont souvent des indices proches */
+unsigned int mortonIndex(unsigned int x, unsigned int y) {
+    unsigned int index = 0, bit;
+
+    for(bit = 0 ; bit < 16 ; bit++) {
+        index |= ((x >> bit) & 1) << (2 * bit);
+        index |= ((y >> bit) & 1) << (2 * bit + 1);
+    }
+
+    return index;
+}
+
+/* Case (colonne ou ligne) de la coordonnée value dans [minimum, maximum] découpé en gridSize : les points hors du cadre vont au bord */
+unsigned int storeCell(float value, float minimum, float maximum, unsigned int gridSize) {
+    float cell = (value - minimum) / (maximum - minimum) * gridSize;
+
+    /* Un cadre vide (tous les points au même endroit) donne une division par zéro : tout va dans la première case */
+    if(!(cell >= 1)) {
+        return 0;
+    }
+
+    return cell < gridSize ? (unsigned int)cell : gridSize - 1;
+}
+
+/* Octets d'un morceau de nbPoints points dans le fichier : positions puis couleurs, complétés jusqu'à la page suivante */
+unsigned long long storeChunkSize(unsigned long long nbPoints) {
+    return (nbPoints * (2 * sizeof(float) + 3) + STORE_PAGE_SIZE - 1) / STORE_PAGE_SIZE * STORE_PAGE_SIZE;
+}
+
+/* Construit le magasin storePath à partir du fichier de scène scenePath (toutes primitives confondues) : renvoie 0 en cas d'erreur */
+/* Deux passages sur la scène projetée, qui peuvent tous deux dépasser la mémoire : on compte les points de chaque case, */
+/* puis on écrit chaque point à sa place dans le magasin projeté, avant de mélanger chaque morceau */
+int buildPointStore(const char* scenePath, const char* storePath) {
+    size_t sceneSize;
+    unsigned char* scene = mapSceneFile(scenePath, &sceneSize);
+    const SceneFileHeader* sceneHeader;
+    const SceneFilePrimitive* table;
+    StoreFileHeader header;
+    StoreChunk* chunks;
+    unsigned long long* counts;
+    unsigned int* fills;
+    unsigned long long offset;
+    unsigned char* data;
+    unsigned int nbChunks, i, j, chunk;
+    char tmpPath[1024];
+    int fd, ok = 1;
+
+    if(!scene) {
+        return 0;
+    }
+    sceneHeader = (const SceneFileHeader*)scene;
+    table = (const SceneFilePrimitive*)(scene + sizeof(SceneFileHeader));
+    madvise(scene, sceneSize, MADV_SEQUENTIAL);
+
+    /* Le cadre de tous les points, et assez de cases pour qu'un morceau ait en moyenne au plus STORE_CHUNK_POINTS points */
+    memset(&header, 0, sizeof(StoreFileHeader));
+    memcpy(header.magic, "IMACOOC", 8);
+    header.version = STORE_FILE_VERSION;
+    header.byteOrder = 0x01020304;
+    for(i = 0 ; i < sceneHeader->nbPrimitives ; i++) {
+        if(table[i].nbPoints == 0) {
+            continue;
+        }
+        if(header.nbPoints == 0) {
+            header.box = table[i].box;
+        }
+        else {
+            header.box.minX = table[i].box.minX < header.box.minX ? table[i].box.minX : header.box.minX;
+            header.box.minY = table[i].box.minY < header.box.minY ? table[i].box.minY : header.box.minY;
+            header.box.maxX = table[i].box.maxX > header.box.maxX ? table[i].box.maxX : header.box.maxX;
+            header.box.maxY = table[i].box.maxY > header.box.maxY ? table[i].box.maxY : header.box.maxY;
+        }
+        header.nbPoints += table[i].nbPoints;
+    }
+    header.gridSize = 1;
+    while(header.gridSize < STORE_MAX_GRID && (unsigned long long)header.gridSize * header.gridSize * STORE_CHUNK_POINTS < header.nbPoints) {
+        header.gridSize *= 2;
+    }
+    nbChunks = header.gridSize * header.gridSize;
+
+    chunks = (StoreChunk*)calloc(nbChunks, sizeof(StoreChunk));
+    counts = (unsigned long long*)calloc(nbChunks, sizeof(unsigned long long));
+    fills = (unsigned int*)calloc(nbChunks, sizeof(unsigned int));
+    if(!chunks || !counts || !fills) {
+        printf("Error at store table malloc\n");
+        exit(1);
+    }
+
+    /* Premier passage : les points de chaque case */
+    for(i = 0 ; i < sceneHeader->nbPrimitives ; i++) {
+        PointList list;
+        memset(&list, 0, sizeof(PointList));
+        mapSceneFileList(&list, scene, table + i);
+        for(j = 0 ; j < list.nbPoints ; j++) {
+            Point point = getPoint(&list, j);
+            counts[mortonIndex(storeCell(point.x, header.box.minX, header.box.maxX, header.gridSize), storeCell(point.y, header.box.minY, header.box.maxY, header.gridSize))]++;
+        }
+    }
+
+    /* Les morceaux se suivent dans l'ordre de Morton, chacun sur ses pages */
+    offset = (sizeof(StoreFileHeader) + nbChunks * sizeof(StoreChunk) + STORE_PAGE_SIZE - 1) / STORE_PAGE_SIZE * STORE_PAGE_SIZE;
+    for(chunk = 0 ; chunk < nbChunks ; chunk++) {
+        /* Une case trop dense pour le format (plus de 4 milliards de points) : il faudrait un cadre plus fin */
+        if(counts[chunk] > UINT_MAX) {
+            ok = 0;
+        }
+        chunks[chunk].offset = offset;
+        chunks[chunk].nbPoints = counts[chunk];
+        offset += storeChunkSize(counts[chunk]);
+    }
+    header.fileSize = offset;
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", storePath);
+    fd = ok ? open(tmpPath, O_RDWR | O_CREAT | O_TRUNC, 0644) : -1;
+    if(fd < 0 || ftruncate(fd, header.fileSize) != 0) {
+        if(fd >= 0) {
+            close(fd);
+            remove(tmpPath);
+        }
+        munmap(scene, sceneSize);
+        free(chunks);
+        free(counts);
+        free(fills);
+        return 0;
+    }
+    data = (unsigned char*)mmap(NULL, header.fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        remove(tmpPath);
+        munmap(scene, sceneSize);
+        free(chunks);
+        free(counts);
+        free(fills);
+        return 0;
+    }
+
+    /* Second passage : chaque point à la suite de ceux de sa case, et la boîte de chaque morceau */
+    for(i = 0 ; i < sceneHeader->nbPrimitives ; i++) {
+        PointList list;
+        memset(&list, 0, sizeof(PointList));
+        mapSceneFileList(&list, scene, table + i);
+        for(j = 0 ; j < list.nbPoints ; j++) {
+            Point point = getPoint(&list, j);
+            StoreChunk* entry;
+            float* position;
+            unsigned char* color;
+
+            chunk = mortonIndex(storeCell(point.x, header.box.minX, header.box.maxX, header.gridSize), storeCell(point.y, header.box.minY, header.box.maxY, header.gridSize));
+            entry = chunks + chunk;
+            position = (float*)(data + entry->offset) + 2 * fills[chunk];
+            color = data + entry->offset + 2 * sizeof(float) * entry->nbPoints + 3 * fills[chunk];
+            position[0] = point.x;
+            position[1] = point.y;
+            color[0] = point.r;
+            color[1] = point.g;
+            color[2] = point.b;
+            if(fills[chunk] == 0) {
+                entry->box.minX = entry->box.maxX = point.x;
+                entry->box.minY = entry->box.maxY = point.y;
+            }
+            else {
+                entry->box.minX = point.x < entry->box.minX ? point.x : entry->box.minX;
+                entry->box.minY = point.y < entry->box.minY ? point.y : entry->box.minY;
+                entry->box.maxX = point.x > entry->box.maxX ? point.x : entry->box.maxX;
+                entry->box.maxY = point.y > entry->box.maxY ? point.y : entry->box.maxY;
+            }
+            fills[chunk]++;
+        }
+    }
+    munmap(scene, sceneSize);
+
+    /* Mélange de Fisher-Yates de chaque morceau : n'importe quel début est un échantillon uniforme du morceau */
+    for(chunk = 0 ; chunk < nbChunks ; chunk++) {
+        float* positions = (float*)(data + chunks[chunk].offset);
+        unsigned char* colors = data + chunks[chunk].offset + 2 * sizeof(float) * chunks[chunk].nbPoints;
+        unsigned int state = 2463534242u ^ chunk;
+
+        for(i = chunks[chunk].nbPoints ; i > 1 ; i--) {
+            float position[2];
+            unsigned char color[3];
+
+            /* Générateur xorshift : la qualité d'un mélange d'affichage suffit */
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            j = state % i;
+            memcpy(position, positions + 2 * (i - 1), sizeof(position));
+            memcpy(positions + 2 * (i - 1), positions + 2 * j, sizeof(position));
+            memcpy(positions + 2 * j, position, sizeof(position));
+            memcpy(color, colors + 3 * (i - 1), 3);
+            memcpy(colors + 3 * (i - 1), colors + 3 * j, 3);
+            memcpy(colors + 3 * j, color, 3);
+        }
+    }
+
+    memcpy(data, &header, sizeof(StoreFileHeader));
+    memcpy(data + sizeof(StoreFileHeader), chunks, nbChunks * sizeof(StoreChunk));
+    ok = msync(data, header.fileSize, MS_SYNC) == 0;
+    munmap(data, header.fileSize);
+    free(chunks);
+    free(counts);
+    free(fills);
+    if(!ok || rename(tmpPath, storePath) != 0) {
+        remove(tmpPath);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Demande au système de lire les pages de [start, end) et attend qu'elles soient là (une lecture par page de 4 Ko, la plus petite courante) */
+void touchStoreRange(const unsigned char* start, const unsigned char* end) {
+    const unsigned char* page = (const unsigned char*)((size_t)start / STORE_PAGE_SIZE * STORE_PAGE_SIZE);
+    volatile unsigned char sink = 0;
+
+    if(start >= end) {
+        return;
+    }
+    madvise((void*)page, end - page, MADV_WILLNEED);
+    for( ; start < end ; start += 4096) {
+        sink ^= *start;
+    }
+    sink ^= end[-1];
+    (void)sink;
+
+    return;
+}
+
+/* Fil de chargement : lit les points demandés, les morceaux visibles d'abord, en libérant ceux que les dernières images n'ont pas utilisés */
+int storeLoaderMain(void* data) {
+    PointStore* store = (PointStore*)data;
+
+    SDL_LockMutex(store->mutex);
+    while(!store->stop) {
+        unsigned int chunk, from, to;
+        const unsigned char* base;
+        size_t needed;
+
+        if(store->nextRequest >= store->nbRequests) {
+            SDL_CondWait(store->wake, store->mutex);
+            continue;
+        }
+        chunk = store->requests[store->nextRequest++];
+        from = store->residentPoints[chunk];
+        to = store->wantedPoints[chunk];
+        if(from >= to) {
+            continue;
+        }
+
+        /* Budget dépassé : on libère le morceau le plus anciennement utilisé, jamais un morceau épinglé par le dessin en cours */
+        /* ni un de ceux des deux dernières images (la suivante les redessine sans doute) */
+        needed = (size_t)(to - from) * (2 * sizeof(float) + 3);
+        while(store->residentBytes + needed > store->budget) {
+            unsigned int victim = store->nbChunks, i;
+            for(i = 0 ; i < store->nbChunks ; i++) {
+                if(store->residentPoints[i] > 0 && !store->pinned[i] && store->lastUsed[i] + 1 < store->frame
+                    && (victim == store->nbChunks || store->lastUsed[i] < store->lastUsed[victim])) {
+                    victim = i;
+                }
+            }
+            if(victim == store->nbChunks) {
+                break;
+            }
+            /* residentPoints passe à 0 avant que le verrou soit rendu : la boucle principale ne le dessinera plus avant qu'il soit relu */
+            store->residentBytes -= (size_t)store->residentPoints[victim] * (2 * sizeof(float) + 3);
+            store->residentPoints[victim] = 0;
+            store->nbEvictions++;
+            SDL_UnlockMutex(store->mutex);
+            madvise(store->data + store->chunks[victim].offset, storeChunkSize(store->chunks[victim].nbPoints), MADV_DONTNEED);
+            SDL_LockMutex(store->mutex);
+        }
+        /* Tout ce qui est en mémoire sert aux images en cours : on ne charge que ce que le budget permet */
+        if(store->residentBytes + needed > store->budget) {
+            to = from + (store->budget - store->residentBytes) / (2 * sizeof(float) + 3);
+            needed = (size_t)(to - from) * (2 * sizeof(float) + 3);
+            if(to <= from) {
+                continue;
+            }
+        }
+        /* La place est réservée avant la lecture, faite sans bloquer la boucle principale */
+        store->residentBytes += needed;
+        SDL_UnlockMutex(store->mutex);
+
+        base = store->data + store->chunks[chunk].offset;
+        touchStoreRange(base + 2 * sizeof(float) * from, base + 2 * sizeof(float) * to);
+        base += 2 * sizeof(float) * store->chunks[chunk].nbPoints;
+        touchStoreRange(base + 3 * from, base + 3 * to);
+
+        SDL_LockMutex(store->mutex);
+        store->residentPoints[chunk] = to;
+        store->nbLoads++;
+    }
+    SDL_UnlockMutex(store->mutex);
+
+    return 0;
+}
+
+/* Arrête le fil de chargement et ferme le magasin */
+void closePointStore(PointStore* store) {
+
+    if(!store->data) {
+        return;
+    }
+    if(store->loader) {
+        SDL_LockMutex(store->mutex);
+        store->stop = 1;
+        SDL_CondSignal(store->wake);
+        SDL_UnlockMutex(store->mutex);
+        SDL_WaitThread(store->loader, NULL);
+    }
+    SDL_DestroyCond(store->wake);
+    SDL_DestroyMutex(store->mutex);
+    free(store->residentPoints);
+    free(store->wantedPoints);
+    free(store->lastUsed);
+    free(store->pinned);
+    free(store->requests);
+    free(store->visible);
+    free(store->drawCounts);
+    munmap(store->data, store->size);
+    memset(store, 0, sizeof(PointStore));
+
+    return;
+}
+
+/* Ouvre le magasin path avec un budget de budget octets et lance son fil de chargement : renvoie 0 s'il est absent ou invalide */
+int openPointStore(PointStore* store, const char* path, size_t budget) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    const StoreFileHeader* header;
+    unsigned int i;
+
+    if(fd < 0) {
+        return 0;
+    }
+    if(fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(StoreFileHeader)) {
+        close(fd);
+        return 0;
+    }
+    store->data = (unsigned char*)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(store->data == MAP_FAILED) {
+        store->data = NULL;
+        return 0;
+    }
+    store->size = info.st_size;
+    header = (const StoreFileHeader*)store->data;
+    if(memcmp(header->magic, "IMACOOC", 8) != 0 || header->version != STORE_FILE_VERSION || header->byteOrder != 0x01020304
+        || header->fileSize != (unsigned long long)info.st_size
+        || header->gridSize == 0 || header->gridSize > STORE_MAX_GRID || (header->gridSize & (header->gridSize - 1)) != 0
+        || (unsigned long long)header->gridSize * header->gridSize > (info.st_size - sizeof(StoreFileHeader)) / sizeof(StoreChunk)) {
+        munmap(store->data, store->size);
+        store->data = NULL;
+        return 0;
+    }
+    store->header = header;
+    store->chunks = (const StoreChunk*)(store->data + sizeof(StoreFileHeader));
+    store->nbChunks = header->gridSize * header->gridSize;
+    for(i = 0 ; i < store->nbChunks ; i++) {
+        if(store->chunks[i].offset % STORE_PAGE_SIZE != 0 || store->chunks[i].offset > header->fileSize
+            || storeChunkSize(store->chunks[i].nbPoints) > header->fileSize - store->chunks[i].offset) {
+            munmap(store->data, store->size);
+            store->data = NULL;
+            return 0;
+        }
+    }
+    /* Le système ne lit rien d'avance : c'est le fil de chargement qui décide quoi lire */
+    madvise(store->data, store->size, MADV_RANDOM);
+
+    store->residentPoints = (unsigned int*)calloc(store->nbChunks, sizeof(unsigned int));
+    store->wantedPoints = (unsigned int*)calloc(store->nbChunks, sizeof(unsigned int));
+    store->lastUsed = (unsigned int*)calloc(store->nbChunks, sizeof(unsigned int));
+    store->pinned = (unsigned char*)calloc(store->nbChunks, sizeof(unsigned char));
+    store->requests = (unsigned int*)malloc(store->nbChunks * sizeof(unsigned int));
+    store->visible = (unsigned int*)malloc(store->nbChunks * sizeof(unsigned int));
+    store->drawCounts = (unsigned int*)malloc(store->nbChunks * sizeof(unsigned int));
+    if(!store->residentPoints || !store->wantedPoints || !store->lastUsed || !store->pinned || !store->requests || !store->visible || !store->drawCounts) {
+        printf("Error at store arrays malloc\n");
+        exit(1);
+    }
+    store->budget = budget;
+    store->mutex = SDL_CreateMutex();
+    store->wake = SDL_CreateCond();
+    store->loader = SDL_CreateThread(storeLoaderMain, store);
+    if(!store->loader) {
+        closePointStore(store);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Demande les morceaux de la case [minX, maxX] x [minY, maxY] qui touchent box (en sautant ceux de la case skip) : */
+/* fraction de leurs points, marqués utilisés à cette image. La liste des morceaux visibles est remplie si visible vaut 1 */
+void requestStoreChunks(PointStore* store, const BoundingBox* box, const unsigned int* cells, const unsigned int* skip, double fraction, int visible) {
+    unsigned int x, y;
+
+    for(y = cells[1] ; y <= cells[3] ; y++) {
+        for(x = cells[0] ; x <= cells[2] ; x++) {
+            unsigned int chunk = mortonIndex(x, y);
+            const StoreChunk* entry = store->chunks + chunk;
+            unsigned int wanted;
+
+            if(skip && x >= skip[0] && x <= skip[2] && y >= skip[1] && y <= skip[3]) {
+                continue;
+            }
+            if(entry->nbPoints == 0 || entry->box.maxX < box->minX || entry->box.minX > box->maxX || entry->box.maxY < box->minY || entry->box.minY > box->maxY) {
+                continue;
+            }
+            wanted = ceil(fraction * entry->nbPoints);
+            store->wantedPoints[chunk] = wanted;
+            store->lastUsed[chunk] = store->frame;
+            if(store->residentPoints[chunk] < wanted) {
+                store->requests[store->nbRequests++] = chunk;
+            }
+            if(visible) {
+                store->visible[store->nbVisible] = chunk;
+                store->drawCounts[store->nbVisible] = store->residentPoints[chunk] < wanted ? store->residentPoints[chunk] : wanted;
+                store->drawnPoints += store->drawCounts[store->nbVisible];
+                store->missingPoints += wanted - store->drawCounts[store->nbVisible];
+                store->nbVisible++;
+            }
+        }
+    }
+
+    return;
+}
+
+/* Cases du magasin touchées par box (colonnes puis lignes, bornes comprises) : renvoie 0 si box est hors du cadre */
+int storeCells(const PointStore* store, const BoundingBox* box, unsigned int* cells) {
+    const StoreFileHeader* header = store->header;
+
+    if(box->maxX < header->box.minX || box->minX > header->box.maxX || box->maxY < header->box.minY || box->minY > header->box.maxY) {
+        return 0;
+    }
+    cells[0] = storeCell(box->minX, header->box.minX, header->box.maxX, header->gridSize);
+    cells[1] = storeCell(box->minY, header->box.minY, header->box.maxY, header->gridSize);
+    cells[2] = storeCell(box->maxX, header->box.minX, header->box.maxX, header->gridSize);
+    cells[3] = storeCell(box->maxY, header->box.minY, header->box.maxY, header->gridSize);
+
+    return 1;
+}
+
+/* Dessine les points chargés des morceaux visibles, directement depuis la projection du fichier, et demande la suite au fil de chargement */
+/* Au plus STORE_FRAME_POINTS points par image : vu de loin, chaque morceau ne donne que le début (mélangé) de ses points */
+/* Les voisins de la vue sont demandés après elle : en se déplaçant, la caméra trouve des morceaux déjà lus */
+void drawPointStore(PointStore* store) {
+    GLfloat projection[16], modelview[16], matrix[16];
+    BoundingBox view, around;
+    unsigned int cells[4], aroundCells[4], x, y, i;
+    unsigned long long total = 0;
+    double fraction = 1;
+    int inside;
+
+    if(!store->data) {
+        return;
+    }
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    multiplyMatrices(projection, modelview, matrix);
+    visibleWorldBox(matrix, &view);
+    around.minX = view.minX - (view.maxX - view.minX) / 2;
+    around.maxX = view.maxX + (view.maxX - view.minX) / 2;
+    around.minY = view.minY - (view.maxY - view.minY) / 2;
+    around.maxY = view.maxY + (view.maxY - view.minY) / 2;
+
+    /* Les points visibles décident de la part de chaque morceau à dessiner */
+    inside = storeCells(store, &view, cells);
+    for(y = cells[1] ; inside && y <= cells[3] ; y++) {
+        for(x = cells[0] ; x <= cells[2] ; x++) {
+            const StoreChunk* entry = store->chunks + mortonIndex(x, y);
+            if(!(entry->box.maxX < view.minX || entry->box.minX > view.maxX || entry->box.maxY < view.minY || entry->box.minY > view.maxY)) {
+                total += entry->nbPoints;
+            }
+        }
+    }
+    if(total > STORE_FRAME_POINTS) {
+        fraction = (double)STORE_FRAME_POINTS / total;
+    }
+
+    SDL_LockMutex(store->mutex);
+    store->frame++;
+    store->nbRequests = 0;
+    store->nextRequest = 0;
+    store->nbVisible = 0;
+    store->drawnPoints = 0;
+    store->missingPoints = 0;
+    if(inside) {
+        requestStoreChunks(store, &view, cells, NULL, fraction, 1);
+    }
+    if(storeCells(store, &around, aroundCells)) {
+        requestStoreChunks(store, &around, aroundCells, inside ? cells : NULL, fraction, 0);
+    }
+    /* Les morceaux dessinés sont épinglés jusqu'à la fin des glDrawArrays : le fil de chargement ne peut pas rendre leurs pages entre-temps */
+    for(i = 0 ; i < store->nbVisible ; i++) {
+        store->pinned[store->visible[i]] = 1;
+    }
+    if(store->nbRequests > 0) {
+        SDL_CondSignal(store->wake);
+    }
+    SDL_UnlockMutex(store->mutex);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    for(i = 0 ; i < store->nbVisible ; i++) {
+        const StoreChunk* entry = store->chunks + store->visible[i];
+        if(store->drawCounts[i] > 0) {
+            glVertexPointer(2, GL_FLOAT, 0, store->data + entry->offset);
+            glColorPointer(3, GL_UNSIGNED_BYTE, 0, store->data + entry->offset + 2 * sizeof(float) * entry->nbPoints);
+            glDrawArrays(GL_POINTS, 0, store->drawCounts[i]);
+        }
+    }
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    /* Les tableaux clients sont lus pendant glDrawArrays : les morceaux peuvent être libérés dès maintenant */
+    SDL_LockMutex(store->mutex);
+    for(i = 0 ; i < store->nbVisible ; i++) {
+        store->pinned[store->visible[i]] = 0;
+    }
+    SDL_UnlockMutex(store->mutex);
+
+    return;
+}
+
+/* Compteurs du magasin : points dessinés et en attente à la dernière image, mémoire occupée, morceaux lus et libérés */
+void printPointStore(PointStore* store) {
+
+    if(!store->data) {
+        return;
+    }
+    SDL_LockMutex(store->mutex);
+    printf("Magasin : %llu points en %u morceaux, %llu dessinés et %llu en attente, %.1f Mo chargés sur %.1f Mo, %llu lectures et %llu libérations\n",
+        store->header->nbPoints, store->nbChunks, store->drawnPoints, store->missingPoints,
+        store->residentBytes / 1048576., store->budget / 1048576., store->nbLoads, store->nbEvictions);
+    SDL_UnlockMutex(store->mutex);
+
+    return;
+}
+
+/* Fonctions du générateur de scènes, pour mesurer sans cliquer : les mêmes paramètres et la même graine redonnent la même scène */
+
+/* Nombre pseudo-aléatoire de 64 bits (splitmix64 : rapide, et le même partout contrairement à rand) */
+unsigned long long generatorRandom(SceneGenerator* generator) {
+    unsigned long long value = (generator->state += 0x9E3779B97F4A7C15ULL);
+
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+
+    return value ^ (value >> 31);
+}
+
+/* Nombre pseudo-aléatoire dans [0, 1[ */
+float generatorUniform(SceneGenerator* generator) {
+    return (generatorRandom(generator) >> 40) / 16777216.;
+}
+
+/* Position d'un sommet selon la distribution du générateur */
+void generatorPosition(SceneGenerator* generator, float* x, float* y) {
+
+    if(generator->distribution == GENERATOR_CLUSTERS) {
+        /* Loi normale par la méthode de Box-Muller, écart type d'un quarantième du cadre */
+        const float* center = generator->clusters + 2 * (generatorRandom(generator) % GENERATOR_NB_CLUSTERS);
+        float radius = sqrt(-2 * log(1 - generatorUniform(generator))) * (ORTHO_RIGHT - ORTHO_LEFT) / 40;
+        float angle = 2 * M_PI * generatorUniform(generator);
+        *x = center[0] + radius * cos(angle);
+        *y = center[1] + radius * sin(angle);
+    }
+    else if(generator->distribution == GENERATOR_GRID) {
+        unsigned long long index = generator->gridIndex++;
+        *x = ORTHO_LEFT + (ORTHO_RIGHT - ORTHO_LEFT) * ((index % generator->gridSide) + 0.5) / generator->gridSide;
+        *y = ORTHO_BOTTOM + (ORTHO_TOP - ORTHO_BOTTOM) * ((index / generator->gridSide % generator->gridSide) + 0.5) / generator->gridSide;
+    }
+    else {
+        *x = ORTHO_LEFT + (ORTHO_RIGHT - ORTHO_LEFT) * generatorUniform(generator);
+        *y = ORTHO_BOTTOM + (ORTHO_TOP - ORTHO_BOTTOM) * generatorUniform(generator);
+    }
+
+    return;
+}
+
+/* Ramène dans [minimum, maximum] une coordonnée qui vient d'en sortir d'un pas, en la réfléchissant sur le bord franchi */
+float reflectCoordinate(float value, float minimum, float maximum) {
+
+    if(value < minimum) {
+        value = 2 * minimum - value;
+    }
+    else if(value > maximum) {
+        value = 2 * maximum - value;
+    }
+
+    return value < minimum ? minimum : value > maximum ? maximum : value;
+}
+
+/* Distribution d'après son nom (uniform, clusters, grid) : renvoie 0 si le nom est inconnu */
+int parseDistribution(const char* name, int* distribution) {
+    static const char* NAMES[] = {"uniform", "clusters", "grid"};
+    unsigned int i;
+
+    for(i = 0 ; i < 3 ; i++) {
+        if(strcmp(name, NAMES[i]) == 0) {
+            *distribution = i;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Écrit une forme de primitiveType (un groupe de sommets : 1, 2, 3 ou 4) dans positions, et renvoie le nombre de sommets écrits */
+/* Les lignes brisées avancent d'un pas au hasard depuis le sommet précédent (previous, NULL pour le premier), réfléchi sur les bords du cadre */
+unsigned int generateShape(SceneGenerator* generator, GLenum primitiveType, float* positions, const float* previous) {
+    float x, y, angle;
+    unsigned int i, nbVertices;
+
+    switch(primitiveType) {
+        case GL_LINES:
+            generatorPosition(generator, positions, positions + 1);
+            angle = 2 * M_PI * generatorUniform(generator);
+            positions[2] = positions[0] + generator->size * cos(angle);
+            positions[3] = positions[1] + generator->size * sin(angle);
+            return 2;
+        case GL_TRIANGLES:
+        case GL_QUADS:
+            /* Sommets dans l'ordre autour du centre : les formes ne se croisent pas elles-mêmes */
+            nbVertices = primitiveType == GL_TRIANGLES ? 3 : 4;
+            generatorPosition(generator, &x, &y);
+            angle = 2 * M_PI * generatorUniform(generator);
+            for(i = 0 ; i < nbVertices ; i++) {
+                float vertexAngle = angle + 2 * M_PI * i / nbVertices;
+                positions[2 * i] = x + generator->size * cos(vertexAngle);
+                positions[2 * i + 1] = y + generator->size * sin(vertexAngle);
+            }
+            return nbVertices;
+        case GL_LINE_STRIP:
+            if(previous) {
+                positions[0] = reflectCoordinate(previous[0] + generator->size * (2 * generatorUniform(generator) - 1), ORTHO_LEFT, ORTHO_RIGHT);
+                positions[1] = reflectCoordinate(previous[1] + generator->size * (2 * generatorUniform(generator) - 1), ORTHO_BOTTOM, ORTHO_TOP);
+                return 1;
+            }
+            generatorPosition(generator, positions, positions + 1);
+            return 1;
+        default:
+            generatorPosition(generator, positions, positions + 1);
+            return 1;
+    }
+}
+
+/* Remplace la scène par nbPrimitives primitives de types mélangés (points, segments, triangles, quadrilatères, lignes brisées) */
+/* totalisant environ nbVertices sommets (chaque primitive en a entre la moitié et une fois et demie de la moyenne, en formes entières), */
+/* placés selon distribution. Renvoie le nombre de sommets générés */
+unsigned long long generateScene(PrimitiveList* scene, unsigned int nbPrimitives, unsigned long long nbVertices, int distribution, unsigned long long seed) {
+    static const GLenum TYPES[] = {GL_POINTS, GL_LINES, GL_TRIANGLES, GL_QUADS, GL_LINE_STRIP};
+    static const unsigned int GROUPS[] = {1, 2, 3, 4, 1};
+    SceneGenerator generator;
+    float* positions = (float*)malloc(2 * GENERATOR_CHUNK_POINTS * sizeof(float));
+    unsigned char* colors = (unsigned char*)malloc(3 * GENERATOR_CHUNK_POINTS * sizeof(unsigned char));
+    unsigned long long remaining = nbVertices, generated = 0;
+    unsigned int i, j;
+
+    if(!positions || !colors) {
+        printf("Error at generator malloc\n");
+        exit(1);
+    }
+    memset(&generator, 0, sizeof(SceneGenerator));
+    generator.state = seed;
+    generator.distribution = distribution;
+    generator.size = (ORTHO_RIGHT - ORTHO_LEFT) / 100;
+    for(generator.gridSide = 1 ; generator.gridSide * generator.gridSide < nbVertices ; generator.gridSide++);
+    for(i = 0 ; i < GENERATOR_NB_CLUSTERS ; i++) {
+        generator.clusters[2 * i] = ORTHO_LEFT + (ORTHO_RIGHT - ORTHO_LEFT) * (0.1 + 0.8 * generatorUniform(&generator));
+        generator.clusters[2 * i + 1] = ORTHO_BOTTOM + (ORTHO_TOP - ORTHO_BOTTOM) * (0.1 + 0.8 * generatorUniform(&generator));
+    }
+
+    resetScene(scene);
+    for(i = 0 ; i < nbPrimitives ; i++) {
+        unsigned int type = generatorRandom(&generator) % 5;
+        unsigned int group = GROUPS[type];
+        const unsigned char* color = COLORS + 3 * (generatorRandom(&generator) % NB_COLORS);
+        unsigned long long count = remaining / (nbPrimitives - i);
+        Primitive* primitive = allocPrimitive(TYPES[type]);
+        unsigned int filled = 0;
+        float last[2];
+
+        /* La dernière primitive prend le reste, les autres s'écartent de la moyenne au hasard */
+        if(i + 1 < nbPrimitives) {
+            count = count * (0.5 + generatorUniform(&generator));
+        }
+        else {
+            count = remaining;
+        }
+        count = count > UINT_MAX - group ? UINT_MAX - group : count;
+        count = count < group ? group : count - count % group;
+        remaining = remaining > count ? remaining - count : 0;
+        addPrimitive(primitive, scene);
+        reservePoints(&primitive->points, count);
+
+        /* Par morceaux de GENERATOR_CHUNK_POINTS sommets, ajoutés d'une copie */
+        while(count > 0) {
+            unsigned int nbShape = generateShape(&generator, TYPES[type], positions + 2 * filled, filled > 0 || primitive->points.nbPoints > 0 ? last : NULL);
+            filled += nbShape;
+            count -= nbShape;
+            memcpy(last, positions + 2 * (filled - 1), sizeof(last));
+            if(count == 0 || filled + 4 > GENERATOR_CHUNK_POINTS) {
+                for(j = 0 ; j < filled ; j++) {
+                    memcpy(colors + 3 * j, color, 3);
+                }
+                appendPoints(&primitive->points, positions, colors, filled);
+                generated += filled;
+                filled = 0;
+            }
+        }
+    }
+    free(positions);
+    free(colors);
+
+    return generated;
+}
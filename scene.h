@@ -0,0 +1,652 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+/* Scène de primitives des programmes de dessin : tableaux de points, tas, journal d'annulation, fichiers, sauvegarde automatique, */
+/* lecture en flux et dessin. Le programme définit WINDOW_WIDTH et WINDOW_HEIGHT et les tient à jour quand la fenêtre change de taille */
+
+#include "render.h"
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include <stddef.h>
+
+
+/************* CONSTANTES **************/
+
+
+/* Dimensions de la fenêtre (définies par le programme) */
+extern unsigned int WINDOW_WIDTH;
+extern unsigned int WINDOW_HEIGHT;
+
+/* Couleurs RVB (à savoir qu'un unsigned char est relatif à un int) */
+static const unsigned char COLORS[] = {
+     255, 255, 255 ,
+     0, 0, 0 ,
+     255, 0, 0 ,
+     0, 255, 0 ,
+     0, 0, 255 ,
+     255, 255, 0 ,
+     0, 255, 255 ,
+     255, 0, 255
+};
+
+/* Pour avoir les couleurs RVB du points, on prend les 3 valeurs correspondantes à ce point */
+static const unsigned int NB_COLORS = sizeof(COLORS) / (3 * sizeof(unsigned char));
+
+/* Bornes du repère passées à gluOrtho2D : cadre de la palette et vue de départ de la caméra */
+static const float ORTHO_LEFT = -1.;
+static const float ORTHO_RIGHT = 1.;
+static const float ORTHO_BOTTOM = -1.;
+static const float ORTHO_TOP = 1.;
+
+
+/************** STRUCTURES **************/
+
+/* Boîte englobante alignée sur les axes */
+typedef struct BoundingBox{
+    float minX, minY; // Coin en bas à gauche
+    float maxX, maxY; // Coin en haut à droite
+} BoundingBox;
+
+typedef struct Point{
+    float x, y; // Position 2D du point
+    unsigned char r, g, b; // Couleur du point
+} Point;
+
+/* Tableau contigu de points : la capacité double quand il est plein, l'ajout est donc en O(1) amorti */
+/* Un tableau est soit au format flottant (positions + colors), soit au format compact (quantized + colorIndices) */
+typedef struct PointList{
+    float* positions; // x0, y0, x1, y1... les positions des points se suivent en mémoire
+    unsigned char* colors; // r0, g0, b0, r1... les couleurs des points se suivent en mémoire
+    unsigned short* quantized; // Format compact : x0, y0, x1... en virgule fixe 16 bits dans la boîte englobante
+    unsigned char* colorIndices; // Format compact : indice de la couleur de chaque point dans COLORS
+    unsigned int nbPoints; // Nombre de points dans le tableau
+    unsigned int capacity; // Nombre de points qu'on peut ranger sans réallouer
+    BoundingBox box; // Boîte englobante des points, tenue à jour à chaque ajout (valable si nbPoints > 0)
+    unsigned int nbLodPoints; // Nombre de points déjà versés dans la pyramide de niveaux de détail
+    float* significance; // Écart de chaque sommet à la ligne simplifiée (Douglas-Peucker), pour décimer les lignes
+    unsigned int significanceCapacity; // Nombre de cases allouées pour significance
+    unsigned int nbSignificant; // Nombre de points pour lesquels significance est à jour (0 : à recalculer)
+    unsigned int nbSignificantBase; // Nombre de points lors du dernier calcul complet de significance
+    unsigned int sharedVersion; // Dernier instantané qui lit les tableaux de points (0 si aucun)
+    unsigned int nbShared; // Nombre de points que les instantanés lisent : on ne les réécrit pas en place
+    int mapped; // 1 si les tableaux sont dans un fichier de scène projeté en mémoire : ils ne sont jamais rendus au tas
+    unsigned int autosaveId; // Rang de la primitive dans le journal de sauvegarde automatique
+    int counted; // 1 si la primitive est dans la scène : ses points entrent dans les statistiques
+    int vertexPool; // Réserve de sommets (celle du type de la primitive) où est la plage du tableau
+    unsigned int poolSlot; // Indice du tableau parmi les propriétaires de la réserve
+    unsigned int poolFirst; // Premier sommet de la plage dans le tampon de la réserve
+    unsigned int poolCapacity; // Nombre de sommets de la plage (0 si le tableau n'en a pas)
+    unsigned int nbUploaded; // Nombre de points à jour dans la plage : les suivants seront envoyés avant le dessin
+    unsigned int dirtyFirst; // Points modifiés sur place [dirtyFirst, dirtyEnd[ parmi ceux déjà envoyés (vide si les deux sont égaux)
+    unsigned int dirtyEnd;
+} PointList;
+
+typedef struct Primitive{
+    GLenum primitiveType;
+    PointList points;
+    struct Primitive* next;
+} Primitive, *PrimitiveList;
+
+/* Bloc de mémoire demandé au système, découpé ensuite pour les éléments de la scène */
+typedef struct ArenaBlock{
+    struct ArenaBlock* next; // Bloc suivant, conservé après un reset pour être réutilisé
+    size_t size; // Nombre d'octets utilisables dans le bloc
+    size_t used; // Nombre d'octets déjà découpés
+} ArenaBlock;
+
+/* Morceau plus grand qu'un bloc : demandé au système à sa taille exacte (un tableau de couleurs arrondi à une puissance de 2 prendrait jusqu'au double) */
+typedef struct ArenaLarge{
+    struct ArenaLarge* prev; // Chaînage dans les deux sens : un gros morceau est rendu au système dès qu'il est rendu au tas
+    struct ArenaLarge* next;
+    size_t size;
+} ArenaLarge;
+
+/* Nombre de classes de tailles : la classe i contient les morceaux de 2^i octets (une par bit de size_t) */
+#define ARENA_NB_CLASSES (sizeof(size_t) * 8)
+
+/* Tas qui possède toutes les primitives et tous les tableaux de points de la scène */
+typedef struct SceneArena{
+    ArenaBlock* first; // Premier bloc de la chaîne
+    ArenaBlock* current; // Bloc dans lequel on découpe en ce moment
+    void* freeLists[ARENA_NB_CLASSES]; // Morceaux rendus, rangés par classe de taille
+    ArenaLarge* large; // Gros morceaux en cours d'utilisation (ils ne passent pas par les blocs)
+    size_t bytesReserved; // Octets demandés au système
+    size_t bytesUsed; // Octets distribués à la scène et pas encore rendus
+} SceneArena;
+
+/* Entrée de la grille spatiale : le point d'indice index du tableau list */
+typedef struct GridEntry{
+    PointList* list;
+    unsigned int index;
+} GridEntry;
+
+/* Case de la grille : elle contient les points dont la position tombe dans le carré (cellX, cellY) */
+typedef struct GridCell{
+    int cellX, cellY;
+    GridEntry* entries; // Tableau qui double quand il est plein, comme les points
+    unsigned int nbEntries;
+    unsigned int capacity;
+    struct GridCell* next; // Case suivante dans le même seau de la table
+} GridCell;
+
+/* Grille uniforme sur tous les points de la scène, rangée dans une table de hachage (le canevas n'a donc pas de bord) */
+typedef struct SpatialGrid{
+    GridCell** buckets; // Seaux de la table (leur nombre est une puissance de 2)
+    unsigned int nbBuckets;
+    unsigned int nbCells;
+    float cellSize; // Côté d'une case dans le repère du dessin
+    int dirty; // 1 si des points ont bougé en masse : la grille sera reconstruite à la prochaine requête
+} SpatialGrid;
+
+/* Caméra sur le canevas infini : la vue est le cadre de gluOrtho2D du TD, décalé de (panX, panY) et agrandi zoom fois */
+typedef struct Camera{
+    float panX, panY; // Décalage du centre de la vue par rapport au centre du repère du TD
+    float zoom; // 1 pour le cadre d'origine, 2 pour voir deux fois plus gros
+} Camera;
+
+/* Trait à main levée en cours : les points de la souris sont filtrés à l'arrivée (distance radiale puis Reumann-Witkam) */
+typedef struct StrokeFilter{
+    PointList* list; // Tableau qui reçoit le trait (NULL si aucun trait en cours)
+    unsigned int anchor; // Indice du dernier sommet fixé du trait
+    int floating; // 1 si le dernier point du tableau est provisoire : il suit la souris tant qu'elle reste dans le couloir
+    float keyX, keyY; // Direction du couloir, depuis le sommet fixé vers le premier point qui s'en est éloigné
+    float tolerance; // Demi-largeur du couloir et distance minimale entre deux points gardés
+} StrokeFilter;
+
+/* Types d'étapes du journal d'annulation */
+#define JOURNAL_ADD_POINTS 0 // Points ajoutés en fin de tableau (un clic, ou tout un trait à main levée)
+#define JOURNAL_ADD_PRIMITIVE 1 // Primitives ajoutées en tête de liste
+#define JOURNAL_ERASE_POINTS 2 // Points enlevés d'un tableau par la gomme
+#define JOURNAL_TRANSFORM 3 // Transformation de la sélection (ou de toute la scène)
+
+/* Étape du journal : elle ne garde que ce qui a changé, jamais une copie de la scène */
+typedef struct JournalEntry{
+    int type; // JOURNAL_ADD_POINTS, JOURNAL_ADD_PRIMITIVE, JOURNAL_ERASE_POINTS ou JOURNAL_TRANSFORM
+    Primitive* primitive; // Primitive ajoutée, la plus récente si l'étape en ajoute plusieurs (JOURNAL_ADD_PRIMITIVE), ou transformée (JOURNAL_TRANSFORM, NULL pour toute la scène)
+    PointList* list; // Tableau modifié (JOURNAL_ADD_POINTS, JOURNAL_ERASE_POINTS)
+    unsigned int first; // Indice du premier point ajouté (JOURNAL_ADD_POINTS)
+    unsigned int count; // Nombre de points ajoutés ou enlevés, ou de primitives ajoutées en tête de liste (JOURNAL_ADD_PRIMITIVE, plus d'une une fois fondues)
+    Point* points; // Copie des points enlevés (par la gomme, ou par l'annulation d'un ajout), NULL sinon
+    unsigned int* indices; // Indices d'origine des points enlevés par la gomme, dans l'ordre croissant
+    float matrix[6]; // Transformation appliquée a, b, c, d, tx, ty (JOURNAL_TRANSFORM)
+    int chained; // 1 si l'étape s'annule et se refait avec la précédente (gomme passée sur plusieurs primitives)
+} JournalEntry;
+
+/* Journal circulaire : les étapes faites puis les étapes annulées. Au-delà de sa mémoire maximale (setJournalLimit), */
+/* les plus anciennes sont fondues dans la suivante quand c'est possible, sinon oubliées */
+typedef struct Journal{
+    JournalEntry* entries; // Tableau circulaire d'étapes, pris dans le tas de la scène
+    unsigned int capacity; // Nombre de cases de entries (puissance de 2)
+    unsigned int start; // Case de l'étape la plus ancienne
+    unsigned int nbDone; // Nombre d'étapes qu'on peut annuler
+    unsigned int nbUndone; // Nombre d'étapes annulées qu'on peut refaire
+    size_t bytes; // Mémoire prise par les étapes et leurs copies de points
+} Journal;
+
+/* Instantané de la scène : copie des en-têtes des primitives, les tableaux de points sont partagés avec la scène */
+/* La scène ne réécrit ni ne rend jamais un tableau qu'un instantané vivant lit : elle le recopie ou le met de côté */
+typedef struct SceneSnapshot{
+    unsigned int version; // Numéro de l'instantané (croissant)
+    PrimitiveList scene; // Copies des primitives, chaînées dans l'ordre de la scène (NULL si elle est vide)
+    int released; // 1 quand le lecteur a fini (protégé par snapshots.mutex)
+    struct SceneSnapshot* next; // Instantané vivant plus ancien
+} SceneSnapshot;
+
+/* Fichier de scène projeté en mémoire : les tableaux des primitives chargées pointent dedans */
+typedef struct SceneMapping{
+    void* data; // Début de la projection
+    size_t size; // Taille projetée
+    unsigned int version; // Dernier instantané pris avant que la scène ne la quitte : elle est fermée quand il n'en reste aucun d'aussi ancien
+    struct SceneMapping* next;
+} SceneMapping;
+
+/* Mémoire que la scène n'utilise plus mais qu'un instantané peut encore lire */
+typedef struct RetiredMemory{
+    void* chunk; // Morceau du tas de la scène (NULL pour un tas entier)
+    size_t size; // Taille du morceau
+    SceneArena* arena; // Tas entier mis de côté par resetScene (NULL pour un morceau)
+    unsigned int version; // Dernier instantané pris avant la mise de côté : la mémoire est rendue quand il n'en reste aucun d'aussi ancien
+    struct RetiredMemory* next;
+} RetiredMemory;
+
+/* Instantanés vivants et mémoire mise de côté : seule la boucle principale les modifie (sauf released) */
+typedef struct SnapshotRegistry{
+    SceneSnapshot* live; // Instantanés vivants, le plus récent en premier
+    RetiredMemory* retired; // Mémoire à rendre
+    SceneMapping* retiredMappings; // Fichiers projetés que la scène a quittés mais qu'un instantané peut encore lire
+    unsigned int lastVersion; // Numéro du dernier instantané pris
+    unsigned int oldestVersion; // Numéro du plus ancien instantané vivant (lastVersion + 1 s'il n'y en a pas)
+    SDL_mutex* mutex; // Protège released (créé avec le premier instantané)
+} SnapshotRegistry;
+
+/* En-tête d'un fichier de scène : viennent ensuite la table des primitives puis leurs tableaux tels qu'en mémoire, alignés sur 64 octets */
+typedef struct SceneFileHeader{
+    char magic[8]; // "IMACSCN" suivi d'un zéro
+    unsigned int version; // SCENE_FILE_VERSION
+    unsigned int byteOrder; // 0x01020304 écrit dans l'ordre de la machine qui a sauvegardé
+    unsigned int nbPrimitives; // Nombre d'entrées dans la table
+    unsigned int reserved; // Toujours 0
+    unsigned long long fileSize; // Taille totale du fichier, pour repérer un fichier tronqué
+} SceneFileHeader;
+
+/* Entrée de la table des primitives, dans l'ordre de la liste (la primitive courante en premier) */
+typedef struct SceneFilePrimitive{
+    unsigned int primitiveType; // GL_POINTS, GL_LINES...
+    unsigned int compact; // 1 : quantized et colorIndices, 0 : positions et colors
+    unsigned int nbPoints;
+    unsigned int reserved; // Toujours 0
+    BoundingBox box; // Boîte englobante (et repère de quantification au format compact)
+    unsigned long long positionsOffset; // Position dans le fichier de positions (ou quantized)
+    unsigned long long colorsOffset; // Position dans le fichier de colors (ou colorIndices)
+} SceneFilePrimitive;
+
+/* Flux d'un fichier d'archive, lu ou écrit par morceaux de ARCHIVE_BUFFER_SIZE octets */
+typedef struct ArchiveStream{
+    FILE* file;
+    unsigned char* buffer; // Morceau en cours
+    size_t position; // Prochain octet à lire ou à écrire dans buffer
+    size_t size; // Nombre d'octets lus dans buffer (en lecture)
+    int writing; // 1 en écriture, 0 en lecture
+    int error; // 1 après une erreur d'entrée-sortie ou un fichier tronqué
+} ArchiveStream;
+
+/* Écriture de la scène dans un fichier (CSV, format binaire) : renvoie 0 en cas d'erreur */
+typedef int (*SceneWriter)(PrimitiveList scene, const char* path);
+
+/* Types d'enregistrements du journal de sauvegarde automatique */
+#define AUTOSAVE_ADD_PRIMITIVE 0 // Primitive ajoutée en tête de liste (value : son type)
+#define AUTOSAVE_REMOVE_PRIMITIVE 1 // Primitive de tête enlevée
+#define AUTOSAVE_ADD_POINTS 2 // count points ajoutés en fin de tableau, suivis des Point
+#define AUTOSAVE_REPLACE_LAST 3 // Dernier point du tableau remplacé, suivi du Point
+#define AUTOSAVE_TRUNCATE 4 // Tableau raccourci à value points
+#define AUTOSAVE_ERASE 5 // count points enlevés, suivis de leurs indices croissants
+#define AUTOSAVE_RESTORE 6 // count points remis, suivis de leurs indices croissants puis des Point
+#define AUTOSAVE_TRANSFORM 7 // count points transformés à partir de l'indice value, suivis de a, b, c, d, tx, ty
+#define AUTOSAVE_RECOLOR 8 // count points recolorés à partir de l'indice value, suivis de r, g, b et d'un octet de bourrage
+#define AUTOSAVE_COMPACT 9 // Tableau passé au format compact
+
+/* En-tête du journal de sauvegarde automatique, suivi des enregistrements */
+typedef struct AutosaveFileHeader{
+    char magic[8]; // "IMACLOG"
+    unsigned int version; // AUTOSAVE_FILE_VERSION
+    unsigned int byteOrder; // 0x01020304 écrit par la machine : le journal n'est relu que sur une machine du même ordre d'octets
+} AutosaveFileHeader;
+
+/* Enregistrement du journal : les données qui suivent ont une taille multiple de 4 */
+typedef struct AutosaveRecord{
+    unsigned int type; // AUTOSAVE_ADD_PRIMITIVE...
+    unsigned int id; // Rang de la primitive en partant de la queue de la scène (les primitives ne s'ajoutent et ne s'enlèvent qu'en tête)
+    unsigned int count;
+    unsigned int value;
+} AutosaveRecord;
+
+/* Enregistrements en mémoire, en attente d'écriture */
+typedef struct AutosaveBuffer{
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+} AutosaveBuffer;
+
+/* Sauvegarde automatique : la boucle principale ajoute les enregistrements, le fil d'écriture les écrit par groupes et attend le disque */
+typedef struct AutosaveState{
+    SDL_Thread* thread; // Fil d'écriture (NULL si la sauvegarde automatique est arrêtée)
+    SDL_mutex* mutex; // Protège pending, canMerge, checkpoint, boundary, compacting, logBytes, checkpointBytes, writable, failed, failedTime et running
+    SDL_cond* wake; // Réveille le fil d'écriture avant la fin de son attente
+    SDL_cond* drained; // Signalé par le fil d'écriture quand il prend pending : la boucle principale attend dessus si pending est plein
+    const char* path; // Fichier du journal
+    AutosaveBuffer pending; // Enregistrements pas encore écrits
+    size_t lastRecord; // Position dans pending du dernier ajout de points, auquel les ajouts suivants se fusionnent
+    int canMerge; // 1 si lastRecord est valable
+    SceneSnapshot* checkpoint; // Instantané à écrire en tête d'un nouveau journal (NULL si aucun compactage n'attend)
+    size_t boundary; // Position dans pending de l'instantané : les enregistrements qui précèdent y sont déjà
+    int compacting; // 1 du compactage demandé jusqu'à ce que le nouveau journal soit en place
+    size_t logBytes; // Taille du journal sur le disque
+    size_t checkpointBytes; // Taille du journal juste après le dernier compactage réussi : il n'est recompacté qu'une fois doublé
+    int writable; // 1 si le fil a un journal à jour où écrire : sinon il garde pending jusqu'au prochain compactage
+    int failed; // 1 depuis un compactage raté jusqu'au suivant réussi : la boucle principale en redemande un
+    Uint32 failedTime; // Moment du dernier compactage raté
+    int running; // 0 pour arrêter le fil d'écriture
+    int checkpointNeeded; // 1 après une modification qui ne s'écrit pas dans le journal (reset, ouverture d'un fichier) : boucle principale
+    unsigned int nbPrimitives; // Nombre de primitives de la scène, donc rang de la prochaine : boucle principale
+} AutosaveState;
+
+/* Nombre de lots que la file de lecture en flux peut garder : le fil de lecture attend quand elle est pleine */
+#define INGEST_QUEUE_LENGTH 8
+
+/* Lot de points lu par le fil de lecture : les premiers vont dans la primitive courante, les suivants dans les primitives commencées par le lot */
+typedef struct IngestBatch{
+    unsigned int nbPoints; // Nombre de points du lot (au plus INGEST_BATCH_POINTS)
+    float* positions; // x0, y0, x1, y1...
+    unsigned char* colors; // r0, g0, b0, r1...
+    unsigned int nbPrimitives; // Primitives commencées dans le lot (au plus INGEST_BATCH_PRIMITIVES)
+    unsigned int* starts; // Indice du premier point de chacune
+    GLenum* primitiveTypes; // Type de chacune
+    unsigned int nbIgnored; // Lignes de texte invalides ignorées pendant la lecture du lot
+} IngestBatch;
+
+/* Lecture de points en flux (entrée standard, fichier ou tube nommé) : un fil lit et découpe, la boucle principale verse les lots dans la scène */
+typedef struct IngestState{
+    SDL_Thread* thread; // Fil de lecture (NULL si aucune lecture en cours)
+    SDL_mutex* mutex; // Protège batches, first, nbBatches, done, stop et nbIgnored
+    SDL_cond* notFull; // Le fil de lecture y attend une place dans la file
+    IngestBatch* batches[INGEST_QUEUE_LENGTH]; // File circulaire des lots lus
+    unsigned int first; // Case du lot le plus ancien
+    unsigned int nbBatches; // Nombre de lots dans la file
+    int fd; // Descripteur lu par le fil
+    const char* path; // Nom du flux ("-" pour l'entrée standard)
+    int done; // 1 quand le fil a tout lu (fin du flux ou erreur)
+    int stop; // 1 pour arrêter le fil
+    unsigned int nbIgnored; // Lignes de texte invalides ignorées : chaque lot compte les siennes, ajoutées ici quand il est pris
+    unsigned long long nbPoints; // Points versés dans la scène (boucle principale)
+    int csvColumns[16]; // Rôle de chaque colonne CSV : indice dans CSV_COLUMNS, -1 si elle est ignorée (fil de lecture)
+    unsigned int nbCsvColumns; // Colonnes CSV, 0 tant que la première ligne n'est pas lue (fil de lecture)
+    char csvSeparator; // ';' ou ',' (fil de lecture)
+    long csvPrimitive; // Numéro de primitive de la dernière ligne CSV (fil de lecture)
+    int svgLines; // 1 si la primitive courante réunit des éléments <line> consécutifs (fil de lecture)
+} IngestState;
+
+/* Tracé d'un élément SVG en cours de lecture : le point courant, le début du sous-chemin et la primitive ouverte */
+typedef struct SvgPen{
+    IngestBatch** batch; // Lot qui reçoit les points
+    unsigned char color[3]; // Couleur du trait
+    float x, y; // Point courant (repère du SVG, y vers le bas)
+    float startX, startY; // Début du sous-chemin
+    int open; // 1 si le sous-chemin a commencé sa primitive
+    int stop; // 1 si la lecture doit s'arrêter
+} SvgPen;
+
+/* En-tête d'un anneau de points en mémoire partagée (un producteur, un consommateur), suivi des positions puis des couleurs */
+/* head et tail comptent les points depuis la création : le point n est dans la case n % capacity */
+typedef struct SharedRingHeader{
+    char magic[8]; // "IMACRNG"
+    unsigned int version; // SHARED_RING_VERSION
+    unsigned int capacity; // Nombre de cases (puissance de 2)
+    unsigned int primitiveType; // Type de primitive des points, choisi par le producteur
+    unsigned int reserved;
+    unsigned long long stalls; // Lots que le producteur n'a pas pu écrire faute de place (producteur)
+    unsigned long long droppedPoints; // Points de ces lots (producteur)
+    char padding[24]; // head et tail sont chacun sur leur ligne de cache
+    unsigned long long head; // Points écrits (producteur)
+    char headPadding[56];
+    unsigned long long tail; // Points libérés (consommateur)
+    char tailPadding[56];
+} SharedRingHeader;
+
+/* Anneau partagé projeté dans le processus */
+typedef struct SharedRing{
+    SharedRingHeader* header; // NULL si l'anneau n'est pas ouvert
+    float* positions; // x0, y0, x1, y1... (capacity cases)
+    unsigned char* colors; // r0, g0, b0, r1... (capacity cases)
+    size_t size; // Taille de la projection
+    const char* name; // Nom de la mémoire partagée
+    int owner; // 1 si ce processus l'a créée (et l'efface en la fermant)
+} SharedRing;
+
+/* En-tête d'un magasin de points sur disque, pour les nuages plus gros que la mémoire : suivi de la table des morceaux puis de leurs points */
+/* Le cadre box est découpé en gridSize x gridSize cases, une case par morceau, rangées dans l'ordre de Morton (deux cases voisines restent proches sur le disque) */
+typedef struct StoreFileHeader{
+    char magic[8]; // "IMACOOC"
+    unsigned int version; // STORE_FILE_VERSION
+    unsigned int byteOrder; // 0x01020304 écrit dans l'ordre de la machine qui a construit le magasin
+    unsigned int gridSize; // Cases par côté (puissance de 2)
+    unsigned int reserved; // Toujours 0
+    BoundingBox box; // Cadre de tous les points
+    unsigned long long nbPoints; // Nombre total de points
+    unsigned long long fileSize; // Taille totale du fichier, pour repérer un fichier tronqué
+} StoreFileHeader;
+
+/* Entrée de la table : les positions puis les couleurs d'un morceau, qui commence sur une page */
+/* Les points d'un morceau sont mélangés : les n premiers sont un échantillon de tout le morceau, dessiné quand on voit de loin */
+typedef struct StoreChunk{
+    BoundingBox box; // Boîte englobante des points du morceau
+    unsigned long long offset; // Position des positions dans le fichier (multiple de STORE_PAGE_SIZE)
+    unsigned int nbPoints;
+    unsigned int reserved; // Toujours 0
+} StoreChunk;
+
+/* Magasin ouvert : le fichier est projeté en entier, seuls les débuts de morceaux demandés sont en mémoire */
+/* La boucle principale demande des points à chaque image, un fil de chargement les lit et libère les morceaux oubliés depuis longtemps */
+typedef struct PointStore{
+    unsigned char* data; // Projection du fichier (NULL si aucun magasin n'est ouvert)
+    size_t size; // Taille de la projection
+    const StoreFileHeader* header;
+    const StoreChunk* chunks; // Table des morceaux (gridSize * gridSize entrées)
+    unsigned int nbChunks;
+    unsigned int* residentPoints; // Points en mémoire au début de chaque morceau (fil de chargement)
+    unsigned int* wantedPoints; // Points demandés par la dernière image (boucle principale)
+    unsigned int* lastUsed; // Dernière image qui a vu ou demandé le morceau (boucle principale)
+    unsigned char* pinned; // 1 pendant que la boucle principale dessine le morceau : le fil de chargement ne le libère pas
+    unsigned int* requests; // Morceaux à charger, les visibles d'abord puis leurs voisins (boucle principale)
+    unsigned int nbRequests, nextRequest; // Demandes de la dernière image, et la prochaine à traiter (fil de chargement)
+    unsigned int* visible; // Morceaux dessinés par la dernière image
+    unsigned int* drawCounts; // Points dessinés de chacun
+    unsigned int nbVisible;
+    size_t residentBytes; // Octets en mémoire (fil de chargement)
+    size_t budget; // Octets que les morceaux chargés ne dépassent pas (au plus une page par tableau près) : ce qui ne tient pas n'est pas lu
+    unsigned int frame; // Numéro de l'image
+    unsigned long long nbLoads, nbEvictions; // Morceaux lus et libérés (fil de chargement)
+    unsigned long long drawnPoints, missingPoints; // Points dessinés et points pas encore chargés à la dernière image
+    SDL_Thread* loader; // Fil de chargement
+    SDL_mutex* mutex; // Protège residentPoints, wantedPoints, lastUsed, pinned, requests, nbRequests, nextRequest, residentBytes, frame et stop
+    SDL_cond* wake; // Le fil de chargement y attend des demandes
+    int stop; // 1 pour arrêter le fil
+} PointStore;
+
+/* Distributions des positions du générateur de scènes */
+#define GENERATOR_UNIFORM 0 // Uniforme dans le cadre du TD
+#define GENERATOR_CLUSTERS 1 // Autour de GENERATOR_NB_CLUSTERS centres (loi normale)
+#define GENERATOR_GRID 2 // Sur une grille régulière, les sommets dans l'ordre de génération
+#define GENERATOR_NB_CLUSTERS 16
+
+/* État du générateur de scènes : tout dépend de la graine, la même graine redonne la même scène sur toutes les machines */
+typedef struct SceneGenerator{
+    unsigned long long state; // État du générateur pseudo-aléatoire (splitmix64)
+    int distribution; // GENERATOR_UNIFORM...
+    float clusters[2 * GENERATOR_NB_CLUSTERS]; // Centres des amas
+    unsigned long long gridSide, gridIndex; // Côté de la grille et prochaine case
+    float size; // Taille des formes (segments, triangles, quadrilatères, pas des lignes brisées)
+} SceneGenerator;
+
+/* Nombre de cases d'échantillonnage par côté d'une tuile de la pyramide */
+#define LOD_TILE_CELLS 64
+
+/* Nombre de niveaux de la pyramide : l'espacement double à chaque niveau */
+#define LOD_NB_LEVELS 16
+
+/* Tuile de la pyramide d'un tableau de points : au plus un point représentant par case d'échantillonnage */
+typedef struct LodTile{
+    const PointList* list; // Tableau dont la tuile représente les points
+    int level, tileX, tileY;
+    unsigned char occupied[LOD_TILE_CELLS * LOD_TILE_CELLS / 8]; // Un bit par case déjà représentée
+    PointList points; // Les points représentants de la tuile
+    struct LodTile* next; // Tuile suivante dans le même seau de la table
+} LodTile;
+
+/* Pyramide de niveaux de détail des primitives GL_POINTS, tuiles rangées par tableau : vue de loin, chaque primitive n'envoie que ses représentants, à sa place dans la liste */
+typedef struct LodPyramid{
+    LodTile** buckets;
+    unsigned int nbBuckets;
+    unsigned int nbTiles;
+    float baseSpacing; // Espacement des cases au niveau 0
+    int dirty; // 1 si des points ont été enlevés ou déplacés : la pyramide sera reconstruite
+} LodPyramid;
+
+/* Sommet d'un tampon : position et couleur entrelacées (la couleur est complétée à 4 octets, 12 octets en tout) */
+typedef struct BufferVertex{
+    float x, y;
+    unsigned char r, g, b, a;
+} BufferVertex;
+
+/* Réserve de sommets d'un type de primitive : un seul tampon, découpé en une plage par primitive */
+typedef struct VertexPool{
+    GLuint buffer; // 0 tant qu'il n'a pas été créé (ou après la perte du contexte)
+    unsigned int capacity; // Nombre de sommets du tampon
+    unsigned int used; // Fin de la dernière plage : les nouvelles plages sont prises à partir d'ici
+    unsigned int wasted; // Sommets des plages rendues avant used, repris au prochain tassement
+    PointList** owners; // Tableaux qui ont une plage dans la réserve (resetScene rend tout sans parcourir la scène)
+    unsigned int nbOwners;
+    unsigned int ownersCapacity;
+} VertexPool;
+
+/* Lot de primitives d'un même type dessiné d'un seul glMultiDrawArrays */
+#define BATCH_GRID 64 // Nombre de cases de la vue sur chaque axe pour savoir quelles primitives se touchent
+typedef struct DrawBatch{
+    GLenum type;
+    unsigned int first; // Première plage du lot dans firsts et counts
+    unsigned int count; // Nombre de plages du lot
+} DrawBatch;
+
+/* Rendu par tampons : une réserve par type, et les tableaux qui servent à regrouper les dessins de l'image */
+typedef struct VertexBuffers{
+    VertexPool pools[GL_POLYGON + 1];
+    BufferVertex* staging; // Sommets entrelacés avant leur envoi
+    unsigned int stagingCapacity;
+    Primitive** drawList; // Primitives visibles de l'image, dans l'ordre de la liste
+    unsigned int* drawBatch; // Lot de chaque primitive visible
+    GLint* firsts; // Premier sommet et nombre de sommets de chaque primitive visible, rangés lot par lot
+    GLsizei* counts;
+    DrawBatch* batches;
+    unsigned int drawCapacity;
+} VertexBuffers;
+
+/* Rendu de la scène par drawPrimitives */
+#define RENDER_IMMEDIATE 0 // glBegin, puis glColor3ub et glVertex2f pour chaque sommet
+#define RENDER_BUFFERS 1 // Une plage par primitive dans le tampon de son type, un glMultiDrawArrays par lot
+
+/* Statistiques de la scène, tenues à jour à chaque ajout ou retrait : les lire ne parcourt pas la liste */
+typedef struct SceneStatistics{
+    unsigned int nbPrimitives[GL_POLYGON + 2]; // Nombre de primitives de chaque type (GL_POINTS à GL_POLYGON, puis les types inconnus)
+    unsigned int totalPrimitives;
+    unsigned long long nbVertices; // Nombre de points de toutes les primitives
+    unsigned long long usedBytes; // Octets occupés par les points (selon le format de chaque tableau)
+    unsigned long long reservedBytes; // Octets réservés pour les points (capacité des tableaux)
+    size_t heapUsed; // Octets distribués par le tas de la scène (primitives, points, journal, grille...)
+    size_t heapReserved; // Octets demandés au système par le tas de la scène
+    unsigned int drawnPrimitives; // Compteurs du dernier drawPrimitives
+    unsigned int culledPrimitives;
+    unsigned int drawCalls;
+    unsigned long long uploadedBytes;
+    unsigned long long streamedBytes; // Octets de géométrie refaite écrits dans l'anneau par la dernière image
+    unsigned int streamWaits; // Attentes du processeur sur une part de l'anneau encore dessinée
+    unsigned int renderPackets; // Paquets de la file de rendu et changements de texture et de couleur lors du dernier flushRenderQueue
+    unsigned int stateChanges;
+    int lodLevel;
+    unsigned int drawnLodPoints;
+    unsigned int decimatedVertices;
+    unsigned int expandedLists; // Tableaux compacts repassés au format flottant depuis le dernier reset (points ajoutés, couleur ou point remis hors palette)
+    unsigned int mergedSteps; // Étapes du journal fondues dans la suivante et étapes oubliées pour tenir sous sa limite, depuis le dernier reset
+    unsigned int forgottenSteps;
+} SceneStatistics;
+
+/* Formats de writeSceneStatistics */
+#define STATISTICS_CSV 0 // Une ligne d'en-tête puis une ligne de valeurs
+#define STATISTICS_JSON 1 // Un objet sur une seule ligne
+
+/* Le tas unique de la scène (initialisé à zéro, le premier bloc est créé à la première demande) */
+extern SceneArena sceneArena;
+
+/* La caméra du dessin */
+extern Camera camera;
+
+/* Le trait à main levée en cours */
+extern StrokeFilter stroke;
+
+/* Rendu de drawPrimitives : RENDER_BUFFERS par défaut */
+extern int renderBackend;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Tas de la scène */
+void* arenaAlloc(SceneArena* arena, size_t size);
+void arenaFree(SceneArena* arena, void* chunk, size_t size);
+void arenaReset(SceneArena* arena);
+void freeArena(SceneArena* arena);
+
+/* Points et primitives */
+Point allocPoint(float x, float y, unsigned char r, unsigned char g, unsigned char b);
+void addPointToList(Point point, PointList* list);
+Point getPoint(const PointList* list, unsigned int index);
+void drawPoints(const PointList* list);
+void deletePoints(PointList* list);
+Primitive* allocPrimitive(GLenum primitiveType);
+void addPrimitive(Primitive* primitive, PrimitiveList* list);
+void deletePrimitive(PrimitiveList* list);
+void resetScene(PrimitiveList* list);
+
+/* Dessin de la scène et statistiques (checkVertexBuffers quand la fenêtre est recréée) */
+void checkVertexBuffers();
+void drawPrimitives(PrimitiveList list);
+void drawBoundingBox(const BoundingBox* box);
+int writeSceneStatistics(FILE* file, int format);
+
+/* Caméra sur le canevas infini */
+void applyCamera(int enabled);
+void windowToWorld(int px, int py, float* x, float* y);
+void zoomCamera(float factor, int px, int py);
+void panCamera(int dx, int dy);
+void resetCamera();
+
+/* Sélection, transformations, gomme et aimant */
+int findNearestPoint(PrimitiveList scene, float x, float y, float maxDistance, PointList** foundList, unsigned int* foundIndex);
+Primitive* selectPrimitive(PrimitiveList scene, float x, float y, float maxDistance);
+void transformSelection(PrimitiveList list, Primitive* selection, float a, float b, float c, float d, float tx, float ty);
+int boundingBoxSelection(PrimitiveList list, Primitive* selection, BoundingBox* box);
+void compactPrimitives(PrimitiveList list);
+unsigned int erasePoints(PrimitiveList scene, float x, float y, float radius);
+
+/* Journal d'annulation */
+void journalAddPrimitive(Primitive* primitive);
+void journalAddPoint(PointList* list, int merge);
+int undo(PrimitiveList* scene);
+int redo(PrimitiveList* scene);
+void setJournalLimit(size_t maxBytes);
+
+/* Trait à main levée */
+void beginStroke(PointList* list, Point point, float tolerance);
+void addStrokePoint(Point point);
+void endStroke();
+
+/* Fichiers de scène, archives et export en arrière-plan */
+int writeSceneCSV(PrimitiveList scene, const char* path);
+int saveSceneFile(PrimitiveList scene, const char* path);
+int loadSceneFile(const char* path, PrimitiveList* scene);
+int saveSceneArchive(PrimitiveList scene, const char* path);
+int loadSceneArchive(const char* path, PrimitiveList* scene);
+int convertArchiveToSceneFile(const char* archivePath, const char* scenePath);
+int convertSceneFileToArchive(const char* scenePath, const char* archivePath);
+int startExport(PrimitiveList scene, SceneWriter writer, const char* path);
+void finishExport();
+void collectSnapshots();
+
+/* Sauvegarde automatique */
+int startAutosave(PrimitiveList scene, const char* path);
+void autosaveTick(PrimitiveList scene);
+void finishAutosave();
+unsigned int replayAutosave(const char* path, PrimitiveList* scene);
+
+/* Lecture de points en flux */
+int startIngest(const char* path);
+int drainIngest(PrimitiveList* scene);
+void finishIngest();
+
+/* Anneau de points partagé avec un autre processus */
+int openSharedRing(SharedRing* ring, const char* name, int create);
+void closeSharedRing(SharedRing* ring);
+void drawSharedRing(SharedRing* ring);
+void printSharedRing(const SharedRing* ring);
+int runSharedRingProducer(const char* name);
+
+/* Magasin de points sur disque */
+int buildPointStore(const char* scenePath, const char* storePath);
+int openPointStore(PointStore* store, const char* path, size_t budget);
+void closePointStore(PointStore* store);
+void drawPointStore(PointStore* store);
+void printPointStore(PointStore* store);
+
+/* Générateur de scènes */
+int parseDistribution(const char* name, int* distribution);
+unsigned long long generateScene(PrimitiveList* scene, unsigned int nbPrimitives, unsigned long long nbVertices, int distribution, unsigned long long seed);
+
+#endif
@@ -0,0 +1,249 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "check.h"
+
+
+/************* CONSTANTES **************/
+
+
+/* Dimensions de la fenêtre, que la scène attend du programme */
+unsigned int WINDOW_WIDTH = 400;
+unsigned int WINDOW_HEIGHT = 400;
+
+/* Nombre maximal de fichiers temporaires d'un programme de vérification */
+#define CHECK_MAX_PATHS 16
+
+
+/************* VARIABLES ***************/
+
+
+/* Nombre de vérifications ratées */
+static unsigned int nbFailures = 0;
+
+/* Fichiers temporaires demandés, effacés à la fin */
+static char tempPaths[CHECK_MAX_PATHS][64];
+static unsigned int nbTempPaths = 0;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Compte et affiche une vérification ratée */
+void check(int condition, const char* text, const char* file, int line) {
+
+    if(!condition) {
+        printf("Echec %s:%d : %s\n", file, line, text);
+        nbFailures++;
+    }
+
+    return;
+}
+
+/* Efface les fichiers temporaires et donne le résultat du programme (à renvoyer par main) */
+int finishChecks(const char* name) {
+    unsigned int i;
+
+    for(i = 0 ; i < nbTempPaths ; i++) {
+        remove(tempPaths[i]);
+    }
+    if(nbFailures > 0) {
+        printf("%s : %u vérifications ratées\n", name, nbFailures);
+        return EXIT_FAILURE;
+    }
+    printf("%s : toutes les vérifications sont passées\n", name);
+
+    return EXIT_SUCCESS;
+}
+
+/* Chemin d'un fichier temporaire propre au processus, terminé par suffix */
+const char* tempPath(const char* suffix) {
+
+    if(nbTempPaths == CHECK_MAX_PATHS) {
+        printf("Error at temporary path\n");
+        exit(1);
+    }
+    snprintf(tempPaths[nbTempPaths], sizeof(tempPaths[0]), "/tmp/check_%d_%s", (int)getpid(), suffix);
+
+    return tempPaths[nbTempPaths++];
+}
+
+/* Copie la scène (malloc, à libérer avec freeSceneCopy) */
+void copyScene(PrimitiveList scene, SceneCopy* copy) {
+    unsigned int i;
+
+    memset(copy, 0, sizeof(SceneCopy));
+    for( ; scene && copy->nbPrimitives < COPY_MAX_PRIMITIVES ; scene = scene->next) {
+        unsigned int k = copy->nbPrimitives++;
+        copy->types[k] = scene->primitiveType;
+        copy->nbPoints[k] = scene->points.nbPoints;
+        copy->points[k] = (Point*)malloc((scene->points.nbPoints + 1) * sizeof(Point));
+        if(!copy->points[k]) {
+            printf("Error at scene copy malloc\n");
+            exit(1);
+        }
+        for(i = 0 ; i < scene->points.nbPoints ; i++) {
+            copy->points[k][i] = getPoint(&scene->points, i);
+        }
+    }
+
+    return;
+}
+
+void freeSceneCopy(SceneCopy* copy) {
+    unsigned int k;
+
+    for(k = 0 ; k < copy->nbPrimitives ; k++) {
+        free(copy->points[k]);
+    }
+    memset(copy, 0, sizeof(SceneCopy));
+
+    return;
+}
+
+/* 1 si la primitive a les mêmes points que ceux de la copie (positions à tolerance près, couleurs exactes) */
+int samePoints(const Primitive* primitive, const SceneCopy* copy, unsigned int k, float tolerance) {
+    unsigned int i;
+
+    if(primitive->primitiveType != copy->types[k] || primitive->points.nbPoints != copy->nbPoints[k]) {
+        return 0;
+    }
+    for(i = 0 ; i < copy->nbPoints[k] ; i++) {
+        Point point = getPoint(&primitive->points, i);
+        const Point* expected = copy->points[k] + i;
+        if(fabsf(point.x - expected->x) > tolerance || fabsf(point.y - expected->y) > tolerance
+            || point.r != expected->r || point.g != expected->g || point.b != expected->b) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* 1 si la scène est celle de la copie, primitive par primitive */
+int sameScene(PrimitiveList scene, const SceneCopy* copy, float tolerance) {
+    unsigned int k;
+
+    for(k = 0 ; k < copy->nbPrimitives ; k++, scene = scene->next) {
+        if(!scene || !samePoints(scene, copy, k, tolerance)) {
+            return 0;
+        }
+    }
+
+    return scene == NULL;
+}
+
+unsigned int countPrimitives(PrimitiveList scene) {
+    unsigned int count = 0;
+
+    for( ; scene ; scene = scene->next) {
+        count++;
+    }
+
+    return count;
+}
+
+/* Scène de test : de la queue à la tête, une primitive de points vide (celle du lancement), des points aux couleurs de la palette, */
+/* une ligne brisée rouge et des triangles hors palette */
+void buildScene(PrimitiveList* scene) {
+    unsigned int i;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    for(i = 0 ; i < 200 ; i++) {
+        unsigned int color = i % NB_COLORS;
+        addPointToList(allocPoint(cosf(i * 0.1) * 0.9, sinf(i * 0.13) * 0.7, COLORS[color * 3], COLORS[color * 3 + 1], COLORS[color * 3 + 2]), &(*scene)->points);
+    }
+    addPrimitive(allocPrimitive(GL_LINE_STRIP), scene);
+    for(i = 0 ; i < 50 ; i++) {
+        addPointToList(allocPoint(-1 + i * 0.04, (i % 2) * 0.25, 255, 0, 0), &(*scene)->points);
+    }
+    addPrimitive(allocPrimitive(GL_TRIANGLES), scene);
+    for(i = 0 ; i < 30 ; i++) {
+        addPointToList(allocPoint(i * 0.01, i * -0.02, 10 + i, 20, 30), &(*scene)->points);
+    }
+
+    return;
+}
+
+/* Écrit text dans path : renvoie 0 en cas d'erreur */
+int writeText(const char* path, const char* text) {
+    FILE* file = fopen(path, "w");
+    int ok;
+
+    if(!file) {
+        return 0;
+    }
+    ok = fputs(text, file) >= 0;
+
+    return fclose(file) == 0 && ok;
+}
+
+/* Copie le fichier source dans destination : renvoie 0 en cas d'erreur */
+int copyFile(const char* source, const char* destination) {
+    FILE* input = fopen(source, "rb");
+    FILE* output;
+    char buffer[4096];
+    size_t size;
+    int ok = 1;
+
+    if(!input) {
+        return 0;
+    }
+    output = fopen(destination, "wb");
+    if(!output) {
+        fclose(input);
+        return 0;
+    }
+    while((size = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        if(fwrite(buffer, 1, size, output) != size) {
+            ok = 0;
+            break;
+        }
+    }
+    fclose(input);
+
+    return fclose(output) == 0 && ok;
+}
+
+/* Verse dans la scène tout le fichier lu en flux : renvoie 0 s'il ne peut pas être ouvert */
+int ingestFile(const char* path, PrimitiveList* scene) {
+
+    if(!startIngest(path)) {
+        return 0;
+    }
+    while(drainIngest(scene)) {
+        SDL_Delay(1);
+    }
+
+    return 1;
+}
+
+/* Attend que le fil de sauvegarde automatique ait tout écrit : la taille du journal ne bouge plus pendant plusieurs de ses tours */
+int waitAutosave(const char* path) {
+    struct stat info;
+    off_t size = -1;
+    unsigned int stable = 0, tries;
+
+    for(tries = 0 ; tries < 100 && stable < 4 ; tries++) {
+        SDL_Delay(100);
+        if(stat(path, &info) != 0 || info.st_size == 0) {
+            stable = 0;
+            continue;
+        }
+        stable = info.st_size == size ? stable + 1 : 0;
+        size = info.st_size;
+    }
+
+    return stable >= 4;
+}
@@ -0,0 +1,85 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+/* Outils communs aux programmes de vérification de make check : chacun vérifie une partie de la scène sans fenêtre ni contexte OpenGL, */
+/* affiche chaque vérification ratée et échoue s'il y en a une */
+
+#include "scene.h"
+
+
+/************* CONSTANTES **************/
+
+
+/* Nombre maximal de primitives copiées pour comparer deux scènes */
+#define COPY_MAX_PRIMITIVES 16
+
+/* Compte la vérification ratée et affiche sa ligne */
+#define CHECK(condition) check((condition) != 0, #condition, __FILE__, __LINE__)
+
+
+/*************** TYPES *****************/
+
+
+/* Copie d'une scène (de la tête à la queue), indépendante du tas */
+typedef struct SceneCopy{
+    unsigned int nbPrimitives;
+    GLenum types[COPY_MAX_PRIMITIVES];
+    unsigned int nbPoints[COPY_MAX_PRIMITIVES];
+    Point* points[COPY_MAX_PRIMITIVES];
+} SceneCopy;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Vérifications */
+void check(int condition, const char* text, const char* file, int line);
+int finishChecks(const char* name);
+
+/* Fichiers temporaires (effacés par finishChecks) */
+const char* tempPath(const char* suffix);
+
+/* Copies et comparaisons de scènes */
+void copyScene(PrimitiveList scene, SceneCopy* copy);
+void freeSceneCopy(SceneCopy* copy);
+int samePoints(const Primitive* primitive, const SceneCopy* copy, unsigned int k, float tolerance);
+int sameScene(PrimitiveList scene, const SceneCopy* copy, float tolerance);
+unsigned int countPrimitives(PrimitiveList scene);
+void buildScene(PrimitiveList* scene);
+
+/* Fonctions internes de la scène (scene.c) vérifiées directement */
+SceneStatistics getSceneStatistics(void);
+void recolorPoints(PointList* list, unsigned int first, unsigned int count, unsigned char r, unsigned char g, unsigned char b);
+void transformPoints(PointList* list, unsigned int first, unsigned int count, float a, float b, float c, float d, float tx, float ty);
+void touchPoints(PointList* list, unsigned int first, unsigned int end);
+void reserveVertexRange(PointList* list, GLenum primitiveType);
+void releaseVertexRange(PointList* list);
+void updateLodPyramid(PrimitiveList list);
+int chooseLodLevel(float pixelSize);
+float lodBaseSpacing();
+LodTile* findLodTile(const PointList* list, int level, int tileX, int tileY, int create);
+int isPrimitiveDecimated(const Primitive* primitive, float tolerance);
+float segmentDistance(Point p, Point a, Point b);
+void computeSignificance(PointList* list);
+SceneSnapshot* takeSnapshot(PrimitiveList scene);
+void releaseSnapshot(SceneSnapshot* snapshot);
+int writeSharedRing(SharedRing* ring, const float* positions, const unsigned char* colors, unsigned int count);
+unsigned int sharedRingWindow(const SharedRing* ring, unsigned long long* head, unsigned long long* tail);
+void releaseSharedRing(SharedRing* ring, unsigned long long head, unsigned long long tail);
+unsigned int assignDrawBatches(VertexBuffers* buffers, unsigned int nbPrimitives, const BoundingBox* view, float margin);
+unsigned int mortonIndex(unsigned int x, unsigned int y);
+unsigned int storeCell(float value, float minimum, float maximum, unsigned int gridSize);
+int storeCells(const PointStore* store, const BoundingBox* box, unsigned int* cells);
+void requestStoreChunks(PointStore* store, const BoundingBox* box, const unsigned int* cells, const unsigned int* skip, double fraction, int visible);
+
+/* Fonctions internes de la file de rendu (render.c) vérifiées directement */
+unsigned long long renderKey(unsigned int layer, GLuint texture, GLenum type, int r, int g, int b, unsigned int order);
+void sortRenderQueue();
+
+/* Fichiers */
+int writeText(const char* path, const char* text);
+int copyFile(const char* source, const char* destination);
+int ingestFile(const char* path, PrimitiveList* scene);
+int waitAutosave(const char* path);
+
+#endif
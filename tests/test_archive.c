@@ -0,0 +1,159 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "check.h"
+
+/* Archive compressée : aller-retour au pas de quantification près, bien plus petite que le fichier de scène, conversions en flux */
+
+
+/************* VARIABLES ***************/
+
+
+/* Fichiers temporaires des tests */
+static const char* scenePath;
+static const char* archivePath;
+static const char* damagedPath;
+
+
+/************** FONCTIONS ***************/
+
+
+long fileSize(const char* path) {
+    struct stat info;
+
+    return stat(path, &info) == 0 ? (long)info.st_size : -1;
+}
+
+/* Longue ligne brisée dont les points se suivent de près, aux couleurs de la palette par longues séries, comme un tracé */
+void buildDrawing(PrimitiveList* scene, unsigned int nbPoints) {
+    unsigned int i;
+    float x = 0, y = 0;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_LINE_STRIP), scene);
+    for(i = 0 ; i < nbPoints ; i++) {
+        unsigned int color = i / 1000 % NB_COLORS;
+        x += 0.0005 * cosf(i * 0.01);
+        y += 0.0005 * sinf(i * 0.013);
+        x = x > 1 ? 1 : (x < -1 ? -1 : x);
+        y = y > 1 ? 1 : (y < -1 ? -1 : y);
+        addPointToList(allocPoint(x, y, COLORS[color * 3], COLORS[color * 3 + 1], COLORS[color * 3 + 2]), &(*scene)->points);
+    }
+
+    return;
+}
+
+/* Archive : aller-retour au pas de quantification près, y compris pour une scène vide */
+void testArchive(PrimitiveList* scene) {
+    SceneCopy copy;
+
+    buildScene(scene);
+    copyScene(*scene, &copy);
+    CHECK(saveSceneArchive(*scene, archivePath));
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    CHECK(loadSceneArchive(archivePath, scene));
+    CHECK(sameScene(*scene, &copy, 2.0 / 65535));
+
+    CHECK(convertArchiveToSceneFile(archivePath, scenePath));
+    CHECK(loadSceneFile(scenePath, scene));
+    CHECK(sameScene(*scene, &copy, 2.0 / 65535));
+    freeSceneCopy(&copy);
+
+    /* Un fichier invalide laisse la scène en place */
+    CHECK(writeText(damagedPath, "pas une scene"));
+    CHECK(!loadSceneArchive(damagedPath, scene));
+    CHECK(countPrimitives(*scene) == 4);
+
+    /* Scène vide : une primitive de points sans point */
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    CHECK(saveSceneArchive(*scene, archivePath));
+    buildScene(scene);
+    CHECK(loadSceneArchive(archivePath, scene));
+    CHECK(countPrimitives(*scene) == 1 && (*scene)->points.nbPoints == 0);
+
+    return;
+}
+
+/* Un tracé de points voisins aux couleurs de la palette prend moins de la moitié de sa place dans le fichier de scène (deux octets par coordonnée au plus) */
+void testCompression(PrimitiveList* scene) {
+    SceneCopy copy;
+
+    buildDrawing(scene, 200000);
+    copyScene(*scene, &copy);
+    CHECK(saveSceneFile(*scene, scenePath));
+    CHECK(saveSceneArchive(*scene, archivePath));
+    CHECK(fileSize(archivePath) > 0 && fileSize(archivePath) * 2 < fileSize(scenePath));
+    CHECK(loadSceneArchive(archivePath, scene));
+    CHECK(sameScene(*scene, &copy, 2.0 / 65535));
+    freeSceneCopy(&copy);
+
+    return;
+}
+
+/* Les conversions passent par morceaux de plusieurs tableaux de points sans charger la scène : celle en mémoire ne bouge pas */
+void testConversions(PrimitiveList* scene) {
+    SceneCopy drawing, current;
+
+    buildDrawing(scene, 100000);
+    copyScene(*scene, &drawing);
+    CHECK(saveSceneFile(*scene, scenePath));
+    buildScene(scene);
+    copyScene(*scene, &current);
+
+    CHECK(convertSceneFileToArchive(scenePath, archivePath));
+    CHECK(remove(scenePath) == 0);
+    CHECK(convertArchiveToSceneFile(archivePath, scenePath));
+    CHECK(sameScene(*scene, &current, 0));
+
+    CHECK(loadSceneFile(scenePath, scene));
+    CHECK(sameScene(*scene, &drawing, 2.0 / 65535));
+    CHECK(!convertSceneFileToArchive("/nonexistent/scene.bin", archivePath));
+    freeSceneCopy(&drawing);
+    freeSceneCopy(&current);
+
+    return;
+}
+
+/* Une archive tronquée n'est découverte qu'en la décodant : elle est refusée et la scène reste en place */
+void testTruncatedArchive(PrimitiveList* scene) {
+
+    buildDrawing(scene, 50000);
+    CHECK(saveSceneArchive(*scene, archivePath));
+    CHECK(copyFile(archivePath, damagedPath) && truncate(damagedPath, fileSize(archivePath) / 2) == 0);
+    buildScene(scene);
+    CHECK(!loadSceneArchive(damagedPath, scene));
+    CHECK(countPrimitives(*scene) == 4 && (*scene)->next->next->points.nbPoints == 200);
+    CHECK(!convertArchiveToSceneFile(damagedPath, scenePath));
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    scenePath = tempPath("scene.bin");
+    archivePath = tempPath("scene.sca");
+    damagedPath = tempPath("damaged.sca");
+
+    testArchive(&scene);
+    testCompression(&scene);
+    testConversions(&scene);
+    testTruncatedArchive(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("archive");
+}
@@ -0,0 +1,83 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "check.h"
+
+/* Tas de la scène : découpe en blocs, free lists par classe de taille, gros morceaux et reset */
+
+
+/************** FONCTIONS ***************/
+
+
+/* Tas : découpe alignée, réutilisation des morceaux rendus, gros morceaux rendus au système, reset et libération */
+void testArena() {
+    SceneArena arena;
+    unsigned char* first;
+    unsigned char* second;
+    unsigned char* large;
+    size_t reserved;
+
+    memset(&arena, 0, sizeof(SceneArena));
+    first = (unsigned char*)arenaAlloc(&arena, 24);
+    second = (unsigned char*)arenaAlloc(&arena, 24);
+    CHECK(first && second && first != second);
+    CHECK(((size_t)first & 15) == 0 && ((size_t)second & 15) == 0);
+    CHECK(arena.bytesUsed == 64);
+    memset(first, 0xAB, 24);
+    memset(second, 0xCD, 24);
+    CHECK(first[23] == 0xAB && second[0] == 0xCD);
+
+    arenaFree(&arena, first, 24);
+    CHECK(arena.bytesUsed == 32);
+    CHECK(arenaAlloc(&arena, 20) == first);
+
+    reserved = arena.bytesReserved;
+    large = (unsigned char*)arenaAlloc(&arena, 3 << 20);
+    CHECK(large && arena.bytesReserved == reserved + (3 << 20));
+    memset(large, 1, 3 << 20);
+    arenaFree(&arena, large, 3 << 20);
+    CHECK(arena.bytesReserved == reserved && arena.large == NULL);
+
+    arenaReset(&arena);
+    CHECK(arena.bytesUsed == 0 && arena.bytesReserved == reserved);
+    CHECK(arenaAlloc(&arena, 24) == first);
+
+    freeArena(&arena);
+    CHECK(arena.first == NULL && arena.bytesReserved == 0);
+
+    return;
+}
+
+/* Tas de la scène : resetScene rend tout d'un coup, et la scène suivante réutilise les mêmes blocs */
+void testSceneArena(PrimitiveList* scene) {
+    size_t reserved;
+
+    buildScene(scene);
+    reserved = sceneArena.bytesReserved;
+    CHECK(sceneArena.bytesUsed > 0 && reserved > 0);
+    resetScene(scene);
+    CHECK(*scene == NULL && sceneArena.bytesUsed == 0 && sceneArena.bytesReserved == reserved);
+    buildScene(scene);
+    CHECK(sceneArena.bytesReserved == reserved);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testArena();
+    testSceneArena(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("tas");
+}
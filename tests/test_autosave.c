@@ -0,0 +1,151 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "check.h"
+
+/* Sauvegarde automatique : le journal laissé par un arrêt brutal redonne la scène, même après des compactages ratés */
+
+
+/************* VARIABLES ***************/
+
+
+/* Fichiers temporaires des tests */
+static const char* autosavePath;
+static const char* copyPath;
+static const char* directoryPath;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Scène de départ : dix points bleus */
+void buildPoints(PrimitiveList* scene) {
+    unsigned int i;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    for(i = 0 ; i < 10 ; i++) {
+        addPointToList(allocPoint(i * 0.05, 0.1, 0, 0, 255), &(*scene)->points);
+    }
+
+    return;
+}
+
+/* Modifications qui vont dans le journal : une ligne, une transformation et un point effacé */
+void editScene(PrimitiveList* scene) {
+    unsigned int i;
+
+    addPrimitive(allocPrimitive(GL_LINE_STRIP), scene);
+    journalAddPrimitive(*scene);
+    for(i = 0 ; i < 5 ; i++) {
+        addPointToList(allocPoint(-0.6, i * 0.1, 255, 255, 0), &(*scene)->points);
+        journalAddPoint(&(*scene)->points, 0);
+    }
+    transformSelection(*scene, *scene, 1, 0, 0, 1, 0.5, 0);
+    CHECK(erasePoints(*scene, 0.2, 0.1, 0.01) == 1);
+
+    return;
+}
+
+/* Le journal laissé par un arrêt brutal redonne la scène */
+void testAutosave(PrimitiveList* scene) {
+    SceneCopy copy;
+
+    buildPoints(scene);
+    remove(autosavePath);
+    CHECK(startAutosave(*scene, autosavePath));
+    CHECK(waitAutosave(autosavePath));
+
+    /* Des modifications après le premier compactage, qui vont dans le journal */
+    editScene(scene);
+    copyScene(*scene, &copy);
+    CHECK(waitAutosave(autosavePath));
+
+    /* L'arrêt normal efface le journal : la copie tient lieu de celui d'un arrêt brutal */
+    CHECK(copyFile(autosavePath, copyPath));
+    finishAutosave();
+    CHECK(access(autosavePath, F_OK) != 0);
+
+    CHECK(replayAutosave(copyPath, scene) > 0);
+    CHECK(sameScene(*scene, &copy, 1e-6));
+    freeSceneCopy(&copy);
+
+    /* Journal absent ou invalide : rien n'est rejoué */
+    CHECK(replayAutosave(autosavePath, scene) == 0);
+    CHECK(writeText(copyPath, "IMACLOG"));
+    CHECK(replayAutosave(copyPath, scene) == 0);
+
+    return;
+}
+
+/* Répertoire du journal absent au lancement : les compactages ratent, les modifications restent en attente, */
+/* et le compactage redemandé une fois le répertoire créé écrit un journal qui redonne toute la scène */
+void testFailedCompaction(PrimitiveList* scene) {
+    char path[128];
+    SceneCopy copy;
+    unsigned int i;
+
+    snprintf(path, sizeof(path), "%s/autosave.log", directoryPath);
+    rmdir(directoryPath);
+    buildPoints(scene);
+    CHECK(startAutosave(*scene, path));
+    editScene(scene);
+    for(i = 0 ; i < 10 ; i++) {
+        autosaveTick(*scene);
+        SDL_Delay(50);
+    }
+    CHECK(access(path, F_OK) != 0);
+
+    /* Encore des modifications pendant que personne n'écrit, puis le répertoire apparaît */
+    CHECK(erasePoints(*scene, 0.3, 0.1, 0.01) == 1);
+    copyScene(*scene, &copy);
+    CHECK(mkdir(directoryPath, 0700) == 0);
+    for(i = 0 ; i < 100 && access(path, F_OK) != 0 ; i++) {
+        autosaveTick(*scene);
+        SDL_Delay(50);
+    }
+    CHECK(waitAutosave(path));
+
+    /* Les modifications qui suivent le compactage réussi vont de nouveau dans le journal */
+    CHECK(erasePoints(*scene, 0.35, 0.1, 0.01) == 1);
+    freeSceneCopy(&copy);
+    copyScene(*scene, &copy);
+    for(i = 0 ; i < 10 ; i++) {
+        autosaveTick(*scene);
+        SDL_Delay(50);
+    }
+    CHECK(waitAutosave(path));
+
+    CHECK(copyFile(path, copyPath));
+    finishAutosave();
+    CHECK(replayAutosave(copyPath, scene) > 0);
+    CHECK(sameScene(*scene, &copy, 1e-6));
+    freeSceneCopy(&copy);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    directoryPath = tempPath("dir");
+    autosavePath = tempPath("autosave.log");
+    copyPath = tempPath("copy");
+
+    testAutosave(&scene);
+    testFailedCompaction(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("sauvegarde automatique");
+}
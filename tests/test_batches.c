@@ -0,0 +1,237 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "check.h"
+
+/* Regroupement des primitives en lots : deux primitives qui se touchent restent dans l'ordre de la liste, */
+/* et celles qui ne se touchent pas se réunissent en un lot par type */
+
+
+/************* CONSTANTES **************/
+
+
+/* Vue des tests : une case de la grille des lots par unité */
+static const BoundingBox VIEW = {0, 0, BATCH_GRID, BATCH_GRID};
+
+/* Primitives de la scène aléatoire */
+#define RANDOM_PRIMITIVES 2000
+
+
+/************* VARIABLES ***************/
+
+
+/* Générateur pseudo-aléatoire des boîtes (toujours la même suite) */
+static unsigned int seed = 4321;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Nombre pseudo-aléatoire dans [min, max] */
+float randomFloat(float min, float max) {
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (seed >> 8) / (float)(1 << 24);
+}
+
+/* Ajoute en tête de la scène (elle sera dessinée avant les autres) une primitive de deux points aux coins de la boîte (minX, minY) - (maxX, maxY) */
+void addBox(PrimitiveList* scene, GLenum primitiveType, float minX, float minY, float maxX, float maxY) {
+
+    addPrimitive(allocPrimitive(primitiveType), scene);
+    addPointToList(allocPoint(minX, minY, 255, 255, 255), &(*scene)->points);
+    addPointToList(allocPoint(maxX, maxY, 255, 255, 255), &(*scene)->points);
+
+    return;
+}
+
+/* Tableaux du regroupement pour nbPrimitives primitives */
+void allocDrawList(VertexBuffers* buffers, unsigned int nbPrimitives) {
+
+    memset(buffers, 0, sizeof(VertexBuffers));
+    buffers->drawList = (Primitive**)malloc(nbPrimitives * sizeof(Primitive*));
+    buffers->drawBatch = (unsigned int*)malloc(nbPrimitives * sizeof(unsigned int));
+    buffers->firsts = (GLint*)malloc(nbPrimitives * sizeof(GLint));
+    buffers->counts = (GLsizei*)malloc(nbPrimitives * sizeof(GLsizei));
+    buffers->batches = (DrawBatch*)malloc(nbPrimitives * sizeof(DrawBatch));
+    if(!buffers->drawList || !buffers->drawBatch || !buffers->firsts || !buffers->counts || !buffers->batches) {
+        printf("Error at draw list malloc\n");
+        exit(1);
+    }
+    buffers->drawCapacity = nbPrimitives;
+
+    return;
+}
+
+void freeDrawList(VertexBuffers* buffers) {
+
+    free(buffers->drawList);
+    free(buffers->drawBatch);
+    free(buffers->firsts);
+    free(buffers->counts);
+    free(buffers->batches);
+    memset(buffers, 0, sizeof(VertexBuffers));
+
+    return;
+}
+
+/* Range toutes les primitives de la scène dans drawList, dans l'ordre de la liste, et les regroupe en lots : renvoie le nombre de lots */
+/* Chaque primitive a pour plage son rang dans la liste, pour retrouver l'ordre dans firsts */
+unsigned int batchScene(PrimitiveList scene, VertexBuffers* buffers, float margin) {
+    unsigned int nbPrimitives = 0;
+
+    for( ; scene && nbPrimitives < buffers->drawCapacity ; scene = scene->next) {
+        scene->points.poolFirst = nbPrimitives;
+        buffers->drawList[nbPrimitives++] = scene;
+    }
+
+    return assignDrawBatches(buffers, nbPrimitives, &VIEW, margin);
+}
+
+/* 1 si les lots sont bien formés : chaque lot n'a que des primitives de son type, chaque primitive y est une fois, */
+/* à sa place dans l'ordre de la liste, avec son nombre de sommets */
+int validBatches(const VertexBuffers* buffers, unsigned int nbPrimitives, unsigned int nbBatches) {
+    unsigned int i, k, total = 0;
+
+    for(i = 0 ; i < nbBatches ; i++) {
+        const DrawBatch* batch = buffers->batches + i;
+        if(batch->first != total || batch->count == 0) {
+            return 0;
+        }
+        for(k = batch->first ; k < batch->first + batch->count ; k++) {
+            const Primitive* primitive = buffers->drawList[buffers->firsts[k]];
+            if(primitive->primitiveType != batch->type || buffers->drawBatch[buffers->firsts[k]] != i
+                || buffers->counts[k] != (GLsizei)primitive->points.nbPoints || (k > batch->first && buffers->firsts[k] <= buffers->firsts[k - 1])) {
+                return 0;
+            }
+        }
+        total += batch->count;
+    }
+
+    return total == nbPrimitives;
+}
+
+/* Primitives qui ne se touchent pas : un lot par type, quel que soit l'ordre des types dans la liste */
+void testDisjoint(PrimitiveList* scene, VertexBuffers* buffers) {
+    static const GLenum TYPES[] = {GL_POINTS, GL_LINES, GL_TRIANGLES};
+    unsigned int i, nbBatches;
+
+    resetScene(scene);
+    for(i = 0 ; i < 40 ; i++) {
+        float x = 3 * (i % 20) + 1, y = 3 * (i / 20) + 1;
+        addBox(scene, TYPES[i % 3], x, y, x + 1, y + 1);
+    }
+    nbBatches = batchScene(*scene, buffers, 0.1);
+    CHECK(nbBatches == 3 && validBatches(buffers, 40, nbBatches));
+    CHECK(buffers->batches[0].count + buffers->batches[1].count + buffers->batches[2].count == 40);
+
+    return;
+}
+
+/* Primitives qui se recouvrent : l'ordre de la liste est gardé, seule une primitive ailleurs rejoint le premier lot de son type */
+void testOverlap(PrimitiveList* scene, VertexBuffers* buffers) {
+    unsigned int nbBatches;
+
+    /* Dans l'ordre de la liste (l'inverse des ajouts) : des points, des lignes par-dessus, puis encore des points par-dessus */
+    resetScene(scene);
+    addBox(scene, GL_POINTS, 10, 10, 12, 12);
+    addBox(scene, GL_LINES, 10, 10, 12, 12);
+    addBox(scene, GL_POINTS, 10, 10, 12, 12);
+    nbBatches = batchScene(*scene, buffers, 0.1);
+    CHECK(nbBatches == 3 && validBatches(buffers, 3, nbBatches));
+    CHECK(buffers->batches[0].type == GL_POINTS && buffers->batches[1].type == GL_LINES && buffers->batches[2].type == GL_POINTS);
+
+    /* Les derniers points ailleurs : ils sont dessinés avec les premiers */
+    resetScene(scene);
+    addBox(scene, GL_POINTS, 40, 40, 42, 42);
+    addBox(scene, GL_LINES, 10, 10, 12, 12);
+    addBox(scene, GL_POINTS, 10, 10, 12, 12);
+    nbBatches = batchScene(*scene, buffers, 0.1);
+    CHECK(nbBatches == 2 && validBatches(buffers, 3, nbBatches) && buffers->batches[0].type == GL_POINTS && buffers->batches[0].count == 2);
+
+    /* Des lignes sur toute la largeur de la vue séparent les points qui sont dessous, pas ceux qui sont plus haut */
+    resetScene(scene);
+    addBox(scene, GL_POINTS, 60, 30, 61, 31);
+    addBox(scene, GL_LINES, -100, 30, 100, 30);
+    addBox(scene, GL_POINTS, 5, 30, 6, 31);
+    nbBatches = batchScene(*scene, buffers, 0.1);
+    CHECK(nbBatches == 3 && validBatches(buffers, 3, nbBatches));
+    (*scene)->next->next->points.box.minY = (*scene)->next->next->points.box.maxY = 50;
+    nbBatches = batchScene(*scene, buffers, 0.1);
+    CHECK(nbBatches == 2 && validBatches(buffers, 3, nbBatches));
+
+    return;
+}
+
+/* La marge (deux pixels dans drawPrimitives) : des primitives proches sont traitées comme si elles se touchaient */
+void testMargin(PrimitiveList* scene, VertexBuffers* buffers) {
+    unsigned int nbBatches;
+
+    resetScene(scene);
+    addBox(scene, GL_POINTS, 10.2, 10.2, 10.8, 10.8);
+    addBox(scene, GL_LINES, 13.2, 10.2, 13.8, 10.8);
+    addBox(scene, GL_POINTS, 10.2, 10.2, 10.8, 10.8);
+    nbBatches = batchScene(*scene, buffers, 0.1);
+    CHECK(nbBatches == 2 && validBatches(buffers, 3, nbBatches));
+    nbBatches = batchScene(*scene, buffers, 1.5);
+    CHECK(nbBatches == 3 && validBatches(buffers, 3, nbBatches));
+
+    return;
+}
+
+/* Scène aléatoire : pour chaque paire de primitives qui se touchent (à la marge près), la première est dessinée avant la seconde */
+void testRandom(PrimitiveList* scene, VertexBuffers* buffers) {
+    static const GLenum TYPES[] = {GL_POINTS, GL_LINES, GL_LINE_STRIP, GL_TRIANGLES, GL_QUADS};
+    const float margin = 0.2;
+    unsigned int i, j, nbBatches;
+    int ordered = 1;
+
+    resetScene(scene);
+    for(i = 0 ; i < RANDOM_PRIMITIVES ; i++) {
+        float x = randomFloat(-4, BATCH_GRID + 4), y = randomFloat(-4, BATCH_GRID + 4);
+        float width = randomFloat(0, i % 50 == 0 ? 40 : 3), height = randomFloat(0, 3);
+        addBox(scene, TYPES[(unsigned int)randomFloat(0, 4.99)], x, y, x + width, y + height);
+    }
+    nbBatches = batchScene(*scene, buffers, margin);
+    CHECK(validBatches(buffers, RANDOM_PRIMITIVES, nbBatches));
+    CHECK(nbBatches > 5 && nbBatches < RANDOM_PRIMITIVES / 2);
+
+    for(i = 0 ; i < RANDOM_PRIMITIVES ; i++) {
+        const Primitive* a = buffers->drawList[i];
+        for(j = i + 1 ; j < RANDOM_PRIMITIVES ; j++) {
+            const Primitive* b = buffers->drawList[j];
+            if(a->points.box.maxX + margin < b->points.box.minX - margin || b->points.box.maxX + margin < a->points.box.minX - margin
+                || a->points.box.maxY + margin < b->points.box.minY - margin || b->points.box.maxY + margin < a->points.box.minY - margin) {
+                continue;
+            }
+            /* Même type : même lot (dans l'ordre) ou un lot plus loin ; sinon, un lot plus loin */
+            ordered &= a->primitiveType == b->primitiveType ? buffers->drawBatch[i] <= buffers->drawBatch[j] : buffers->drawBatch[i] < buffers->drawBatch[j];
+        }
+    }
+    CHECK(ordered);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+    VertexBuffers buffers;
+
+    (void)argc;
+    (void)argv;
+    allocDrawList(&buffers, RANDOM_PRIMITIVES);
+
+    testDisjoint(&scene, &buffers);
+    testOverlap(&scene, &buffers);
+    testMargin(&scene, &buffers);
+    testRandom(&scene, &buffers);
+
+    freeDrawList(&buffers);
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("lots de dessin");
+}
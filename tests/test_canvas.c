@@ -0,0 +1,162 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "check.h"
+
+/* Canevas infini : caméra, pyramide de niveaux de détail des points et réduction des autres primitives vues de loin */
+
+
+/************** FONCTIONS ***************/
+
+
+/* Le zoom garde le point sous la souris immobile, le glissement suit la souris, le reset revient au cadre du TD */
+void testCamera() {
+    float x, y, beforeX, beforeY;
+
+    resetCamera();
+    windowToWorld(0, 0, &x, &y);
+    CHECK(x == ORTHO_LEFT && y == ORTHO_TOP);
+    windowToWorld(WINDOW_WIDTH, WINDOW_HEIGHT, &x, &y);
+    CHECK(x == ORTHO_RIGHT && y == ORTHO_BOTTOM);
+
+    windowToWorld(100, 300, &beforeX, &beforeY);
+    zoomCamera(4, 100, 300);
+    windowToWorld(100, 300, &x, &y);
+    CHECK(fabsf(x - beforeX) < 1e-6 && fabsf(y - beforeY) < 1e-6 && camera.zoom == 4);
+    windowToWorld(101, 300, &x, &y);
+    CHECK(fabsf((x - beforeX) - (ORTHO_RIGHT - ORTHO_LEFT) / (4 * WINDOW_WIDTH)) < 1e-6);
+
+    windowToWorld(200, 200, &beforeX, &beforeY);
+    panCamera(50, -20);
+    windowToWorld(250, 180, &x, &y);
+    CHECK(fabsf(x - beforeX) < 1e-6 && fabsf(y - beforeY) < 1e-6);
+
+    resetCamera();
+    CHECK(camera.panX == 0 && camera.panY == 0 && camera.zoom == 1);
+
+    return;
+}
+
+/* Vue de près on dessine tout ; de loin, le niveau choisi a des cases d'au moins un pixel */
+void testLodLevel() {
+    float spacing = lodBaseSpacing();
+    int level;
+
+    CHECK(chooseLodLevel(spacing / 4) == -1);
+    for(level = 0 ; level < 6 ; level++) {
+        float pixelSize = spacing * (1 << level) * 0.9;
+        CHECK(chooseLodLevel(pixelSize) == level);
+    }
+    CHECK(chooseLodLevel(1e9) == LOD_NB_LEVELS - 1);
+
+    return;
+}
+
+/* Chaque primitive GL_POINTS a ses propres représentants : au plus un par case, tous pris parmi ses points */
+void testPyramid(PrimitiveList* scene) {
+    PrimitiveList primitive;
+    unsigned int i, k;
+    int level = 3;
+    float cellSize = lodBaseSpacing() * (1 << level);
+    float tileSize = cellSize * LOD_TILE_CELLS;
+
+    resetScene(scene);
+    for(k = 0 ; k < 2 ; k++) {
+        addPrimitive(allocPrimitive(GL_POINTS), scene);
+        for(i = 0 ; i < 20000 ; i++) {
+            addPointToList(allocPoint(-0.8 + (i % 200) * 0.008, -0.8 + (i / 200) * 0.016, 255 * k, 0, 0), &(*scene)->points);
+        }
+    }
+    updateLodPyramid(*scene);
+
+    for(primitive = *scene ; primitive ; primitive = primitive->next) {
+        const BoundingBox* box = &primitive->points.box;
+        unsigned int nbRepresentatives = 0, nbCells;
+        int tileX, tileY, valid = 1;
+        for(tileX = (int)floor(box->minX / tileSize) ; tileX <= (int)floor(box->maxX / tileSize) ; tileX++) {
+            for(tileY = (int)floor(box->minY / tileSize) ; tileY <= (int)floor(box->maxY / tileSize) ; tileY++) {
+                LodTile* tile = findLodTile(&primitive->points, level, tileX, tileY, 0);
+                for(i = 0 ; tile && i < tile->points.nbPoints ; i++) {
+                    Point point = getPoint(&tile->points, i);
+                    valid &= point.r == getPoint(&primitive->points, 0).r;
+                    valid &= floor(point.x / tileSize) == tileX && floor(point.y / tileSize) == tileY;
+                    nbRepresentatives++;
+                }
+            }
+        }
+        nbCells = (unsigned int)((box->maxX - box->minX) / cellSize + 2) * (unsigned int)((box->maxY - box->minY) / cellSize + 2);
+        CHECK(valid);
+        CHECK(nbRepresentatives > 0 && nbRepresentatives <= nbCells && nbRepresentatives < primitive->points.nbPoints / 4);
+    }
+
+    /* Un point effacé : la pyramide est reconstruite sans lui */
+    CHECK(erasePoints(*scene, -0.8, -0.8, 1e-4) == 2);
+    updateLodPyramid(*scene);
+    for(primitive = *scene ; primitive ; primitive = primitive->next) {
+        LodTile* tile = findLodTile(&primitive->points, 0, (int)floor(-0.8 / (lodBaseSpacing() * LOD_TILE_CELLS)), (int)floor(-0.8 / (lodBaseSpacing() * LOD_TILE_CELLS)), 0);
+        int erased = 0;
+        for(i = 0 ; tile && i < tile->points.nbPoints ; i++) {
+            Point point = getPoint(&tile->points, i);
+            erased |= fabs(point.x + 0.8) < 1e-6 && fabs(point.y + 0.8) < 1e-6;
+        }
+        CHECK(tile && !erased);
+    }
+
+    return;
+}
+
+/* Vues de loin, les lignes, triangles et quadrilatères trop denses, ou une primitive qui tient dans un pixel, passent par la réduction */
+void testDecimation(PrimitiveList* scene) {
+    unsigned int i;
+    float pixel = 0.01;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_TRIANGLES), scene);
+    for(i = 0 ; i < 3000 ; i++) {
+        addPointToList(allocPoint((i / 3) * 1e-4, (i % 3) * 1e-4, 0, 0, 255), &(*scene)->points);
+    }
+    CHECK(isPrimitiveDecimated(*scene, pixel));
+    CHECK(!isPrimitiveDecimated(*scene, 1e-5));
+
+    addPrimitive(allocPrimitive(GL_QUADS), scene);
+    for(i = 0 ; i < 400 ; i++) {
+        addPointToList(allocPoint((i / 4) * 0.02, (i % 4 / 2) * 0.5, 0, 0, 255), &(*scene)->points);
+    }
+    CHECK(!isPrimitiveDecimated(*scene, pixel));
+
+    addPrimitive(allocPrimitive(GL_TRIANGLE_FAN), scene);
+    for(i = 0 ; i < 100 ; i++) {
+        addPointToList(allocPoint(0.5 + cosf(i) * 0.001, 0.5 + sinf(i) * 0.001, 0, 0, 255), &(*scene)->points);
+    }
+    CHECK(isPrimitiveDecimated(*scene, pixel));
+    CHECK(!isPrimitiveDecimated(*scene, 1e-4));
+
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    for(i = 0 ; i < 100 ; i++) {
+        addPointToList(allocPoint(0, 0, 0, 0, 255), &(*scene)->points);
+    }
+    CHECK(!isPrimitiveDecimated(*scene, pixel));
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testCamera();
+    testLodLevel();
+    testPyramid(&scene);
+    testDecimation(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("canevas");
+}
@@ -0,0 +1,109 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include "check.h"
+
+/* Format compact : quantification, et gomme, annulation et couleurs qui ne repassent pas le tableau au format flottant */
+
+
+/************** FONCTIONS ***************/
+
+
+/* Format compact : les points reviennent à un pas de quantification près, et un tableau hors palette reste tel quel */
+void testCompact(PrimitiveList* scene) {
+    SceneCopy copy;
+    Primitive* primitive;
+
+    buildScene(scene);
+    copyScene(*scene, &copy);
+    compactPrimitives(*scene);
+    for(primitive = *scene ; primitive ; primitive = primitive->next) {
+        if(primitive->points.nbPoints == 0) {
+            continue;
+        }
+        CHECK((primitive->points.quantized != NULL) == (primitive->primitiveType != GL_TRIANGLES));
+    }
+    CHECK(sameScene(*scene, &copy, 2.0 / 65535));
+
+    /* Un point ajouté après le passage au format compact */
+    primitive = (*scene)->next->next;
+    addPointToList(allocPoint(0.5, 0.5, COLORS[3], COLORS[4], COLORS[5]), &primitive->points);
+    CHECK(primitive->points.nbPoints == 201);
+    CHECK(getPoint(&primitive->points, 200).x == 0.5f && getPoint(&primitive->points, 199).r == copy.points[2][199].r);
+    freeSceneCopy(&copy);
+
+    return;
+}
+
+/* Gomme sur un tableau compact : les points gardés ne bougent pas d'un bit, l'annulation et la reprise le laissent compact */
+void testCompactErase(PrimitiveList* scene) {
+    SceneCopy compacted, erased;
+    Primitive* points;
+    unsigned int expanded;
+
+    buildScene(scene);
+    compactPrimitives(*scene);
+    copyScene(*scene, &compacted);
+    points = (*scene)->next->next;
+    expanded = getSceneStatistics().expandedLists;
+
+    CHECK(erasePoints(*scene, 0.9, 0, 0.2) > 0);
+    CHECK(points->points.quantized != NULL && points->points.nbPoints < 200);
+    copyScene(*scene, &erased);
+    CHECK(undo(scene));
+    CHECK(points->points.quantized != NULL);
+    CHECK(sameScene(*scene, &compacted, 0));
+    CHECK(redo(scene));
+    CHECK(points->points.quantized != NULL);
+    CHECK(sameScene(*scene, &erased, 0));
+    CHECK(getSceneStatistics().expandedLists == expanded);
+    freeSceneCopy(&compacted);
+    freeSceneCopy(&erased);
+
+    return;
+}
+
+/* Couleur de la palette : seul l'indice change ; couleur hors palette : le tableau repasse au format flottant, et c'est compté */
+void testCompactRecolor(PrimitiveList* scene) {
+    PointList* list;
+    unsigned int expanded;
+    Point point;
+
+    buildScene(scene);
+    compactPrimitives(*scene);
+    list = &(*scene)->next->next->points;
+    expanded = getSceneStatistics().expandedLists;
+
+    recolorPoints(list, 10, 5, COLORS[6], COLORS[7], COLORS[8]);
+    CHECK(list->quantized != NULL && getSceneStatistics().expandedLists == expanded);
+    point = getPoint(list, 12);
+    CHECK(point.r == COLORS[6] && point.g == COLORS[7] && point.b == COLORS[8]);
+    point = getPoint(list, 15);
+    CHECK(point.r == COLORS[(15 % NB_COLORS) * 3] && point.g == COLORS[(15 % NB_COLORS) * 3 + 1]);
+
+    recolorPoints(list, 0, 1, 1, 2, 3);
+    CHECK(list->quantized == NULL && getSceneStatistics().expandedLists == expanded + 1);
+    point = getPoint(list, 0);
+    CHECK(point.r == 1 && point.g == 2 && point.b == 3);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testCompact(&scene);
+    testCompactErase(&scene);
+    testCompactRecolor(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("format compact");
+}
@@ -0,0 +1,136 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "check.h"
+
+/* Générateur de scènes : la même graine redonne la même scène, le nombre de sommets demandé est tenu en formes entières, */
+/* et les lignes brisées restent dans le cadre quelle que soit leur longueur */
+
+
+/************** FONCTIONS ***************/
+
+
+/* Sommets par forme d'une primitive du générateur */
+unsigned int shapeVertices(GLenum primitiveType) {
+
+    switch(primitiveType) {
+        case GL_LINES:
+            return 2;
+        case GL_TRIANGLES:
+            return 3;
+        case GL_QUADS:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+/* Mêmes paramètres, même scène ; une autre graine donne une autre scène. Le total de sommets est celui demandé, en formes entières */
+void testDeterminism(PrimitiveList* scene) {
+    SceneCopy copy;
+    PrimitiveList primitive;
+    unsigned long long generated, total;
+    int distribution, whole;
+
+    for(distribution = GENERATOR_UNIFORM ; distribution <= GENERATOR_GRID ; distribution++) {
+        generated = generateScene(scene, 12, 200000, distribution, 42);
+        CHECK(countPrimitives(*scene) == 12);
+        total = 0;
+        whole = 1;
+        for(primitive = *scene ; primitive ; primitive = primitive->next) {
+            total += primitive->points.nbPoints;
+            whole &= primitive->points.nbPoints > 0 && primitive->points.nbPoints % shapeVertices(primitive->primitiveType) == 0;
+        }
+        CHECK(whole && generated == total && generated + 4 > 200000 && generated < 200000 + 4);
+
+        copyScene(*scene, &copy);
+        CHECK(generateScene(scene, 12, 200000, distribution, 42) == generated);
+        CHECK(sameScene(*scene, &copy, 0));
+        generateScene(scene, 12, 200000, distribution, 43);
+        CHECK(!sameScene(*scene, &copy, 0));
+        freeSceneCopy(&copy);
+    }
+
+    return;
+}
+
+/* Lignes brisées de centaines de milliers de pas : chaque sommet reste dans le cadre, */
+/* et chaque pas (réfléchi sur un bord) reste de la taille d'une forme */
+void testStrips(PrimitiveList* scene) {
+    PrimitiveList primitive;
+    unsigned int nbStrips = 0, i;
+    int distribution, inside = 1, small = 1;
+
+    for(distribution = GENERATOR_UNIFORM ; distribution <= GENERATOR_GRID ; distribution++) {
+        generateScene(scene, 10, 2000000, distribution, 7);
+        for(primitive = *scene ; primitive ; primitive = primitive->next) {
+            Point previous;
+            if(primitive->primitiveType != GL_LINE_STRIP) {
+                continue;
+            }
+            nbStrips++;
+            previous = getPoint(&primitive->points, 0);
+            for(i = 1 ; i < primitive->points.nbPoints ; i++) {
+                Point point = getPoint(&primitive->points, i);
+                inside &= point.x >= ORTHO_LEFT && point.x <= ORTHO_RIGHT && point.y >= ORTHO_BOTTOM && point.y <= ORTHO_TOP;
+                /* Le premier sommet d'un amas peut tomber hors du cadre : le pas qui l'y ramène est plus grand */
+                if(distribution != GENERATOR_CLUSTERS || i > 1) {
+                    small &= fabs(point.x - previous.x) <= (ORTHO_RIGHT - ORTHO_LEFT) / 100 * 1.001 && fabs(point.y - previous.y) <= (ORTHO_TOP - ORTHO_BOTTOM) / 100 * 1.001;
+                }
+                previous = point;
+            }
+        }
+    }
+    CHECK(nbStrips >= 3);
+    CHECK(inside && small);
+
+    return;
+}
+
+/* Distributions : la grille donne des sommets tous différents au centre de leurs cases, les noms inconnus sont refusés */
+void testDistributions(PrimitiveList* scene) {
+    PrimitiveList primitive;
+    unsigned int i, nbPoints = 0;
+    int distribution = -1, centered = 1;
+
+    generateScene(scene, 4, 10000, GENERATOR_GRID, 3);
+    for(primitive = *scene ; primitive ; primitive = primitive->next) {
+        if(primitive->primitiveType != GL_POINTS) {
+            continue;
+        }
+        for(i = 0 ; i < primitive->points.nbPoints ; i++, nbPoints++) {
+            Point point = getPoint(&primitive->points, i);
+            /* 100 cases par côté : les centres sont à 0.01 + 0.02 k */
+            float cellX = (point.x - ORTHO_LEFT) * 50 - 0.5, cellY = (point.y - ORTHO_BOTTOM) * 50 - 0.5;
+            centered &= fabs(cellX - floor(cellX + 0.5)) < 1e-3 && fabs(cellY - floor(cellY + 0.5)) < 1e-3;
+        }
+    }
+    CHECK(nbPoints > 0 && centered);
+
+    CHECK(parseDistribution("uniform", &distribution) && distribution == GENERATOR_UNIFORM);
+    CHECK(parseDistribution("clusters", &distribution) && distribution == GENERATOR_CLUSTERS);
+    CHECK(parseDistribution("grid", &distribution) && distribution == GENERATOR_GRID);
+    CHECK(!parseDistribution("gaussian", &distribution) && distribution == GENERATOR_GRID);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testDeterminism(&scene);
+    testStrips(&scene);
+    testDistributions(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("générateur de scènes");
+}
@@ -0,0 +1,175 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include "check.h"
+
+/* Grille spatiale et gomme : chaque requête est comparée au parcours de tous les points de la scène */
+
+
+/************* VARIABLES ***************/
+
+
+/* Générateur pseudo-aléatoire des positions (toujours la même suite) */
+static unsigned int seed = 12345;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Nombre pseudo-aléatoire dans [min, max] */
+float randomFloat(float min, float max) {
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (seed >> 8) / (float)(1 << 24);
+}
+
+/* Plus petite distance au carré entre (x, y) et un point de la scène, par un parcours de tous les points */
+float nearestDistance(PrimitiveList scene, float x, float y) {
+    float best = -1;
+    unsigned int i;
+
+    for( ; scene ; scene = scene->next) {
+        for(i = 0 ; i < scene->points.nbPoints ; i++) {
+            Point point = getPoint(&scene->points, i);
+            float distance = (point.x - x) * (point.x - x) + (point.y - y) * (point.y - y);
+            if(best < 0 || distance < best) {
+                best = distance;
+            }
+        }
+    }
+
+    return best;
+}
+
+/* Nombre de points de la scène à moins de radius de (x, y), par un parcours de tous les points */
+unsigned int countInside(PrimitiveList scene, float x, float y, float radius) {
+    unsigned int i, count = 0;
+
+    for( ; scene ; scene = scene->next) {
+        for(i = 0 ; i < scene->points.nbPoints ; i++) {
+            Point point = getPoint(&scene->points, i);
+            count += (point.x - x) * (point.x - x) + (point.y - y) * (point.y - y) <= radius * radius;
+        }
+    }
+
+    return count;
+}
+
+/* 1 si la grille retrouve chaque point de la scène à sa place : une entrée oubliée ou mal renumérotée donne un autre point */
+int isGridConsistent(PrimitiveList scene) {
+    PrimitiveList primitive;
+    unsigned int i;
+
+    for(primitive = scene ; primitive ; primitive = primitive->next) {
+        for(i = 0 ; i < primitive->points.nbPoints ; i++) {
+            Point point = getPoint(&primitive->points, i), found;
+            PointList* foundList;
+            unsigned int foundIndex;
+            if(!findNearestPoint(scene, point.x, point.y, 1e-4, &foundList, &foundIndex) || foundIndex >= foundList->nbPoints) {
+                return 0;
+            }
+            found = getPoint(foundList, foundIndex);
+            if(found.x != point.x || found.y != point.y) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* Scène au hasard : des points et des lignes, dont une partie au format compact */
+void buildRandomScene(PrimitiveList* scene) {
+    unsigned int i, k;
+
+    resetScene(scene);
+    for(k = 0 ; k < 6 ; k++) {
+        addPrimitive(allocPrimitive(k % 2 ? GL_LINE_STRIP : GL_POINTS), scene);
+        for(i = 0 ; i < 400 ; i++) {
+            unsigned int color = k < 3 ? i % NB_COLORS : 1;
+            addPointToList(allocPoint(randomFloat(-1, 1), randomFloat(-1, 1), k < 3 ? 10 : COLORS[color * 3], COLORS[color * 3 + 1], COLORS[color * 3 + 2]), &(*scene)->points);
+        }
+    }
+    compactPrimitives(*scene);
+
+    return;
+}
+
+/* Le point le plus proche donné par la grille est à la même distance que celui du parcours complet */
+void testNearest(PrimitiveList* scene) {
+    unsigned int n;
+    int same = 1;
+
+    buildRandomScene(scene);
+    for(n = 0 ; n < 200 ; n++) {
+        float x = randomFloat(-1, 1), y = randomFloat(-1, 1);
+        float expected = nearestDistance(*scene, x, y);
+        PointList* list;
+        unsigned int index;
+        if(expected > 0.1 * 0.1) {
+            same &= !findNearestPoint(*scene, x, y, 0.1, &list, &index);
+            continue;
+        }
+        if(!findNearestPoint(*scene, x, y, 0.1, &list, &index)) {
+            same = 0;
+            continue;
+        }
+        Point point = getPoint(list, index);
+        same &= (point.x - x) * (point.x - x) + (point.y - y) * (point.y - y) == expected;
+    }
+    CHECK(same);
+
+    return;
+}
+
+/* La gomme enlève exactement les points du disque, et la grille suit les points décalés, les annulations et les reprises */
+void testErase(PrimitiveList* scene) {
+    SceneCopy before;
+    unsigned int n, nbErased = 0;
+    int counts = 1;
+
+    buildRandomScene(scene);
+    copyScene(*scene, &before);
+    for(n = 0 ; n < 30 ; n++) {
+        float x = randomFloat(-1, 1), y = randomFloat(-1, 1), radius = randomFloat(0.01, 0.15);
+        unsigned int expected = countInside(*scene, x, y, radius);
+        unsigned int erased = erasePoints(*scene, x, y, radius);
+        counts &= erased == expected;
+        nbErased += erased;
+    }
+    CHECK(counts && nbErased > 0);
+    CHECK(countInside(*scene, 0, 0, 10) == 2400 - nbErased);
+    CHECK(isGridConsistent(*scene));
+
+    for(n = 0 ; n < 15 ; n++) {
+        CHECK(undo(scene));
+    }
+    CHECK(isGridConsistent(*scene));
+    for(n = 0 ; n < 5 ; n++) {
+        CHECK(redo(scene));
+    }
+    CHECK(isGridConsistent(*scene));
+    while(undo(scene));
+    CHECK(sameScene(*scene, &before, 0));
+    CHECK(isGridConsistent(*scene));
+    freeSceneCopy(&before);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testNearest(&scene);
+    testErase(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("grille spatiale");
+}
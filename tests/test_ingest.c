@@ -0,0 +1,129 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include "check.h"
+
+/* Lecture de points en flux : le lecteur CSV, et les lots versés dans la scène qui vont dans le journal de sauvegarde automatique */
+
+
+/************* VARIABLES ***************/
+
+
+/* Fichiers temporaires des tests */
+static const char* textPath;
+static const char* autosavePath;
+static const char* copyPath;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Lecteur CSV : l'export CSV de la scène se relit à l'identique (les primitives reviennent dans l'ordre inverse, sans les vides) */
+void testCsv(PrimitiveList* scene) {
+    SceneCopy copy;
+    Primitive* primitive;
+    unsigned int k;
+
+    buildScene(scene);
+    copyScene(*scene, &copy);
+    CHECK(writeSceneCSV(*scene, textPath));
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    CHECK(ingestFile(textPath, scene));
+    CHECK(countPrimitives(*scene) == 4);
+    for(primitive = *scene, k = 2 ; primitive && primitive->points.nbPoints > 0 ; primitive = primitive->next, k--) {
+        CHECK(samePoints(primitive, &copy, k, 0));
+    }
+    CHECK(primitive && primitive->next == NULL && primitive->points.nbPoints == 0);
+    freeSceneCopy(&copy);
+
+    /* Colonnes dans un autre ordre, séparateur virgule, ligne invalide ignorée et couleur absente (blanc) */
+    CHECK(writeText(textPath, "y,x,r,g,b\n0.5,0.25,1,2,3\nnimporte quoi\n-1,2\n"));
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    CHECK(ingestFile(textPath, scene));
+    CHECK(countPrimitives(*scene) == 2 && (*scene)->primitiveType == GL_LINE_STRIP && (*scene)->points.nbPoints == 2);
+    if((*scene)->points.nbPoints == 2) {
+        Point first = getPoint(&(*scene)->points, 0), second = getPoint(&(*scene)->points, 1);
+        CHECK(first.x == 0.25f && first.y == 0.5f && first.r == 1 && first.g == 2 && first.b == 3);
+        CHECK(second.x == 2 && second.y == -1 && second.r == 255 && second.g == 255 && second.b == 255);
+    }
+
+    return;
+}
+
+/* Un flux lu pendant la sauvegarde automatique : ses lots vont dans le journal sans le compacter (le fichier reste le même, */
+/* un compactage le remplacerait d'un rename), et le journal redonne la scène */
+void testIngestAutosave(PrimitiveList* scene) {
+    struct stat before, after;
+    SceneCopy copy;
+    unsigned int i, k;
+
+    resetScene(scene);
+    for(k = 0 ; k < 3 ; k++) {
+        addPrimitive(allocPrimitive(GL_LINE_STRIP), scene);
+        for(i = 0 ; i < 50000 ; i++) {
+            addPointToList(allocPoint(i * 1e-5 - 0.25, k * 0.1 + (i % 7) * 1e-3, k * 80, i % 256, 255 - k * 80), &(*scene)->points);
+        }
+    }
+    CHECK(writeSceneCSV(*scene, textPath));
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    remove(autosavePath);
+    CHECK(startAutosave(*scene, autosavePath));
+    CHECK(waitAutosave(autosavePath));
+    CHECK(stat(autosavePath, &before) == 0);
+
+    CHECK(startIngest(textPath));
+    while(drainIngest(scene)) {
+        autosaveTick(*scene);
+        SDL_Delay(1);
+    }
+    for(i = 0 ; i < 10 ; i++) {
+        autosaveTick(*scene);
+        SDL_Delay(20);
+    }
+    CHECK(countPrimitives(*scene) == 4 && (*scene)->points.nbPoints == 50000);
+
+    /* Les points versés s'annulent comme les autres, et l'annulation va aussi dans le journal */
+    CHECK(undo(scene));
+    CHECK(countPrimitives(*scene) == 4 && (*scene)->points.nbPoints < 50000);
+    copyScene(*scene, &copy);
+    CHECK(waitAutosave(autosavePath));
+    CHECK(stat(autosavePath, &after) == 0);
+    CHECK(after.st_ino == before.st_ino && after.st_size > 150000 * (off_t)sizeof(Point));
+
+    CHECK(copyFile(autosavePath, copyPath));
+    finishAutosave();
+    CHECK(replayAutosave(copyPath, scene) > 0);
+    CHECK(sameScene(*scene, &copy, 0));
+    freeSceneCopy(&copy);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    textPath = tempPath("text");
+    autosavePath = tempPath("autosave.log");
+    copyPath = tempPath("copy");
+
+    testCsv(&scene);
+    testIngestAutosave(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("lecture en flux");
+}
@@ -0,0 +1,211 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include "check.h"
+
+/* Journal d'annulation : chaque étape se défait et se refait, et au-delà de sa limite les plus anciennes sont fondues avant d'être oubliées */
+
+
+/************** FONCTIONS ***************/
+
+
+/* Journal d'annulation : chaque étape annulée rend la scène d'avant (à l'arrondi près après une transformation), et tout se refait */
+void testUndoRedo(PrimitiveList* scene) {
+    SceneCopy steps[4];
+    unsigned int i;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    copyScene(*scene, steps);
+
+    for(i = 0 ; i < 3 ; i++) {
+        addPointToList(allocPoint(i * 0.1, i * 0.2, 255, 0, 0), &(*scene)->points);
+        journalAddPoint(&(*scene)->points, 0);
+    }
+    copyScene(*scene, steps + 1);
+
+    addPrimitive(allocPrimitive(GL_LINES), scene);
+    journalAddPrimitive(*scene);
+    for(i = 0 ; i < 2 ; i++) {
+        addPointToList(allocPoint(-0.5, i * 0.5, 0, 255, 0), &(*scene)->points);
+        journalAddPoint(&(*scene)->points, 0);
+    }
+    copyScene(*scene, steps + 2);
+
+    transformSelection(*scene, NULL, 2, 0, 0, 2, 0.25, -0.25);
+    copyScene(*scene, steps + 3);
+    CHECK(!sameScene(*scene, steps + 2, 1e-6));
+
+    CHECK(undo(scene));
+    CHECK(sameScene(*scene, steps + 2, 1e-6));
+    CHECK(undo(scene) && undo(scene) && undo(scene));
+    CHECK(sameScene(*scene, steps + 1, 1e-6));
+    for(i = 0 ; i < 3 ; i++) {
+        CHECK(undo(scene));
+    }
+    CHECK(sameScene(*scene, steps, 0));
+    CHECK(!undo(scene));
+
+    while(redo(scene));
+    CHECK(sameScene(*scene, steps + 3, 1e-6));
+
+    /* Une nouvelle étape oublie celles qui étaient annulées */
+    CHECK(undo(scene));
+    addPointToList(allocPoint(0, 0, 0, 0, 255), &(*scene)->points);
+    journalAddPoint(&(*scene)->points, 0);
+    CHECK(!redo(scene));
+
+    for(i = 0 ; i < 4 ; i++) {
+        freeSceneCopy(steps + i);
+    }
+
+    return;
+}
+
+/* Les primitives ajoutées sont retirées de la tête de liste, dans l'ordre inverse de leur ajout, et remises au même endroit */
+void testUndoPrimitives(PrimitiveList* scene) {
+    Primitive* added[3];
+    Primitive* first;
+    unsigned int i;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    first = *scene;
+    for(i = 0 ; i < 3 ; i++) {
+        addPrimitive(allocPrimitive(GL_LINES), scene);
+        journalAddPrimitive(*scene);
+        added[i] = *scene;
+    }
+    for(i = 3 ; i-- > 0 ; ) {
+        CHECK(*scene == added[i] && undo(scene));
+        CHECK(countPrimitives(*scene) == i + 1);
+    }
+    CHECK(*scene == first && !undo(scene));
+    while(redo(scene));
+    CHECK(*scene == added[2] && added[2]->next == added[1] && added[1]->next == added[0] && added[0]->next == first);
+
+    return;
+}
+
+/* Au-delà de la limite, les primitives ajoutées avec leurs clics, leurs coups de gomme et leurs transformations sont fondues, */
+/* comme les transformations successives : rien n'est oublié, les annulations ramènent à la scène de départ et les reprises à la scène finale */
+void testMergeSteps(PrimitiveList* scene) {
+    SceneCopy start, end;
+    SceneStatistics statistics;
+    unsigned int i, k, nbUndos = 0;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    for(i = 0 ; i < 10 ; i++) {
+        addPointToList(allocPoint(i * 0.05, -0.5, 255, 255, 255), &(*scene)->points);
+    }
+    copyScene(*scene, &start);
+    setJournalLimit(20 * sizeof(JournalEntry));
+
+    for(k = 0 ; k < 6 ; k++) {
+        addPrimitive(allocPrimitive(k % 2 ? GL_LINE_STRIP : GL_POINTS), scene);
+        journalAddPrimitive(*scene);
+        for(i = 0 ; i < 40 ; i++) {
+            addPointToList(allocPoint(-0.9 + k * 0.1, i * 0.02, 0, 255, 0), &(*scene)->points);
+            journalAddPoint(&(*scene)->points, 0);
+        }
+        CHECK(erasePoints(*scene, -0.9 + k * 0.1, 0.4, 0.001) == 1);
+        transformSelection(*scene, *scene, 1, 0, 0, 1, 0.01, 0);
+    }
+    copyScene(*scene, &end);
+
+    statistics = getSceneStatistics();
+    CHECK(statistics.mergedSteps > 200 && statistics.forgottenSteps == 0);
+    while(undo(scene)) {
+        nbUndos++;
+    }
+    CHECK(nbUndos <= 20);
+    CHECK(sameScene(*scene, &start, 0));
+    while(redo(scene));
+    CHECK(sameScene(*scene, &end, 1e-6));
+    freeSceneCopy(&start);
+    freeSceneCopy(&end);
+
+    /* Cent transformations de toute la scène n'en font plus que quelques-unes, à l'arrondi près */
+    resetScene(scene);
+    buildScene(scene);
+    copyScene(*scene, &start);
+    for(i = 0 ; i < 100 ; i++) {
+        transformSelection(*scene, NULL, 1.01, 0.01, 0, 0.99, 0.001, -0.001);
+    }
+    copyScene(*scene, &end);
+    statistics = getSceneStatistics();
+    CHECK(statistics.mergedSteps >= 80 && statistics.forgottenSteps == 0);
+    nbUndos = 0;
+    while(undo(scene)) {
+        nbUndos++;
+    }
+    CHECK(nbUndos <= 20);
+    CHECK(sameScene(*scene, &start, 1e-4));
+    while(redo(scene));
+    CHECK(sameScene(*scene, &end, 1e-4));
+
+    setJournalLimit(8 << 20);
+    freeSceneCopy(&start);
+    freeSceneCopy(&end);
+
+    return;
+}
+
+/* Des étapes qui ne se combinent pas (gomme sur deux primitives tour à tour) sont oubliées, et le journal reste sous sa limite ; */
+/* baisser la limite d'un journal plein l'y ramène tout de suite */
+void testForgetSteps(PrimitiveList* scene) {
+    SceneStatistics statistics;
+    size_t heapUsed;
+    unsigned int i, nbUndos = 0, nbPoints;
+
+    resetScene(scene);
+    for(i = 0 ; i < 2 ; i++) {
+        unsigned int k;
+        addPrimitive(allocPrimitive(GL_POINTS), scene);
+        for(k = 0 ; k < 100 ; k++) {
+            addPointToList(allocPoint(k * 0.01, i * 0.5, 0, 0, 255), &(*scene)->points);
+        }
+    }
+    for(i = 0 ; i < 100 ; i++) {
+        CHECK(erasePoints(*scene, (i / 2) * 0.01, (i % 2) * 0.5, 0.001) == 1);
+    }
+    statistics = getSceneStatistics();
+    CHECK(statistics.forgottenSteps == 0);
+
+    heapUsed = sceneArena.bytesUsed;
+    setJournalLimit(10 * (sizeof(JournalEntry) + sizeof(Point) + sizeof(unsigned int)));
+    statistics = getSceneStatistics();
+    CHECK(statistics.forgottenSteps >= 90 && statistics.mergedSteps == 0);
+    CHECK(sceneArena.bytesUsed < heapUsed);
+
+    nbPoints = (*scene)->points.nbPoints + (*scene)->next->points.nbPoints;
+    while(undo(scene)) {
+        nbUndos++;
+    }
+    CHECK(nbUndos <= 10 && nbUndos > 0);
+    CHECK((*scene)->points.nbPoints + (*scene)->next->points.nbPoints == nbPoints + nbUndos);
+    setJournalLimit(8 << 20);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testUndoRedo(&scene);
+    testUndoPrimitives(&scene);
+    testMergeSteps(&scene);
+    testForgetSteps(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("journal d'annulation");
+}
@@ -0,0 +1,161 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "check.h"
+
+/* Simplification des lignes au rendu : les sommets gardés à une tolérance sont ceux de Douglas-Peucker, à moins d'un pixel de la ligne */
+
+
+/************** FONCTIONS ***************/
+
+
+/* Douglas-Peucker récursif de référence : marque dans kept les sommets gardés de ]first, last[ */
+void referenceSimplify(PointList* list, unsigned int first, unsigned int last, float tolerance, char* kept) {
+    Point a = getPoint(list, first), b = getPoint(list, last);
+    unsigned int i, farthest = first + 1;
+    float maxDistance = -1;
+
+    if(last - first < 2) {
+        return;
+    }
+    for(i = first + 1 ; i < last ; i++) {
+        float distance = segmentDistance(getPoint(list, i), a, b);
+        if(distance > maxDistance) {
+            maxDistance = distance;
+            farthest = i;
+        }
+    }
+    if(maxDistance < tolerance) {
+        return;
+    }
+    kept[farthest] = 1;
+    referenceSimplify(list, first, farthest, tolerance, kept);
+    referenceSimplify(list, farthest, last, tolerance, kept);
+
+    return;
+}
+
+/* Plus grand écart d'un sommet sauté au segment qui joint les deux sommets gardés qui l'entourent */
+float simplificationError(PointList* list, float tolerance) {
+    unsigned int i, previous = 0, next;
+    float maxDistance = 0;
+
+    for(next = 1 ; next < list->nbPoints ; next++) {
+        if(list->significance[next] < tolerance) {
+            continue;
+        }
+        for(i = previous + 1 ; i < next ; i++) {
+            float distance = segmentDistance(getPoint(list, i), getPoint(list, previous), getPoint(list, next));
+            if(distance > maxDistance) {
+                maxDistance = distance;
+            }
+        }
+        previous = next;
+    }
+
+    return maxDistance;
+}
+
+/* Courbe dense : bruit de mesure autour d'une sinusoïde, plusieurs sommets par pixel */
+void addCurve(PointList* list, unsigned int first, unsigned int count) {
+    unsigned int i;
+
+    for(i = first ; i < first + count ; i++) {
+        float x = -1 + i * 1e-4;
+        addPointToList(allocPoint(x, 0.5 * sinf(x * 6) + ((i * 7919) % 13) * 1e-4, 0, 128, 255), list);
+    }
+
+    return;
+}
+
+/* Un seul calcul : à chaque tolérance, les sommets gardés sont exactement ceux de Douglas-Peucker, extrémités comprises */
+void testSignificance(PrimitiveList* scene) {
+    PointList* list;
+    float tolerances[3] = {2.0 / 400, 2.0 / 4000, 1e-5};
+    unsigned int i, t, nbKept[3];
+    char* kept;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_LINE_STRIP), scene);
+    list = &(*scene)->points;
+    addCurve(list, 0, 20000);
+    computeSignificance(list);
+    CHECK(list->nbSignificant == 20000);
+    CHECK(list->significance[0] == FLT_MAX && list->significance[19999] == FLT_MAX);
+
+    kept = (char*)malloc(list->nbPoints);
+    if(!kept) {
+        printf("Error at kept malloc\n");
+        exit(1);
+    }
+    for(t = 0 ; t < 3 ; t++) {
+        int same = 1;
+        memset(kept, 0, list->nbPoints);
+        kept[0] = kept[list->nbPoints - 1] = 1;
+        referenceSimplify(list, 0, list->nbPoints - 1, tolerances[t], kept);
+        nbKept[t] = 0;
+        for(i = 0 ; i < list->nbPoints ; i++) {
+            same &= kept[i] == (list->significance[i] >= tolerances[t]);
+            nbKept[t] += kept[i];
+        }
+        CHECK(same);
+        CHECK(simplificationError(list, tolerances[t]) < tolerances[t]);
+    }
+    free(kept);
+
+    /* Un pixel de la fenêtre entière garde une petite partie des sommets ; une tolérance plus fine en garde plus */
+    CHECK(nbKept[0] < 20000 / 20);
+    CHECK(nbKept[0] < nbKept[1] && nbKept[1] < nbKept[2]);
+
+    return;
+}
+
+/* Des points ajoutés après le calcul forment un morceau à part : les deux morceaux restent sous la tolérance */
+/* et le calcul complet n'est refait qu'une fois le tableau doublé */
+void testIncremental(PrimitiveList* scene) {
+    PointList* list;
+    float tolerance = 2.0 / 4000;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_LINE_STRIP), scene);
+    list = &(*scene)->points;
+    addCurve(list, 0, 10000);
+    computeSignificance(list);
+    CHECK(list->nbSignificantBase == 10000);
+
+    addCurve(list, 10000, 3000);
+    CHECK(list->nbSignificant == 10000);
+    computeSignificance(list);
+    CHECK(list->nbSignificant == 13000 && list->nbSignificantBase == 10000);
+    CHECK(list->significance[9999] == FLT_MAX && list->significance[12999] == FLT_MAX);
+    CHECK(simplificationError(list, tolerance) < tolerance);
+
+    addCurve(list, 13000, 7000);
+    computeSignificance(list);
+    CHECK(list->nbSignificant == 20000 && list->nbSignificantBase == 20000);
+    CHECK(list->significance[9999] != FLT_MAX);
+    CHECK(simplificationError(list, tolerance) < tolerance);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testSignificance(&scene);
+    testIncremental(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("simplification des lignes");
+}
@@ -0,0 +1,187 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "check.h"
+
+/* File de rendu : ordre des champs de la clé (couche, texture, type, couleur, rang), et tri par base qui range les paquets */
+/* par clé en gardant l'ordre de dépôt des paquets de même état */
+
+
+/************* CONSTANTES **************/
+
+
+/* Paquets de la file triée : au-delà de RENDER_ORDER_MASK, le rang sature et seule la stabilité du tri garde l'ordre */
+#define NB_PACKETS 70000
+
+
+/************* VARIABLES ***************/
+
+
+/* Générateur pseudo-aléatoire des états (toujours la même suite) */
+static unsigned int seed = 777;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Nombre pseudo-aléatoire dans [0, count[ */
+unsigned int randomIndex(unsigned int count) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) % count;
+}
+
+/* Tableaux de la file pour nbPackets paquets */
+void allocQueue(unsigned int nbPackets) {
+
+    memset(&renderQueue, 0, sizeof(RenderQueue));
+    renderQueue.packets = (RenderPacket*)malloc(nbPackets * sizeof(RenderPacket));
+    renderQueue.sorted = (RenderPacket*)malloc(nbPackets * sizeof(RenderPacket));
+    if(!renderQueue.packets || !renderQueue.sorted) {
+        printf("Error at render queue malloc\n");
+        exit(1);
+    }
+    renderQueue.packetsCapacity = nbPackets;
+
+    return;
+}
+
+void freeQueue() {
+
+    free(renderQueue.packets);
+    free(renderQueue.sorted);
+    memset(&renderQueue, 0, sizeof(RenderQueue));
+
+    return;
+}
+
+/* Dépose un paquet sans sommets comme le fait queueTexturedVertices : first garde son rang de dépôt */
+void pushPacket(unsigned int layer, GLuint texture, GLenum type, int r, int g, int b) {
+    RenderPacket* packet = renderQueue.packets + renderQueue.nbPackets;
+
+    packet->key = renderKey(layer, texture, type, r, g, b, renderQueue.nbPackets);
+    packet->texture = texture;
+    packet->first = renderQueue.nbPackets++;
+    packet->count = 0;
+
+    return;
+}
+
+/* 1 si les paquets triés ont des clés croissantes, si chacun y est une fois, et si deux paquets de même couche et de même état */
+/* restent dans l'ordre de leur dépôt */
+int sortedQueue() {
+    unsigned char* seen = (unsigned char*)calloc(renderQueue.nbPackets, 1);
+    unsigned int i;
+    int sorted = 1;
+
+    if(!seen) {
+        printf("Error at seen calloc\n");
+        exit(1);
+    }
+    for(i = 0 ; i < renderQueue.nbPackets ; i++) {
+        const RenderPacket* packet = renderQueue.packets + i;
+        sorted &= packet->first < renderQueue.nbPackets && !seen[packet->first];
+        if(packet->first < renderQueue.nbPackets) {
+            seen[packet->first] = 1;
+        }
+        if(i > 0) {
+            const RenderPacket* previous = packet - 1;
+            sorted &= previous->key <= packet->key;
+            if(previous->key >> RENDER_LAYER_SHIFT == packet->key >> RENDER_LAYER_SHIFT && (previous->key & RENDER_STATE_MASK) == (packet->key & RENDER_STATE_MASK)) {
+                sorted &= previous->first < packet->first;
+            }
+        }
+    }
+    free(seen);
+
+    return sorted;
+}
+
+/* Clé : chaque champ l'emporte sur tous ceux d'en dessous, l'état ne dépend ni de la couche ni du rang */
+void testKeys() {
+    unsigned long long key = renderKey(3, 7, GL_LINES, 10, 20, 30, 5);
+
+    CHECK(renderKey(1, 0, GL_POINTS, 0, 0, 0, 0) > renderKey(0, 255, GL_POLYGON, 255, 255, 255, RENDER_ORDER_MASK));
+    CHECK(renderKey(0, 2, GL_POINTS, 0, 0, 0, 0) > renderKey(0, 1, GL_POLYGON, 255, 255, 255, RENDER_ORDER_MASK));
+    CHECK(renderKey(0, 1, GL_LINES, 0, 0, 0, 0) > renderKey(0, 1, GL_POINTS, 255, 255, 255, RENDER_ORDER_MASK));
+    CHECK(renderKey(0, 1, GL_LINES, 0, 0, 1, 0) > renderKey(0, 1, GL_LINES, 0, 0, 0, RENDER_ORDER_MASK));
+    CHECK(renderKey(0, 1, GL_LINES, 0, 1, 0, 0) > renderKey(0, 1, GL_LINES, 0, 0, 255, 0));
+    CHECK(renderKey(0, 1, GL_LINES, 1, 0, 0, 0) > renderKey(0, 1, GL_LINES, 0, 255, 255, 0));
+
+    /* Chaque champ se relit à sa place */
+    CHECK(key >> RENDER_LAYER_SHIFT == 3 && ((key >> RENDER_TEXTURE_SHIFT) & 0xFF) == 7 && ((key >> RENDER_TYPE_SHIFT) & 0xFF) == GL_LINES);
+    CHECK(((key >> RENDER_COLOR_SHIFT) & 0xFFFFFF) == 0x0A141E && (key & RENDER_ORDER_MASK) == 5);
+    CHECK(renderKey(0, 0, GL_POINTS, 0, 0, 0, NB_PACKETS) == RENDER_ORDER_MASK);
+
+    /* L'état : la texture, le type et la couleur, pas la couche ni le rang */
+    CHECK((renderKey(0, 7, GL_LINES, 10, 20, 30, 0) & RENDER_STATE_MASK) == (key & RENDER_STATE_MASK));
+    CHECK((renderKey(3, 8, GL_LINES, 10, 20, 30, 5) & RENDER_STATE_MASK) != (key & RENDER_STATE_MASK));
+    CHECK((renderKey(3, 7, GL_LINES, 10, 20, 31, 5) & RENDER_STATE_MASK) != (key & RENDER_STATE_MASK));
+
+    /* Deux textures de même octet de poids faible ont la même clé : c'est la texture du paquet qui les sépare au dessin */
+    CHECK(renderKey(0, 257, GL_QUADS, 0, 0, 0, 0) == renderKey(0, 1, GL_QUADS, 0, 0, 0, 0));
+
+    return;
+}
+
+/* Tri d'une file aléatoire : par couche, puis texture, type et couleur, l'ordre de dépôt gardé dans chaque état */
+void testSort() {
+    static const GLenum TYPES[] = {GL_POINTS, GL_LINES, GL_LINE_STRIP, GL_TRIANGLE_FAN, GL_QUADS};
+    unsigned int i;
+
+    allocQueue(NB_PACKETS);
+    for(i = 0 ; i < 5000 ; i++) {
+        unsigned int color = randomIndex(4) * 60;
+        pushPacket(randomIndex(4), randomIndex(3), TYPES[randomIndex(5)], color, 255 - color, 0);
+    }
+    sortRenderQueue();
+    CHECK(sortedQueue());
+
+    /* Une seule couche et une seule texture : les octets communs sont sautés sans changer le tri */
+    renderQueue.nbPackets = 0;
+    for(i = 0 ; i < 1000 ; i++) {
+        pushPacket(2, 0, TYPES[randomIndex(5)], 0, 0, randomIndex(2));
+    }
+    sortRenderQueue();
+    CHECK(sortedQueue());
+    CHECK(renderQueue.packets[0].key >> RENDER_LAYER_SHIFT == 2 && ((renderQueue.packets[0].key >> RENDER_TYPE_SHIFT) & 0xFF) == GL_POINTS);
+    freeQueue();
+
+    return;
+}
+
+/* Plus de paquets que de rangs : les paquets d'après RENDER_ORDER_MASK ont le même rang et restent dans l'ordre par la stabilité du tri */
+void testOverflow() {
+    unsigned int i;
+
+    allocQueue(NB_PACKETS);
+    for(i = 0 ; i < NB_PACKETS ; i++) {
+        pushPacket(i % 2 ? 0 : 1, i % 3 ? 0 : 1, GL_TRIANGLE_FAN, 255, 255, 255);
+    }
+    sortRenderQueue();
+    CHECK(sortedQueue());
+    CHECK(renderQueue.packets[0].key >> RENDER_LAYER_SHIFT == 0 && renderQueue.packets[NB_PACKETS - 1].key >> RENDER_LAYER_SHIFT == 1);
+    CHECK((renderQueue.packets[NB_PACKETS - 1].key & RENDER_ORDER_MASK) == RENDER_ORDER_MASK);
+    freeQueue();
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testKeys();
+    testSort();
+    testOverflow();
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("file de rendu");
+}
@@ -0,0 +1,222 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "check.h"
+
+/* Anneau de points partagé : lots qui font le tour, anneau plein, place rendue par le consommateur, */
+/* et un producteur dans un autre processus dont chaque point arrive une fois, dans l'ordre */
+
+
+/************* CONSTANTES **************/
+
+
+/* Points écrits par le producteur de l'autre processus, par lots de RING_BATCH */
+#define RING_POINTS (1 << 22)
+#define RING_BATCH 1024
+
+
+/************* VARIABLES ***************/
+
+
+/* Nom de la mémoire partagée des tests */
+static char ringName[64];
+
+
+/************** FONCTIONS ***************/
+
+
+/* Lot de count points numérotés à partir de first : x vaut le numéro, la couleur en dépend */
+void fillBatch(float* positions, unsigned char* colors, unsigned int first, unsigned int count) {
+    unsigned int i;
+
+    for(i = 0 ; i < count ; i++) {
+        positions[2 * i] = first + i;
+        positions[2 * i + 1] = -(float)(first + i);
+        colors[3 * i] = (first + i) % 251;
+        colors[3 * i + 1] = (first + i) % 241;
+        colors[3 * i + 2] = 7;
+    }
+
+    return;
+}
+
+/* 1 si les points de numéros first à first + count - 1 sont dans leurs cases */
+int checkWindow(const SharedRing* ring, unsigned long long first, unsigned long long count) {
+    unsigned int capacity = ring->header->capacity;
+    unsigned long long n;
+
+    for(n = first ; n < first + count ; n++) {
+        unsigned int slot = n & (capacity - 1);
+        if(ring->positions[2 * slot] != n || ring->positions[2 * slot + 1] != -(float)n
+            || ring->colors[3 * slot] != n % 251 || ring->colors[3 * slot + 1] != n % 241 || ring->colors[3 * slot + 2] != 7) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Ouverture : un consommateur crée l'anneau, un producteur l'ouvre sans le créer ; un anneau absent, vide ou invalide est refusé */
+void testOpen() {
+    SharedRing consumer, producer, other;
+    int fd;
+
+    memset(&consumer, 0, sizeof(SharedRing));
+    memset(&producer, 0, sizeof(SharedRing));
+    memset(&other, 0, sizeof(SharedRing));
+    shm_unlink(ringName);
+    CHECK(!openSharedRing(&producer, ringName, 0));
+    CHECK(openSharedRing(&consumer, ringName, 1) && consumer.owner);
+    CHECK(openSharedRing(&producer, ringName, 0) && !producer.owner);
+    CHECK(producer.header->capacity == consumer.header->capacity && producer.header->capacity > 0);
+    CHECK((producer.header->capacity & (producer.header->capacity - 1)) == 0);
+    closeSharedRing(&producer);
+    closeSharedRing(&consumer);
+    CHECK(consumer.header == NULL && shm_open(ringName, O_RDONLY, 0) < 0);
+
+    /* Mémoire partagée pas encore dimensionnée, puis d'un autre format */
+    fd = shm_open(ringName, O_RDWR | O_CREAT, 0600);
+    CHECK(fd >= 0);
+    CHECK(!openSharedRing(&other, ringName, 0));
+    CHECK(ftruncate(fd, 4096) == 0);
+    CHECK(pwrite(fd, "IMACXXX", 8, 0) == 8);
+    CHECK(!openSharedRing(&other, ringName, 0));
+    close(fd);
+    shm_unlink(ringName);
+
+    return;
+}
+
+/* Lots qui font le tour de l'anneau, anneau plein, et place rendue : au moins la moitié de l'anneau libre après un dessin */
+void testWrap() {
+    SharedRing consumer, producer;
+    unsigned long long head, tail;
+    unsigned int capacity, count;
+    float* positions;
+    unsigned char* colors;
+
+    memset(&consumer, 0, sizeof(SharedRing));
+    memset(&producer, 0, sizeof(SharedRing));
+    shm_unlink(ringName);
+    CHECK(openSharedRing(&consumer, ringName, 1));
+    CHECK(openSharedRing(&producer, ringName, 0));
+    capacity = consumer.header->capacity;
+    positions = malloc(2 * capacity * sizeof(float));
+    colors = malloc(3 * capacity);
+    if(!positions || !colors) {
+        printf("Error at malloc\n");
+        exit(1);
+    }
+
+    /* L'anneau se remplit à 100 cases près : un lot de 101 points ne tient pas et est compté comme perdu */
+    fillBatch(positions, colors, 0, capacity - 100);
+    CHECK(writeSharedRing(&producer, positions, colors, capacity - 100));
+    fillBatch(positions, colors, capacity - 100, 101);
+    CHECK(!writeSharedRing(&producer, positions, colors, 101));
+    CHECK(consumer.header->stalls == 1 && consumer.header->droppedPoints == 101);
+    count = sharedRingWindow(&consumer, &head, &tail);
+    CHECK(count == capacity - 100 && tail == 0 && checkWindow(&consumer, 0, count));
+
+    /* Le consommateur garde la moitié la plus récente : le lot refusé tient alors, en faisant le tour de l'anneau */
+    releaseSharedRing(&consumer, head, tail);
+    CHECK(consumer.header->tail == head - capacity / 2);
+    fillBatch(positions, colors, capacity - 100, 300);
+    CHECK(writeSharedRing(&producer, positions, colors, 300));
+    count = sharedRingWindow(&consumer, &head, &tail);
+    CHECK(head == capacity + 200 && count == capacity / 2 + 300 && checkWindow(&consumer, tail, count));
+
+    /* Le dessin rend la place : moins de la moitié de l'anneau occupée, rien n'est libéré */
+    releaseSharedRing(&consumer, head, tail);
+    CHECK(consumer.header->tail == head - capacity / 2);
+    consumer.header->tail = head - 10;
+    count = sharedRingWindow(&consumer, &head, &tail);
+    releaseSharedRing(&consumer, head, tail);
+    CHECK(count == 10 && consumer.header->tail == head - 10);
+
+    /* Une tête incohérente ne fait jamais lire plus de capacity points */
+    consumer.header->head = head + 3 * capacity;
+    count = sharedRingWindow(&consumer, &head, &tail);
+    CHECK(count == capacity && head - tail == capacity);
+
+    free(positions);
+    free(colors);
+    closeSharedRing(&producer);
+    closeSharedRing(&consumer);
+
+    return;
+}
+
+/* Producteur dans un autre processus : il réessaie chaque lot refusé, le consommateur vérifie chaque point qui arrive */
+/* avant de libérer sa place : tous arrivent, une fois, dans l'ordre, avec leur couleur */
+void testProducer() {
+    SharedRing consumer;
+    unsigned long long head, tail, checked = 0;
+    unsigned int tries;
+    int ordered = 1, status;
+    pid_t pid;
+
+    memset(&consumer, 0, sizeof(SharedRing));
+    shm_unlink(ringName);
+    CHECK(openSharedRing(&consumer, ringName, 1));
+    pid = fork();
+    if(pid == 0) {
+        SharedRing producer;
+        float positions[2 * RING_BATCH];
+        unsigned char colors[3 * RING_BATCH];
+        unsigned int first;
+
+        memset(&producer, 0, sizeof(SharedRing));
+        if(!openSharedRing(&producer, ringName, 0)) {
+            _exit(1);
+        }
+        for(first = 0 ; first < RING_POINTS ; first += RING_BATCH) {
+            fillBatch(positions, colors, first, RING_BATCH);
+            while(!writeSharedRing(&producer, positions, colors, RING_BATCH)) {
+                usleep(100);
+            }
+        }
+        closeSharedRing(&producer);
+        _exit(0);
+    }
+    CHECK(pid > 0);
+
+    for(tries = 0 ; pid > 0 && checked < RING_POINTS && tries < 1000000 ; tries++) {
+        sharedRingWindow(&consumer, &head, &tail);
+        ordered &= tail <= checked && checkWindow(&consumer, checked, head - checked);
+        checked = head;
+        releaseSharedRing(&consumer, head, tail);
+        usleep(50);
+    }
+    CHECK(ordered && checked == RING_POINTS);
+    CHECK(pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(consumer.header->droppedPoints == consumer.header->stalls * RING_BATCH);
+    closeSharedRing(&consumer);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    snprintf(ringName, sizeof(ringName), "/imac_check_%d", (int)getpid());
+
+    testOpen();
+    testWrap();
+    testProducer();
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("anneau partagé");
+}
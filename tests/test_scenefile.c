@@ -0,0 +1,148 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <unistd.h>
+#include "check.h"
+
+/* Fichier de scène binaire : projeté en mémoire tel quel, aller-retour exact, et tout fichier abîmé est refusé sans toucher la scène */
+
+
+/************* VARIABLES ***************/
+
+
+/* Fichiers temporaires des tests */
+static const char* scenePath;
+static const char* damagedPath;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Écrit size octets de bytes à la position offset du fichier : renvoie 0 en cas d'erreur */
+int patchFile(const char* path, long offset, const void* bytes, size_t size) {
+    FILE* file = fopen(path, "r+b");
+    int ok;
+
+    if(!file) {
+        return 0;
+    }
+    ok = fseek(file, offset, SEEK_SET) == 0 && fwrite(bytes, 1, size, file) == size;
+
+    return fclose(file) == 0 && ok;
+}
+
+/* Aller-retour exact, au format flottant comme au format compact : les tableaux chargés sont ceux de la projection, alignés sur 64 octets */
+void testRoundTrip(PrimitiveList* scene) {
+    SceneCopy copy;
+    PrimitiveList primitive;
+    int mapped = 1;
+
+    buildScene(scene);
+    compactPrimitives((*scene)->next->next);
+    copyScene(*scene, &copy);
+    CHECK(saveSceneFile(*scene, scenePath));
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    CHECK(loadSceneFile(scenePath, scene));
+    CHECK(sameScene(*scene, &copy, 0));
+    for(primitive = *scene ; primitive ; primitive = primitive->next) {
+        const void* data = primitive->points.quantized ? (const void*)primitive->points.quantized : (const void*)primitive->points.positions;
+        if(primitive->points.nbPoints > 0) {
+            mapped &= primitive->points.mapped && (size_t)data % 64 == 0;
+        }
+    }
+    CHECK(mapped);
+    CHECK((*scene)->next->next->points.quantized != NULL && (*scene)->points.quantized == NULL);
+    freeSceneCopy(&copy);
+
+    return;
+}
+
+/* Modifier la scène chargée ne touche pas le fichier : la projection est privée */
+void testPrivateMapping(PrimitiveList* scene) {
+    SceneCopy copy;
+    unsigned int i;
+
+    buildScene(scene);
+    copyScene(*scene, &copy);
+    CHECK(saveSceneFile(*scene, scenePath));
+    CHECK(loadSceneFile(scenePath, scene));
+
+    transformSelection(*scene, NULL, 2, 0, 0, 2, 0.1, 0);
+    for(i = 0 ; i < 100 ; i++) {
+        addPointToList(allocPoint(0, i * 0.01, 0, 0, 0), &(*scene)->points);
+    }
+    CHECK(erasePoints(*scene, 0, 0, 0.5) > 0);
+    CHECK(!sameScene(*scene, &copy, 1e-3));
+
+    CHECK(loadSceneFile(scenePath, scene));
+    CHECK(sameScene(*scene, &copy, 0));
+    freeSceneCopy(&copy);
+
+    return;
+}
+
+/* Fichier abîmé : pas une scène, tronqué, d'une autre version, ou dont un tableau sort du fichier ; la scène reste en place */
+void testDamagedFiles(PrimitiveList* scene) {
+    unsigned int version = 99;
+    unsigned long long offset = 1ULL << 40;
+
+    buildScene(scene);
+    CHECK(saveSceneFile(*scene, scenePath));
+
+    CHECK(writeText(damagedPath, "pas une scene"));
+    CHECK(!loadSceneFile(damagedPath, scene));
+
+    CHECK(copyFile(scenePath, damagedPath) && truncate(damagedPath, 200) == 0);
+    CHECK(!loadSceneFile(damagedPath, scene));
+
+    CHECK(copyFile(scenePath, damagedPath) && patchFile(damagedPath, 8, &version, sizeof(version)));
+    CHECK(!loadSceneFile(damagedPath, scene));
+
+    CHECK(copyFile(scenePath, damagedPath));
+    CHECK(patchFile(damagedPath, sizeof(SceneFileHeader) + sizeof(SceneFilePrimitive) + offsetof(SceneFilePrimitive, positionsOffset), &offset, sizeof(offset)));
+    CHECK(!loadSceneFile(damagedPath, scene));
+
+    CHECK(!loadSceneFile("/nonexistent/scene.bin", scene));
+    CHECK(countPrimitives(*scene) == 4 && (*scene)->next->next->points.nbPoints == 200);
+
+    return;
+}
+
+/* Scène vide : une primitive de points sans point */
+void testEmptyScene(PrimitiveList* scene) {
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    CHECK(saveSceneFile(*scene, scenePath));
+    buildScene(scene);
+    CHECK(loadSceneFile(scenePath, scene));
+    CHECK(countPrimitives(*scene) == 1 && (*scene)->points.nbPoints == 0);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    scenePath = tempPath("scene.bin");
+    damagedPath = tempPath("damaged.bin");
+
+    testRoundTrip(&scene);
+    testPrivateMapping(&scene);
+    testDamagedFiles(&scene);
+    testEmptyScene(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("fichier de scène");
+}
@@ -0,0 +1,175 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include "check.h"
+
+/* Instantanés : un lecteur voit la scène telle qu'à la prise pendant qu'elle change, et la mémoire n'est rendue qu'après lui */
+
+
+/************* VARIABLES ***************/
+
+
+/* Fichiers temporaires des tests */
+static const char* scenePath;
+static const char* exportPath;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Modifie tous les tableaux de la scène : transformation, gomme et couleur en place, ajouts jusqu'à les agrandir, puis nouvelle primitive */
+void editScene(PrimitiveList* scene) {
+    PrimitiveList primitive;
+    unsigned int i;
+
+    transformSelection(*scene, NULL, 0.5, 0, 0, 0.5, 0.1, 0.1);
+    erasePoints(*scene, 0.35, 0.1, 0.05);
+    recolorPoints(&(*scene)->points, 0, (*scene)->points.nbPoints, 9, 9, 9);
+    for(primitive = *scene ; primitive ; primitive = primitive->next) {
+        for(i = 0 ; i < 300 ; i++) {
+            addPointToList(allocPoint(0.5, i * 0.001, 1, 2, 3), &primitive->points);
+        }
+    }
+    addPrimitive(allocPrimitive(GL_LINES), scene);
+    journalAddPrimitive(*scene);
+
+    return;
+}
+
+/* Le lecteur garde la scène du moment de la prise ; les tableaux qu'il lit ne sont rendus qu'une fois relâché et ramassé */
+void testCopyOnWrite(PrimitiveList* scene) {
+    SceneSnapshot* snapshot;
+    SceneCopy before, after;
+    size_t heapShared, heapReleased;
+
+    buildScene(scene);
+    collectSnapshots();
+    copyScene(*scene, &before);
+    snapshot = takeSnapshot(*scene);
+    CHECK(sameScene(snapshot->scene, &before, 0));
+
+    editScene(scene);
+    copyScene(*scene, &after);
+    CHECK(!sameScene(*scene, &before, 1e-3));
+    CHECK(sameScene(snapshot->scene, &before, 0));
+
+    /* Tant qu'il n'est pas relâché, rien de ce qu'il lit n'est rendu */
+    heapShared = sceneArena.bytesUsed;
+    collectSnapshots();
+    CHECK(sceneArena.bytesUsed == heapShared);
+    CHECK(sameScene(snapshot->scene, &before, 0));
+
+    releaseSnapshot(snapshot);
+    collectSnapshots();
+    heapReleased = sceneArena.bytesUsed;
+    CHECK(heapReleased < heapShared);
+    CHECK(sameScene(*scene, &after, 0));
+
+    /* Sans instantané vivant, une nouvelle modification n'est plus recopiée */
+    transformSelection(*scene, NULL, 1, 0, 0, 1, 0.01, 0);
+    CHECK(sceneArena.bytesUsed <= heapReleased + 64 * sizeof(JournalEntry));
+    freeSceneCopy(&before);
+    freeSceneCopy(&after);
+
+    return;
+}
+
+/* Deux instantanés : la mémoire quittée avant le plus récent reste tant que le plus ancien vit, même si le plus récent est relâché */
+void testTwoSnapshots(PrimitiveList* scene) {
+    SceneSnapshot* older;
+    SceneSnapshot* newer;
+    SceneCopy first, second;
+    size_t heapUsed;
+
+    buildScene(scene);
+    collectSnapshots();
+    copyScene(*scene, &first);
+    older = takeSnapshot(*scene);
+    editScene(scene);
+    copyScene(*scene, &second);
+    newer = takeSnapshot(*scene);
+    editScene(scene);
+
+    releaseSnapshot(newer);
+    collectSnapshots();
+    heapUsed = sceneArena.bytesUsed;
+    CHECK(sameScene(older->scene, &first, 0));
+
+    releaseSnapshot(older);
+    collectSnapshots();
+    CHECK(sceneArena.bytesUsed < heapUsed);
+    freeSceneCopy(&first);
+    freeSceneCopy(&second);
+
+    return;
+}
+
+/* resetScene avec un instantané vivant : le tas entier et le fichier projeté restent lisibles par lui jusqu'à sa libération */
+void testResetWhileShared(PrimitiveList* scene) {
+    SceneSnapshot* snapshot;
+    SceneCopy copy, loaded;
+
+    buildScene(scene);
+    copyScene(*scene, &copy);
+    CHECK(saveSceneFile(*scene, scenePath));
+    CHECK(loadSceneFile(scenePath, scene));
+    copyScene(*scene, &loaded);
+    snapshot = takeSnapshot(*scene);
+
+    resetScene(scene);
+    buildScene(scene);
+    editScene(scene);
+    CHECK(sameScene(snapshot->scene, &loaded, 0));
+    CHECK(sameScene(snapshot->scene, &copy, 0));
+
+    releaseSnapshot(snapshot);
+    collectSnapshots();
+    freeSceneCopy(&copy);
+    freeSceneCopy(&loaded);
+
+    return;
+}
+
+/* Export en arrière-plan : le fichier écrit est la scène du moment du lancement, même si elle change pendant l'écriture */
+void testExport(PrimitiveList* scene) {
+    SceneCopy copy;
+    unsigned int i;
+
+    buildScene(scene);
+    for(i = 0 ; i < 100000 ; i++) {
+        addPointToList(allocPoint(i * 1e-5, 0.2, 4, 5, 6), &(*scene)->points);
+    }
+    copyScene(*scene, &copy);
+    CHECK(startExport(*scene, saveSceneFile, exportPath));
+    editScene(scene);
+    finishExport();
+
+    CHECK(loadSceneFile(exportPath, scene));
+    CHECK(sameScene(*scene, &copy, 0));
+    freeSceneCopy(&copy);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    scenePath = tempPath("scene.bin");
+    exportPath = tempPath("export.bin");
+
+    testCopyOnWrite(&scene);
+    testTwoSnapshots(&scene);
+    testResetWhileShared(&scene);
+    testExport(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("instantanés");
+}
@@ -0,0 +1,253 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "check.h"
+
+/* Statistiques de la scène : les compteurs tenus à jour à chaque modification valent un recomptage complet, */
+/* et les sorties CSV et JSON donnent chacun d'eux sur une ligne */
+
+
+/************* VARIABLES ***************/
+
+
+/* Fichiers temporaires des tests */
+static const char* scenePath;
+static const char* outputPath;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Recompte la scène en la parcourant, comme le faisait l'ancienne fonction de statistiques */
+SceneStatistics recountScene(PrimitiveList scene) {
+    SceneStatistics statistics;
+
+    memset(&statistics, 0, sizeof(SceneStatistics));
+    for( ; scene ; scene = scene->next) {
+        const PointList* list = &scene->points;
+        unsigned long long pointSize = list->quantized ? 2 * sizeof(unsigned short) + sizeof(unsigned char) : 2 * sizeof(float) + 3 * sizeof(unsigned char);
+        statistics.nbPrimitives[scene->primitiveType <= GL_POLYGON ? scene->primitiveType : GL_POLYGON + 1]++;
+        statistics.totalPrimitives++;
+        statistics.nbVertices += list->nbPoints;
+        statistics.usedBytes += list->nbPoints * pointSize;
+        statistics.reservedBytes += list->capacity * pointSize;
+    }
+
+    return statistics;
+}
+
+/* 1 si les compteurs de la scène tenus à jour valent ceux du recomptage */
+int sameCounts(PrimitiveList scene) {
+    SceneStatistics counted = getSceneStatistics(), expected = recountScene(scene);
+    unsigned int i;
+    int same = counted.totalPrimitives == expected.totalPrimitives && counted.nbVertices == expected.nbVertices
+        && counted.usedBytes == expected.usedBytes && counted.reservedBytes == expected.reservedBytes;
+
+    for(i = 0 ; i < GL_POLYGON + 2 ; i++) {
+        same &= counted.nbPrimitives[i] == expected.nbPrimitives[i];
+    }
+
+    return same;
+}
+
+/* Les compteurs suivent chaque sorte de modification : ajouts, format compact, gomme, annulations, transformations, */
+/* couleurs hors palette, primitives d'un type inconnu, chargement d'un fichier, génération et remise à zéro */
+void testCounters(PrimitiveList* scene) {
+    unsigned int i, expanded;
+
+    resetScene(scene);
+    CHECK(sameCounts(*scene) && getSceneStatistics().totalPrimitives == 0 && getSceneStatistics().expandedLists == 0);
+    buildScene(scene);
+    CHECK(sameCounts(*scene));
+
+    /* Croissance d'un tableau : la capacité double */
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    journalAddPrimitive(*scene);
+    for(i = 0 ; i < 5000 ; i++) {
+        addPointToList(allocPoint(i * 1e-4, 0.5, COLORS[3], COLORS[4], COLORS[5]), &(*scene)->points);
+        journalAddPoint(&(*scene)->points, 1);
+    }
+    CHECK(sameCounts(*scene) && getSceneStatistics().nbVertices > 5000);
+
+    /* Format compact, puis un point hors palette qui repasse le tableau au format flottant */
+    compactPrimitives(*scene);
+    CHECK(sameCounts(*scene) && (*scene)->points.quantized != NULL);
+    expanded = getSceneStatistics().expandedLists;
+    addPointToList(allocPoint(0.1, 0.2, 1, 2, 3), &(*scene)->points);
+    CHECK(sameCounts(*scene) && (*scene)->points.quantized == NULL && getSceneStatistics().expandedLists == expanded + 1);
+
+    /* Gomme, annulations et reprises, transformation */
+    CHECK(erasePoints(*scene, 0.2, 0.5, 0.05) > 0);
+    CHECK(sameCounts(*scene));
+    CHECK(undo(scene) && undo(scene));
+    CHECK(sameCounts(*scene));
+    CHECK(redo(scene));
+    CHECK(sameCounts(*scene));
+    transformSelection(*scene, NULL, 0.5, 0, 0, 0.5, 0, 0);
+    CHECK(sameCounts(*scene));
+
+    /* Primitive d'un type inconnu, comptée à part, puis retirée */
+    addPrimitive(allocPrimitive(GL_POLYGON + 7), scene);
+    addPointToList(allocPoint(0, 0, 0, 0, 0), &(*scene)->points);
+    CHECK(sameCounts(*scene) && getSceneStatistics().nbPrimitives[GL_POLYGON + 1] == 1);
+    deletePrimitive(scene);
+    CHECK(sameCounts(*scene) && getSceneStatistics().nbPrimitives[GL_POLYGON + 1] == 0);
+
+    /* Fichier de scène projeté, puis scène générée */
+    CHECK(saveSceneFile(*scene, scenePath));
+    CHECK(loadSceneFile(scenePath, scene));
+    CHECK(sameCounts(*scene));
+    addPointToList(allocPoint(0.3, 0.3, 255, 0, 0), &(*scene)->points);
+    CHECK(sameCounts(*scene));
+    generateScene(scene, 10, 100000, GENERATOR_UNIFORM, 5);
+    CHECK(sameCounts(*scene) && getSceneStatistics().nbVertices == recountScene(*scene).nbVertices);
+
+    resetScene(scene);
+    CHECK(sameCounts(*scene) && getSceneStatistics().totalPrimitives == 0 && getSceneStatistics().expandedLists == 0);
+    CHECK(getSceneStatistics().mergedSteps == 0 && getSceneStatistics().forgottenSteps == 0);
+
+    return;
+}
+
+/* Lit le fichier de sortie en entier : renvoie 0 si la lecture a échoué */
+int readOutput(char* text, size_t size) {
+    FILE* file = fopen(outputPath, "r");
+    size_t length;
+
+    if(!file) {
+        return 0;
+    }
+    length = fread(text, 1, size - 1, file);
+    text[length] = '\0';
+    fclose(file);
+
+    return length > 0;
+}
+
+/* Valeur de la colonne name d'une sortie CSV (ligne d'en-tête, ligne de valeurs) : renvoie 0 si la colonne est absente */
+int csvValue(const char* text, const char* name, long long* value) {
+    const char* values = strchr(text, '\n');
+    const char* field = text;
+    size_t length = strlen(name);
+
+    if(!values) {
+        return 0;
+    }
+    values++;
+    while(field < values) {
+        if(strncmp(field, name, length) == 0 && (field[length] == ',' || field[length] == '\n')) {
+            return sscanf(values, "%lld", value) == 1;
+        }
+        field += strcspn(field, ",\n") + 1;
+        values += strcspn(values, ",\n") + 1;
+    }
+
+    return 0;
+}
+
+/* Valeur de la clé name d'une sortie JSON : renvoie 0 si la clé est absente */
+int jsonValue(const char* text, const char* name, long long* value) {
+    char key[64];
+    const char* found;
+
+    snprintf(key, sizeof(key), "\"%s\":", name);
+    found = strstr(text, key);
+
+    return found && sscanf(found + strlen(key), "%lld", value) == 1;
+}
+
+/* Sorties CSV et JSON : une ligne (deux pour le CSV), autant de valeurs que de colonnes, et les valeurs de getSceneStatistics */
+void testOutput(PrimitiveList* scene) {
+    static const char* NAMES[] = {"points", "lines", "line_strip", "other", "total_primitives", "vertices", "used_bytes", "reserved_bytes", "expanded_lists", "journal_merged", "journal_forgotten"};
+    SceneStatistics statistics;
+    PointList* palette;
+    long long expected[11], value;
+    char text[4096];
+    unsigned int i, nbHeaders = 0, nbValues = 0;
+    const char* values;
+    FILE* file;
+    int csv = 1, json = 1;
+
+    buildScene(scene);
+    palette = &(*scene)->next->next->points;
+    addPrimitive(allocPrimitive(GL_POLYGON + 3), scene);
+    compactPrimitives(*scene);
+    CHECK(palette->quantized != NULL);
+    addPointToList(allocPoint(0.5, 0.5, 9, 9, 9), palette);
+    setJournalLimit(200);
+    for(i = 0 ; i < 50 ; i++) {
+        addPrimitive(allocPrimitive(GL_POINTS), scene);
+        journalAddPrimitive(*scene);
+    }
+    setJournalLimit(8 << 20);
+    statistics = getSceneStatistics();
+    CHECK(statistics.mergedSteps > 0 || statistics.forgottenSteps > 0);
+    expected[0] = statistics.nbPrimitives[GL_POINTS];
+    expected[1] = statistics.nbPrimitives[GL_LINES];
+    expected[2] = statistics.nbPrimitives[GL_LINE_STRIP];
+    expected[3] = statistics.nbPrimitives[GL_POLYGON + 1];
+    expected[4] = statistics.totalPrimitives;
+    expected[5] = statistics.nbVertices;
+    expected[6] = statistics.usedBytes;
+    expected[7] = statistics.reservedBytes;
+    expected[8] = statistics.expandedLists;
+    expected[9] = statistics.mergedSteps;
+    expected[10] = statistics.forgottenSteps;
+    CHECK(expected[3] == 1 && expected[8] >= 1);
+
+    file = fopen(outputPath, "w");
+    CHECK(file && writeSceneStatistics(file, STATISTICS_CSV));
+    if(file) {
+        fclose(file);
+    }
+    CHECK(readOutput(text, sizeof(text)));
+    values = strchr(text, '\n');
+    CHECK(values && strchr(values + 1, '\n') && strchr(values + 1, '\n')[1] == '\0');
+    for(i = 0 ; values && text + i < values ; i++) {
+        nbHeaders += text[i] == ',';
+    }
+    for(i = 0 ; values && values[i] ; i++) {
+        nbValues += values[i] == ',';
+    }
+    CHECK(nbHeaders > 20 && nbHeaders == nbValues);
+    for(i = 0 ; i < 11 ; i++) {
+        csv &= csvValue(text, NAMES[i], &value) && value == expected[i];
+    }
+    CHECK(csv);
+
+    file = fopen(outputPath, "w");
+    CHECK(file && writeSceneStatistics(file, STATISTICS_JSON));
+    if(file) {
+        fclose(file);
+    }
+    CHECK(readOutput(text, sizeof(text)));
+    CHECK(text[0] == '{' && strchr(text, '\n') == text + strlen(text) - 1 && text[strlen(text) - 2] == '}');
+    for(i = 0 ; i < 11 ; i++) {
+        json &= jsonValue(text, NAMES[i], &value) && value == expected[i];
+    }
+    CHECK(json);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    scenePath = tempPath("scene.bin");
+    outputPath = tempPath("statistics");
+
+    testCounters(&scene);
+    testOutput(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("statistiques");
+}
@@ -0,0 +1,105 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include "check.h"
+
+/* Tableaux contigus de points : ajout en fin de tableau, capacité doublée, boîte englobante et libération */
+
+
+/************** FONCTIONS ***************/
+
+
+/* Des milliers d'ajouts : la capacité double, les points se suivent en mémoire et restent dans l'ordre */
+void testGrowth(PrimitiveList* scene) {
+    PointList* list;
+    unsigned int i, capacity = 0, nbGrowths = 0;
+    int ordered = 1;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_LINE_STRIP), scene);
+    list = &(*scene)->points;
+    CHECK(list->nbPoints == 0 && list->capacity == 0 && list->positions == NULL);
+
+    for(i = 0 ; i < 5000 ; i++) {
+        addPointToList(allocPoint(i * 0.001 - 1, i % 7 * 0.1, i % 256, 0, 255 - i % 256), list);
+        if(list->capacity != capacity) {
+            CHECK(capacity == 0 ? list->capacity == 16 : list->capacity == 2 * capacity);
+            capacity = list->capacity;
+            nbGrowths++;
+        }
+    }
+    CHECK(list->nbPoints == 5000 && list->capacity == 8192);
+    CHECK(nbGrowths == 10);
+
+    for(i = 0 ; i < 5000 ; i++) {
+        Point point = getPoint(list, i);
+        if(point.x != list->positions[2 * i] || point.y != list->positions[2 * i + 1] || point.r != i % 256 || point.b != 255 - i % 256) {
+            ordered = 0;
+        }
+    }
+    CHECK(ordered);
+
+    return;
+}
+
+/* La boîte englobante suit chaque ajout */
+void testBoundingBox(PrimitiveList* scene) {
+    PointList* list;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    list = &(*scene)->points;
+    addPointToList(allocPoint(0.25, -0.5, 0, 0, 0), list);
+    CHECK(list->box.minX == 0.25f && list->box.maxX == 0.25f && list->box.minY == -0.5f && list->box.maxY == -0.5f);
+    addPointToList(allocPoint(-0.75, 0.5, 0, 0, 0), list);
+    addPointToList(allocPoint(0, 0, 0, 0, 0), list);
+    CHECK(list->box.minX == -0.75f && list->box.maxX == 0.25f && list->box.minY == -0.5f && list->box.maxY == 0.5f);
+
+    return;
+}
+
+/* deletePrimitive vide la liste et rend tous les tableaux au tas : refaire la même scène ne prend pas plus de mémoire */
+void testDelete(PrimitiveList* scene) {
+    unsigned int i, k, round;
+    size_t used[2];
+
+    resetScene(scene);
+    for(round = 0 ; round < 2 ; round++) {
+        for(k = 0 ; k < 3 ; k++) {
+            addPrimitive(allocPrimitive(GL_POINTS), scene);
+            for(i = 0 ; i < 100 * (k + 1) ; i++) {
+                addPointToList(allocPoint(i * 0.01, k * 0.1, 255, 255, 255), &(*scene)->points);
+            }
+        }
+        CHECK(countPrimitives(*scene) == 3 && (*scene)->points.nbPoints == 300);
+
+        deletePoints(&(*scene)->points);
+        CHECK((*scene)->points.nbPoints == 0 && (*scene)->points.capacity == 0 && (*scene)->points.positions == NULL);
+
+        deletePrimitive(scene);
+        CHECK(*scene == NULL);
+        used[round] = sceneArena.bytesUsed;
+    }
+    CHECK(used[1] == used[0]);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testGrowth(&scene);
+    testBoundingBox(&scene);
+    testDelete(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("tableaux de points");
+}
@@ -0,0 +1,320 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include "check.h"
+
+/* Magasin de points sur disque : chaque point de la scène dans le morceau de sa case, morceaux mélangés, */
+/* et un fil de chargement qui ne dépasse jamais son budget ni ne libère un morceau en train d'être dessiné */
+
+
+/************* CONSTANTES **************/
+
+
+/* Points de la scène de départ : assez pour découper le magasin en 4 x 4 cases */
+#define STORE_TEST_POINTS 600000
+
+/* Octets d'un point chargé (deux float, trois octets de couleur) */
+#define STORE_POINT_BYTES (2 * sizeof(float) + 3)
+
+
+/************* VARIABLES ***************/
+
+
+/* Fichiers temporaires des tests */
+static const char* scenePath;
+static const char* storePath;
+static const char* damagedPath;
+
+/* Générateur pseudo-aléatoire des positions (toujours la même suite) */
+static unsigned int seed = 98765;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Nombre pseudo-aléatoire dans [min, max] */
+float randomFloat(float min, float max) {
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (seed >> 8) / (float)(1 << 24);
+}
+
+/* Ordre de deux points (x, y, r, g, b) pour qsort */
+int comparePoints(const void* a, const void* b) {
+    const Point* p = (const Point*)a;
+    const Point* q = (const Point*)b;
+
+    if(p->x != q->x) {
+        return p->x < q->x ? -1 : 1;
+    }
+    if(p->y != q->y) {
+        return p->y < q->y ? -1 : 1;
+    }
+
+    return (p->r * 65536 + p->g * 256 + p->b) - (q->r * 65536 + q->g * 256 + q->b);
+}
+
+/* Scène au hasard de STORE_TEST_POINTS points en six primitives, les trois premières au format compact, écrite dans scenePath */
+void buildStoreScene(PrimitiveList* scene) {
+    unsigned int i, k;
+
+    resetScene(scene);
+    for(k = 0 ; k < 6 ; k++) {
+        addPrimitive(allocPrimitive(GL_POINTS), scene);
+        for(i = 0 ; i < STORE_TEST_POINTS / 6 ; i++) {
+            unsigned int color = i % NB_COLORS;
+            if(k < 3) {
+                addPointToList(allocPoint(randomFloat(-3, 5), randomFloat(-2, 2), COLORS[color * 3], COLORS[color * 3 + 1], COLORS[color * 3 + 2]), &(*scene)->points);
+            }
+            else {
+                addPointToList(allocPoint(randomFloat(-3, 5), randomFloat(-2, 2), i % 256, k * 40, 255 - i % 256), &(*scene)->points);
+            }
+        }
+        if(k == 2) {
+            compactPrimitives(*scene);
+        }
+    }
+    CHECK(saveSceneFile(*scene, scenePath));
+
+    return;
+}
+
+/* Demande les points de box comme le ferait une image de drawPointStore, sans contexte OpenGL */
+void requestView(PointStore* store, float minX, float minY, float maxX, float maxY) {
+    BoundingBox box = {minX, minY, maxX, maxY};
+    unsigned int cells[4];
+
+    SDL_LockMutex(store->mutex);
+    store->frame++;
+    store->nbRequests = 0;
+    store->nextRequest = 0;
+    store->nbVisible = 0;
+    store->drawnPoints = 0;
+    store->missingPoints = 0;
+    if(storeCells(store, &box, cells)) {
+        requestStoreChunks(store, &box, cells, NULL, 1, 1);
+    }
+    SDL_CondSignal(store->wake);
+    SDL_UnlockMutex(store->mutex);
+
+    return;
+}
+
+/* Attend que le fil de chargement ait traité toutes les demandes : plus rien ne bouge pendant plusieurs millisecondes */
+/* (il rend le verrou pendant qu'il libère un morceau). Renvoie 0 si ses comptes ne tombent pas juste : */
+/* la place réservée est celle des points chargés, et le budget est tenu */
+int waitLoader(PointStore* store) {
+    unsigned long long operations = 0;
+    unsigned int tries, stable = 0, i;
+    int consistent = 0;
+
+    for(tries = 0 ; tries < 5000 && stable < 10 ; tries++) {
+        size_t bytes = 0;
+        SDL_Delay(1);
+        SDL_LockMutex(store->mutex);
+        for(i = 0 ; i < store->nbChunks ; i++) {
+            bytes += store->residentPoints[i] * STORE_POINT_BYTES;
+        }
+        consistent = bytes <= store->budget && store->residentBytes <= store->budget;
+        if(store->nextRequest >= store->nbRequests && bytes == store->residentBytes && store->nbLoads + store->nbEvictions == operations) {
+            stable++;
+        }
+        else {
+            stable = 0;
+        }
+        operations = store->nbLoads + store->nbEvictions;
+        SDL_UnlockMutex(store->mutex);
+    }
+
+    return stable >= 10 && consistent;
+}
+
+/* Construction : chaque point de la scène est une fois dans le magasin, dans le morceau de sa case et dans sa boîte, */
+/* et le début de chaque morceau est un échantillon de tout le morceau */
+void testBuild(PrimitiveList* scene) {
+    PointStore store;
+    PrimitiveList primitive;
+    Point* expected = malloc(STORE_TEST_POINTS * sizeof(Point));
+    Point* stored = malloc(STORE_TEST_POINTS * sizeof(Point));
+    unsigned int nbExpected = 0, nbStored = 0, chunk, i;
+    int placed = 1, aligned = 1, sampled = 1, same = 1;
+
+    if(!expected || !stored) {
+        printf("Error at malloc\n");
+        exit(1);
+    }
+    buildStoreScene(scene);
+    CHECK((*scene)->points.quantized == NULL && (*scene)->next->next->next->points.quantized != NULL);
+    for(primitive = *scene ; primitive ; primitive = primitive->next) {
+        for(i = 0 ; i < primitive->points.nbPoints ; i++) {
+            expected[nbExpected++] = getPoint(&primitive->points, i);
+        }
+    }
+    CHECK(buildPointStore(scenePath, storePath));
+
+    memset(&store, 0, sizeof(PointStore));
+    CHECK(openPointStore(&store, storePath, 64 << 20));
+    CHECK(store.header->nbPoints == STORE_TEST_POINTS && store.header->gridSize == 4 && store.nbChunks == 16);
+    for(chunk = 0 ; chunk < store.nbChunks && nbStored + store.chunks[chunk].nbPoints <= STORE_TEST_POINTS ; chunk++) {
+        const StoreChunk* entry = store.chunks + chunk;
+        const float* positions = (const float*)(store.data + entry->offset);
+        const unsigned char* colors = store.data + entry->offset + 2 * sizeof(float) * entry->nbPoints;
+        float minX = entry->box.maxX, maxX = entry->box.minX;
+
+        aligned &= entry->offset % 4096 == 0;
+        for(i = 0 ; i < entry->nbPoints ; i++) {
+            Point point = {positions[2 * i], positions[2 * i + 1], colors[3 * i], colors[3 * i + 1], colors[3 * i + 2]};
+            placed &= mortonIndex(storeCell(point.x, store.header->box.minX, store.header->box.maxX, 4), storeCell(point.y, store.header->box.minY, store.header->box.maxY, 4)) == chunk;
+            placed &= point.x >= entry->box.minX && point.x <= entry->box.maxX && point.y >= entry->box.minY && point.y <= entry->box.maxY;
+            stored[nbStored++] = point;
+            /* Les 500 premiers points couvrent déjà la plupart de la largeur du morceau */
+            if(i < 500) {
+                minX = point.x < minX ? point.x : minX;
+                maxX = point.x > maxX ? point.x : maxX;
+            }
+        }
+        sampled &= entry->nbPoints < 10000 || maxX - minX > 0.8 * (entry->box.maxX - entry->box.minX);
+    }
+    CHECK(placed && aligned && sampled);
+    CHECK(nbStored == nbExpected);
+
+    /* Même ensemble de points, à l'ordre près */
+    qsort(expected, nbExpected, sizeof(Point), comparePoints);
+    qsort(stored, nbStored, sizeof(Point), comparePoints);
+    for(i = 0 ; i < nbStored && i < nbExpected ; i++) {
+        same &= comparePoints(expected + i, stored + i) == 0;
+    }
+    CHECK(nbStored == nbExpected && same);
+    closePointStore(&store);
+    CHECK(store.data == NULL);
+    free(expected);
+    free(stored);
+
+    return;
+}
+
+/* Chargement : ce qui est demandé arrive, le budget (cinq morceaux) n'est jamais dépassé, */
+/* et une vue qui parcourt le cadre fait libérer les morceaux les plus anciens sauf celui qui est en train d'être dessiné */
+void testLoading() {
+    PointStore store;
+    unsigned int step, i, pinnedChunk;
+    int loaded = 1, accounted = 1;
+    size_t budget = (size_t)(STORE_TEST_POINTS / 16) * 5 * STORE_POINT_BYTES;
+
+    memset(&store, 0, sizeof(PointStore));
+    CHECK(openPointStore(&store, storePath, budget));
+
+    /* Tout le cadre : le fil de chargement s'arrête au budget */
+    requestView(&store, -3, -2, 5, 2);
+    CHECK(store.nbVisible == 16 && store.missingPoints == STORE_TEST_POINTS);
+    CHECK(waitLoader(&store));
+    CHECK(store.residentBytes > budget - STORE_TEST_POINTS / 16 * STORE_POINT_BYTES && store.residentBytes <= budget);
+
+    /* Une case, qui reste dessinée (épinglée) pendant que la vue parcourt le cadre, case par case */
+    requestView(&store, -2.5, -1.5, -2.4, -1.4);
+    CHECK(store.nbVisible == 1);
+    pinnedChunk = store.visible[0];
+    CHECK(waitLoader(&store));
+    SDL_LockMutex(store.mutex);
+    store.pinned[pinnedChunk] = 1;
+    SDL_UnlockMutex(store.mutex);
+    for(step = 0 ; step < 48 ; step++) {
+        float x = -3 + (step % 16 % 4) * 2 + 1, y = -2 + (step % 16 / 4) + 0.5;
+        requestView(&store, x - 0.1, y - 0.1, x + 0.1, y + 0.1);
+        accounted &= waitLoader(&store);
+        /* Les points de la vue sont tous là, et le morceau épinglé n'a pas été libéré */
+        SDL_LockMutex(store.mutex);
+        for(i = 0 ; i < store.nbVisible ; i++) {
+            loaded &= store.residentPoints[store.visible[i]] == store.chunks[store.visible[i]].nbPoints;
+        }
+        loaded &= store.residentPoints[pinnedChunk] == store.chunks[pinnedChunk].nbPoints;
+        SDL_UnlockMutex(store.mutex);
+    }
+    CHECK(loaded && accounted);
+    CHECK(store.nbEvictions > 16 && store.residentBytes <= budget);
+
+    /* Une fois rendu, le morceau épinglé peut partir comme les autres */
+    SDL_LockMutex(store.mutex);
+    store.pinned[pinnedChunk] = 0;
+    SDL_UnlockMutex(store.mutex);
+    for(step = 0 ; step < 16 ; step++) {
+        float x = -3 + (step % 4) * 2 + 1, y = -2 + (step / 4) + 0.5;
+        if(x < 0 && y < 0) {
+            continue;
+        }
+        requestView(&store, x - 0.1, y - 0.1, x + 0.1, y + 0.1);
+        CHECK(waitLoader(&store));
+    }
+    CHECK(store.residentPoints[pinnedChunk] == 0);
+    closePointStore(&store);
+
+    return;
+}
+
+/* Magasins abîmés : absent, tronqué, d'un autre format ou avec une table qui sort du fichier, tous refusés */
+void testDamagedStore() {
+    PointStore store;
+    FILE* file;
+    unsigned long long offset = 1ULL << 40;
+    unsigned int gridSize = 3;
+
+    memset(&store, 0, sizeof(PointStore));
+    remove(damagedPath);
+    CHECK(!openPointStore(&store, damagedPath, 1 << 20));
+    CHECK(writeText(damagedPath, "IMACOOC pas un magasin"));
+    CHECK(!openPointStore(&store, damagedPath, 1 << 20));
+
+    CHECK(copyFile(storePath, damagedPath));
+    CHECK(truncate(damagedPath, 100000) == 0);
+    CHECK(!openPointStore(&store, damagedPath, 1 << 20));
+
+    CHECK(copyFile(storePath, damagedPath));
+    file = fopen(damagedPath, "r+b");
+    CHECK(file && fseek(file, offsetof(StoreFileHeader, gridSize), SEEK_SET) == 0 && fwrite(&gridSize, sizeof(unsigned int), 1, file) == 1);
+    if(file) {
+        fclose(file);
+    }
+    CHECK(!openPointStore(&store, damagedPath, 1 << 20));
+
+    CHECK(copyFile(storePath, damagedPath));
+    file = fopen(damagedPath, "r+b");
+    CHECK(file && fseek(file, sizeof(StoreFileHeader) + 3 * sizeof(StoreChunk) + offsetof(StoreChunk, offset), SEEK_SET) == 0
+        && fwrite(&offset, sizeof(unsigned long long), 1, file) == 1);
+    if(file) {
+        fclose(file);
+    }
+    CHECK(!openPointStore(&store, damagedPath, 1 << 20));
+    CHECK(store.data == NULL && store.loader == NULL);
+
+    /* Le magasin intact s'ouvre toujours */
+    CHECK(openPointStore(&store, storePath, 1 << 20));
+    closePointStore(&store);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    scenePath = tempPath("scene.bin");
+    storePath = tempPath("store.bin");
+    damagedPath = tempPath("damaged.bin");
+
+    testBuild(&scene);
+    testLoading();
+    testDamagedStore();
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("magasin de points");
+}
@@ -0,0 +1,147 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include "check.h"
+
+/* Trait à main levée : le nombre de sommets gardés suit la courbure du trait, pas la fréquence des mouvements de la souris */
+
+
+/************** FONCTIONS ***************/
+
+
+/* Distance du point (x, y) à la ligne brisée du tableau */
+float polylineDistance(const PointList* list, float x, float y) {
+    Point p = allocPoint(x, y, 0, 0, 0);
+    float best = FLT_MAX;
+    unsigned int i;
+
+    for(i = 0 ; i + 1 < list->nbPoints ; i++) {
+        float distance = segmentDistance(p, getPoint(list, i), getPoint(list, i + 1));
+        if(distance < best) {
+            best = distance;
+        }
+    }
+
+    return best;
+}
+
+/* Trace un cercle de rayon radius en nbSamples mouvements de souris, et renvoie le plus grand écart d'un mouvement au trait gardé */
+float traceCircle(PrimitiveList* scene, float radius, unsigned int nbSamples, float tolerance) {
+    PointList* list;
+    unsigned int i;
+    float maxDistance = 0;
+
+    addPrimitive(allocPrimitive(GL_LINE_STRIP), scene);
+    list = &(*scene)->points;
+    beginStroke(list, allocPoint(radius, 0, 255, 0, 0), tolerance);
+    for(i = 1 ; i <= nbSamples ; i++) {
+        float angle = 2 * M_PI * i / nbSamples;
+        addStrokePoint(allocPoint(radius * cosf(angle), radius * sinf(angle), 255, 0, 0));
+    }
+    endStroke();
+    CHECK(stroke.list == NULL);
+
+    for(i = 0 ; i <= nbSamples ; i++) {
+        float angle = 2 * M_PI * i / nbSamples;
+        float distance = polylineDistance(list, radius * cosf(angle), radius * sinf(angle));
+        if(distance > maxDistance) {
+            maxDistance = distance;
+        }
+    }
+
+    return maxDistance;
+}
+
+/* Une droite tracée en mille mouvements ne garde que ses extrémités */
+void testStraight(PrimitiveList* scene) {
+    PointList* list;
+    float tolerance = 2.0 / 400;
+    unsigned int i;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_LINE_STRIP), scene);
+    list = &(*scene)->points;
+    beginStroke(list, allocPoint(-0.9, -0.5, 0, 255, 0), tolerance);
+    CHECK(stroke.list == list && list->nbPoints == 1);
+    for(i = 1 ; i <= 1000 ; i++) {
+        addStrokePoint(allocPoint(-0.9 + i * 0.0018, -0.5 + i * 0.001, 0, 255, 0));
+    }
+    endStroke();
+    CHECK(list->nbPoints == 2);
+    CHECK(fabs(getPoint(list, 1).x - 0.9) < tolerance);
+
+    /* Les mouvements sur place sont ignorés */
+    beginStroke(list, allocPoint(0, 0, 0, 255, 0), tolerance);
+    for(i = 0 ; i < 100 ; i++) {
+        addStrokePoint(allocPoint(tolerance * 0.5 * cosf(i), tolerance * 0.5 * sinf(i), 0, 255, 0));
+    }
+    endStroke();
+    CHECK(list->nbPoints == 3);
+
+    return;
+}
+
+/* Le même cercle échantillonné dix fois plus souvent garde à peu près autant de sommets, et le trait reste à moins de deux pixels */
+void testCurvature(PrimitiveList* scene) {
+    float tolerance = 2.0 / 400;
+    unsigned int slow, fast, small;
+
+    resetScene(scene);
+    CHECK(traceCircle(scene, 0.5, 500, tolerance) <= 2 * tolerance);
+    slow = (*scene)->points.nbPoints;
+    CHECK(traceCircle(scene, 0.5, 5000, tolerance) <= 2 * tolerance);
+    fast = (*scene)->points.nbPoints;
+    CHECK(slow < 200 && fast < 200);
+    CHECK(fast <= slow + slow / 2 && slow <= fast + fast / 2);
+
+    /* Un cercle plus petit, donc moins de courbe à suivre, garde moins de sommets */
+    CHECK(traceCircle(scene, 0.05, 5000, tolerance) <= 2 * tolerance);
+    small = (*scene)->points.nbPoints;
+    CHECK(small < fast);
+
+    return;
+}
+
+/* Une annulation enlève tout le trait, une reprise le remet en entier ; un trait vidé entre deux mouvements est abandonné */
+void testStrokeUndo(PrimitiveList* scene) {
+    SceneCopy drawn;
+    float tolerance = 2.0 / 400;
+
+    resetScene(scene);
+    traceCircle(scene, 0.3, 2000, tolerance);
+    copyScene(*scene, &drawn);
+    CHECK((*scene)->points.nbPoints > 10);
+    CHECK(undo(scene));
+    CHECK((*scene)->points.nbPoints == 0);
+    CHECK(redo(scene));
+    CHECK(sameScene(*scene, &drawn, 0));
+    freeSceneCopy(&drawn);
+
+    beginStroke(&(*scene)->points, allocPoint(0, 0, 0, 0, 0), tolerance);
+    CHECK(undo(scene));
+    addStrokePoint(allocPoint(0.5, 0.5, 0, 0, 0));
+    CHECK(stroke.list == NULL);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testStraight(&scene);
+    testCurvature(&scene);
+    testStrokeUndo(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("trait à main levée");
+}
@@ -0,0 +1,231 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "check.h"
+
+/* Lecteur SVG : éléments de tracé, courbes découpées à la tolérance près, et fichiers plus gros qu'une lecture */
+
+
+/************* CONSTANTES **************/
+
+
+/* Écart maximal entre une courbe et sa ligne brisée (SVG_TOLERANCE de scene.c) */
+#define TOLERANCE 0.05
+
+/* Polylignes du gros fichier : il dépasse une lecture du fil (1 Mo) et un lot (4096 primitives) */
+#define LARGE_POLYLINES 20000
+
+
+/************* VARIABLES ***************/
+
+
+/* Fichier temporaire des tests */
+static const char* svgPath;
+
+
+/************** FONCTIONS ***************/
+
+
+/* Lit le SVG text dans une scène qui ne contient qu'une primitive vide : renvoie 0 si la lecture n'a pas pu commencer */
+int ingestSvg(const char* text, PrimitiveList* scene) {
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    if(!writeText(svgPath, text)) {
+        return 0;
+    }
+
+    return ingestFile(svgPath, scene);
+}
+
+/* Plus petite distance de (x, y) à la ligne brisée de primitive */
+float polylineDistance(const Primitive* primitive, float x, float y) {
+    Point point = {x, y, 0, 0, 0};
+    float best = -1;
+    unsigned int i;
+
+    for(i = 0 ; i + 1 < primitive->points.nbPoints ; i++) {
+        float distance = segmentDistance(point, getPoint(&primitive->points, i), getPoint(&primitive->points, i + 1));
+        best = best < 0 || distance < best ? distance : best;
+    }
+
+    return best;
+}
+
+/* Lecteur SVG : polyligne, rectangle et tracé, l'axe y retourné et les couleurs lues */
+void testSvg(PrimitiveList* scene) {
+    static const float PATH[] = {0, 0, 5, -5, 10, 0};
+    static const float RECT[] = {1, -2, 4, -2, 4, -6, 1, -6};
+    static const float POLYLINE[] = {0, 0, 10, 0, 10, -10};
+    Primitive* primitive;
+    unsigned int i;
+
+    CHECK(ingestSvg("<?xml version=\"1.0\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"20\" height=\"20\">\n"
+        "  <polyline points=\"0,0 10,0 10,10\" stroke=\"red\" fill=\"none\"/>\n"
+        "  <rect x=\"1\" y=\"2\" width=\"3\" height=\"4\" style=\"fill:#00f\"/>\n"
+        "  <path d=\"M 0 0 L 5 5 l 5 -5\" stroke=\"rgb(0, 255, 0)\"/>\n"
+        "</svg>\n", scene));
+    CHECK(countPrimitives(*scene) == 4);
+
+    primitive = *scene;
+    CHECK(primitive->primitiveType == GL_LINE_STRIP && primitive->points.nbPoints == 3);
+    for(i = 0 ; i < 3 && i < primitive->points.nbPoints ; i++) {
+        Point point = getPoint(&primitive->points, i);
+        CHECK(point.x == PATH[2 * i] && point.y == PATH[2 * i + 1] && point.r == 0 && point.g == 255 && point.b == 0);
+    }
+    primitive = primitive->next;
+    CHECK(primitive->primitiveType == GL_LINE_LOOP && primitive->points.nbPoints == 4);
+    for(i = 0 ; i < 4 && i < primitive->points.nbPoints ; i++) {
+        Point point = getPoint(&primitive->points, i);
+        CHECK(point.x == RECT[2 * i] && point.y == RECT[2 * i + 1] && point.r == 0 && point.g == 0 && point.b == 255);
+    }
+    primitive = primitive->next;
+    CHECK(primitive->primitiveType == GL_LINE_STRIP && primitive->points.nbPoints == 3);
+    for(i = 0 ; i < 3 && i < primitive->points.nbPoints ; i++) {
+        Point point = getPoint(&primitive->points, i);
+        CHECK(point.x == POLYLINE[2 * i] && point.y == POLYLINE[2 * i + 1] && point.r == 255 && point.g == 0 && point.b == 0);
+    }
+
+    return;
+}
+
+/* Courbes : la ligne brisée passe à moins de TOLERANCE de chaque point de la vraie courbe, sans être découpée plus finement que nécessaire */
+void testCurves(PrimitiveList* scene) {
+    const Primitive* primitive;
+    unsigned int i;
+    int close = 1, round = 1;
+
+    /* Bézier cubique puis quadratique, de (0, 0) à (200, 0) */
+    CHECK(ingestSvg("<svg><path d=\"M 0 0 C 0 100 100 100 100 0 Q 150 -100 200 0\"/></svg>", scene));
+    primitive = *scene;
+    CHECK(countPrimitives(*scene) == 2 && primitive->primitiveType == GL_LINE_STRIP);
+    CHECK(primitive->points.nbPoints > 10 && primitive->points.nbPoints < 100);
+    for(i = 0 ; i <= 1000 ; i++) {
+        double t = i / 1000., u = 1 - t;
+        float cubicX = 3 * u * t * t * 100 + t * t * t * 100, cubicY = 3 * u * u * t * 100 + 3 * u * t * t * 100;
+        float quadX = u * u * 100 + 2 * u * t * 150 + t * t * 200, quadY = 2 * u * t * -100;
+        close &= polylineDistance(primitive, cubicX, -cubicY) <= TOLERANCE * 1.01;
+        close &= polylineDistance(primitive, quadX, -quadY) <= TOLERANCE * 1.01;
+    }
+    CHECK(close);
+    if(primitive->points.nbPoints > 0) {
+        Point last = getPoint(&primitive->points, primitive->points.nbPoints - 1);
+        CHECK(last.x == 200 && last.y == 0);
+    }
+
+    /* Arc de cercle et cercle : les sommets sont sur le cercle, et le milieu de chaque corde à moins de TOLERANCE */
+    CHECK(ingestSvg("<svg><path d=\"M 200 0 A 50 50 0 0 1 300 0\"/><circle cx=\"10\" cy=\"20\" r=\"30\"/></svg>", scene));
+    CHECK(countPrimitives(*scene) == 3 && (*scene)->primitiveType == GL_LINE_LOOP && (*scene)->next->primitiveType == GL_LINE_STRIP);
+    for(primitive = *scene ; primitive->next ; primitive = primitive->next) {
+        float centerX = primitive == *scene ? 10 : 250, centerY = primitive == *scene ? -20 : 0, radius = primitive == *scene ? 30 : 50;
+        unsigned int nbSegments = primitive->points.nbPoints - (primitive->primitiveType == GL_LINE_STRIP);
+        for(i = 0 ; i < primitive->points.nbPoints ; i++) {
+            Point a = getPoint(&primitive->points, i), b = getPoint(&primitive->points, (i + 1) % primitive->points.nbPoints);
+            round &= fabs(hypot(a.x - centerX, a.y - centerY) - radius) < 1e-3;
+            if(i < nbSegments) {
+                round &= radius - hypot((a.x + b.x) / 2 - centerX, (a.y + b.y) / 2 - centerY) <= TOLERANCE * 1.01;
+            }
+        }
+        /* Un découpage deux fois plus fin que nécessaire ferait des cordes à moins du quart de la tolérance */
+        round &= primitive->points.nbPoints > 3 && primitive->points.nbPoints < 2 * M_PI * radius / (2 * sqrt(2 * radius * TOLERANCE / 4));
+    }
+    CHECK(round);
+
+    return;
+}
+
+/* Autres éléments : commentaires et texte sautés, line consécutifs réunis, polygone et ellipse fermés, */
+/* commandes relatives, et un chemin qui s'arrête à sa première commande invalide */
+void testElements(PrimitiveList* scene) {
+    static const float RELATIVE[] = {10, -10, 15, -10, 15, -15, 10, -10};
+    const Primitive* primitive;
+    unsigned int i;
+
+    CHECK(ingestSvg("<svg><!-- <line x1=\"9\" y1=\"9\" x2=\"9\" y2=\"9\"/> -->du texte"
+        "<line x1=\"0\" y1=\"0\" x2=\"1\" y2=\"1\"/><line x1=\"2\" y1=\"2\" x2=\"3\" y2=\"3\"/>"
+        "<polygon points=\"0,0 4,0 4,4\"/><line x1=\"5\" y1=\"5\" x2=\"6\" y2=\"6\"/>"
+        "<ellipse cx=\"0\" cy=\"0\" rx=\"8\" ry=\"2\"/><path d=\"m 10 10 h 5 v 5 z\"/>"
+        "<path d=\"M 0 0 L 1 1 X 5 5 L 9 9\"/><g><text>pas un tracé</text></g></svg>", scene));
+    CHECK(countPrimitives(*scene) == 7);
+
+    primitive = *scene;
+    CHECK(primitive->primitiveType == GL_LINE_STRIP && primitive->points.nbPoints == 2);
+    primitive = primitive->next;
+    CHECK(primitive->primitiveType == GL_LINE_STRIP && primitive->points.nbPoints == 4);
+    for(i = 0 ; i < 4 && i < primitive->points.nbPoints ; i++) {
+        Point point = getPoint(&primitive->points, i);
+        CHECK(point.x == RELATIVE[2 * i] && point.y == RELATIVE[2 * i + 1]);
+    }
+    primitive = primitive->next;
+    CHECK(primitive->primitiveType == GL_LINE_LOOP && primitive->points.nbPoints > 8);
+    primitive = primitive->next;
+    CHECK(primitive->primitiveType == GL_LINES && primitive->points.nbPoints == 2);
+    primitive = primitive->next;
+    CHECK(primitive->primitiveType == GL_LINE_LOOP && primitive->points.nbPoints == 3);
+    primitive = primitive->next;
+    CHECK(primitive->primitiveType == GL_LINES && primitive->points.nbPoints == 4);
+    for(i = 0 ; i < 4 && i < primitive->points.nbPoints ; i++) {
+        Point point = getPoint(&primitive->points, i);
+        CHECK(point.x == i && point.y == -(float)i);
+    }
+
+    return;
+}
+
+/* Gros fichier : les balises à cheval sur deux lectures et les lots de primitives pleins ne perdent aucun point */
+void testLargeFile(PrimitiveList* scene) {
+    const Primitive* primitive;
+    FILE* file = fopen(svgPath, "w");
+    unsigned int i, k;
+    int exact = 1;
+
+    CHECK(file != NULL);
+    if(!file) {
+        return;
+    }
+    fprintf(file, "<svg>\n");
+    for(k = 0 ; k < LARGE_POLYLINES ; k++) {
+        fprintf(file, "  <polyline points=\"%u,0 %u,1 %u,2\" stroke=\"#102030\"/>\n", k, k + 1, k + 2);
+    }
+    fprintf(file, "</svg>\n");
+    CHECK(fclose(file) == 0);
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    CHECK(ingestFile(svgPath, scene));
+    CHECK(countPrimitives(*scene) == LARGE_POLYLINES + 1);
+    for(primitive = *scene, k = LARGE_POLYLINES ; primitive->next && k > 0 ; primitive = primitive->next) {
+        k--;
+        exact &= primitive->primitiveType == GL_LINE_STRIP && primitive->points.nbPoints == 3;
+        for(i = 0 ; i < 3 && i < primitive->points.nbPoints ; i++) {
+            Point point = getPoint(&primitive->points, i);
+            exact &= point.x == k + i && point.y == -(float)i && point.r == 0x10 && point.g == 0x20 && point.b == 0x30;
+        }
+    }
+    CHECK(exact && k == 0);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    svgPath = tempPath("svg");
+
+    testSvg(&scene);
+    testCurves(&scene);
+    testElements(&scene);
+    testLargeFile(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("lecteur SVG");
+}
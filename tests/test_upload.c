@@ -0,0 +1,197 @@
+#ifdef __APPLE__
+#include <openGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include "check.h"
+
+/* Envois vers les tampons : chaque modification ne marque à renvoyer que les points qu'elle a changés, */
+/* et les plages des réserves de sommets grandissent sur place ou déménagent sans rien perdre */
+
+
+/************* CONSTANTES **************/
+
+
+/* Points de la primitive des tests, tous les 0.001 sur l'axe x */
+#define NB_POINTS 1000
+
+
+/************** FONCTIONS ***************/
+
+
+/* Ce que uploadPoints retient après un envoi : tout est à jour, rien n'est modifié */
+void markUploaded(PointList* list) {
+
+    list->nbUploaded = list->nbPoints;
+    list->dirtyFirst = 0;
+    list->dirtyEnd = 0;
+
+    return;
+}
+
+/* 1 si les points [first, end[ sont les seuls modifiés parmi ceux déjà envoyés, et si nbUploaded points sont à jour */
+int isDirty(const PointList* list, unsigned int nbUploaded, unsigned int first, unsigned int end) {
+    return list->nbUploaded == nbUploaded && list->dirtyFirst == first && list->dirtyEnd == end;
+}
+
+/* Une primitive de NB_POINTS points de la palette, seule dans la scène */
+void buildLine(PrimitiveList* scene) {
+    unsigned int i;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_LINE_STRIP), scene);
+    journalAddPrimitive(*scene);
+    for(i = 0 ; i < NB_POINTS ; i++) {
+        addPointToList(allocPoint(i * 0.001, 0, COLORS[3], COLORS[4], COLORS[5]), &(*scene)->points);
+        journalAddPoint(&(*scene)->points, 1);
+    }
+
+    return;
+}
+
+/* Modifications sur place : une seule plage englobe tout ce qui a changé depuis le dernier envoi, */
+/* et ce qui touche la fin du tableau fait seulement reculer nbUploaded */
+void testTouch(PrimitiveList* scene) {
+    PointList* list;
+
+    buildLine(scene);
+    list = &(*scene)->points;
+    CHECK(isDirty(list, 0, 0, 0));
+    markUploaded(list);
+
+    recolorPoints(list, 100, 10, COLORS[0], COLORS[1], COLORS[2]);
+    CHECK(isDirty(list, NB_POINTS, 100, 110));
+    recolorPoints(list, 500, 5, COLORS[0], COLORS[1], COLORS[2]);
+    CHECK(isDirty(list, NB_POINTS, 100, 505));
+    transformPoints(list, 50, 10, 1, 0, 0, 1, 0.5, 0);
+    CHECK(isDirty(list, NB_POINTS, 50, 505));
+    transformPoints(list, 990, 10, 1, 0, 0, 1, 0.5, 0);
+    CHECK(isDirty(list, 990, 50, 505));
+
+    /* Des points ajoutés : seuls ceux d'après nbUploaded partiront */
+    addPointToList(allocPoint(0.5, 0.5, COLORS[3], COLORS[4], COLORS[5]), list);
+    CHECK(list->nbPoints == NB_POINTS + 1 && isDirty(list, 990, 50, 505));
+
+    /* Une modification après nbUploaded est déjà couverte par l'envoi de la fin */
+    markUploaded(list);
+    list->nbUploaded = 900;
+    touchPoints(list, 950, 960);
+    CHECK(isDirty(list, 900, 0, 0));
+
+    /* Tout le tableau change : tout repart */
+    markUploaded(list);
+    transformSelection(*scene, *scene, 1, 0, 0, 1, -0.5, 0);
+    CHECK(isDirty(list, 0, 0, 0));
+
+    return;
+}
+
+/* Points enlevés, remis, ajoutés puis annulés, et passage au format compact */
+void testEdits(PrimitiveList* scene) {
+    PointList* list;
+
+    /* La gomme enlève les points 298 à 302 : ceux d'avant n'ont pas bougé, les suivants sont décalés */
+    buildLine(scene);
+    list = &(*scene)->points;
+    markUploaded(list);
+    CHECK(erasePoints(*scene, 0.3, 0, 0.0025) == 5);
+    CHECK(list->nbPoints == NB_POINTS - 5 && isDirty(list, 298, 0, 0));
+
+    /* L'annulation remet les points à leur place : le tableau repart du premier */
+    markUploaded(list);
+    CHECK(undo(scene));
+    CHECK(list->nbPoints == NB_POINTS && isDirty(list, 298, 0, 0));
+
+    /* Des points ajoutés puis annulés : ceux qui restent sont à jour, rien n'est renvoyé */
+    addPointToList(allocPoint(0.7, 0.7, COLORS[3], COLORS[4], COLORS[5]), list);
+    journalAddPoint(list, 0);
+    addPointToList(allocPoint(0.8, 0.8, COLORS[3], COLORS[4], COLORS[5]), list);
+    journalAddPoint(list, 1);
+    markUploaded(list);
+    CHECK(undo(scene));
+    CHECK(list->nbPoints == NB_POINTS && isDirty(list, NB_POINTS, 0, 0));
+
+    /* Le format compact décale les positions de tout le tableau */
+    compactPrimitives(*scene);
+    CHECK(list->quantized != NULL && isDirty(list, 0, 0, 0));
+
+    return;
+}
+
+/* Plages des réserves : prises avec de la marge, la dernière grandit sur place, les autres déménagent au bout de la réserve */
+/* (tout est à renvoyer), et une réserve agrandie sans copie par le pilote renvoie tous ses propriétaires */
+void testRanges(PrimitiveList* scene) {
+    PointList *a, *b, *c;
+    unsigned int i;
+
+    resetScene(scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    addPrimitive(allocPrimitive(GL_POINTS), scene);
+    a = &(*scene)->points;
+    b = &(*scene)->next->points;
+    c = &(*scene)->next->next->points;
+    for(i = 0 ; i < 100 ; i++) {
+        addPointToList(allocPoint(i * 0.001, 0, 0, 0, 0), a);
+        addPointToList(allocPoint(i * 0.001, 0.1, 0, 0, 0), b);
+    }
+
+    /* La moitié en plus, puis sur place tant que la plage est la dernière */
+    reserveVertexRange(a, GL_POINTS);
+    CHECK(a->poolFirst == 0 && a->poolCapacity == 150 && a->nbUploaded == 0);
+    markUploaded(a);
+    for(i = 0 ; i < 100 ; i++) {
+        addPointToList(allocPoint(0.2, 0.2, 0, 0, 0), a);
+    }
+    reserveVertexRange(a, GL_POINTS);
+    CHECK(a->poolFirst == 0 && a->poolCapacity == 300 && a->nbUploaded == 100);
+
+    /* Une plage qui n'est plus la dernière déménage : sa place est perdue jusqu'au prochain tassement */
+    reserveVertexRange(b, GL_POINTS);
+    CHECK(b->poolFirst == 300 && b->poolCapacity == 150);
+    markUploaded(a);
+    markUploaded(b);
+    for(i = 0 ; i < 200 ; i++) {
+        addPointToList(allocPoint(0.3, 0.3, 0, 0, 0), a);
+    }
+    reserveVertexRange(a, GL_POINTS);
+    CHECK(a->poolFirst == 450 && a->poolCapacity == 600 && a->nbUploaded == 0 && b->nbUploaded == 100);
+
+    /* Une plage trop grande pour la réserve (4096 sommets) la fait doubler : sans tampon à copier, tout est à renvoyer */
+    markUploaded(a);
+    for(i = 0 ; i < 3000 ; i++) {
+        addPointToList(allocPoint(0.4, 0.4, 0, 0, 0), c);
+    }
+    reserveVertexRange(c, GL_POINTS);
+    CHECK(c->poolFirst == 1050 && c->poolCapacity == 4500 && a->nbUploaded == 0 && b->nbUploaded == 0);
+
+    /* La dernière plage rendue est reprise tout de suite */
+    releaseVertexRange(c);
+    CHECK(c->poolCapacity == 0);
+    reserveVertexRange(c, GL_POINTS);
+    CHECK(c->poolFirst == 1050);
+
+    /* Les primitives supprimées rendent leurs plages */
+    deletePoints(c);
+    deletePoints(a);
+    CHECK(a->poolCapacity == 0 && c->poolCapacity == 0 && b->poolFirst == 300);
+
+    return;
+}
+
+int main(int argc, char** argv) {
+    PrimitiveList scene = NULL;
+
+    (void)argc;
+    (void)argv;
+    testTouch(&scene);
+    testEdits(&scene);
+    testRanges(&scene);
+
+    resetScene(&scene);
+    freeArena(&sceneArena);
+
+    return finishChecks("envois vers les tampons");
+}